@@ -0,0 +1,694 @@
+// Headless microbenchmarks of the math, mesh and scene graph libraries (no GLFW/GL needed).
+//
+// Build on Linux (from the repository root):
+//   g++ -std=c++14 -O2 -DMESH_NO_CACHE_LOG -Iinclude -Isrc -o ibr_benchmark benchmark/benchmark.cpp src/mesh.cpp
+//       src/maths_batch.cpp src/maths_fast.cpp src/maths_frustum.cpp src/scene_graph.cpp src/jobs.cpp externals/tiny_obj_loader.cpp -pthread
+// On Windows, build benchmark/benchmark.vcxproj (part of ibr.sln).
+//
+// Usage: ibr_benchmark [--json <file>] [--runs <n>] [--filter <substring>] [--quick]
+// Each benchmark runs over increasing input sizes, every size is timed --runs times
+// and reported as ns/op (median, min, max, stddev), ops/s and run-to-run variation.
+// The Math::Fast accuracy contracts are also checked, the exit code is 1 if one is broken.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "maths.h"
+#include "maths_batch.h"
+#include "maths_fast.h"
+#include "maths_frustum.h"
+#include "mesh.h"
+#include "scene_graph.h"
+
+struct benchmark_options
+{
+    const char* JsonFile = nullptr;
+    const char* Filter = nullptr;
+    int Runs = 7;
+    double TargetRunMs = 25.0;
+};
+
+struct benchmark_result
+{
+    std::string Name;
+    int Size;
+    double OpsPerIteration;
+    int IterationsPerRun;
+    std::vector<double> NsPerOp; // One value per run
+
+    double Median, Mean, Min, Max, StdDev;
+};
+
+struct accuracy_result
+{
+    std::string Name;
+    std::string Domain;
+    double MaxError;
+    double Bound;
+};
+
+static benchmark_options gOptions;
+static std::vector<benchmark_result> gResults;
+static std::vector<accuracy_result> gAccuracy;
+
+// Results are folded in here so the optimizer cannot drop the timed work
+static volatile float gSink = 0.f;
+
+static double NowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+// Time Function (doing OpsPerIteration operations per call) and record its statistics
+static void Run(const char* Name, int Size, double OpsPerIteration, const std::function<void()>& Function)
+{
+    if (gOptions.Filter && strstr(Name, gOptions.Filter) == nullptr)
+        return;
+
+    // Warm up caches and calibrate the number of iterations of one run
+    double Start = NowMs();
+    Function();
+    double Elapsed = Math::Max(NowMs() - Start, 1e-4);
+    int Iterations = Math::Max(1, (int)(gOptions.TargetRunMs / Elapsed));
+
+    benchmark_result Result;
+    Result.Name = Name;
+    Result.Size = Size;
+    Result.OpsPerIteration = OpsPerIteration;
+    Result.IterationsPerRun = Iterations;
+
+    for (int r = 0; r < gOptions.Runs; ++r)
+    {
+        Start = NowMs();
+        for (int i = 0; i < Iterations; ++i)
+            Function();
+        Elapsed = NowMs() - Start;
+        Result.NsPerOp.push_back(Elapsed * 1e6 / (Iterations * OpsPerIteration));
+    }
+
+    std::vector<double> Sorted = Result.NsPerOp;
+    std::sort(Sorted.begin(), Sorted.end());
+    Result.Median = Sorted[Sorted.size() / 2];
+    Result.Min = Sorted.front();
+    Result.Max = Sorted.back();
+
+    Result.Mean = 0.0;
+    for (double V : Sorted)
+        Result.Mean += V;
+    Result.Mean /= Sorted.size();
+
+    Result.StdDev = 0.0;
+    for (double V : Sorted)
+        Result.StdDev += (V - Result.Mean) * (V - Result.Mean);
+    Result.StdDev = std::sqrt(Result.StdDev / Sorted.size());
+
+    printf("%-28s %9d %12.2f %12.2f %12.2f %7.2f%% %14.0f\n", Name, Size, Result.Median, Result.Min, Result.Max,
+        100.0 * Result.StdDev / Result.Mean, 1e9 / Result.Median);
+    fflush(stdout);
+
+    gResults.push_back(Result);
+}
+
+static std::mt19937 gRandom(1234);
+
+static float RandomFloat(float Min, float Max)
+{
+    return std::uniform_real_distribution<float>(Min, Max)(gRandom);
+}
+
+static mat4 RandomTransform()
+{
+    return Mat4::Translate({ RandomFloat(-10.f, 10.f), RandomFloat(-10.f, 10.f), RandomFloat(-10.f, 10.f) })
+        * Mat4::RotateY(RandomFloat(-3.f, 3.f)) * Mat4::RotateX(RandomFloat(-3.f, 3.f))
+        * Mat4::Scale({ RandomFloat(0.5f, 2.f), RandomFloat(0.5f, 2.f), RandomFloat(0.5f, 2.f) });
+}
+
+static vertex_descriptor FullVertexDescriptor()
+{
+    vertex_descriptor Descriptor = {};
+    Descriptor.Stride = sizeof(vertex_full);
+    Descriptor.PositionOffset = offsetof(vertex_full, Position);
+    Descriptor.HasNormal = true;
+    Descriptor.NormalOffset = offsetof(vertex_full, Normal);
+    Descriptor.HasUV = true;
+    Descriptor.UVOffset = offsetof(vertex_full, UV);
+    Descriptor.TangentOffset = offsetof(vertex_full, Tangents);
+    Descriptor.BitangentOffset = offsetof(vertex_full, Bitangents);
+    return Descriptor;
+}
+
+// Triangulated Size x Size grid with unique UVs, as non-indexed triangles
+static std::vector<vertex_full> BuildGrid(int Size)
+{
+    std::vector<vertex_full> Mesh;
+    for (int y = 0; y < Size; ++y)
+    {
+        for (int x = 0; x < Size; ++x)
+        {
+            vertex_full Corners[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                float U = (float)(x + (i & 1)) / Size;
+                float V = (float)(y + (i >> 1)) / Size;
+                Corners[i].Position = { U * 10.f, RandomFloat(0.f, 0.1f), V * 10.f };
+                Corners[i].UV = { U, V };
+            }
+            Mesh.push_back(Corners[0]); Mesh.push_back(Corners[1]); Mesh.push_back(Corners[2]);
+            Mesh.push_back(Corners[2]); Mesh.push_back(Corners[1]); Mesh.push_back(Corners[3]);
+        }
+    }
+    return Mesh;
+}
+
+static void WriteGridObj(const char* Filename, int Size)
+{
+    FILE* File = fopen(Filename, "w");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write '%s'\n", Filename);
+        return;
+    }
+
+    for (int y = 0; y <= Size; ++y)
+    {
+        for (int x = 0; x <= Size; ++x)
+        {
+            float U = (float)x / Size;
+            float V = (float)y / Size;
+            fprintf(File, "v %f %f %f\nvt %f %f\nvn 0 1 0\n", U * 10.f, RandomFloat(0.f, 0.1f), V * 10.f, U, V);
+        }
+    }
+
+    for (int y = 0; y < Size; ++y)
+    {
+        for (int x = 0; x < Size; ++x)
+        {
+            int I0 = 1 + y * (Size + 1) + x;
+            int I1 = I0 + 1;
+            int I2 = I0 + (Size + 1);
+            int I3 = I2 + 1;
+            fprintf(File, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", I0, I0, I0, I1, I1, I1, I2, I2, I2);
+            fprintf(File, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", I2, I2, I2, I1, I1, I1, I3, I3, I3);
+        }
+    }
+    fclose(File);
+}
+
+// ========================================================================
+// BENCHMARKS
+// ========================================================================
+
+static void BenchmarkMat4()
+{
+    for (int Count : { 64, 4096, 262144 })
+    {
+        std::vector<mat4> A(Count), B(Count), R(Count);
+        std::vector<v4> V(Count), W(Count);
+        for (int i = 0; i < Count; ++i)
+        {
+            V[i] = { RandomFloat(-10.f, 10.f), RandomFloat(-10.f, 10.f), RandomFloat(-10.f, 10.f), 1.f };
+            A[i] = RandomTransform();
+            B[i] = RandomTransform();
+        }
+
+        Run("mat4_multiply", Count, Count, [&]() {
+            for (int i = 0; i < Count; ++i)
+                R[i] = A[i] * B[i];
+            gSink = gSink + R[Count - 1].e[0];
+        });
+
+        Run("mat4_inverse", Count, Count, [&]() {
+            for (int i = 0; i < Count; ++i)
+                R[i] = Mat4::Inverse(A[i]);
+            gSink = gSink + R[Count - 1].e[0];
+        });
+
+        // Whole vectors are stored, otherwise the scalar path only computes the component read
+        Run("mat4_transform_v4", Count, Count, [&]() {
+            for (int i = 0; i < Count; ++i)
+                V[i] = A[i] * v4{ 1.f, 2.f, 3.f, 1.f };
+            gSink = gSink + V[Count - 1].w;
+        });
+
+        // One matrix over an array (vertices, bounds corners)
+        Run("mat4_transform_v4_array", Count, Count, [&]() {
+            Mat4::TransformV4s(A[0], V.data(), W.data(), Count);
+            gSink = gSink + W[Count - 1].w;
+        });
+    }
+}
+
+static void BenchmarkBatch()
+{
+    for (int Count : { 1024, 16384, 131072 })
+    {
+        int BlockCount = Batch::GetBlockCount(Count);
+        std::vector<aabb_block> Boxes(BlockCount), Transformed(BlockCount);
+        std::vector<sphere_block> Spheres(BlockCount);
+        std::vector<uint8_t> Masks(BlockCount);
+        for (int i = 0; i < BlockCount * MATHS_BATCH_LANES; ++i)
+        {
+            v3 Center = { RandomFloat(-50.f, 50.f), RandomFloat(-50.f, 50.f), RandomFloat(-50.f, 50.f) };
+            Batch::SetAABB(Boxes.data(), i, Center - 1.f, Center + 1.f);
+        }
+
+        mat4 M = RandomTransform();
+        frustum F = Frustum::FromMatrix(Mat4::Perspective(1.f, 16.f / 9.f, 0.1f, 100.f) * Mat4::LookAt({ 0.f, 5.f, 20.f }, Vec3::Zero()));
+
+        Run("batch_transform_aabbs", Count, Count, [&]() {
+            Batch::TransformAABBs(M, Boxes.data(), Transformed.data(), BlockCount);
+            gSink = gSink + Transformed[0].MinX[0];
+        });
+
+        Run("batch_bounding_spheres", Count, Count, [&]() {
+            Batch::ComputeBoundingSpheres(Boxes.data(), Spheres.data(), BlockCount);
+            gSink = gSink + Spheres[0].Radius[0];
+        });
+
+        Run("frustum_test_aabbs", Count, Count, [&]() {
+            Frustum::TestAABBs(F, Boxes.data(), BlockCount, Masks.data(), FRUSTUM_TEST_CORNERS);
+            gSink = gSink + Masks[0];
+        });
+
+        Run("frustum_test_aabbs_exact", Count, Count, [&]() {
+            Frustum::TestAABBs(F, Boxes.data(), BlockCount, Masks.data(), FRUSTUM_TEST_EXACT);
+            gSink = gSink + Masks[0];
+        });
+    }
+}
+
+static void BenchmarkMesh()
+{
+    vertex_descriptor Descriptor = FullVertexDescriptor();
+
+    for (int Count : { 1024, 16384, 262144 })
+    {
+        std::vector<vertex_full> Vertices(Count);
+        mat4 M = RandomTransform();
+        Run("mesh_transform", Count, Count, [&]() {
+            Mesh::Transform(Vertices.data(), Vertices.data() + Count, Descriptor, M);
+            gSink = gSink + Vertices[0].Position.x;
+        });
+    }
+
+    for (int Segments : { 16, 64, 256 })
+    {
+        int Count = Segments * Segments * 6;
+        std::vector<vertex_full> Vertices(Count);
+        Run("mesh_build_sphere", Count, Count, [&]() {
+            Mesh::BuildSphere(Vertices.data(), Vertices.data() + Count, Descriptor, Segments, Segments);
+            gSink = gSink + Vertices[Count - 1].Position.y;
+        });
+    }
+
+    // Every vertex is searched among the already known ones, sizes kept small
+    for (int GridSize : { 8, 16, 32 })
+    {
+        std::vector<vertex_full> Source = BuildGrid(GridSize);
+        std::vector<vertex_full> Mesh;
+        Run("mesh_tangent_basis", (int)Source.size(), (double)Source.size(), [&]() {
+            Mesh = Source;
+            Mesh::ComputeTangentBasis(Mesh);
+            gSink = gSink + Mesh[0].Tangents.x;
+        });
+    }
+
+    for (int GridSize : { 8, 16, 32 })
+    {
+        char Filename[64];
+        snprintf(Filename, sizeof(Filename), "benchmark_grid_%d.obj", GridSize);
+        std::string CacheFilename = std::string(Filename) + ".cache";
+        WriteGridObj(Filename, GridSize);
+
+        int VertexCount = GridSize * GridSize * 6;
+        std::vector<vertex_full> Mesh;
+
+        // Parse + tangent basis + cache write
+        Run("obj_load_uncached", VertexCount, VertexCount, [&]() {
+            remove(CacheFilename.c_str());
+            Mesh.clear();
+            Mesh::LoadObjNoConvertion(Mesh, Filename, 1.f);
+            gSink = gSink + (float)Mesh.size();
+        });
+
+        // .cache read only
+        Run("obj_load_cached", VertexCount, VertexCount, [&]() {
+            Mesh.clear();
+            Mesh::LoadObjNoConvertion(Mesh, Filename, 1.f);
+            gSink = gSink + (float)Mesh.size();
+        });
+
+        remove(CacheFilename.c_str());
+        remove(Filename);
+    }
+}
+
+static transform RandomLocalTransform()
+{
+    v3 Axis = Vec3::Normalize({ RandomFloat(-1.f, 1.f), RandomFloat(-1.f, 1.f), RandomFloat(-1.f, 1.f) });
+    return { Quat::AxisAngle(Axis, RandomFloat(-3.f, 3.f)), { RandomFloat(-5.f, 5.f), 0.f, RandomFloat(-5.f, 5.f) }, Vec3::One() };
+}
+
+static void BenchmarkSceneGraph()
+{
+    // Roots with 10 children of 10 children each (111 nodes per root)
+    for (int RootCount : { 100, 1000 })
+    {
+        scene_graph Graph;
+        std::vector<scene_node> Roots;
+        std::vector<scene_node> Nodes;
+        for (int r = 0; r < RootCount; ++r)
+        {
+            scene_node Root = Graph.CreateNode(SCENE_NODE_NONE, RandomLocalTransform());
+            Roots.push_back(Root);
+            Nodes.push_back(Root);
+            for (int c = 0; c < 10; ++c)
+            {
+                scene_node Child = Graph.CreateNode(Root, RandomLocalTransform());
+                Nodes.push_back(Child);
+                for (int l = 0; l < 10; ++l)
+                    Nodes.push_back(Graph.CreateNode(Child, RandomLocalTransform()));
+            }
+        }
+        Graph.Update();
+
+        int Count = Graph.GetNodeCount();
+        Run("scene_graph_update_all", Count, Count, [&]() {
+            for (scene_node Root : Roots)
+                Graph.SetLocalTranslation(Root, { RandomFloat(-5.f, 5.f), 0.f, 0.f });
+            Graph.Update();
+            gSink = gSink + Graph.GetWorldMatrices()[Count - 1].e[12];
+        });
+
+        // Ops are the touched nodes, their subtrees are updated too
+        int Touched = Count / 100;
+        Run("scene_graph_update_1pct", Count, Touched, [&]() {
+            for (int i = 0; i < Touched; ++i)
+                Graph.SetLocalTranslation(Nodes[gRandom() % Count], { RandomFloat(-5.f, 5.f), 0.f, 0.f });
+            Graph.Update();
+            gSink = gSink + Graph.GetWorldMatrices()[Count - 1].e[12];
+        });
+
+        Run("scene_graph_reparent", Count, 1, [&]() {
+            // Any node but the roots, moved between the first and last root
+            scene_node Node = Nodes[1 + gRandom() % (Count - 1)];
+            if (Graph.GetParent(Node) == SCENE_NODE_NONE)
+                return;
+            Graph.SetParent(Node, Graph.GetParent(Node) == Roots[0] ? Roots.back() : Roots[0]);
+            Graph.Update();
+            gSink = gSink + Graph.GetWorldMatrices()[0].e[12];
+        });
+
+        // Only the range between the two roots is rotated
+        Run("scene_graph_reparent_local", Count, 1, [&]() {
+            // Any child of the root in the middle, moved to its neighbour and back
+            scene_node Node = Nodes[(RootCount / 2) * 111 + 1 + (gRandom() % 10) * 11];
+            scene_node Root = Roots[RootCount / 2];
+            Graph.SetParent(Node, Graph.GetParent(Node) == Root ? Roots[RootCount / 2 + 1] : Root);
+            Graph.Update();
+            gSink = gSink + Graph.GetWorldMatrices()[0].e[12];
+        });
+    }
+}
+
+static void BenchmarkFastMath()
+{
+    const int Count = 4096;
+    std::vector<float> X(Count), Y(Count), Positive(Count), R0(Count), R1(Count);
+    for (int i = 0; i < Count; ++i)
+    {
+        X[i] = RandomFloat(-10.f, 10.f);
+        Y[i] = RandomFloat(-10.f, 10.f);
+        Positive[i] = RandomFloat(1e-3f, 1e3f);
+    }
+
+    Run("std_sincos", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) { R0[i] = std::sin(X[i]); R1[i] = std::cos(X[i]); }
+        gSink = gSink + R0[0] + R1[0];
+    });
+    Run("fast_sincos", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) Math::Fast::SinCos(X[i], &R0[i], &R1[i]);
+        gSink = gSink + R0[0] + R1[0];
+    });
+    Run("fast_sincos_batch", Count, Count, [&]() {
+        Math::Fast::SinCos(X.data(), R0.data(), R1.data(), Count);
+        gSink = gSink + R0[0] + R1[0];
+    });
+
+    Run("std_atan2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = std::atan2(Y[i], X[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_atan2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = Math::Fast::Atan2(Y[i], X[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_atan2_batch", Count, Count, [&]() {
+        Math::Fast::Atan2(Y.data(), X.data(), R0.data(), Count);
+        gSink = gSink + R0[0];
+    });
+
+    Run("std_rsqrt", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = 1.f / std::sqrt(Positive[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_rsqrt", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = Math::Fast::Rsqrt(Positive[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_rsqrt_batch", Count, Count, [&]() {
+        Math::Fast::Rsqrt(Positive.data(), R0.data(), Count);
+        gSink = gSink + R0[0];
+    });
+
+    Run("std_exp2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = std::exp2(X[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_exp2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = Math::Fast::Exp2(X[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_exp2_batch", Count, Count, [&]() {
+        Math::Fast::Exp2(X.data(), R0.data(), Count);
+        gSink = gSink + R0[0];
+    });
+
+    Run("std_log2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = std::log2(Positive[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_log2", Count, Count, [&]() {
+        for (int i = 0; i < Count; ++i) R0[i] = Math::Fast::Log2(Positive[i]);
+        gSink = gSink + R0[0];
+    });
+    Run("fast_log2_batch", Count, Count, [&]() {
+        Math::Fast::Log2(Positive.data(), R0.data(), Count);
+        gSink = gSink + R0[0];
+    });
+}
+
+// ========================================================================
+// ACCURACY CONTRACTS OF MATH::FAST
+// ========================================================================
+
+// Sweep Count samples (chunked) through the scalar and the batch versions
+static void CheckAccuracy(const char* Name, const char* Domain, double Bound, int Count,
+    const std::function<float(int)>& Input, const std::function<void(const float*, float*, int)>& Fast, const std::function<double(float, float)>& Error)
+{
+    const int ChunkSize = 4096;
+    std::vector<float> In(ChunkSize), Out(ChunkSize);
+    double MaxError = 0.0;
+    for (int Start = 0; Start < Count; Start += ChunkSize)
+    {
+        int Size = Math::Min(ChunkSize, Count - Start);
+        for (int i = 0; i < Size; ++i)
+            In[i] = Input(Start + i);
+
+        Fast(In.data(), Out.data(), Size);
+        for (int i = 0; i < Size; ++i)
+            MaxError = Math::Max(MaxError, Error(In[i], Out[i]));
+    }
+
+    printf("%-28s %-40s %12.3e %12.3e %s\n", Name, Domain, MaxError, Bound, MaxError <= Bound ? "ok" : "FAILED");
+    gAccuracy.push_back({ Name, Domain, MaxError, Bound });
+}
+
+static float BitsToFloat(uint32_t Bits) { return Math::Fast::AsFloat(Bits); }
+
+static void CheckFastMathAccuracy(int Count)
+{
+    // Positive normal floats, evenly spread over the bit patterns (so over the exponents)
+    auto PositiveNormal = [Count](int i) { return BitsToFloat(0x00800000u + (uint32_t)((double)i / Count * (0x7F7FFFFFu - 0x00800000u))); };
+    auto Linear = [Count](double Min, double Max) { return [=](int i) { return (float)(Min + (Max - Min) * i / (Count - 1)); }; };
+
+    for (int Batch = 0; Batch < 2; ++Batch)
+    {
+        bool UseBatch = Batch == 1;
+        auto Apply = [UseBatch](float (*Scalar)(float), void (*Vector)(const float*, float*, int)) {
+            return [=](const float* In, float* Out, int Size) {
+                if (UseBatch)
+                    Vector(In, Out, Size);
+                else
+                    for (int i = 0; i < Size; ++i) Out[i] = Scalar(In[i]);
+            };
+        };
+
+        auto SinCos = [UseBatch](bool Sin) {
+            return [=](const float* In, float* Out, int Size) {
+                std::vector<float> S(Size), C(Size);
+                if (UseBatch)
+                    Math::Fast::SinCos(In, S.data(), C.data(), Size);
+                else
+                    for (int i = 0; i < Size; ++i) Math::Fast::SinCos(In[i], &S[i], &C[i]);
+                memcpy(Out, Sin ? S.data() : C.data(), Size * sizeof(float));
+            };
+        };
+
+        CheckAccuracy(UseBatch ? "sin_batch" : "sin", "|x| <= 8192, abs", 1e-7, Count, Linear(-8192.0, 8192.0), SinCos(true),
+            [](float X, float R) { return std::fabs(R - std::sin((double)X)); });
+        CheckAccuracy(UseBatch ? "cos_batch" : "cos", "|x| <= 8192, abs", 1e-7, Count, Linear(-8192.0, 8192.0), SinCos(false),
+            [](float X, float R) { return std::fabs(R - std::cos((double)X)); });
+        CheckAccuracy(UseBatch ? "sin_wide_batch" : "sin_wide", "|x| <= 65536, abs", 1e-6, Count, Linear(-65536.0, 65536.0), SinCos(true),
+            [](float X, float R) { return std::fabs(R - std::sin((double)X)); });
+
+        // Angle sweep on circles of several radii
+        auto Atan2 = [UseBatch, Count](const float* In, float* Out, int Size) {
+            std::vector<float> X(Size), Y(Size);
+            for (int i = 0; i < Size; ++i)
+            {
+                float Radius = 1e-3f + 1e3f * std::fabs(In[i]);
+                float Angle = In[i] * Math::Pi();
+                X[i] = Radius * std::cos(Angle * 7.f);
+                Y[i] = Radius * std::sin(Angle * 7.f);
+            }
+            if (UseBatch)
+                Math::Fast::Atan2(Y.data(), X.data(), Out, Size);
+            else
+                for (int i = 0; i < Size; ++i) Out[i] = Math::Fast::Atan2(Y[i], X[i]);
+        };
+        CheckAccuracy(UseBatch ? "atan2_batch" : "atan2", "all angles, abs radians", 2e-6, Count, Linear(-1.0, 1.0), Atan2,
+            [](float T, float R) {
+                float Radius = 1e-3f + 1e3f * std::fabs(T);
+                float Angle = T * Math::Pi();
+                float X = Radius * std::cos(Angle * 7.f);
+                float Y = Radius * std::sin(Angle * 7.f);
+                return std::fabs(R - std::atan2((double)Y, (double)X));
+            });
+
+        CheckAccuracy(UseBatch ? "rsqrt_batch" : "rsqrt", "positive normal floats, rel", 3e-7, Count, PositiveNormal,
+            Apply(&Math::Fast::Rsqrt, &Math::Fast::Rsqrt),
+            [](float X, float R) { double Ref = 1.0 / std::sqrt((double)X); return std::fabs(R - Ref) / Ref; });
+
+        CheckAccuracy(UseBatch ? "exp2_batch" : "exp2", "[-126, 127], rel", 2.5e-7, Count, Linear(-126.0, 127.0),
+            Apply(&Math::Fast::Exp2, &Math::Fast::Exp2),
+            [](float X, float R) { double Ref = std::exp2((double)X); return std::fabs(R - Ref) / Ref; });
+
+        CheckAccuracy(UseBatch ? "log2_batch" : "log2", "positive normal floats, /max(1,|y|)", 1.2e-7, Count, PositiveNormal,
+            Apply(&Math::Fast::Log2, &Math::Fast::Log2),
+            [](float X, float R) { double Ref = std::log2((double)X); return std::fabs(R - Ref) / Math::Max(1.0, std::fabs(Ref)); });
+    }
+}
+
+// ========================================================================
+// JSON OUTPUT
+// ========================================================================
+
+static void WriteJson(const char* Filename)
+{
+    FILE* File = fopen(Filename, "w");
+    if (File == nullptr)
+    {
+        fprintf(stderr, "Cannot write '%s'\n", Filename);
+        return;
+    }
+
+    fprintf(File, "{\n");
+    fprintf(File, "  \"backend\": \"%s\",\n", Batch::GetBackendName());
+    fprintf(File, "  \"runs\": %d,\n", gOptions.Runs);
+    fprintf(File, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < gResults.size(); ++i)
+    {
+        const benchmark_result& R = gResults[i];
+        fprintf(File, "    { \"name\": \"%s\", \"size\": %d, \"iterations_per_run\": %d, ", R.Name.c_str(), R.Size, R.IterationsPerRun);
+        fprintf(File, "\"ns_per_op\": { \"median\": %.4f, \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f, \"stddev\": %.4f }, ",
+            R.Median, R.Mean, R.Min, R.Max, R.StdDev);
+        fprintf(File, "\"ops_per_second\": %.1f, \"runs_ns_per_op\": [", 1e9 / R.Median);
+        for (size_t r = 0; r < R.NsPerOp.size(); ++r)
+            fprintf(File, "%s%.4f", r ? ", " : "", R.NsPerOp[r]);
+        fprintf(File, "] }%s\n", i + 1 < gResults.size() ? "," : "");
+    }
+    fprintf(File, "  ],\n");
+
+    fprintf(File, "  \"accuracy\": [\n");
+    for (size_t i = 0; i < gAccuracy.size(); ++i)
+    {
+        const accuracy_result& A = gAccuracy[i];
+        fprintf(File, "    { \"name\": \"%s\", \"domain\": \"%s\", \"max_error\": %.4e, \"bound\": %.4e, \"pass\": %s }%s\n",
+            A.Name.c_str(), A.Domain.c_str(), A.MaxError, A.Bound, A.MaxError <= A.Bound ? "true" : "false", i + 1 < gAccuracy.size() ? "," : "");
+    }
+    fprintf(File, "  ]\n");
+    fprintf(File, "}\n");
+    fclose(File);
+
+    printf("Results written to '%s'\n", Filename);
+}
+
+int main(int argc, char* argv[])
+{
+    bool Quick = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            gOptions.JsonFile = argv[++i];
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            gOptions.Runs = Math::Max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            gOptions.Filter = argv[++i];
+        else if (strcmp(argv[i], "--quick") == 0)
+            Quick = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--json <file>] [--runs <n>] [--filter <substring>] [--quick]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (Quick)
+    {
+        gOptions.Runs = Math::Min(gOptions.Runs, 3);
+        gOptions.TargetRunMs = 5.0;
+    }
+
+    printf("Backend: %s, %d runs per size\n\n", Batch::GetBackendName(), gOptions.Runs);
+    printf("%-28s %9s %12s %12s %12s %8s %14s\n", "benchmark", "size", "median ns/op", "min ns/op", "max ns/op", "stddev", "ops/s");
+
+    BenchmarkMat4();
+    BenchmarkBatch();
+    BenchmarkMesh();
+    BenchmarkSceneGraph();
+    BenchmarkFastMath();
+
+    printf("\n%-28s %-40s %12s %12s\n", "function", "domain", "max error", "bound");
+    CheckFastMathAccuracy(Quick ? 1 << 20 : 1 << 24);
+
+    if (gOptions.JsonFile)
+        WriteJson(gOptions.JsonFile);
+
+    for (const accuracy_result& A : gAccuracy)
+    {
+        if (A.MaxError > A.Bound)
+            return 1;
+    }
+    return 0;
+}
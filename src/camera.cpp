@@ -97,22 +97,20 @@ camera CameraUpdateFreefly(const camera& PreviousCamera, const camera_inputs& In
     return Camera;
 }
 
+transform CameraGetTransform(const camera& Camera)
+{
+    // Mat4::RotateY turns the opposite way of the quaternion convention, hence -Yaw
+    quat Rotation = Quat::AxisAngle(Vec3::Y(), -Camera.Yaw) * Quat::AxisAngle(Vec3::X(), Camera.Pitch);
+    return { Rotation, Camera.Position, Vec3::One() };
+}
+
 mat4 CameraGetMatrix(const camera& Camera)
 {
-    // We know how to compute the inverse of the camera
-    mat4 CameraTransform = Mat4::Identity();
-    CameraTransform *= Mat4::Translate(Camera.Position);
-    CameraTransform *= Mat4::RotateY(Camera.Yaw);
-    CameraTransform *= Mat4::RotateX(Camera.Pitch);
-    return CameraTransform;
+    return Transform::ToMat4(CameraGetTransform(Camera));
 }
 
 mat4 CameraGetInverseMatrix(const camera& Camera)
 {
-    // We know how to compute the inverse of the camera
-    mat4 ViewTransform = Mat4::Identity();
-    ViewTransform *= Mat4::RotateX(-Camera.Pitch);
-    ViewTransform *= Mat4::RotateY(-Camera.Yaw);
-    ViewTransform *= Mat4::Translate(-Camera.Position);
-    return ViewTransform;
+    // Closed form from the rotation/translation parts, no matrix products
+    return Transform::ToInverseMat4(CameraGetTransform(Camera));
 }
\ No newline at end of file
@@ -33,5 +33,6 @@ struct camera_inputs
 
 camera CameraUpdateFPS(const camera& PreviousCamera, const camera_inputs& Inputs);
 camera CameraUpdateFreefly(const camera& PreviousCamera, const camera_inputs& Inputs);
+transform CameraGetTransform(const camera& Camera);
 mat4 CameraGetMatrix(const camera& Camera);
 mat4 CameraGetInverseMatrix(const camera& Camera);
\ No newline at end of file
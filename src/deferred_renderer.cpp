@@ -0,0 +1,560 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <imgui.h>
+
+#include "platform.h"
+#include "mesh.h"
+
+#include "deferred_renderer.h"
+
+// Unit volumes tessellation
+static const int SPHERE_LON = 16;
+static const int SPHERE_LAT = 12;
+static const int CONE_SEGMENTS = 16;
+
+#pragma region StencilShaders
+static const char* gStencilVertexShaderStr = R"GLSL(
+layout(location = 0) in vec3 aPosition;
+
+void main()
+{
+    gl_Position = uViewProjection * uModel * vec4(aPosition, 1.0);
+})GLSL";
+
+static const char* gStencilFragmentShaderStr = R"GLSL(
+void main()
+{
+})GLSL";
+#pragma endregion
+
+#pragma region LightShaders
+static const char* gLightVertexShaderStr = R"GLSL(
+layout(location = 0) in vec3 aPosition;
+
+void main()
+{
+#ifdef FULLSCREEN
+    // Triangle covering the screen, from the vertex index
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+#else
+    gl_Position = uViewProjection * uModel * vec4(aPosition, 1.0);
+#endif
+})GLSL";
+
+static const char* gLightFragmentShaderStr = R"GLSL(
+// Uniform blocks
+layout(std140) uniform uDeferredLightBlock
+{
+    light uLight;
+};
+
+// Shader outputs
+out vec4 oColor;
+
+void main()
+{
+    gbuffer_sample g = gbuffer_fetch(ivec2(gl_FragCoord.xy));
+
+    // Background
+    if (g.depth >= 1.0)
+        discard;
+
+#ifdef PBR
+    Frag_PBR_material mat = Frag_PBR_material(g.albedo, g.metallic, g.roughness, 1.0);
+    vec3 F0 = mix(vec3(0.04), mat.albedo, mat.metallic);
+    vec3 viewDir = normalize(uViewPosition - g.position);
+
+    oColor = vec4(compute_PBR_lighting(uLight, g.position, g.normal, viewDir, mat, F0), 1.0);
+#else
+    light_shade_result lightResult = light_shade(uLight, gDefaultMaterial.shininess, uViewPosition, g.position, g.normal);
+
+    vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * g.albedo;
+    vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * g.albedo;
+    vec3 specularColor = gDefaultMaterial.specular * lightResult.specular;
+
+    oColor = vec4(ambientColor + diffuseColor + specularColor, 1.0);
+#endif
+})GLSL";
+#pragma endregion
+
+#pragma region ResolveShaders
+static const char* gResolveFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uLighting;
+
+// Shader outputs
+out vec4 oColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    gbuffer_sample g = gbuffer_fetch(pixel);
+
+#if defined(VIEW_ALBEDO)
+    vec3 color = g.albedo;
+#elif defined(VIEW_NORMAL)
+    vec3 color = g.normal * 0.5 + 0.5;
+#elif defined(VIEW_ROUGHNESS_METALLIC)
+    vec3 color = vec3(g.roughness, g.metallic, 0.0);
+#elif defined(VIEW_DEPTH)
+    vec3 color = vec3(1.0 - clamp(length(g.position - uViewPosition) / 20.0, 0.0, 1.0));
+#else
+    vec3 color = texelFetch(uLighting, pixel, 0).rgb;
+#ifdef TONEMAP
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0/2.2));
+#endif
+#endif
+
+    oColor = vec4(color, 1.0);
+    gl_FragDepth = g.depth;
+})GLSL";
+#pragma endregion
+
+// Light pass features
+enum light_features
+{
+    FEATURE_PBR        = 1 << 0,
+    FEATURE_FULLSCREEN = 1 << 1,
+};
+
+static const std::vector<const char*> gLightFeatureNames =
+{
+    "PBR",
+    "FULLSCREEN",
+};
+
+// Resolve features (bit i for deferred_view i, the lighting view has none)
+enum resolve_features
+{
+    FEATURE_TONEMAP = 1 << 0,
+};
+
+static const std::vector<const char*> gResolveFeatureNames =
+{
+    "TONEMAP",
+    "VIEW_ALBEDO",
+    "VIEW_NORMAL",
+    "VIEW_ROUGHNESS_METALLIC",
+    "VIEW_DEPTH",
+};
+
+static const char* gViewNames[DEFERRED_VIEW_COUNT] =
+{
+    "Lighting",
+    "Albedo",
+    "Normal",
+    "Roughness/Metallic",
+    "Depth",
+};
+
+// Same texture units in every program reading the G-buffer
+static void SetupGBufferSamplers(GLuint Program)
+{
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uGBufferAlbedoRoughness"), 0);
+    glUniform1i(glGetUniformLocation(Program, "uGBufferNormalMetallic"), 1);
+    glUniform1i(glGetUniformLocation(Program, "uGBufferDepth"), 2);
+    glUniform1i(glGetUniformLocation(Program, "uLighting"), 3);
+}
+
+deferred_renderer::deferred_renderer()
+{
+    // Create shaders
+    {
+        this->StencilProgram = GL::CreateProgram(gStencilVertexShaderStr, gStencilFragmentShaderStr, GLINCLUDE_FRAMECONSTANTS);
+
+        this->LightPrograms = new GL::shader_permutations(1, &gLightVertexShaderStr, 1, &gLightFragmentShaderStr,
+            GLINCLUDE_PHONGLIGHT | GLINCLUDE_PBR | GLINCLUDE_GBUFFER | GLINCLUDE_FRAMECONSTANTS, gLightFeatureNames);
+        this->LightPrograms->SetProgramSetup([](GLuint Program)
+        {
+            SetupGBufferSamplers(Program);
+            glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uDeferredLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        });
+        this->LightPrograms->Precompile({ 0, FEATURE_FULLSCREEN, FEATURE_PBR, FEATURE_PBR | FEATURE_FULLSCREEN });
+
+        // Same fullscreen triangle than the light passes
+        const char* ResolveVertexShaderStrs[2] = { "#define FULLSCREEN\n", gLightVertexShaderStr };
+        this->ResolvePrograms = new GL::shader_permutations(2, ResolveVertexShaderStrs, 1, &gResolveFragmentShaderStr,
+            GLINCLUDE_GBUFFER | GLINCLUDE_FRAMECONSTANTS, gResolveFeatureNames);
+        this->ResolvePrograms->SetProgramSetup(SetupGBufferSamplers);
+        this->ResolvePrograms->Precompile({ 0, FEATURE_TONEMAP });
+    }
+
+    // One light per block, at the uniform buffer offset alignment
+    {
+        GLint Alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+        this->LightBlockStride = ((int)sizeof(GL::light) + Alignment - 1) / Alignment * Alignment;
+        glGenBuffers(1, &this->LightsBuffer);
+    }
+
+    glGenVertexArrays(1, &this->EmptyVAO);
+    this->CreateVolumes();
+}
+
+deferred_renderer::~deferred_renderer()
+{
+    // Cleanup GL
+    glDeleteFramebuffers(1, &this->GeometryFBO);
+    glDeleteFramebuffers(1, &this->LightingFBO);
+    glDeleteTextures(1, &this->AlbedoRoughnessTexture);
+    glDeleteTextures(1, &this->NormalMetallicTexture);
+    glDeleteTextures(1, &this->LightingTexture);
+    glDeleteTextures(1, &this->DepthStencilTexture);
+    glDeleteRenderbuffers(1, &this->LightingDepthStencil);
+
+    glDeleteVertexArrays(1, &this->VolumeVAO);
+    glDeleteVertexArrays(1, &this->EmptyVAO);
+    glDeleteBuffers(1, &this->VolumeBuffer);
+    glDeleteBuffers(1, &this->LightsBuffer);
+
+    glDeleteProgram(this->StencilProgram);
+    delete this->LightPrograms;
+    delete this->ResolvePrograms;
+}
+
+void deferred_renderer::CreateVolumes()
+{
+    this->SphereVertexCount = SPHERE_LON * SPHERE_LAT * 6;
+    this->ConeFirstVertex = this->SphereVertexCount;
+    this->ConeVertexCount = CONE_SEGMENTS * 6;
+
+    std::vector<v3> Vertices(this->SphereVertexCount + this->ConeVertexCount);
+
+    // Sphere of diameter 1, its faces are inside the circumscribed sphere
+    vertex_descriptor Descriptor = {};
+    Descriptor.Stride = sizeof(v3);
+    Descriptor.PositionOffset = 0;
+    Mesh::BuildSphere(&Vertices[0], &Vertices[this->ConeFirstVertex], Descriptor, SPHERE_LON, SPHERE_LAT);
+    this->SphereScale = 2.f / (Math::Cos(Math::Pi() / SPHERE_LON) * Math::Cos(Math::Pi() / SPHERE_LAT));
+
+    // Cone with its apex at the origin and a base of radius 1 at z = 1 (outward CCW faces)
+    v3* Cone = &Vertices[this->ConeFirstVertex];
+    for (int i = 0; i < CONE_SEGMENTS; ++i)
+    {
+        float Angle0 = Math::TwoPi() * (i + 0) / CONE_SEGMENTS;
+        float Angle1 = Math::TwoPi() * (i + 1) / CONE_SEGMENTS;
+        v3 Base0 = { Math::Cos(Angle0), Math::Sin(Angle0), 1.f };
+        v3 Base1 = { Math::Cos(Angle1), Math::Sin(Angle1), 1.f };
+
+        // Side
+        *Cone++ = { 0.f, 0.f, 0.f };
+        *Cone++ = Base1;
+        *Cone++ = Base0;
+
+        // Base
+        *Cone++ = { 0.f, 0.f, 1.f };
+        *Cone++ = Base0;
+        *Cone++ = Base1;
+    }
+    this->ConeScale = 1.f / Math::Cos(Math::Pi() / CONE_SEGMENTS);
+
+    glGenBuffers(1, &this->VolumeBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VolumeBuffer);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(v3), Vertices.data(), GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &this->VolumeVAO);
+    glBindVertexArray(this->VolumeVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(v3), (void*)0);
+    glBindVertexArray(0);
+}
+
+void deferred_renderer::CreateTargets(int Width, int Height)
+{
+    this->Width = Width;
+    this->Height = Height;
+
+    if (this->GeometryFBO == 0)
+    {
+        glGenFramebuffers(1, &this->GeometryFBO);
+        glGenFramebuffers(1, &this->LightingFBO);
+        glGenRenderbuffers(1, &this->LightingDepthStencil);
+
+        GLuint* Textures[] = { &this->AlbedoRoughnessTexture, &this->NormalMetallicTexture, &this->LightingTexture, &this->DepthStencilTexture };
+        for (GLuint* Texture : Textures)
+        {
+            glGenTextures(1, Texture);
+            glBindTexture(GL_TEXTURE_2D, *Texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+
+    // 16 bytes per pixel (and the depth/stencil copy): albedo in sRGB to keep dark values, normals on 10 bits per axis, lighting in packed float
+    glBindTexture(GL_TEXTURE_2D, this->AlbedoRoughnessTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, this->NormalMetallicTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2, Width, Height, 0, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, NULL);
+    glBindTexture(GL_TEXTURE_2D, this->LightingTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, Width, Height, 0, GL_RGB, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, this->DepthStencilTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, Width, Height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->LightingDepthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->GeometryFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->AlbedoRoughnessTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, this->NormalMetallicTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, this->LightingTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, this->DepthStencilTexture, 0);
+    GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(ARRAY_SIZE(DrawBuffers), DrawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::printf("ERROR::FRAMEBUFFER:: G-buffer is not complete!\n");
+    }
+
+    // The light passes test the scene depth and use the stencil on a copy, the G-buffer depth is sampled
+    glBindFramebuffer(GL_FRAMEBUFFER, this->LightingFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->LightingTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->LightingDepthStencil);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::printf("ERROR::FRAMEBUFFER:: Lighting framebuffer is not complete!\n");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void deferred_renderer::BeginGeometryPass(int ViewportWidth, int ViewportHeight)
+{
+    if (this->Width != ViewportWidth || this->Height != ViewportHeight)
+        this->CreateTargets(ViewportWidth, ViewportHeight);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->GeometryFBO);
+    glViewport(0, 0, this->Width, this->Height);
+
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClearStencil(0);
+    glDepthMask(GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    glEnable(GL_DEPTH_TEST);
+
+    // Linear albedo written to the sRGB target
+    glEnable(GL_FRAMEBUFFER_SRGB);
+}
+
+void deferred_renderer::EndGeometryPass()
+{
+    glDisable(GL_FRAMEBUFFER_SRGB);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+float deferred_renderer::ComputeLightRadius(const GL::light& Light) const
+{
+    return GL::GetLightRange(Light, this->LightCutoff);
+}
+
+bool deferred_renderer::GetVolumeMatrix(const GL::light& Light, mat4* VolumeMatrix, bool* IsCone) const
+{
+    if (Light.Type == LIGHT_DIRECTIONNAL)
+        return false;
+
+    float Radius = this->ComputeLightRadius(Light);
+    if (Radius < 0.f || Radius > this->MaxVolumeRadius)
+        return false;
+
+    // Cone for spot lights narrower than ~84 degrees (outer cut off is a cosine)
+    float CosOuter = Light.CutOff.y;
+    *IsCone = Light.Type == LIGHT_SPOT && CosOuter > 0.1f;
+    if (!*IsCone)
+    {
+        *VolumeMatrix = Mat4::Translate(Light.Position) * Mat4::Scale(v3{ 1.f, 1.f, 1.f } * (Radius * this->SphereScale));
+        return true;
+    }
+
+    v3 Forward = Vec3::Normalize(Light.Direction);
+    v3 Up = fabsf(Forward.y) < 0.99f ? Vec3::Y() : Vec3::X();
+    v3 Right = Vec3::Normalize(Vec3::Cross(Up, Forward));
+    Up = Vec3::Cross(Forward, Right);
+
+    float BaseRadius = Radius * Math::Sqrt(1.f - CosOuter * CosOuter) / CosOuter * this->ConeScale;
+    VolumeMatrix->c[0] = Vec4::vec4(Right * BaseRadius, 0.f);
+    VolumeMatrix->c[1] = Vec4::vec4(Up * BaseRadius, 0.f);
+    VolumeMatrix->c[2] = Vec4::vec4(Forward * Radius, 0.f);
+    VolumeMatrix->c[3] = Vec4::vec4(Light.Position, 1.f);
+    return true;
+}
+
+void deferred_renderer::AccumulateLights(const GL::light* Lights, int LightCount, const mat4& ProjectionMatrix, const mat4& ViewMatrix, const v3& ViewPosition, deferred_shading Shading)
+{
+    this->VolumeLightCount = 0;
+    this->FullscreenLightCount = 0;
+    this->InverseViewProjection = Mat4::Inverse(ProjectionMatrix * ViewMatrix);
+
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, ViewPosition);
+
+    // Upload every light in its own block
+    if (LightCount > 0)
+    {
+        std::vector<uint8_t> LightsData(LightCount * this->LightBlockStride);
+        for (int i = 0; i < LightCount; ++i)
+            memcpy(&LightsData[i * this->LightBlockStride], &Lights[i], sizeof(GL::light));
+
+        glBindBuffer(GL_UNIFORM_BUFFER, this->LightsBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, LightsData.size(), LightsData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Scene depth and cleared stencil copied to the lighting framebuffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->GeometryFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->LightingFBO);
+    glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->LightingFBO);
+    glViewport(0, 0, this->Width, this->Height);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->AlbedoRoughnessTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, this->NormalMetallicTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, this->DepthStencilTexture);
+    glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
+
+    bool CullFace = glIsEnabled(GL_CULL_FACE);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    // Volumes crossing the near or far plane are not clipped (their pixels would be lost)
+    glEnable(GL_DEPTH_CLAMP);
+
+    uint32_t ShadingFeatures = Shading == DEFERRED_SHADING_PBR ? FEATURE_PBR : 0;
+
+    for (int i = 0; i < LightCount; ++i)
+    {
+        const GL::light& Light = Lights[i];
+        if (!Light.Enabled)
+            continue;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, this->LightsBuffer, i * this->LightBlockStride, sizeof(GL::light));
+
+        mat4 VolumeMatrix = {};
+        bool IsCone = false;
+        if (!this->GetVolumeMatrix(Light, &VolumeMatrix, &IsCone))
+        {
+            // Every pixel
+            GLuint Program = this->LightPrograms->GetProgram(ShadingFeatures | FEATURE_FULLSCREEN);
+            glUseProgram(Program);
+            glUniformMatrix4fv(glGetUniformLocation(Program, "uGBufferInverseViewProjection"), 1, GL_FALSE, this->InverseViewProjection.e);
+
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_STENCIL_TEST);
+            glDisable(GL_CULL_FACE);
+
+            glBindVertexArray(this->EmptyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            this->FullscreenLightCount++;
+            continue;
+        }
+
+        GL::SetDrawConstants(VolumeMatrix);
+        glBindVertexArray(this->VolumeVAO);
+        GLint First = IsCone ? this->ConeFirstVertex : 0;
+        GLsizei Count = IsCone ? this->ConeVertexCount : this->SphereVertexCount;
+
+        // Stencil pass: non zero where the scene surface is between the front and back faces of the volume
+        glUseProgram(this->StencilProgram);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        glDrawArrays(GL_TRIANGLES, First, Count);
+
+        // Light pass on the marked pixels, back faces still cover them with the camera inside the volume.
+        // The stencil is reset to zero by the pass itself for the next light.
+        GLuint Program = this->LightPrograms->GetProgram(ShadingFeatures);
+        glUseProgram(Program);
+        glUniformMatrix4fv(glGetUniformLocation(Program, "uGBufferInverseViewProjection"), 1, GL_FALSE, this->InverseViewProjection.e);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        glDrawArrays(GL_TRIANGLES, First, Count);
+
+        this->VolumeLightCount++;
+    }
+
+    // Restore states
+    glCullFace(GL_BACK);
+    if (CullFace)
+        glEnable(GL_CULL_FACE);
+    else
+        glDisable(GL_CULL_FACE);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void deferred_renderer::Resolve(bool Tonemap)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, this->Width, this->Height);
+
+    uint32_t Features = this->View == DEFERRED_VIEW_LIGHTING ? 0 : (1u << this->View);
+    if (Tonemap)
+        Features |= FEATURE_TONEMAP;
+
+    GLuint Program = this->ResolvePrograms->GetProgram(Features);
+    glUseProgram(Program);
+    glUniformMatrix4fv(glGetUniformLocation(Program, "uGBufferInverseViewProjection"), 1, GL_FALSE, this->InverseViewProjection.e);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->AlbedoRoughnessTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, this->NormalMetallicTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, this->DepthStencilTexture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, this->LightingTexture);
+    glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
+
+    // Depth written too, so forward draws (wireframe, transparent...) can follow
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glBindVertexArray(this->EmptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthFunc(GL_LESS);
+}
+
+void deferred_renderer::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Deferred"))
+    {
+        int View = (int)this->View;
+        ImGui::Combo("View", &View, gViewNames, DEFERRED_VIEW_COUNT);
+        this->View = (deferred_view)View;
+
+        ImGui::SliderFloat("Light cutoff", &this->LightCutoff, 1.f / 1024.f, 0.1f, "%.4f", 2.f);
+        ImGui::SliderFloat("Max volume radius", &this->MaxVolumeRadius, 1.f, 100.f);
+
+        ImGui::Text("G-buffer: %dx%d, %d bytes/pixel (%.1f MB)", this->Width, this->Height, BYTES_PER_PIXEL,
+            (double)this->Width * this->Height * BYTES_PER_PIXEL / (1024.0 * 1024.0));
+        ImGui::Text("Lights: %d volumes, %d fullscreen", this->VolumeLightCount, this->FullscreenLightCount);
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "opengl_helpers.h"
+#include "maths.h"
+
+// Light shading functions used by the light passes
+enum deferred_shading
+{
+    DEFERRED_SHADING_PHONG, // light_shade() with gDefaultMaterial, albedo as diffuse color
+    DEFERRED_SHADING_PBR,   // compute_PBR_lighting(), result tonemapped on resolve
+};
+
+// What Resolve() writes to the screen
+enum deferred_view
+{
+    DEFERRED_VIEW_LIGHTING,
+    DEFERRED_VIEW_ALBEDO,
+    DEFERRED_VIEW_NORMAL,
+    DEFERRED_VIEW_ROUGHNESS_METALLIC,
+    DEFERRED_VIEW_DEPTH,
+    DEFERRED_VIEW_COUNT,
+};
+
+// Deferred shading path: the scene is rasterized once into a compact G-buffer, then every light
+// is accumulated only on the pixels it reaches (stencil-marked sphere/cone volumes, fullscreen
+// for directional or unbounded lights), reusing the light struct and the forward shading functions.
+//
+// Usage: BeginGeometryPass(), draw with programs writing the outputs of GLINCLUDE_GBUFFER
+// (location 0/1 from gbuffer_pack(), location 2 for emission and ambient), EndGeometryPass(),
+// AccumulateLights(), then Resolve() to the default framebuffer (color and depth).
+class deferred_renderer
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    // Uniform block binding of the light being accumulated (0 to 2 are used by the light/frame/draw blocks)
+    static const int LIGHT_BLOCK_BINDING_POINT = 3;
+
+    // G-buffer bytes per pixel (albedo/roughness, normal/metallic, lighting, depth/stencil and its copy)
+    static const int BYTES_PER_PIXEL = 4 + 4 + 4 + 4 + 4;
+
+    // Light intensity under which a point/spot light is considered out of range (sizes the volumes)
+    float LightCutoff = 1.f / 256.f;
+
+    // Volumes bigger than this are drawn fullscreen (ranges of slowly attenuated lights)
+    float MaxVolumeRadius = 50.f;
+
+    deferred_view View = DEFERRED_VIEW_LIGHTING;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    deferred_renderer();
+    ~deferred_renderer();
+
+    deferred_renderer(const deferred_renderer&) = delete;
+    deferred_renderer& operator=(const deferred_renderer&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Bind and clear the G-buffer (resized to the viewport when needed)
+    void BeginGeometryPass(int ViewportWidth, int ViewportHeight);
+    void EndGeometryPass();
+
+    // Add the enabled lights to the lighting target (frame constants are set from the matrices)
+    void AccumulateLights(const GL::light* Lights, int LightCount, const mat4& ProjectionMatrix, const mat4& ViewMatrix, const v3& ViewPosition, deferred_shading Shading);
+
+    // Write the selected view to the default framebuffer, with the G-buffer depth (for later forward draws)
+    void Resolve(bool Tonemap);
+
+    // ImGui debug function (view selection and stats)
+    void DisplayDebugUI();
+
+    // Stats of the last AccumulateLights()
+    int GetVolumeLightCount() const { return this->VolumeLightCount; }
+    int GetFullscreenLightCount() const { return this->FullscreenLightCount; }
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    void CreateTargets(int Width, int Height);
+    void CreateVolumes();
+
+    // Range of a point/spot light from its attenuation (negative when unbounded)
+    float ComputeLightRadius(const GL::light& Light) const;
+
+    // Volume transform (unit sphere or unit cone pointing to +Z), false when fullscreen is needed
+    bool GetVolumeMatrix(const GL::light& Light, mat4* VolumeMatrix, bool* IsCone) const;
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    int Width = 0;
+    int Height = 0;
+
+    // Targets
+    GLuint GeometryFBO = 0; // Albedo/roughness, normal/metallic and lighting
+    GLuint LightingFBO = 0; // Lighting only
+    GLuint AlbedoRoughnessTexture = 0;
+    GLuint NormalMetallicTexture = 0;
+    GLuint LightingTexture = 0;
+    GLuint DepthStencilTexture = 0;
+    GLuint LightingDepthStencil = 0; // Renderbuffer, depth tested and stencil marked by the light passes
+
+    // Light volumes (sphere then cone, positions only)
+    GLuint VolumeVAO = 0;
+    GLuint VolumeBuffer = 0;
+    int SphereVertexCount = 0;
+    int ConeFirstVertex = 0;
+    int ConeVertexCount = 0;
+    float SphereScale = 1.f; // Unit sphere mesh scale to contain the sphere
+    float ConeScale = 1.f;   // Same for the base of the cone
+
+    // Empty vertex array for the fullscreen triangles (vertices from gl_VertexID)
+    GLuint EmptyVAO = 0;
+
+    // Lights, one aligned block per light
+    GLuint LightsBuffer = 0;
+    int LightBlockStride = 0;
+
+    GLuint StencilProgram = 0;
+    GL::shader_permutations* LightPrograms = nullptr;
+    GL::shader_permutations* ResolvePrograms = nullptr;
+
+    mat4 InverseViewProjection = Mat4::Identity();
+
+    int VolumeLightCount = 0;
+    int FullscreenLightCount = 0;
+};
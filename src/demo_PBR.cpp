@@ -24,18 +24,15 @@ layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 layout(location = 3) in vec3 aTangent;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
 out vec3 vNormal; // Vertex normal in view-space
 out mat3 vTBN;
 
+// Matches the depth pre-pass
+invariant gl_Position;
+
 void main()
 {
     vUV = aUV;
@@ -64,14 +61,10 @@ in vec3 vNormal;
 in mat3 vTBN;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform vec3 uAlbedo;
 uniform float uMetallic;
 uniform float uRoughness;
 uniform float uAmbientOcclusion;
-uniform bool uUseTextures;
 
 uniform sampler2D uAlbedoTexture;
 uniform sampler2D uMetallicTexture;
@@ -86,7 +79,13 @@ layout(std140) uniform uLightBlock
 };
 
 // Shader outputs
+#ifdef GBUFFER
+layout(location = 0) out vec4 oAlbedoRoughness;
+layout(location = 1) out vec4 oNormalMetallic;
+layout(location = 2) out vec4 oLighting;
+#else
 out vec4 oColor;
+#endif
 
 Frag_PBR_material mat = Frag_PBR_material(
     vec3(0.0),
@@ -97,26 +96,34 @@ Frag_PBR_material mat = Frag_PBR_material(
 
 void main()
 {
-    mat.albedo = uUseTextures ? pow(texture(uAlbedoTexture,vUV).rgb, vec3(2.2)) : uAlbedo;
-    mat.metallic =  uUseTextures ? texture(uMetallicTexture,vUV).r : uMetallic;
-    mat.roughness =  uUseTextures ? texture(uRoughnessTexture,vUV).r : uRoughness;
-    mat.ambientOcclusion =  uUseTextures ? texture(uAmbientOcclusionTexture,vUV).r : uAmbientOcclusion;
+#ifdef USE_TEXTURES
+    mat.albedo = pow(texture(uAlbedoTexture,vUV).rgb, vec3(2.2));
+    mat.metallic = texture(uMetallicTexture,vUV).r;
+    mat.roughness = texture(uRoughnessTexture,vUV).r;
+    mat.ambientOcclusion = texture(uAmbientOcclusionTexture,vUV).r;
+#else
+    mat.albedo = uAlbedo;
+    mat.metallic = uMetallic;
+    mat.roughness = uRoughness;
+    mat.ambientOcclusion = uAmbientOcclusion;
+#endif
 
     vec3 F0 = vec3(0.04); 
     F0 = mix(F0,  mat.albedo , mat.metallic);
 
-    vec3 normal;
-    if(uUseTextures)
-    {
-        normal = texture(uNormalTexture, vUV).rgb;
-        normal = normalize(normal * 2.0 - 1.0);
-        normal = normalize(vTBN * normal);
-    }
-    else
-    {
-        normal = normalize(vNormal);
-    }
-    
+#ifdef USE_TEXTURES
+    vec3 normal = texture(uNormalTexture, vUV).rgb;
+    normal = normalize(normal * 2.0 - 1.0);
+    normal = normalize(vTBN * normal);
+#else
+    vec3 normal = normalize(vNormal);
+#endif
+
+#ifdef GBUFFER
+    // Lights are added by the light passes, only the ambient term is written here
+    gbuffer_pack(mat.albedo, mat.roughness, mat.metallic, normal, oAlbedoRoughness, oNormalMetallic);
+    oLighting = vec4(vec3(0.03) * mat.albedo * mat.ambientOcclusion, 1.0);
+#else
     vec3 viewDir = normalize(uViewPosition - vPos);;
 
     // reflectance equation
@@ -135,9 +142,23 @@ void main()
 
     // Apply light color
     oColor = vec4(color, 1.0);
+#endif
 })GLSL";
 #pragma endregion
 
+// Fragment shader features
+enum pbr_features
+{
+    FEATURE_USE_TEXTURES = 1 << 0,
+    FEATURE_GBUFFER      = 1 << 1, // Geometry pass of the deferred path
+};
+
+static const std::vector<const char*> gFeatureNames =
+{
+    "USE_TEXTURES",
+    "GBUFFER",
+};
+
 demo_PBR::demo_PBR(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug)
 {
@@ -161,19 +182,22 @@ demo_PBR::demo_PBR(GL::cache& GLCache, GL::debug& GLDebug)
                 gFragmentShaderStr,
             };
 
-            Program.push_back(GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PBR));
-
-
-            glUseProgram(Program[i]);
-            glUseProgram(Program[i]);
-            glUniform1i(glGetUniformLocation(Program[i], "uAlbedoTexture"), 0);
-            glUniform1i(glGetUniformLocation(Program[i], "uMetallicTexture"), 1);
-            glUniform1i(glGetUniformLocation(Program[i], "uRoughnessTexture"), 2);
-            glUniform1i(glGetUniformLocation(Program[i], "uAmbientOcclusionTexture"), 3);
-            glUniform1i(glGetUniformLocation(Program[i], "uNormalTexture"), 4);
-            glUniformBlockBinding(Program[i], glGetUniformBlockIndex(Program[i], "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+            Programs.push_back(new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PBR | GLINCLUDE_GBUFFER | GLINCLUDE_FRAMECONSTANTS, gFeatureNames));
+
+            Programs[i]->SetProgramSetup([](GLuint Program)
+            {
+                glUseProgram(Program);
+                glUniform1i(glGetUniformLocation(Program, "uAlbedoTexture"), 0);
+                glUniform1i(glGetUniformLocation(Program, "uMetallicTexture"), 1);
+                glUniform1i(glGetUniformLocation(Program, "uRoughnessTexture"), 2);
+                glUniform1i(glGetUniformLocation(Program, "uAmbientOcclusionTexture"), 3);
+                glUniform1i(glGetUniformLocation(Program, "uNormalTexture"), 4);
+                glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+            });
+            Programs[i]->Precompile({ 0, FEATURE_USE_TEXTURES, FEATURE_GBUFFER, FEATURE_USE_TEXTURES | FEATURE_GBUFFER });
         }
-    }}
+    }
+}
 
 demo_PBR::~demo_PBR()
 {
@@ -186,10 +210,10 @@ demo_PBR::~demo_PBR()
     }
 
 
-    while (!Program.empty())
+    while (!Programs.empty())
     {
-        glDeleteProgram(Program.back());
-        Program.pop_back();
+        delete Programs.back();
+        Programs.pop_back();
     }
 }
 
@@ -209,12 +233,26 @@ void demo_PBR::Update(const platform_io& IO)
     mat4 ModelMatrix = Mat4::Translate({ 0.f, 0.f, 0.f });
 
     // Render tavern
-    this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
+    if (UseDeferred)
+    {
+        scene* Scene = scenes[currentScene];
+
+        Deferred.BeginGeometryPass(IO.WindowWidth, IO.WindowHeight);
+        this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
+        Deferred.EndGeometryPass();
+
+        Deferred.AccumulateLights(Scene->GetLight(0), Scene->LightCount, ProjectionMatrix, ViewMatrix, Camera.Position, DEFERRED_SHADING_PBR);
+        Deferred.Resolve(true);
+    }
+    else
+    {
+        this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
+    }
 
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(scenes[currentScene]->MeshBuffer, scenes[currentScene]->MeshDesc.Stride, scenes[currentScene]->MeshDesc.PositionOffset, scenes[currentScene]->MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(scenes[currentScene]->MeshPositionBuffer, sizeof(v3), 0, scenes[currentScene]->MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, scenes[currentScene]->MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
     
@@ -230,6 +268,10 @@ void demo_PBR::DisplayDebugUI()
         ImGui::SliderInt("Scene", &currentScene, 0, scenes.size() - 1);
 
         ImGui::Checkbox("UseTexture", &UseTexture);
+        ImGui::Checkbox("Deferred", &UseDeferred);
+        if (UseDeferred)
+            Deferred.DisplayDebugUI();
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs[currentScene]->GetVariantCount(), Programs[currentScene]->GetCompileTimeMs());
 
         ImGui::ColorEdit3("Albedo", Albedo.e);
         ImGui::SliderFloat("Metallic", &Metallic,0.f,1.f);
@@ -238,6 +280,7 @@ void demo_PBR::DisplayDebugUI()
 
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
+        Prepass.DisplayDebugUI();
         if (ImGui::TreeNodeEx("Camera"))
         {
             ImGui::Text("Position: (%.2f, %.2f, %.2f)", Camera.Position.x, Camera.Position.y, Camera.Position.z);
@@ -255,23 +298,23 @@ void demo_PBR::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix
 {
     glEnable(GL_DEPTH_TEST);
 
+    // Set uniforms
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+
+    // Optional depth only pass
+    if (Prepass.BeginPrepass())
+        scenes[currentScene]->DrawScenePositions();
+
     // Use shader and configure its uniforms
-    glUseProgram(Program[currentScene]);
+    uint32_t Features = (UseTexture ? FEATURE_USE_TEXTURES : 0) | (UseDeferred ? FEATURE_GBUFFER : 0);
+    GLuint Program = Programs[currentScene]->GetProgram(Features);
+    glUseProgram(Program);
 
-    // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program[currentScene], "uViewPosition"), 1, Camera.Position.e);
-
-    int useText = (int)UseTexture;
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uUseTextures"), useText);
-    glUniform3fv(glGetUniformLocation(Program[currentScene], "uAlbedo"), 1, Albedo.e);
-    glUniform1f(glGetUniformLocation(Program[currentScene], "uMetallic"), Metallic);
-    glUniform1f(glGetUniformLocation(Program[currentScene], "uRoughness"), Roughness);
-    glUniform1f(glGetUniformLocation(Program[currentScene], "uAmbientOcclusion"), AO);
+    glUniform3fv(glGetUniformLocation(Program, "uAlbedo"), 1, Albedo.e);
+    glUniform1f(glGetUniformLocation(Program, "uMetallic"), Metallic);
+    glUniform1f(glGetUniformLocation(Program, "uRoughness"), Roughness);
+    glUniform1f(glGetUniformLocation(Program, "uAmbientOcclusion"), AO);
 
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, scenes[currentScene]->LightsUniformBuffer);
@@ -288,5 +331,7 @@ void demo_PBR::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix
     glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
     
     // Draw mesh
+    Prepass.BeginMainPass();
     scenes[currentScene]->DrawScene();
+    Prepass.EndMainPass();
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #include "camera.h"
 
+#include "deferred_renderer.h"
 #include "scene.h"
 
 class demo_PBR : public demo
@@ -30,9 +31,12 @@ private:
 
     // GL objects needed by this demo
 
-    std::vector<GLuint> Program;
+    std::vector<GL::shader_permutations*> Programs;
     std::vector<scene*> scenes;
 
+    deferred_renderer Deferred;
+    GL::depth_prepass Prepass;
+
     //GLuint Program = 0;
     //GLuint VAO = 0;
 
@@ -44,5 +48,6 @@ private:
     float Metallic = 0.5f;
     float Roughness = 0.75f;
     float AO = 0.5f;
-    bool UseTexture;
+    bool UseTexture = false;
+    bool UseDeferred = false;
 };
\ No newline at end of file
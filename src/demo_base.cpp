@@ -21,17 +21,14 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
 out vec3 vNormal; // Vertex normal in view-space
 
+// Matches the depth pre-pass
+invariant gl_Position;
+
 void main()
 {
     vUV = aUV;
@@ -50,9 +47,6 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 
@@ -93,8 +87,34 @@ void main()
 })GLSL";
 #pragma endregion
 
+#pragma region GBufferFragmentShader
+static const char* gGBufferFragmentShaderStr = R"GLSL(
+// Varyings
+in vec2 vUV;
+in vec3 vPos;
+in vec3 vNormal;
+
+// Uniforms
+uniform sampler2D uDiffuseTexture;
+uniform sampler2D uEmissiveTexture;
+
+// Shader outputs
+layout(location = 0) out vec4 oAlbedoRoughness;
+layout(location = 1) out vec4 oNormalMetallic;
+layout(location = 2) out vec4 oLighting;
+
+void main()
+{
+    // Same material everywhere (gDefaultMaterial), only the diffuse texture is stored
+    gbuffer_pack(texture(uDiffuseTexture, vUV).rgb, 1.0, 0.0, normalize(vNormal), oAlbedoRoughness, oNormalMetallic);
+
+    // Lights are added by the light passes
+    oLighting = vec4(gDefaultMaterial.emission + texture(uEmissiveTexture, vUV).rgb, 1.0);
+})GLSL";
+#pragma endregion
+
 demo_base::demo_base(GL::cache& GLCache, GL::debug& GLDebug)
-    : GLDebug(GLDebug), TavernScene(GLCache)
+    : GLDebug(GLDebug), TavernScene(GLCache), CandleParticles(65536)
 {
     // Create shader
     {
@@ -106,7 +126,8 @@ demo_base::demo_base(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS);
+        this->GBufferProgram = GL::CreateProgramEx(1, &gVertexShaderStr, 1, &gGBufferFragmentShaderStr, GLINCLUDE_GBUFFER | GLINCLUDE_FRAMECONSTANTS);
     }
     
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -131,6 +152,10 @@ demo_base::demo_base(GL::cache& GLCache, GL::debug& GLDebug)
         glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
         glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
         glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+
+        glUseProgram(GBufferProgram);
+        glUniform1i(glGetUniformLocation(GBufferProgram, "uDiffuseTexture"), 0);
+        glUniform1i(glGetUniformLocation(GBufferProgram, "uEmissiveTexture"), 1);
     }
 }
 
@@ -139,6 +164,7 @@ demo_base::~demo_base()
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
     glDeleteProgram(Program);
+    glDeleteProgram(GBufferProgram);
 }
 
 void demo_base::Update(const platform_io& IO)
@@ -156,13 +182,33 @@ void demo_base::Update(const platform_io& IO)
     mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
     mat4 ModelMatrix = Mat4::Translate({ 0.f, 0.f, 0.f });
 
+    // Emit from the enabled point lights (the candles), following their edits
+    if (UseParticles)
+    {
+        CandleParticles.Emitters.clear();
+        for (int i = 0; i < TavernScene.LightCount; ++i)
+        {
+            const GL::light* Light = TavernScene.GetLight(i);
+            if (Light && Light->Enabled && Light->Type == LIGHT_POINT)
+                CandleParticles.Emitters.push_back({ Light->Position, 0.01f, { 0.f, 0.2f, 0.f }, 0.05f });
+        }
+        CandleParticles.Update((float)IO.DeltaTime);
+    }
+
     // Render tavern
-    this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
+    if (UseDeferred)
+        this->RenderTavernDeferred(ProjectionMatrix, ViewMatrix, ModelMatrix, IO.WindowWidth, IO.WindowHeight);
+    else
+        this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
+
+    // Over the opaque tavern, frame constants are still the camera ones
+    if (UseParticles)
+        CandleParticles.Render(IO.WindowWidth, IO.WindowHeight);
 
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
     
@@ -176,6 +222,13 @@ void demo_base::DisplayDebugUI()
     {
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
+        Prepass.DisplayDebugUI();
+        ImGui::Checkbox("Deferred", &UseDeferred);
+        if (UseDeferred)
+            Deferred.DisplayDebugUI();
+        ImGui::Checkbox("Candle particles", &UseParticles);
+        if (UseParticles)
+            CandleParticles.DisplayDebugUI();
         if (ImGui::TreeNodeEx("Camera"))
         {
             ImGui::Text("Position: (%.2f, %.2f, %.2f)", Camera.Position.x, Camera.Position.y, Camera.Position.z);
@@ -193,16 +246,17 @@ void demo_base::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatri
 {
     glEnable(GL_DEPTH_TEST);
 
+    // Set uniforms
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+
+    // Optional depth only pass
+    if (Prepass.BeginPrepass())
+        TavernScene.DrawScenePositions();
+    glBindVertexArray(VAO);
+
     // Use shader and configure its uniforms
     glUseProgram(Program);
-
-    // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
     
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
@@ -213,6 +267,38 @@ void demo_base::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatri
     glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
     
     // Draw mesh
+    Prepass.BeginMainPass();
+    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    Prepass.EndMainPass();
+}
+
+void demo_base::RenderTavernDeferred(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, int ViewportWidth, int ViewportHeight)
+{
+    // Geometry pass
+    Deferred.BeginGeometryPass(ViewportWidth, ViewportHeight);
+
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+
+    if (Prepass.BeginPrepass())
+        TavernScene.DrawScenePositions();
     glBindVertexArray(VAO);
+
+    glUseProgram(GBufferProgram);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, TavernScene.DiffuseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, TavernScene.EmissiveTexture);
+    glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
+
+    Prepass.BeginMainPass();
     glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    Prepass.EndMainPass();
+
+    Deferred.EndGeometryPass();
+
+    // Lighting, then back to the screen
+    Deferred.AccumulateLights(TavernScene.GetLight(0), TavernScene.LightCount, ProjectionMatrix, ViewMatrix, Camera.Position, DEFERRED_SHADING_PHONG);
+    Deferred.Resolve(false);
 }
@@ -8,6 +8,8 @@
 
 #include "camera.h"
 
+#include "deferred_renderer.h"
+#include "particle_system.h"
 #include "tavern_scene.h"
 
 class demo_base : public demo
@@ -18,6 +20,7 @@ public:
     virtual void Update(const platform_io& IO);
 
     void RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix);
+    void RenderTavernDeferred(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, int ViewportWidth, int ViewportHeight);
     void DisplayDebugUI();
 
 private:
@@ -28,9 +31,17 @@ private:
 
     // GL objects needed by this demo
     GLuint Program = 0;
+    GLuint GBufferProgram = 0;
     GLuint VAO = 0;
 
     tavern_scene TavernScene;
+    deferred_renderer Deferred;
+    GL::depth_prepass Prepass;
+
+    // Flames above the candle lights
+    particle_system CandleParticles;
 
     bool Wireframe = false;
+    bool UseDeferred = false;
+    bool UseParticles = true;
 };
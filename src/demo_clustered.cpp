@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <imgui.h>
+
+#include "opengl_helpers.h"
+#include "opengl_helpers_wireframe.h"
+
+#include "color.h"
+#include "jobs.h"
+#include "maths.h"
+#include "mesh.h"
+
+#include "demo_clustered.h"
+
+const int LIGHT_BLOCK_BINDING_POINT = 0;
+
+// Texture units 0 and 1 are the diffuse and emissive textures
+const int CLUSTER_FIRST_TEXTURE_UNIT = 2;
+
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.f;
+
+#pragma region DefaultVertexShader
+static const char* gVertexShaderStr = R"GLSL(
+// Attributes
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec2 aUV;
+layout(location = 2) in vec3 aNormal;
+
+// Varyings
+out vec2 vUV;
+out vec3 vPos;    // Vertex position in world-space
+out vec3 vNormal; // Vertex normal in world-space
+out float vViewDepth;
+
+// Matches the depth pre-pass
+invariant gl_Position;
+
+void main()
+{
+    vUV = aUV;
+    vec4 pos4 = (uModel * vec4(aPosition, 1.0));
+    vPos = pos4.xyz / pos4.w;
+    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    vViewDepth = -(uView * pos4).z;
+    gl_Position = uProjection * uView * pos4;
+})GLSL";
+#pragma endregion
+
+#pragma region DefaultFragmentShader
+static const char* gFragmentShaderStr = R"GLSL(
+// Varyings
+in vec2 vUV;
+in vec3 vPos;
+in vec3 vNormal;
+in float vViewDepth;
+
+// Uniforms
+uniform sampler2D uDiffuseTexture;
+uniform sampler2D uEmissiveTexture;
+
+// Uniform blocks
+layout(std140) uniform uLightBlock
+{
+	light uLight[LIGHT_COUNT];
+};
+
+// Shader outputs
+out vec4 oColor;
+
+vec3 gDiffuse = vec3(0.0);
+vec3 gSpecular = vec3(0.0);
+
+void add_light(light currentLight, float fade, vec3 normal, vec3 viewDir, Frag_PBR_material mat, vec3 F0)
+{
+#ifdef USE_PBR
+    gDiffuse += fade * compute_PBR_lighting(currentLight, vPos, normal, viewDir, mat, F0);
+#else
+    light_shade_result result = light_shade(currentLight, gDefaultMaterial.shininess, uViewPosition, vPos, normal);
+    gDiffuse  += fade * result.diffuse * mat.albedo;
+    gSpecular += fade * result.specular;
+#endif
+}
+
+void add_clustered_light(light currentLight, float radius, vec3 normal, vec3 viewDir, Frag_PBR_material mat, vec3 F0)
+{
+    // Lists are conservative, skip the lights out of range
+    float fade = cluster_light_fade(currentLight.position, radius, vPos);
+    if (fade > 0.0)
+        add_light(currentLight, fade, normal, viewDir, mat, F0);
+}
+
+void main()
+{
+    vec3 normal = normalize(vNormal);
+    vec3 viewDir = normalize(uViewPosition - vPos);
+    vec3 diffuseText = texture(uDiffuseTexture, vUV).rgb;
+
+    Frag_PBR_material mat = Frag_PBR_material(diffuseText, 0.0, 0.6, 1.0);
+    vec3 F0 = mix(vec3(0.04), mat.albedo, mat.metallic);
+
+    // Scene lights
+    vec3 ambient = vec3(0.0);
+	for (int i = 0; i < LIGHT_COUNT; ++i)
+    {
+        if (!uLight[i].enabled)
+            continue;
+        ambient += uLight[i].ambient;
+        add_light(uLight[i], 1.0, normal, viewDir, mat, F0);
+    }
+
+    // Clustered candles
+#ifdef BRUTE_FORCE
+    int lightCount = uClusterLightCount;
+    for (int i = 0; i < lightCount; ++i)
+    {
+        float radius;
+        light currentLight = cluster_fetch_light(i, radius);
+        add_clustered_light(currentLight, radius, normal, viewDir, mat, F0);
+    }
+#else
+    uvec2 range = cluster_get_range(gl_FragCoord.xy, vViewDepth);
+    int lightCount = int(range.y);
+    for (uint i = 0u; i < range.y; ++i)
+    {
+        float radius;
+        light currentLight = cluster_get_light(range.x + i, radius);
+        add_clustered_light(currentLight, radius, normal, viewDir, mat, F0);
+    }
+#endif
+
+#ifdef SHOW_HEATMAP
+    // Blue (no light) to red (64 lights and more)
+    float heat = clamp(float(lightCount) / 64.0, 0.0, 1.0);
+    oColor = vec4(mix(vec3(0.0, 0.0, 0.3), vec3(1.0, 0.1, 0.0), heat) + 0.15 * diffuseText, 1.0);
+    return;
+#endif
+
+    vec3 emissiveColor = gDefaultMaterial.emission + texture(uEmissiveTexture, vUV).rgb;
+
+#ifdef USE_PBR
+    vec3 color = 0.03 * ambient * mat.albedo + gDiffuse;
+    color = color / (color + vec3(1.0));
+    oColor = vec4(pow(color, vec3(1.0/2.2)) + emissiveColor, 1.0);
+#else
+    vec3 ambientColor = gDefaultMaterial.ambient * ambient * diffuseText;
+    vec3 diffuseColor = gDefaultMaterial.diffuse * gDiffuse;
+    vec3 specularColor = gDefaultMaterial.specular * gSpecular;
+    oColor = vec4(ambientColor + diffuseColor + specularColor + emissiveColor, 1.0);
+#endif
+})GLSL";
+#pragma endregion
+
+// Fragment shader features
+enum clustered_features
+{
+    FEATURE_BRUTE_FORCE  = 1 << 0,
+    FEATURE_USE_PBR      = 1 << 1,
+    FEATURE_SHOW_HEATMAP = 1 << 2,
+};
+
+static const std::vector<const char*> gFeatureNames =
+{
+    "BRUTE_FORCE",
+    "USE_PBR",
+    "SHOW_HEATMAP",
+};
+
+// Deterministic [0, 1) random numbers so the light layout does not change between runs
+static float RandomFloat(uint32_t& State)
+{
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    return (State >> 8) / 16777216.f;
+}
+
+demo_clustered::demo_clustered(GL::cache& GLCache, GL::debug& GLDebug)
+    : GLDebug(GLDebug), TavernScene(GLCache), CandleParticles(65536)
+{
+    // Create shader
+    {
+        // Assemble fragment shader strings (defines + code)
+        char FragmentShaderConfig[] = "#define LIGHT_COUNT %d\n";
+        snprintf(FragmentShaderConfig, ARRAY_SIZE(FragmentShaderConfig), "#define LIGHT_COUNT %d\n", TavernScene.LightCount);
+        const char* FragmentShaderStrs[2] = {
+            FragmentShaderConfig,
+            gFragmentShaderStr,
+        };
+
+        const int Includes = GLINCLUDE_PHONGLIGHT | GLINCLUDE_PBR | GLINCLUDE_CLUSTERED_LIGHTS | GLINCLUDE_FRAMECONSTANTS;
+        this->Programs = new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, Includes, gFeatureNames);
+    }
+
+    // Create a vertex array and bind attribs onto the vertex buffer
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, TavernScene.MeshBuffer);
+
+        vertex_descriptor& Desc = TavernScene.MeshDesc;
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+    }
+
+    // Set uniforms that won't change
+    {
+        Programs->SetProgramSetup([this](GLuint Program)
+        {
+            glUseProgram(Program);
+            glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
+            glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
+            glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+            this->Clusters.SetupProgram(Program, CLUSTER_FIRST_TEXTURE_UNIT);
+        });
+        Programs->Precompile({ 0, FEATURE_BRUTE_FORCE });
+    }
+
+    GenerateLights();
+}
+
+demo_clustered::~demo_clustered()
+{
+    // Cleanup GL
+    glDeleteVertexArrays(1, &VAO);
+    delete Programs;
+}
+
+void demo_clustered::GenerateLights()
+{
+    uint32_t RandomState = 0x9E3779B9;
+
+    Lights.resize(LightCount);
+    LightRestPositions.resize(LightCount);
+    for (int i = 0; i < LightCount; ++i)
+    {
+        v3 Position;
+        for (int Axis = 0; Axis < 3; ++Axis)
+            Position.e[Axis] = Math::Lerp(LightsMin.e[Axis], LightsMax.e[Axis], RandomFloat(RandomState));
+        LightRestPositions[i] = Vec4::vec4(Position, RandomFloat(RandomState) * Math::TwoPi());
+
+        // Candle colors, from deep orange to pale yellow
+        clustered_light& Light = Lights[i];
+        Light.Position = Position;
+        Light.Radius = LightRadius;
+        Light.Color = Math::Lerp(Color::RGB(0xFF8A00), Color::RGB(0xFFD27F), RandomFloat(RandomState));
+        Light.Specular = 0.5f;
+        Light.Attenuation = { 1.0f, 0.0f, 1.5f };
+        Light.Unused = 0.f;
+    }
+}
+
+void demo_clustered::AnimateLights(float Time)
+{
+    // Flames bob and flicker, each light with its own phase
+    Jobs::ParallelFor((int)Lights.size(), 1024, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            v4 Rest = LightRestPositions[i];
+            float Phase = Rest.w;
+            Lights[i].Position = { Rest.x, Rest.y + 0.05f * sinf(Time * 1.7f + Phase), Rest.z };
+            Lights[i].Radius = LightRadius * (0.9f + 0.1f * sinf(Time * 11.f + Phase * 3.f));
+        }
+    });
+}
+
+void demo_clustered::UpdateCandleEmitters()
+{
+    // Keep the nearest candles, flames further away are too small to be noticed
+    int EmitterCount = Math::Min((int)Lights.size(), (int)particle_system::MAX_EMITTER_COUNT);
+    CandleEmitterIndices.resize(Lights.size());
+    for (int i = 0; i < (int)Lights.size(); ++i)
+        CandleEmitterIndices[i] = i;
+
+    std::partial_sort(CandleEmitterIndices.begin(), CandleEmitterIndices.begin() + EmitterCount, CandleEmitterIndices.end(), [&](int A, int B)
+    {
+        return Vec3::SquaredLength(Lights[A].Position - Camera.Position) < Vec3::SquaredLength(Lights[B].Position - Camera.Position);
+    });
+
+    CandleParticles.Emitters.clear();
+    for (int i = 0; i < EmitterCount; ++i)
+        CandleParticles.Emitters.push_back({ Lights[CandleEmitterIndices[i]].Position, 0.01f, { 0.f, 0.2f, 0.f }, 0.05f });
+}
+
+void demo_clustered::Update(const platform_io& IO)
+{
+    const float AspectRatio = (float)IO.WindowWidth / (float)IO.WindowHeight;
+    glViewport(0, 0, IO.WindowWidth, IO.WindowHeight);
+
+    Camera = CameraUpdateFreefly(Camera, IO.CameraInputs);
+
+    // Clear screen
+    glClearColor(0.f, 0.f, 0.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    mat4 ProjectionMatrix = Mat4::Perspective(Math::ToRadians(60.f), AspectRatio, NEAR_PLANE, FAR_PLANE);
+    mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
+    mat4 ModelMatrix = Mat4::Translate({ 0.f, 0.f, 0.f });
+
+    // Assign the lights to the clusters of this view
+    if (Animate)
+        AnimateLights((float)IO.Time);
+    Clusters.Build(Lights, ViewMatrix, ProjectionMatrix, NEAR_PLANE, FAR_PLANE);
+    Clusters.Upload(Lights);
+
+    if (UseParticles)
+    {
+        UpdateCandleEmitters();
+        CandleParticles.Update((float)IO.DeltaTime);
+    }
+
+    // Render tavern
+    this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix, IO.WindowWidth, IO.WindowHeight);
+
+    // Candle flames, blended over the opaque scene
+    if (UseParticles)
+        CandleParticles.Render(IO.WindowWidth, IO.WindowHeight);
+
+    // Render tavern wireframe
+    if (Wireframe)
+    {
+        GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
+        GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
+    }
+
+    // Display debug UI
+    this->DisplayDebugUI();
+}
+
+void demo_clustered::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("demo_clustered", ImGuiTreeNodeFlags_Framed))
+    {
+        // Debug display
+        ImGui::Checkbox("Wireframe", &Wireframe);
+        Prepass.DisplayDebugUI();
+
+        bool LightsChanged = ImGui::SliderInt("Candle count", &LightCount, 0, 10000);
+        LightsChanged |= ImGui::SliderFloat("Candle radius", &LightRadius, 0.1f, 4.f);
+        LightsChanged |= ImGui::DragFloat3("Candles min", LightsMin.e, 0.1f);
+        LightsChanged |= ImGui::DragFloat3("Candles max", LightsMax.e, 0.1f);
+        if (LightsChanged)
+            GenerateLights();
+
+        ImGui::Checkbox("Animate", &Animate);
+        ImGui::Checkbox("Brute force (all lights per pixel)", &BruteForce);
+        ImGui::Checkbox("PBR", &UsePBR);
+        ImGui::Checkbox("Heatmap", &ShowHeatmap);
+        ImGui::Checkbox("Candle particles", &UseParticles);
+        if (UseParticles)
+            CandleParticles.DisplayDebugUI();
+
+        ImGui::Text("Clusters: %dx%dx%d, build %.3f ms (%d worker threads)",
+            light_clusters::TILE_COUNT_X, light_clusters::TILE_COUNT_Y, light_clusters::SLICE_COUNT,
+            Clusters.GetBuildTimeMs(), Jobs::GetWorkerCount());
+        ImGui::Text("Light indices: %d, max lights per cluster: %d", Clusters.GetIndexCount(), Clusters.GetMaxClusterLightCount());
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs->GetVariantCount(), Programs->GetCompileTimeMs());
+
+        if (ImGui::TreeNodeEx("Camera"))
+        {
+            ImGui::Text("Position: (%.2f, %.2f, %.2f)", Camera.Position.x, Camera.Position.y, Camera.Position.z);
+            ImGui::Text("Pitch: %.2f", Math::ToDegrees(Camera.Pitch));
+            ImGui::Text("Yaw: %.2f", Math::ToDegrees(Camera.Yaw));
+            ImGui::TreePop();
+        }
+        TavernScene.InspectLights();
+
+        ImGui::TreePop();
+    }
+}
+
+void demo_clustered::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, int ViewportWidth, int ViewportHeight)
+{
+    glEnable(GL_DEPTH_TEST);
+
+    // Set uniforms
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+
+    // Optional depth only pass
+    if (Prepass.BeginPrepass())
+        TavernScene.DrawScenePositions();
+    glBindVertexArray(VAO);
+
+    // Use shader and configure its uniforms
+    uint32_t Features = (BruteForce ? FEATURE_BRUTE_FORCE : 0)
+        | (UsePBR ? FEATURE_USE_PBR : 0)
+        | (ShowHeatmap ? FEATURE_SHOW_HEATMAP : 0);
+    GLuint Program = Programs->GetProgram(Features);
+    glUseProgram(Program);
+
+    // Bind uniform buffer and textures
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, TavernScene.DiffuseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, TavernScene.EmissiveTexture);
+    Clusters.Bind(Program, CLUSTER_FIRST_TEXTURE_UNIT, ViewportWidth, ViewportHeight);
+
+    // Draw mesh
+    Prepass.BeginMainPass();
+    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    Prepass.EndMainPass();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include "demo.h"
+
+#include "opengl_headers.h"
+
+#include "camera.h"
+
+#include "light_clusters.h"
+#include "particle_system.h"
+#include "tavern_scene.h"
+
+class demo_clustered : public demo
+{
+public:
+    demo_clustered(GL::cache& GLCache, GL::debug& GLDebug);
+    virtual ~demo_clustered();
+    virtual void Update(const platform_io& IO);
+
+    void GenerateLights();
+    void AnimateLights(float Time);
+    void UpdateCandleEmitters();
+    void RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, int ViewportWidth, int ViewportHeight);
+    void DisplayDebugUI();
+
+private:
+    GL::debug& GLDebug;
+
+    // 3d camera
+    camera Camera = {};
+
+    // GL objects needed by this demo
+    GL::shader_permutations* Programs = nullptr;
+    GLuint VAO = 0;
+
+    tavern_scene TavernScene;
+
+    // Candle lights (rest positions and flicker phases used by AnimateLights)
+    std::vector<clustered_light> Lights;
+    std::vector<v4> LightRestPositions; // w: phase
+    light_clusters Clusters;
+    GL::depth_prepass Prepass;
+
+    // Flames of the candles closest to the camera (the emitter count is capped)
+    particle_system CandleParticles;
+    std::vector<int> CandleEmitterIndices;
+
+    int LightCount = 1024;
+    float LightRadius = 1.0f;
+    v3 LightsMin = { -6.f, -0.5f, -4.f };
+    v3 LightsMax = { 5.f, 3.f, 7.f };
+
+    bool Wireframe = false;
+    bool Animate = true;
+    bool BruteForce = false;
+    bool UsePBR = false;
+    bool ShowHeatmap = false;
+    bool UseParticles = true;
+};
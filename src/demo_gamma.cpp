@@ -20,12 +20,6 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
@@ -47,14 +41,9 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 
-uniform bool uUseGamma;
-
 // Uniform blocks
 layout(std140) uniform uLightBlock
 {
@@ -85,15 +74,11 @@ void main()
 
     float gamma = 2.2;
     
-    vec3 diffuseText;
-    if(uUseGamma)
-    {
-        diffuseText = pow(texture(uDiffuseTexture, vUV).rgb, vec3(gamma));
-    }
-    else
-    {
-        diffuseText = texture(uDiffuseTexture, vUV).rgb;
-    }
+#ifdef USE_GAMMA
+    vec3 diffuseText = pow(texture(uDiffuseTexture, vUV).rgb, vec3(gamma));
+#else
+    vec3 diffuseText = texture(uDiffuseTexture, vUV).rgb;
+#endif
 
     vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * diffuseText;
     vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * diffuseText;
@@ -103,14 +88,23 @@ void main()
     // Apply light color
     oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
 
-    if(uUseGamma)
-    {
-        // apply gamma correction
-        oColor.rgb = pow(oColor.rgb, vec3(1.0/gamma));
-    }
-
+#ifdef USE_GAMMA
+    // apply gamma correction
+    oColor.rgb = pow(oColor.rgb, vec3(1.0/gamma));
+#endif
 })GLSL";
 
+// Fragment shader features
+enum gamma_features
+{
+    FEATURE_USE_GAMMA = 1 << 0,
+};
+
+static const std::vector<const char*> gFeatureNames =
+{
+    "USE_GAMMA",
+};
+
 demo_gamma::demo_gamma(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), TavernScene(GLCache)
 {
@@ -124,7 +118,7 @@ demo_gamma::demo_gamma(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        this->Programs = new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS, gFeatureNames);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -145,10 +139,14 @@ demo_gamma::demo_gamma(GL::cache& GLCache, GL::debug& GLDebug)
 
     // Set uniforms that won't change
     {
-        glUseProgram(Program);
-        glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
-        glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
-        glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        Programs->SetProgramSetup([](GLuint Program)
+        {
+            glUseProgram(Program);
+            glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
+            glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
+            glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        });
+        Programs->Precompile({ 0, FEATURE_USE_GAMMA });
     }
 }
 
@@ -156,7 +154,7 @@ demo_gamma::~demo_gamma()
 {
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
-    glDeleteProgram(Program);
+    delete Programs;
 }
 
 void demo_gamma::Update(const platform_io& IO)
@@ -180,7 +178,7 @@ void demo_gamma::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -195,6 +193,7 @@ void demo_gamma::DisplayDebugUI()
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
         ImGui::Checkbox("Use Gamma Correction", &UseGamma);
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs->GetVariantCount(), Programs->GetCompileTimeMs());
 
         if (ImGui::TreeNodeEx("Camera"))
         {
@@ -214,18 +213,12 @@ void demo_gamma::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatr
     glEnable(GL_DEPTH_TEST);
 
     // Use shader and configure its uniforms
+    GLuint Program = Programs->GetProgram(UseGamma ? FEATURE_USE_GAMMA : 0);
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
-
-    int uUseGamma = (int)UseGamma;
-    glUniform1iv(glGetUniformLocation(Program, "uUseGamma"), 1, &uUseGamma);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
     
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
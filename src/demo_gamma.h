@@ -27,7 +27,7 @@ private:
     camera Camera = {};
 
     // GL objects needed by this demo
-    GLuint Program = 0;
+    GL::shader_permutations* Programs = nullptr;
     GLuint VAO = 0;
 
     tavern_scene TavernScene;
@@ -23,12 +23,6 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aUV;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
@@ -49,9 +43,6 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 
@@ -153,7 +144,7 @@ demo_hdr::demo_hdr(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS);
         this->hdrProgram = GL::CreateProgram(gHdrVertexShaderStr, gHdrFragmentShaderStr);
     }
 
@@ -294,7 +285,7 @@ void demo_hdr::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -344,12 +335,8 @@ void demo_hdr::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
 
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
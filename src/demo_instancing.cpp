@@ -1,13 +1,20 @@
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <vector>
 
 #include <imgui.h>
 
 #include "opengl_helpers.h"
+#include "opengl_helpers_extensions.h"
 #include "opengl_helpers_wireframe.h"
 
 #include "color.h"
+#include "jobs.h"
 #include "maths.h"
+#include "maths_fast.h"
 #include "mesh.h"
 
 #include "demo_instancing.h"
@@ -16,17 +23,33 @@ const int LIGHT_BLOCK_BINDING_POINT = 0;
 
 #pragma region VertexShader
 static const char* gVertexShaderStr = R"GLSL(
+#ifdef MESH_FROM_BUFFER
+// Draw instance is the mesh triangle, vertices are the culled instances (written 3 times each)
+uniform samplerBuffer uMeshVertices;
+uniform int uMeshStride;    // Floats per vertex
+uniform ivec3 uMeshOffsets; // Position, UV and normal offsets in floats
+vec3 aPosition;
+vec2 aUV;
+vec3 aNormal;
+#else
 // Attributes
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
-layout(location = 3) in vec3 aOffset;
+#endif
+
+#ifdef CULLED_INSTANCES
+// Instance attributes (gpu_culled_instance)
+layout(location = 3) in vec4 aPositionAngle;
+#else
+// Instance attributes (instance_data)
+layout(location = 3) in vec4 aModelRow0;
+layout(location = 4) in vec4 aModelRow1;
+layout(location = 5) in vec4 aModelRow2;
+#endif
+layout(location = 6) in vec4 aTint;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
 uniform int uOrthogonize;
 
 
@@ -34,44 +57,61 @@ uniform int uOrthogonize;
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
 out vec3 vNormal; // Vertex normal in view-space
+out vec4 vTint;
+
+#ifdef MESH_FROM_BUFFER
+vec3 fetch_mesh_vec3(int offset)
+{
+    return vec3(texelFetch(uMeshVertices, offset).r, texelFetch(uMeshVertices, offset + 1).r, texelFetch(uMeshVertices, offset + 2).r);
+}
+#endif
 
 void main()
 {
+#ifdef MESH_FROM_BUFFER
+    int vertex = (gl_InstanceID * 3 + gl_VertexID % 3) * uMeshStride;
+    aPosition = fetch_mesh_vec3(vertex + uMeshOffsets.x);
+    aUV = vec2(texelFetch(uMeshVertices, vertex + uMeshOffsets.y).r, texelFetch(uMeshVertices, vertex + uMeshOffsets.y + 1).r);
+    aNormal = fetch_mesh_vec3(vertex + uMeshOffsets.z);
+#endif
+
+#ifdef CULLED_INSTANCES
+    // Translation * RotationY * Scale, as UpdateInstances
+    float s = sin(aPositionAngle.w);
+    float c = cos(aPositionAngle.w);
+    float scale = 1.0 + 0.1 * c;
+    vec4 row0 = vec4(scale * c, 0.0, scale * s, aPositionAngle.x);
+    vec4 row1 = vec4(0.0, scale, 0.0, aPositionAngle.y);
+    vec4 row2 = vec4(-scale * s, 0.0, scale * c, aPositionAngle.z);
+#else
+    vec4 row0 = aModelRow0;
+    vec4 row1 = aModelRow1;
+    vec4 row2 = aModelRow2;
+#endif
+
     vUV = aUV;
-    vec4 pos4 = (uModel * vec4(aPosition + aOffset, 1.0));
+    mat4 instanceModel = transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+    vec4 pos4 = (uModel * instanceModel * vec4(aPosition, 1.0));
     vPos = pos4.xyz;
 
-    vNormal = (uModelNormalMatrix * vec4(aNormal, 0.0)).xyz;
+    // Uniform scale, the instance matrix transforms normals too
+    vNormal = (uModelNormalMatrix * (instanceModel * vec4(aNormal, 0.0))).xyz;
+    vTint = aTint;
     gl_Position = uProjection * uView * pos4;
 
 })GLSL";
 #pragma endregion
 
 #pragma region FragmentShader
-static const char* gFragmentShaderStr = R"GLSL(
-// Varyings
-in vec2 vUV;
-in vec3 vPos;
-in vec3 vNormal;
-in mat3 vTBN;
-
-// Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
-uniform sampler2D uDiffuseTexture;
-uniform sampler2D uEmissiveTexture;
-
+// Phong shading shared by the mesh and the impostors
+static const char* gShadingStr = R"GLSL(
 // Uniform blocks
 layout(std140) uniform uLightBlock
 {
 	light uLight[LIGHT_COUNT];
 };
 
-// Shader outputs
-out vec4 oColor;
-
-light_shade_result get_lights_shading()
+light_shade_result get_lights_shading(vec3 position, vec3 normal)
 {
     light_shade_result lightResult = light_shade_result(vec3(0.0), vec3(0.0), vec3(0.0));
 	for (int i = 0; i < LIGHT_COUNT; ++i)
@@ -79,7 +119,7 @@ light_shade_result get_lights_shading()
         light currlight =  uLight[i];
         currlight.position.xyz = currlight.position.xyz;
 
-        light_shade_result light = light_shade(currlight, gDefaultMaterial.shininess, uViewPosition,vPos, normalize(vNormal));
+        light_shade_result light = light_shade(currlight, gDefaultMaterial.shininess, uViewPosition, position, normal);
         lightResult.ambient  += light.ambient;
         lightResult.diffuse  += light.diffuse;
         lightResult.specular += light.specular;
@@ -87,99 +127,866 @@ light_shade_result get_lights_shading()
     return lightResult;
 }
 
-void main()
-{  
+vec3 shade(vec3 albedo, vec3 emissive, vec3 position, vec3 normal)
+{
     // Compute phong shading
-    light_shade_result lightResult = get_lights_shading();
-    
-    vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * texture(uDiffuseTexture, vUV).rgb;
-    vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * texture(uDiffuseTexture, vUV).rgb;
+    light_shade_result lightResult = get_lights_shading(position, normal);
+
+    vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * albedo;
+    vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * albedo;
     vec3 specularColor = gDefaultMaterial.specular * lightResult.specular;
-    vec3 emissiveColor = gDefaultMaterial.emission + texture(uEmissiveTexture, vUV).rgb;
+    vec3 emissiveColor = gDefaultMaterial.emission + emissive;
+    return ambientColor + diffuseColor + specularColor + emissiveColor;
+}
+)GLSL";
+
+static const char* gFragmentShaderStr = R"GLSL(
+// Varyings
+in vec2 vUV;
+in vec3 vPos;
+in vec3 vNormal;
+in vec4 vTint;
+in mat3 vTBN;
+
+// Uniforms
+uniform sampler2D uDiffuseTexture;
+uniform sampler2D uEmissiveTexture;
+
+// Shader outputs
+out vec4 oColor;
+
+void main()
+{  
+    vec3 albedo = texture(uDiffuseTexture, vUV).rgb * vTint.rgb;
+    vec3 emissive = texture(uEmissiveTexture, vUV).rgb * vTint.a;
     
     // Apply light color
-    oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
+    oColor = vec4(shade(albedo, emissive, vPos, normalize(vNormal)), 1.0);
+})GLSL";
+
+#pragma endregion
+
+#pragma region ImpostorShaders
+// Instance transform (CPU or GPU culled layout) to the quad expansion
+static const char* gImpostorVertexShaderStr = R"GLSL(
+#ifdef CULLED_INSTANCES
+// Instance attributes (gpu_culled_instance), one point per instance
+layout(location = 3) in vec4 aPositionAngle;
+#else
+// Instance attributes (instance_data), one point per instance
+layout(location = 3) in vec4 aModelRow0;
+layout(location = 4) in vec4 aModelRow1;
+layout(location = 5) in vec4 aModelRow2;
+#endif
+layout(location = 6) in vec4 aTint;
+
+// Varyings
+out vec4 vPositionScale;
+out vec2 vRotation; // Cosine and sine of the angle around Y
+out vec4 vTint;
+
+void main()
+{
+#ifdef CULLED_INSTANCES
+    float c = cos(aPositionAngle.w);
+    float s = sin(aPositionAngle.w);
+    float scale = 1.0 + 0.1 * c;
+    vPositionScale = vec4(aPositionAngle.xyz, scale);
+    vRotation = vec2(c, s);
+#else
+    float scale = aModelRow1.y;
+    vPositionScale = vec4(aModelRow0.w, aModelRow1.w, aModelRow2.w, scale);
+    vRotation = vec2(aModelRow0.x, aModelRow0.z) / scale;
+#endif
+    vTint = aTint;
+})GLSL";
+
+// Quad facing the camera, large enough for the silhouette of the bounding sphere
+static const char* gImpostorGeometryShaderStr = R"GLSL(
+layout(points) in;
+layout(triangle_strip, max_vertices = 4) out;
+
+// Varyings
+in vec4 vPositionScale[];
+in vec2 vRotation[];
+in vec4 vTint[];
+
+flat out vec4 gPositionScale;
+flat out vec2 gRotation;
+flat out vec4 gTint;
+out vec3 gWorldPos;
+
+// Uniforms
+uniform vec4 uImpostorSphere;
+
+void main()
+{
+    vec3 position = vPositionScale[0].xyz;
+    float scale = vPositionScale[0].w;
+    vec2 cs = vRotation[0];
+    vec3 sphereCenter = uImpostorSphere.xyz * scale;
+    vec3 center = position + vec3(cs.x * sphereCenter.x + cs.y * sphereCenter.z, sphereCenter.y, cs.x * sphereCenter.z - cs.y * sphereCenter.x);
+    float radius = uImpostorSphere.w * scale;
+
+    vec3 toCamera = uViewPosition - center;
+    float cameraDistance = length(toCamera);
+    vec3 forward = toCamera / cameraDistance;
+    vec3 right = normalize(cross(abs(forward.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), forward));
+    vec3 up = cross(forward, right);
+
+    // Radius of the silhouette cone in the plane of the center
+    float halfSize = radius * cameraDistance / sqrt(max(cameraDistance * cameraDistance - radius * radius, 1e-4));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 corner = vec2((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0);
+        gPositionScale = vPositionScale[0];
+        gRotation = cs;
+        gTint = vTint[0];
+        gWorldPos = center + (right * corner.x + up * corner.y) * halfSize;
+        gl_Position = uViewProjection * vec4(gWorldPos, 1.0);
+        EmitVertex();
+    }
+    EndPrimitive();
 })GLSL";
 
+static const char* gImpostorFragmentShaderStr = R"GLSL(
+// Varyings
+flat in vec4 gPositionScale;
+flat in vec2 gRotation;
+flat in vec4 gTint;
+in vec3 gWorldPos;
+
+// Shader outputs
+out vec4 oColor;
+
+vec3 rotate_y(vec3 v, vec2 cs)
+{
+    return vec3(cs.x * v.x + cs.y * v.z, v.y, cs.x * v.z - cs.y * v.x);
+}
+
+void main()
+{
+    // Camera ray in mesh space (inverse of Translation * RotationY * Scale)
+    vec3 position = gPositionScale.xyz;
+    float scale = gPositionScale.w;
+    vec2 inverseRotation = vec2(gRotation.x, -gRotation.y);
+    vec3 rayOrigin = rotate_y(uViewPosition - position, inverseRotation) / scale;
+    vec3 rayDirection = normalize(rotate_y(gWorldPos - uViewPosition, inverseRotation));
+
+    impostor_sample impostor = impostor_sample_atlas(rayOrigin, rayDirection);
+    if (impostor.coverage < 0.5)
+        discard;
+
+    // Depth of the baked surface instead of the quad
+    vec3 worldPos = position + rotate_y(impostor.position * scale, gRotation);
+    vec4 clip = uViewProjection * vec4(worldPos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    vec3 normal = rotate_y(impostor.normal, gRotation);
+    oColor = vec4(shade(impostor.albedo * gTint.rgb, impostor.emissive * gTint.a, worldPos, normal), 1.0);
+})GLSL";
 #pragma endregion
 
-#define INSTANCE_RANGE 5
+#pragma region CullShaders
+static const char* gCullVertexShaderStr = R"GLSL(
+// Attributes (gpu_instance_source)
+layout(location = 0) in vec4 aPositionPhase;
+layout(location = 1) in vec4 aTint;
+
+// Uniforms
+uniform float uTime;
+uniform vec4 uMeshSphere;       // Center and radius of the mesh bounds
+uniform vec4 uFrustumPlanes[6]; // Pointing inward: dot(xyz, p) + w >= 0 inside
 
-#define INSTANCES_COUNT INSTANCE_RANGE*INSTANCE_RANGE*INSTANCE_RANGE
+uniform int uSelect;             // 0: every visible instance, 1: meshes only, 2: impostors only
+uniform vec3 uCameraPosition;
+uniform float uImpostorDistance; // Impostor farther than its radius times this
+
+uniform bool uUseHiZ;
+uniform sampler2D uHiZ;          // Farthest depths of the last frame
+uniform mat4 uHiZViewProjection; // Camera of the last frame
+uniform int uHiZLevelCount;
+
+// Varyings
+out vec4 vPositionAngle;
+out vec4 vTint;
+flat out int vVisible;
+
+bool is_occluded(vec3 center, float radius)
+{
+    // Screen rectangle and nearest depth of the sphere box in the last frame
+    vec3 ndcMin = vec3(1.0);
+    vec3 ndcMax = vec3(-1.0);
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = uHiZViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false; // Crosses the camera plane
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+
+    // Level where the rectangle is at most a texel wide, it overlaps 2x2 texels at most
+    // (pixel p is under texel p >> level, the last texel of a level also covers the odd remainder)
+    ivec2 size = textureSize(uHiZ, 0);
+    ivec2 pixelMin = min(ivec2(uvMin * vec2(size)), size - 1);
+    ivec2 pixelMax = min(ivec2(uvMax * vec2(size)), size - 1);
+    ivec2 extent = pixelMax - pixelMin + 1;
+    int level = clamp(int(ceil(log2(float(max(extent.x, extent.y))))), 0, uHiZLevelCount - 1);
+    ivec2 levelSize = textureSize(uHiZ, level);
+    ivec2 texelMin = min(pixelMin >> level, levelSize - 1);
+    ivec2 texelMax = min(pixelMax >> level, levelSize - 1);
+
+    float farthest = max(max(texelFetch(uHiZ, texelMin, level).r, texelFetch(uHiZ, ivec2(texelMax.x, texelMin.y), level).r),
+                         max(texelFetch(uHiZ, ivec2(texelMin.x, texelMax.y), level).r, texelFetch(uHiZ, texelMax, level).r));
+    return ndcMin.z * 0.5 + 0.5 > farthest;
+}
+
+void main()
+{
+    // Same animation as UpdateInstances
+    float phase = aPositionPhase.w;
+    float angle = phase + mod(uTime * (0.5 + phase * 0.1), 6.28318530718);
+    float s = sin(angle);
+    float c = cos(angle);
+    float scale = 1.0 + 0.1 * c;
+    vec3 position = aPositionPhase.xyz + vec3(0.0, 0.5 * s, 0.0);
+
+    vec3 center = vec3(scale * (c * uMeshSphere.x + s * uMeshSphere.z), scale * uMeshSphere.y, scale * (c * uMeshSphere.z - s * uMeshSphere.x)) + position;
+    float radius = scale * uMeshSphere.w;
+
+    bool visible = true;
+    for (int i = 0; i < 6; ++i)
+        visible = visible && dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w >= -radius;
+    if (visible && uSelect != 0)
+        visible = (distance(center, uCameraPosition) > radius * uImpostorDistance) == (uSelect == 2);
+    if (visible && uUseHiZ)
+        visible = !is_occluded(center, radius);
+
+    vPositionAngle = vec4(position, angle);
+    vTint = aTint;
+    vVisible = visible ? 1 : 0;
+})GLSL";
+
+// Compaction: only the visible instances are emitted (uCopies times) to the transform feedback buffer
+static const char* gCullGeometryShaderStr = R"GLSL(
+layout(points) in;
+layout(points, max_vertices = 3) out;
+
+// Varyings
+in vec4 vPositionAngle[];
+in vec4 vTint[];
+flat in int vVisible[];
+
+// Uniforms
+uniform int uCopies;
+
+// Captured outputs (gpu_culled_instance)
+out vec4 oPositionAngle;
+out vec4 oTint;
+
+void main()
+{
+    if (vVisible[0] == 0)
+        return;
+
+    for (int i = 0; i < uCopies; ++i)
+    {
+        oPositionAngle = vPositionAngle[0];
+        oTint = vTint[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+})GLSL";
+#pragma endregion
+
+// Instance data of the CPU paths is streamed through the ring, the GPU path can go much higher
+const int MAX_INSTANCE_COUNT = 131072;
+const int MAX_GPU_INSTANCE_COUNT = 1048576;
+
+const int HIZ_TEXTURE_UNIT = 0;
+const int MESH_TEXTURE_UNIT = 3;
+const int IMPOSTOR_TEXTURE_UNIT = 4; // 3 units
+
+// Sphere blocks tested by one culling job (CULL_CHUNK_BLOCKS * MATHS_BATCH_LANES instances)
+const int CULL_CHUNK_BLOCKS = 64;
+
+// Deterministic per-instance random in [0, 1)
+static float InstanceRandom(uint32_t Index, uint32_t Seed)
+{
+    uint32_t Hash = Index * 747796405u + Seed * 2891336453u;
+    Hash = ((Hash >> ((Hash >> 28u) + 4u)) ^ Hash) * 277803737u;
+    Hash = (Hash >> 22u) ^ Hash;
+    return (float)(Hash >> 8) / (float)(1u << 24);
+}
+
+static void SetMeshAttributes(const vertex_descriptor& Desc, GLuint MeshBuffer)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, MeshBuffer);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// gpu_culled_instance on locations 3 and 6
+static void SetCulledInstanceAttributes(GLuint Buffer, GLuint Divisor)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_culled_instance), (void*)OFFSETOF(gpu_culled_instance, PositionAngle));
+    glVertexAttribDivisor(3, Divisor);
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_culled_instance), (void*)OFFSETOF(gpu_culled_instance, Tint));
+    glVertexAttribDivisor(6, Divisor);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
 demo_instancing::demo_instancing(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), scene(GLCache)
 {
-    // Create shader
+    // Create shaders (CPU instances, GPU culled instances, GPU culled instances drawn per triangle, impostors of both)
     {
         // Assemble fragment shader strings (defines + code)
         char FragmentShaderConfig[] = "#define LIGHT_COUNT %d\n";
         snprintf(FragmentShaderConfig, ARRAY_SIZE(FragmentShaderConfig), "#define LIGHT_COUNT %d\n", scene.LightCount);
-        const char* FragmentShaderStrs[2] = {
+        const char* FragmentShaderStrs[3] = {
             FragmentShaderConfig,
+            gShadingStr,
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        const char* VertexShaderDefines[3] = { "", "#define CULLED_INSTANCES\n", "#define CULLED_INSTANCES\n#define MESH_FROM_BUFFER\n" };
+        GLuint* Programs[3] = { &this->Program, &this->CulledProgram, &this->CulledMeshProgram };
+        for (int i = 0; i < 3; ++i)
+        {
+            const char* VertexShaderStrs[2] = { VertexShaderDefines[i], gVertexShaderStr };
+            *Programs[i] = GL::CreateProgramEx(2, VertexShaderStrs, 3, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS);
+        }
+
+        const char* ImpostorFragmentShaderStrs[4] = {
+            FragmentShaderConfig,
+            gShadingStr,
+            impostor_atlas::GetShaderStr(),
+            gImpostorFragmentShaderStr,
+        };
+        const char* ImpostorDefines[2] = { "", "#define CULLED_INSTANCES\n" };
+        GLuint* ImpostorPrograms[2] = { &this->ImpostorProgram, &this->CulledImpostorProgram };
+        for (int i = 0; i < 2; ++i)
+        {
+            const char* VertexShaderStrs[2] = { ImpostorDefines[i], gImpostorVertexShaderStr };
+            *ImpostorPrograms[i] = GL::CreateProgramEx(2, VertexShaderStrs, 4, ImpostorFragmentShaderStrs, 1, &gImpostorGeometryShaderStr,
+                GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS);
+            Impostors.SetupProgram(*ImpostorPrograms[i], IMPOSTOR_TEXTURE_UNIT);
+        }
     }
 
+    // Bounding sphere of the mesh, scaled and moved with each instance
+    MeshCenter = (scene.MeshBoundsMin + scene.MeshBoundsMax) * 0.5f;
+    MeshRadius = Vec3::Length(scene.MeshBoundsMax - scene.MeshBoundsMin) * 0.5f;
+
+    // Views of the mesh for the distant instances
+    Impostors.Bake(scene.MeshBuffer, scene.MeshDesc, scene.MeshVertexCount, scene.MeshBoundsMin, scene.MeshBoundsMax,
+        scene.DiffuseTexture, scene.EmissiveTexture);
+
+    // Whole frame of instances, written again every frame
+    InstanceRing.Init(GL_ARRAY_BUFFER, MAX_INSTANCE_COUNT * sizeof(instance_data), sizeof(v4));
+    CreateGPUCulling();
+    CreateInstances();
 
-    v3 position[INSTANCES_COUNT];
-    int i = 0;
-    float offsets = 5.f;
-    for (unsigned int x = 0; x < INSTANCE_RANGE; x++)
+    // Create a vertex array and bind attribs onto the vertex buffer
     {
-        for (unsigned int y = 0; y < INSTANCE_RANGE; y++)
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+
+        SetMeshAttributes(scene.MeshDesc, scene.MeshBuffer);
+
+        // Instance attributes, pointed at the ring each frame (Render)
+        for (int Location = 3; Location <= 6; ++Location)
         {
-            for (unsigned int z = 0; z < INSTANCE_RANGE; z++)
+            glEnableVertexAttribArray(Location);
+            glVertexAttribDivisor(Location, 1);
+        }
+
+        // Impostors: the same attributes, one point per instance
+        glGenVertexArrays(1, &ImpostorVAO);
+        glBindVertexArray(ImpostorVAO);
+        for (int Location = 3; Location <= 6; ++Location)
+            glEnableVertexAttribArray(Location);
+
+        glBindVertexArray(0);
+    }
+
+    // Set uniforms that won't change
+    for (GLuint DrawProgram : { Program, CulledProgram, CulledMeshProgram, ImpostorProgram, CulledImpostorProgram })
+    {
+        glUseProgram(DrawProgram);
+        glUniform1i(glGetUniformLocation(DrawProgram, "uDiffuseTexture"), 0);
+        glUniform1i(glGetUniformLocation(DrawProgram, "uEmissiveTexture"), 1);
+        glUniformBlockBinding(DrawProgram, glGetUniformBlockIndex(DrawProgram, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+    }
+}
+
+void demo_instancing::CreateGPUCulling()
+{
+    const GL::extensions& Extensions = GL::GetExtensions();
+
+    const char* Varyings[] = { "oPositionAngle", "oTint" };
+    CullProgram = GL::CreateTransformFeedbackProgram(1, &gCullVertexShaderStr, 1, &gCullGeometryShaderStr, ARRAY_SIZE(Varyings), Varyings);
+    glUseProgram(CullProgram);
+    glUniform1i(glGetUniformLocation(CullProgram, "uHiZ"), HIZ_TEXTURE_UNIT);
+
+    // Buffers are sized by CreateInstances
+    glGenBuffers(1, &CullSourceBuffer);
+    for (cull_output* Output : { &CulledMeshes, &CulledImpostors })
+    {
+        glGenBuffers(1, &Output->Buffer);
+        glGenQueries(1, &Output->Query);
+    }
+
+    // Culling pass input
+    glGenVertexArrays(1, &CullVAO);
+    glBindVertexArray(CullVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, CullSourceBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_instance_source), (void*)OFFSETOF(gpu_instance_source, PositionPhase));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_instance_source), (void*)OFFSETOF(gpu_instance_source, Tint));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Mesh instanced over the read back count
+    glGenVertexArrays(1, &CulledVAO);
+    glBindVertexArray(CulledVAO);
+    SetMeshAttributes(scene.MeshDesc, scene.MeshBuffer);
+    SetCulledInstanceAttributes(CulledMeshes.Buffer, 1);
+
+    // Impostors as points
+    glGenVertexArrays(1, &CulledImpostorVAO);
+    glBindVertexArray(CulledImpostorVAO);
+    SetCulledInstanceAttributes(CulledImpostors.Buffer, 0);
+    glBindVertexArray(0);
+
+    // The mesh is read as floats from a texture buffer when drawn per triangle
+    const vertex_descriptor& Desc = scene.MeshDesc;
+    GLint MaxTextureBufferSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &MaxTextureBufferSize);
+    CanDrawFeedback = Extensions.TransformFeedbackInstanced && (int64_t)scene.MeshVertexCount * Desc.Stride / (int64_t)sizeof(float) <= MaxTextureBufferSize;
+    if (!CanDrawFeedback)
+        return;
+
+    glGenTextures(1, &MeshTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, MeshTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, scene.MeshBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    glUseProgram(CulledMeshProgram);
+    glUniform1i(glGetUniformLocation(CulledMeshProgram, "uMeshVertices"), MESH_TEXTURE_UNIT);
+    glUniform1i(glGetUniformLocation(CulledMeshProgram, "uMeshStride"), Desc.Stride / (int)sizeof(float));
+    glUniform3i(glGetUniformLocation(CulledMeshProgram, "uMeshOffsets"),
+        Desc.PositionOffset / (int)sizeof(float), Desc.UVOffset / (int)sizeof(float), Desc.NormalOffset / (int)sizeof(float));
+
+    Extensions.GenTransformFeedbacksProc(1, &CulledMeshes.Feedback);
+    Extensions.GenTransformFeedbacksProc(1, &CulledImpostors.Feedback);
+
+    // Culled instances as vertices (3 per instance), no mesh attribute
+    glGenVertexArrays(1, &CulledMeshVAO);
+    glBindVertexArray(CulledMeshVAO);
+    SetCulledInstanceAttributes(CulledMeshes.Buffer, 0);
+    glBindVertexArray(0);
+}
+
+void demo_instancing::CreateInstances()
+{
+    InstancePositions.resize(InstanceCount);
+    InstancePhases.resize(InstanceCount);
+    InstanceTints.resize(InstanceCount);
+
+    // Smallest cube holding the instances
+    int Side = (int)std::ceil(std::cbrt((double)InstanceCount));
+    for (int i = 0; i < InstanceCount; ++i)
+    {
+        int x = i % Side;
+        int y = (i / Side) % Side;
+        int z = i / (Side * Side);
+        InstancePositions[i] = { x * InstanceSpacing, y * InstanceSpacing, z * InstanceSpacing };
+
+        InstancePhases[i] = InstanceRandom(i, 0) * Math::TwoPi();
+
+        // Some of them glow
+        float Emissive = InstanceRandom(i, 4) < 0.1f ? 3.f : 1.f;
+        InstanceTints[i] = { 0.5f + 0.5f * InstanceRandom(i, 1), 0.5f + 0.5f * InstanceRandom(i, 2), 0.5f + 0.5f * InstanceRandom(i, 3), Emissive };
+    }
+
+    if (CullingMode == INSTANCE_CULLING_GPU)
+    {
+        // Animated by the culling pass, the CPU instance data is released
+        std::vector<gpu_instance_source> Sources(InstanceCount);
+        for (int i = 0; i < InstanceCount; ++i)
+        {
+            v3 Position = InstancePositions[i];
+            Sources[i] = { { Position.x, Position.y, Position.z, InstancePhases[i] }, InstanceTints[i] };
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, CullSourceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, InstanceCount * sizeof(gpu_instance_source), Sources.data(), GL_STATIC_DRAW);
+
+        // Room for every instance, written 3 times when drawn per triangle
+        int Copies = (CanDrawFeedback && DrawFromFeedback) ? 3 : 1;
+        glBindBuffer(GL_ARRAY_BUFFER, CulledMeshes.Buffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)InstanceCount * Copies * sizeof(gpu_culled_instance), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, CulledImpostors.Buffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)InstanceCount * sizeof(gpu_culled_instance), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        std::vector<instance_data>().swap(Instances);
+        std::vector<instance_data>().swap(VisibleInstances);
+        std::vector<sphere_block>().swap(InstanceSpheres);
+        std::vector<uint64_t>().swap(SortKeys);
+        std::vector<uint32_t>().swap(ImpostorIndices);
+        ChunkVisibleCounts.clear();
+        ChunkImpostorCounts.clear();
+        return;
+    }
+
+    Instances.resize(InstanceCount);
+    VisibleInstances.resize(InstanceCount);
+
+    int BlockCount = Batch::GetBlockCount(InstanceCount);
+    int ChunkCount = (BlockCount + CULL_CHUNK_BLOCKS - 1) / CULL_CHUNK_BLOCKS;
+    InstanceSpheres.resize(BlockCount);
+    SortKeys.resize(BlockCount * MATHS_BATCH_LANES);
+    ImpostorIndices.resize(BlockCount * MATHS_BATCH_LANES);
+    ChunkVisibleCounts.resize(ChunkCount);
+    ChunkImpostorCounts.resize(ChunkCount);
+}
+
+void demo_instancing::UpdateInstances(float Time)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    // Spin, bob and pulse, one sin/cos per instance (angles kept in the accurate range of Fast::SinCos)
+    Angles.resize(InstanceCount);
+    Sines.resize(InstanceCount);
+    Cosines.resize(InstanceCount);
+    for (int i = 0; i < InstanceCount; ++i)
+        Angles[i] = InstancePhases[i] + std::fmod(Time * (0.5f + InstancePhases[i] * 0.1f), Math::TwoPi());
+    Math::Fast::SinCos(Angles.data(), Sines.data(), Cosines.data(), InstanceCount);
+
+    for (int i = 0; i < InstanceCount; ++i)
+    {
+        float Sin = Sines[i];
+        float Cos = Cosines[i];
+        float Scale = 1.f + 0.1f * Cos;
+        v3 Position = InstancePositions[i];
+        Position.y += 0.5f * Sin;
+
+        // Translation * RotationY * Scale
+        instance_data& Instance = Instances[i];
+        Instance.Rows[0] = { Scale * Cos, 0.f, Scale * Sin, Position.x };
+        Instance.Rows[1] = { 0.f, Scale, 0.f, Position.y };
+        Instance.Rows[2] = { -Scale * Sin, 0.f, Scale * Cos, Position.z };
+        Instance.Tint = InstanceTints[i];
+
+        // Same transform applied to the mesh bounding sphere
+        v3 Center = {
+            Scale * (Cos * MeshCenter.x + Sin * MeshCenter.z) + Position.x,
+            Scale * MeshCenter.y + Position.y,
+            Scale * (Cos * MeshCenter.z - Sin * MeshCenter.x) + Position.z,
+        };
+        Batch::SetSphere(InstanceSpheres.data(), i, Center, Scale * MeshRadius);
+    }
+
+    auto Updated = std::chrono::high_resolution_clock::now();
+    UpdateTimeMs = std::chrono::duration<double, std::milli>(Updated - Start).count();
+}
+
+void demo_instancing::CullInstances(const mat4& ViewProjection)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    const instance_data* DrawnInstances = Instances.data();
+    InstancesTested = (CullingMode == INSTANCE_CULLING_CPU) ? InstanceCount : 0;
+    InstancesDrawn = InstanceCount;
+    ImpostorsDrawn = 0;
+    if (CullingMode == INSTANCE_CULLING_CPU)
+    {
+        frustum Frustum = Frustum::FromMatrix(ViewProjection);
+        int BlockCount = Batch::GetBlockCount(InstanceCount);
+        int ChunkCount = (int)ChunkVisibleCounts.size();
+        v3 CameraPosition = Camera.Position;
+
+        // Each job tests a chunk of sphere blocks (8 spheres per test) and writes the keys of its
+        // visible instances at the start of its own range of SortKeys (impostors: ImpostorIndices)
+        Jobs::ParallelFor(ChunkCount, 1, [&](int Begin, int End)
+        {
+            uint8_t VisibleMasks[CULL_CHUNK_BLOCKS];
+            for (int Chunk = Begin; Chunk < End; ++Chunk)
             {
-                position[i] = { x * offsets , y * offsets , z * offsets };
-                i++;
+                int FirstBlock = Chunk * CULL_CHUNK_BLOCKS;
+                int ChunkBlockCount = Math::Min(CULL_CHUNK_BLOCKS, BlockCount - FirstBlock);
+                Frustum::TestSpheres(Frustum, &InstanceSpheres[FirstBlock], ChunkBlockCount, VisibleMasks);
+
+                uint64_t* Keys = &SortKeys[FirstBlock * MATHS_BATCH_LANES];
+                uint32_t* ChunkImpostors = &ImpostorIndices[FirstBlock * MATHS_BATCH_LANES];
+                int Visible = 0;
+                int ImpostorCount = 0;
+                for (int Block = 0; Block < ChunkBlockCount; ++Block)
+                {
+                    const sphere_block& Spheres = InstanceSpheres[FirstBlock + Block];
+                    for (int Lane = 0; Lane < MATHS_BATCH_LANES; ++Lane)
+                    {
+                        int Index = (FirstBlock + Block) * MATHS_BATCH_LANES + Lane;
+                        if (!(VisibleMasks[Block] & (1 << Lane)) || Index >= InstanceCount)
+                            continue;
+
+                        v3 ToCamera = v3{ Spheres.X[Lane], Spheres.Y[Lane], Spheres.Z[Lane] } - CameraPosition;
+                        float SquaredDistance = Vec3::SquaredLength(ToCamera);
+                        float ImpostorRadius = Spheres.Radius[Lane] * ImpostorDistance;
+                        if (ImpostorDistance > 0.f && SquaredDistance > ImpostorRadius * ImpostorRadius)
+                        {
+                            ChunkImpostors[ImpostorCount++] = (uint32_t)Index;
+                            continue;
+                        }
+
+                        // Positive floats sort like their bit patterns
+                        uint32_t DistanceBits;
+                        std::memcpy(&DistanceBits, &SquaredDistance, sizeof(DistanceBits));
+                        Keys[Visible++] = ((uint64_t)DistanceBits << 32) | (uint32_t)Index;
+                    }
+                }
+                ChunkVisibleCounts[Chunk] = Visible;
+                ChunkImpostorCounts[Chunk] = ImpostorCount;
             }
+        });
+
+        // Compact the chunks (in order, destinations never overlap later sources)
+        int VisibleCount = 0;
+        int ImpostorCount = 0;
+        for (int Chunk = 0; Chunk < ChunkCount; ++Chunk)
+        {
+            int ChunkStart = Chunk * CULL_CHUNK_BLOCKS * MATHS_BATCH_LANES;
+            if (ChunkStart != VisibleCount)
+                std::memmove(&SortKeys[VisibleCount], &SortKeys[ChunkStart], ChunkVisibleCounts[Chunk] * sizeof(uint64_t));
+            if (ChunkStart != ImpostorCount)
+                std::memmove(&ImpostorIndices[ImpostorCount], &ImpostorIndices[ChunkStart], ChunkImpostorCounts[Chunk] * sizeof(uint32_t));
+            VisibleCount += ChunkVisibleCounts[Chunk];
+            ImpostorCount += ChunkImpostorCounts[Chunk];
         }
+
+        auto Culled = std::chrono::high_resolution_clock::now();
+
+        // Front to back, so early-Z rejects the hidden fragments of farther instances
+        if (SortFrontToBack)
+            std::sort(SortKeys.begin(), SortKeys.begin() + VisibleCount);
+
+        auto Sorted = std::chrono::high_resolution_clock::now();
+
+        // Meshes first, then the impostors (not sorted, they barely overdraw)
+        Jobs::ParallelFor(VisibleCount + ImpostorCount, 4096, [this, VisibleCount](int Begin, int End)
+        {
+            for (int i = Begin; i < End; ++i)
+            {
+                uint32_t Index = (i < VisibleCount) ? (uint32_t)SortKeys[i] : ImpostorIndices[i - VisibleCount];
+                VisibleInstances[i] = Instances[Index];
+            }
+        });
+
+        auto Compacted = std::chrono::high_resolution_clock::now();
+        CullTimeMs = std::chrono::duration<double, std::milli>((Culled - Start) + (Compacted - Sorted)).count();
+        SortTimeMs = std::chrono::duration<double, std::milli>(Sorted - Culled).count();
+
+        DrawnInstances = VisibleInstances.data();
+        InstancesDrawn = VisibleCount;
+        ImpostorsDrawn = ImpostorCount;
+    }
+    else
+    {
+        CullTimeMs = 0.0;
+        SortTimeMs = 0.0;
     }
 
-    unsigned int instanceVBO;
-    glGenBuffers(1, &instanceVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(v3) * INSTANCES_COUNT, &position[0].e, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    auto UploadStart = std::chrono::high_resolution_clock::now();
 
-    // Create a vertex array and bind attribs onto the vertex buffer
+    // Waits for the ring section of STREAM_RING_FRAME_COUNT frames ago, then writes this frame
+    InstanceRing.BeginFrame();
+    int PushedCount = InstancesDrawn + ImpostorsDrawn;
+    InstanceOffset = (PushedCount > 0) ? InstanceRing.Push(DrawnInstances, PushedCount * sizeof(instance_data)) : -1;
+
+    auto Uploaded = std::chrono::high_resolution_clock::now();
+    UploadTimeMs = std::chrono::duration<double, std::milli>(Uploaded - UploadStart).count();
+}
+
+void demo_instancing::RunCullPass(cull_output& Output, int Select, int Copies, bool FeedbackDraw)
+{
+    const GL::extensions& Extensions = GL::GetExtensions();
+
+    // The count of an earlier frame, only for the UI when drawing from the feedback object
+    if (Output.QueryPending)
     {
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        GLuint Available = GL_TRUE;
+        if (FeedbackDraw)
+            glGetQueryObjectuiv(Output.Query, GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (Available)
+        {
+            GLuint Count = 0;
+            glGetQueryObjectuiv(Output.Query, GL_QUERY_RESULT, &Count);
+            Output.Count = (int)Count / Output.QueryCopies;
+            Output.QueryPending = false;
+        }
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, scene.MeshBuffer);
+    glUniform1i(glGetUniformLocation(CullProgram, "uSelect"), Select);
+    glUniform1i(glGetUniformLocation(CullProgram, "uCopies"), Copies);
 
-        vertex_descriptor& Desc = scene.MeshDesc;
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
+    if (FeedbackDraw)
+        Extensions.BindTransformFeedbackProc(GL_TRANSFORM_FEEDBACK, Output.Feedback);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, Output.Buffer);
 
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
+    bool Counting = !Output.QueryPending;
+    if (Counting)
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, Output.Query);
 
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+    glBindVertexArray(CullVAO);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, InstanceCount);
+    glEndTransformFeedback();
+    glBindVertexArray(0);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (Counting)
+    {
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        Output.QueryPending = true;
+        Output.QueryCopies = Copies;
+    }
 
-        glEnableVertexAttribArray(3);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glVertexAttribDivisor(3, 1);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    if (FeedbackDraw)
+        Extensions.BindTransformFeedbackProc(GL_TRANSFORM_FEEDBACK, 0);
+}
 
-        glBindVertexArray(0);
+void demo_instancing::ReadCullCount(cull_output& Output)
+{
+    // Waits for the culling pass
+    GLuint Count = 0;
+    glGetQueryObjectuiv(Output.Query, GL_QUERY_RESULT, &Count);
+    Output.Count = (int)Count;
+    Output.QueryPending = false;
+}
+
+void demo_instancing::CullInstancesGPU(const mat4& ViewProjection)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    bool FeedbackDraw = CanDrawFeedback && DrawFromFeedback;
+    int Copies = FeedbackDraw ? 3 : 1;
+
+    double Milliseconds = 0.0;
+    int Tag = 0;
+    while (CullTimer.PopResult(&Milliseconds, &Tag))
+        GPUCullTimeMs = Milliseconds;
+
+    frustum Frustum = Frustum::FromMatrix(ViewProjection);
+    bool TestHiZ = UseHiZ && HiZ.IsValid();
+
+    glUseProgram(CullProgram);
+    glUniform1f(glGetUniformLocation(CullProgram, "uTime"), elapsedTime);
+    glUniform4f(glGetUniformLocation(CullProgram, "uMeshSphere"), MeshCenter.x, MeshCenter.y, MeshCenter.z, MeshRadius);
+    glUniform4fv(glGetUniformLocation(CullProgram, "uFrustumPlanes"), FRUSTUM_PLANE_COUNT, &Frustum.Planes[0].x);
+    glUniform3f(glGetUniformLocation(CullProgram, "uCameraPosition"), Camera.Position.x, Camera.Position.y, Camera.Position.z);
+    glUniform1f(glGetUniformLocation(CullProgram, "uImpostorDistance"), ImpostorDistance);
+    glUniform1i(glGetUniformLocation(CullProgram, "uUseHiZ"), TestHiZ);
+    if (TestHiZ)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(CullProgram, "uHiZViewProjection"), 1, GL_FALSE, HiZViewProjection.e);
+        glUniform1i(glGetUniformLocation(CullProgram, "uHiZLevelCount"), HiZ.GetLevelCount());
+        HiZ.Bind(HIZ_TEXTURE_UNIT);
     }
 
-    // Set uniforms that won't change
+    glEnable(GL_RASTERIZER_DISCARD);
+    CullTimer.Begin();
+
+    // Near instances to the mesh output, far ones to the impostor output (one point each)
+    if (ImpostorDistance > 0.f)
     {
-        glUseProgram(Program);
-        glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
-        glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
-        glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        RunCullPass(CulledMeshes, 1, Copies, FeedbackDraw);
+        RunCullPass(CulledImpostors, 2, 1, FeedbackDraw);
     }
+    else
+    {
+        RunCullPass(CulledMeshes, 0, Copies, FeedbackDraw);
+        CulledImpostors.Count = 0;
+    }
+
+    CullTimer.End();
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    // Without the feedback draw the counts are needed now, read once both passes are submitted
+    auto Submitted = std::chrono::high_resolution_clock::now();
+    if (!FeedbackDraw)
+    {
+        ReadCullCount(CulledMeshes);
+        if (ImpostorDistance > 0.f)
+            ReadCullCount(CulledImpostors);
+    }
+
+    InstancesTested = InstanceCount;
+    InstancesDrawn = CulledMeshes.Count;
+    ImpostorsDrawn = CulledImpostors.Count;
+    UpdateTimeMs = 0.0;
+    SortTimeMs = 0.0;
+    UploadTimeMs = 0.0;
+    CullTimeMs = std::chrono::duration<double, std::milli>(Submitted - Start).count();
+    ReadbackWaitMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Submitted).count();
+}
+
+void demo_instancing::DrawInstancesGPU()
+{
+    bool FeedbackDraw = CanDrawFeedback && DrawFromFeedback;
+    if (FeedbackDraw)
+    {
+        // One draw instance per mesh triangle, 3 vertices per visible instance, counted on the GPU
+        glUseProgram(CulledMeshProgram);
+        glActiveTexture(GL_TEXTURE0 + MESH_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, MeshTexture);
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindVertexArray(CulledMeshVAO);
+        GL::GetExtensions().DrawTransformFeedbackInstancedProc(GL_TRIANGLES, CulledMeshes.Feedback, scene.MeshVertexCount / 3);
+    }
+    else if (CulledMeshes.Count > 0)
+    {
+        glUseProgram(CulledProgram);
+        glBindVertexArray(CulledVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, scene.MeshVertexCount, CulledMeshes.Count);
+    }
+
+    if (ImpostorDistance <= 0.f || (!FeedbackDraw && CulledImpostors.Count == 0))
+        return;
+
+    UseImpostorProgram(CulledImpostorProgram);
+    glBindVertexArray(CulledImpostorVAO);
+    if (FeedbackDraw)
+        GL::GetExtensions().DrawTransformFeedbackProc(GL_POINTS, CulledImpostors.Feedback);
+    else
+        glDrawArrays(GL_POINTS, 0, CulledImpostors.Count);
+}
+
+void demo_instancing::UseImpostorProgram(GLuint ImpostorProgram)
+{
+    glUseProgram(ImpostorProgram);
+    Impostors.SetUniforms(ImpostorProgram);
+    Impostors.Bind(IMPOSTOR_TEXTURE_UNIT);
 }
 
 demo_instancing::~demo_instancing()
@@ -187,6 +994,28 @@ demo_instancing::~demo_instancing()
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
     glDeleteProgram(Program);
+    InstanceRing.Destroy();
+
+    glDeleteProgram(CullProgram);
+    glDeleteProgram(CulledProgram);
+    glDeleteProgram(CulledMeshProgram);
+    glDeleteVertexArrays(1, &CullVAO);
+    glDeleteVertexArrays(1, &CulledVAO);
+    glDeleteVertexArrays(1, &CulledMeshVAO);
+    glDeleteBuffers(1, &CullSourceBuffer);
+    glDeleteTextures(1, &MeshTexture);
+    for (cull_output* Output : { &CulledMeshes, &CulledImpostors })
+    {
+        glDeleteBuffers(1, &Output->Buffer);
+        glDeleteQueries(1, &Output->Query);
+        if (Output->Feedback)
+            GL::GetExtensions().DeleteTransformFeedbacksProc(1, &Output->Feedback);
+    }
+
+    glDeleteProgram(ImpostorProgram);
+    glDeleteProgram(CulledImpostorProgram);
+    glDeleteVertexArrays(1, &ImpostorVAO);
+    glDeleteVertexArrays(1, &CulledImpostorVAO);
 }
 
 void demo_instancing::Update(const platform_io& IO)
@@ -196,22 +1025,50 @@ void demo_instancing::Update(const platform_io& IO)
 
     Camera = CameraUpdateFreefly(Camera, IO.CameraInputs);
 
-    // Clear screen
-    glClearColor(0.f, 0.f, 0.f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    mat4 ProjectionMatrix = Mat4::Perspective(Math::ToRadians(60.f), AspectRatio, 0.1f, 100.f);
+    mat4 ProjectionMatrix = Mat4::Perspective(Math::ToRadians(60.f), AspectRatio, 0.1f, 500.f);
     mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
 
     mat4 ModelMatrix = Mat4::Translate({ 0.f, 0.f, 0.f });
 
+    // Bounding sphere diameter in pixels: 2 * Radius * ProjectionMatrix[1][1] * WindowHeight / 2 / Distance
+    bool CanUseImpostors = UseImpostors && Impostors.IsBaked() && CullingMode != INSTANCE_CULLING_NONE;
+    ImpostorDistance = CanUseImpostors ? ProjectionMatrix.e[5] * IO.WindowHeight / ImpostorScreenSize : 0.f;
+
+    // Instances are culled in world space (identity model matrix)
+    if (Animate)
+        elapsedTime += (float)IO.DeltaTime;
+    if (CullingMode == INSTANCE_CULLING_GPU)
+    {
+        CullInstancesGPU(ProjectionMatrix * ViewMatrix);
+    }
+    else
+    {
+        UpdateInstances(elapsedTime);
+        CullInstances(ProjectionMatrix * ViewMatrix);
+    }
+
+    // Clear screen
+    glClearColor(0.f, 0.f, 0.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
     // Render tavern
     this->Render(ProjectionMatrix, ViewMatrix, ModelMatrix);
 
+    // Depth of this frame for the occlusion test of the next one
+    if (CullingMode == INSTANCE_CULLING_GPU && UseHiZ)
+    {
+        HiZ.Build(IO.WindowWidth, IO.WindowHeight);
+        HiZViewProjection = ProjectionMatrix * ViewMatrix;
+    }
+    else
+    {
+        HiZ.Invalidate();
+    }
+
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(scene.MeshBuffer, scene.MeshDesc.Stride, scene.MeshDesc.PositionOffset, scene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(scene.MeshPositionBuffer, sizeof(v3), 0, scene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, scene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -225,6 +1082,63 @@ void demo_instancing::DisplayDebugUI()
     {
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
+
+        bool GPUCulling = CullingMode == INSTANCE_CULLING_GPU;
+        if (ImGui::SliderInt("Instances", &InstanceCount, 1, GPUCulling ? MAX_GPU_INSTANCE_COUNT : MAX_INSTANCE_COUNT))
+            CreateInstances();
+        ImGui::Checkbox("Animate", &Animate);
+
+        const char* CullingModes[] = { "None", "CPU (worker threads)", "GPU (transform feedback)" };
+        if (ImGui::Combo("Culling", &CullingMode, CullingModes, ARRAY_SIZE(CullingModes)))
+        {
+            if (CullingMode != INSTANCE_CULLING_GPU)
+                InstanceCount = Math::Min(InstanceCount, MAX_INSTANCE_COUNT);
+            CreateInstances();
+        }
+
+        if (CullingMode == INSTANCE_CULLING_CPU)
+            ImGui::Checkbox("Front to back sort", &SortFrontToBack);
+
+        if (GPUCulling)
+        {
+            ImGui::Checkbox("Hi-Z occlusion (last frame depth)", &UseHiZ);
+            // The culled buffer is sized for the draw mode
+            if (CanDrawFeedback)
+            {
+                if (ImGui::Checkbox("Count on the GPU (draw per triangle from the feedback object)", &DrawFromFeedback))
+                    CreateInstances();
+            }
+            else
+            {
+                ImGui::Text("No ARB_transform_feedback_instanced, the visible count is read back");
+            }
+        }
+
+        if (CullingMode != INSTANCE_CULLING_NONE)
+        {
+            ImGui::Checkbox("Impostors", &UseImpostors);
+            ImGui::SliderFloat("Impostor below (pixels)", &ImpostorScreenSize, 8.f, 256.f);
+            if (ImGui::Button("Rebake impostors"))
+            {
+                Impostors.Bake(scene.MeshBuffer, scene.MeshDesc, scene.MeshVertexCount, scene.MeshBoundsMin, scene.MeshBoundsMax,
+                    scene.DiffuseTexture, scene.EmissiveTexture);
+            }
+            Impostors.DisplayDebugUI();
+        }
+
+        ImGui::Text("Instances tested: %d, drawn: %d, impostors: %d", InstancesTested, InstancesDrawn, ImpostorsDrawn);
+        if (GPUCulling)
+        {
+            ImGui::Text("CPU: %.3f ms, read back wait: %.3f ms, GPU cull: %.3f ms", CullTimeMs, ReadbackWaitMs, GPUCullTimeMs);
+        }
+        else
+        {
+            ImGui::Text("CPU update: %.3f ms, upload: %.3f ms", UpdateTimeMs, UploadTimeMs);
+            ImGui::Text("CPU cull: %.3f ms, sort: %.3f ms (%d worker threads)", CullTimeMs, SortTimeMs, Jobs::GetWorkerCount());
+            ImGui::Text("Instance stream: %.2f MB per frame (%s)", InstanceRing.GetFrameUsage() / (1024.f * 1024.f),
+                InstanceRing.IsPersistent() ? "persistently mapped ring" : "orphaned buffer");
+        }
+
         if (ImGui::TreeNodeEx("Camera"))
         {
             ImGui::Text("Position: (%.2f, %.2f, %.2f)", Camera.Position.x, Camera.Position.y, Camera.Position.z);
@@ -247,12 +1161,8 @@ void demo_instancing::Render(const mat4& ProjectionMatrix, const mat4& ViewMatri
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
 
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, scene.LightsUniformBuffer);
@@ -264,7 +1174,44 @@ void demo_instancing::Render(const mat4& ProjectionMatrix, const mat4& ViewMatri
     glBindTexture(GL_TEXTURE_2D, scene.NormalTexture);
     glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
 
-    // Draw mesh
+    if (CullingMode == INSTANCE_CULLING_GPU)
+    {
+        DrawInstancesGPU();
+        glBindVertexArray(0);
+        return;
+    }
+
+    // Point the instance attributes at this frame data
     glBindVertexArray(VAO);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, scene.MeshVertexCount, INSTANCES_COUNT);
+    if (InstanceOffset >= 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, InstanceRing.GetBuffer());
+        for (int Row = 0; Row < 3; ++Row)
+            glVertexAttribPointer(3 + Row, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(InstanceOffset + OFFSETOF(instance_data, Rows) + Row * sizeof(v4)));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(InstanceOffset + OFFSETOF(instance_data, Tint)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Draw mesh
+        if (InstancesDrawn > 0)
+            glDrawArraysInstanced(GL_TRIANGLES, 0, scene.MeshVertexCount, InstancesDrawn);
+
+        // Impostors follow the meshes in the ring, one point each
+        if (ImpostorsDrawn > 0)
+        {
+            GLintptr ImpostorOffset = InstanceOffset + InstancesDrawn * sizeof(instance_data);
+            glBindVertexArray(ImpostorVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, InstanceRing.GetBuffer());
+            for (int Row = 0; Row < 3; ++Row)
+                glVertexAttribPointer(3 + Row, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(ImpostorOffset + OFFSETOF(instance_data, Rows) + Row * sizeof(v4)));
+            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(ImpostorOffset + OFFSETOF(instance_data, Tint)));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            UseImpostorProgram(ImpostorProgram);
+            glDrawArrays(GL_POINTS, 0, ImpostorsDrawn);
+        }
+        glBindVertexArray(0);
+    }
+
+    // The ring section is reused once the GPU is done with this frame
+    InstanceRing.EndFrame();
 }
@@ -1,15 +1,49 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "demo.h"
 
 #include "opengl_headers.h"
 
 #include "camera.h"
+#include "impostor_atlas.h"
+#include "maths_frustum.h"
+#include "opengl_helpers_hiz.h"
+#include "opengl_helpers_query.h"
+#include "opengl_helpers_ring.h"
 
 #include "backpack_scene.h"
 
+// Per-instance vertex attributes, streamed every frame (locations 3 to 6, divisor 1)
+struct instance_data
+{
+    v4 Rows[3]; // Model matrix rows (3x4 affine, uniform scale)
+    v4 Tint;    // Diffuse multiplier (rgb) and emissive intensity (a)
+};
+
+// Static input of the GPU culling pass, animated by its vertex shader (locations 0 and 1)
+struct gpu_instance_source
+{
+    v4 PositionPhase;
+    v4 Tint;
+};
+
+// Visible instance written by the GPU culling pass (locations 3 and 6), the matrix is rebuilt from the angle
+struct gpu_culled_instance
+{
+    v4 PositionAngle;
+    v4 Tint;
+};
+
+enum instance_culling
+{
+    INSTANCE_CULLING_NONE,
+    INSTANCE_CULLING_CPU, // Worker threads, compacted and sorted front to back
+    INSTANCE_CULLING_GPU, // Transform feedback, frustum and Hi-Z occlusion
+};
+
 class demo_instancing : public demo
 {
 public:
@@ -21,6 +55,13 @@ public:
     void DisplayDebugUI();
 
 private:
+    void CreateInstances();
+    void UpdateInstances(float Time);
+    void CullInstances(const mat4& ViewProjection);
+    void CreateGPUCulling();
+    void CullInstancesGPU(const mat4& ViewProjection);
+    void DrawInstancesGPU();
+    void UseImpostorProgram(GLuint ImpostorProgram); // With the atlas and its uniforms
     GL::debug& GLDebug;
 
     // 3d camera
@@ -32,6 +73,95 @@ private:
 
     backpack_scene scene;
 
+    // Instance data written each frame, the visible ones are drawn from the ring at InstanceOffset
+    GL::stream_ring InstanceRing;
+    GLintptr InstanceOffset = -1;
+    std::vector<instance_data> Instances;
+    std::vector<instance_data> VisibleInstances; // Culled and sorted copy of Instances
+
+    // Culling: world-space bounding spheres, then per chunk of blocks the visible instances as
+    // (squared distance << 32 | index) keys, compacted to the front of SortKeys
+    std::vector<sphere_block> InstanceSpheres;
+    std::vector<uint64_t> SortKeys;
+    std::vector<uint32_t> ImpostorIndices; // Same layout as SortKeys, visible instances drawn as impostors
+    std::vector<int> ChunkVisibleCounts;
+    std::vector<int> ChunkImpostorCounts;
+    v3 MeshCenter = {};
+    float MeshRadius = 0.f;
+
+    // Animation parameters of every instance
+    std::vector<v3> InstancePositions;
+    std::vector<float> InstancePhases;
+    std::vector<v4> InstanceTints;
+    std::vector<float> Angles, Sines, Cosines; // Per frame scratch
+
+    // GPU culling: the source instances go through CullProgram with the rasterizer disabled, its geometry
+    // shader streams the visible ones to CulledMeshes (transform feedback).
+    // With ARB_transform_feedback_instanced (default), the count stays on the GPU in the feedback object: each
+    // instance is written 3 times and drawn triangle by triangle (CulledMeshProgram, one draw instance per mesh
+    // triangle, vertices fetched from MeshTexture). No read back, the CPU only submits.
+    // Fallback: the count is read back from the query once the passes are submitted (the CPU waits for them)
+    // and the mesh is drawn instanced.
+    // Impostors are culled by a second pass to their own output (points, drawn with CulledImpostorProgram).
+    struct cull_output
+    {
+        GLuint Buffer = 0;
+        GLuint Feedback = 0;
+        GLuint Query = 0;
+        bool QueryPending = false;
+        int QueryCopies = 1;
+        int Count = 0; // Instances, read back from Query
+    };
+
+    void RunCullPass(cull_output& Output, int Select, int Copies, bool FeedbackDraw);
+    void ReadCullCount(cull_output& Output);
+
+    GLuint CullProgram = 0;
+    GLuint CulledProgram = 0;
+    GLuint CulledMeshProgram = 0;
+    GLuint CullVAO = 0;
+    GLuint CulledVAO = 0;
+    GLuint CulledMeshVAO = 0;
+    GLuint CullSourceBuffer = 0;
+    GLuint MeshTexture = 0;
+    cull_output CulledMeshes;
+    cull_output CulledImpostors;
+    bool CanDrawFeedback = false; // Extension and texture buffer size
+    bool DrawFromFeedback = true;  // Count kept on the GPU, per triangle draw
+    GL::gpu_timer CullTimer;
+
+    // Occlusion against the depth of the last frame, tested in its own view
+    GL::hiz_pyramid HiZ;
+    mat4 HiZViewProjection = {};
+    bool UseHiZ = true;
+
+    // Distant instances drawn as octahedral impostors, one point expanded to a camera-facing quad
+    impostor_atlas Impostors;
+    GLuint ImpostorProgram = 0;       // instance_data from the ring
+    GLuint CulledImpostorProgram = 0; // gpu_culled_instance from CulledImpostors
+    GLuint ImpostorVAO = 0;
+    GLuint CulledImpostorVAO = 0;
+    bool UseImpostors = true;
+    float ImpostorScreenSize = 64.f; // Bounding sphere diameter in pixels under which instances become impostors
+    float ImpostorDistance = 0.f;    // Impostor when farther than radius * ImpostorDistance (0: disabled)
+
+    int InstanceCount = 16384;
+    float InstanceSpacing = 5.f;
+    bool Animate = true;
+    int CullingMode = INSTANCE_CULLING_CPU;
+    bool SortFrontToBack = true;
+
+    // CPU cost and counters of the last frame
+    double UpdateTimeMs = 0.0;
+    double CullTimeMs = 0.0;
+    double SortTimeMs = 0.0;
+    double UploadTimeMs = 0.0;
+    double GPUCullTimeMs = 0.0;
+    double ReadbackWaitMs = 0.0; // GPU culling without the feedback draw
+    int InstancesTested = 0;
+    int InstancesDrawn = 0;
+    int ImpostorsDrawn = 0;
+
     float elapsedTime = 0.f;
     bool Wireframe = false;
 };
@@ -22,12 +22,6 @@ layout(location = 2) in vec3 aNormal;
 layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
@@ -61,16 +55,10 @@ in vec3 vNormal;
 in mat3 vTBN;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 uniform sampler2D uNormalTexture;
 
-uniform bool uHasNormal;
-uniform bool uUseGamma;
-
 vec3 Normal;
 
 // Uniform blocks
@@ -99,31 +87,24 @@ light_shade_result get_lights_shading()
 
 void main()
 {
-    if(uHasNormal)
-    {
-        Normal = texture(uNormalTexture, vUV).rgb;
-        Normal = normalize(Normal * 2.0 - 1.0);
-        Normal = normalize(vTBN * Normal);
-    }
-    else
-    {
-        Normal = vNormal;
-    }
+#ifdef HAS_NORMAL
+    Normal = texture(uNormalTexture, vUV).rgb;
+    Normal = normalize(Normal * 2.0 - 1.0);
+    Normal = normalize(vTBN * Normal);
+#else
+    Normal = vNormal;
+#endif
 
     // Compute phong shading
     light_shade_result lightResult = get_lights_shading();
     
     float gamma = 2.2;
     
-    vec3 diffuseText;
-    if(uUseGamma)
-    {
-        diffuseText = pow(texture(uDiffuseTexture, vUV).rgb, vec3(gamma));
-    }
-    else
-    {
-        diffuseText = texture(uDiffuseTexture, vUV).rgb;
-    }
+#ifdef USE_GAMMA
+    vec3 diffuseText = pow(texture(uDiffuseTexture, vUV).rgb, vec3(gamma));
+#else
+    vec3 diffuseText = texture(uDiffuseTexture, vUV).rgb;
+#endif
     vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * diffuseText;
     vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * diffuseText;
     vec3 specularColor = gDefaultMaterial.specular * lightResult.specular;
@@ -133,13 +114,24 @@ void main()
     oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
 
     // Apply gamma
-    if(uUseGamma)
-    {
-        // apply gamma correction
-        oColor.rgb = pow(oColor.rgb, vec3(1.0/gamma));
-    }
+#ifdef USE_GAMMA
+    oColor.rgb = pow(oColor.rgb, vec3(1.0/gamma));
+#endif
 })GLSL";
 
+// Fragment shader features
+enum mix_features
+{
+    FEATURE_HAS_NORMAL = 1 << 0,
+    FEATURE_USE_GAMMA  = 1 << 1,
+};
+
+static const std::vector<const char*> gFeatureNames =
+{
+    "HAS_NORMAL",
+    "USE_GAMMA",
+};
+
 demo_mix::demo_mix(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), scene(GLCache)
 {
@@ -153,7 +145,7 @@ demo_mix::demo_mix(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_SHADOW | GLINCLUDE_KERNELS);
+        this->Programs = new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_SHADOW | GLINCLUDE_KERNELS | GLINCLUDE_FRAMECONSTANTS, gFeatureNames);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -182,11 +174,16 @@ demo_mix::demo_mix(GL::cache& GLCache, GL::debug& GLDebug)
 
     // Set uniforms that won't change
     {
-        glUseProgram(Program);
-        glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
-        glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
-        glUniform1i(glGetUniformLocation(Program, "uNormalTexture"), 2);
-        glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        Programs->SetProgramSetup([](GLuint Program)
+        {
+            glUseProgram(Program);
+            glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
+            glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
+            glUniform1i(glGetUniformLocation(Program, "uNormalTexture"), 2);
+            glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        });
+        // Default UI state, other combinations are compiled on demand
+        Programs->Precompile({ FEATURE_HAS_NORMAL | FEATURE_USE_GAMMA });
     }
 }
 
@@ -194,7 +191,7 @@ demo_mix::~demo_mix()
 {
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
-    glDeleteProgram(Program);
+    delete Programs;
 }
 
 void demo_mix::Update(const platform_io& IO)
@@ -219,7 +216,7 @@ void demo_mix::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(scene.MeshBuffer, scene.MeshDesc.Stride, scene.MeshDesc.PositionOffset, scene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(scene.MeshPositionBuffer, sizeof(v3), 0, scene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, scene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -235,6 +232,7 @@ void demo_mix::DisplayDebugUI()
         ImGui::Checkbox("Wireframe", &Wireframe);
         ImGui::Checkbox("Use Normal Map", &UseNormalMap);
         ImGui::Checkbox("Use Gamma Correction", &UseGamma);
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs->GetVariantCount(), Programs->GetCompileTimeMs());
 
         if (ImGui::TreeNodeEx("Camera"))
         {
@@ -256,19 +254,13 @@ void demo_mix::Render(const mat4& ProjectionMatrix, const mat4& ViewMatrix, cons
     glEnable(GL_DEPTH_TEST);
 
     // Use shader and configure its uniforms
+    uint32_t Features = (UseNormalMap ? FEATURE_HAS_NORMAL : 0) | (UseGamma ? FEATURE_USE_GAMMA : 0);
+    GLuint Program = Programs->GetProgram(Features);
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
-
-    glUniform1i(glGetUniformLocation(Program, "uHasNormal"),UseNormalMap);
-
-    glUniform1i(glGetUniformLocation(Program, "uUseGamma"), UseGamma);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
    
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, scene.LightsUniformBuffer);
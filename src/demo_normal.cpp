@@ -27,10 +27,6 @@ layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
 uniform bool uOrthogonize;
 
 // Varyings
@@ -76,11 +72,6 @@ in vec3 vNormal;
 in mat3 vTBN;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-uniform bool uShowNormal;
-uniform bool uHasNormal;
-uniform bool uUseTangentSpace;
 uniform bool uUseSlider;
 uniform float uSliderValue;
 uniform bool uShowHalfNormal;
@@ -117,11 +108,16 @@ light_shade_result get_lights_shading()
 
 void main()
 {
-    bool useNormal = uHasNormal && (uUseSlider ? false : true);
+#ifdef SHOW_NORMAL
+    bool showNormal = true;
+#else
+    bool showNormal = false;
+#endif
 
-    bool showNormal = uShowNormal;
+#ifdef HAS_NORMAL
+    bool useNormal = !uUseSlider;
 
-    if(uHasNormal && uUseSlider)
+    if(uUseSlider)
     {
         bool showHalfNormal = uShowHalfNormal && !showNormal;
         if(vPos.x < uSliderValue + 0.005 && vPos.x > uSliderValue - 0.005
@@ -147,7 +143,9 @@ void main()
         Normal = texture(uNormalTexture, vUV).rgb;
         Normal = normalize(Normal * 2.0 - 1.0);
         
-        if(uUseTangentSpace) Normal = normalize(vTBN * Normal);
+#ifdef USE_TANGENT_SPACE
+        Normal = normalize(vTBN * Normal);
+#endif
 
         if(showNormal)
         {   
@@ -156,6 +154,7 @@ void main()
         }
     }
     else
+#endif
     {
         Normal = vNormal;
         if(showNormal)
@@ -177,6 +176,21 @@ void main()
     oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
 })GLSL";
 
+// Fragment shader features
+enum normal_features
+{
+    FEATURE_HAS_NORMAL        = 1 << 0,
+    FEATURE_SHOW_NORMAL       = 1 << 1,
+    FEATURE_USE_TANGENT_SPACE = 1 << 2,
+};
+
+static const std::vector<const char*> gFeatureNames =
+{
+    "HAS_NORMAL",
+    "SHOW_NORMAL",
+    "USE_TANGENT_SPACE",
+};
+
 static const char* gVDebugShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
@@ -186,8 +200,6 @@ layout(location = 3) in vec3 aTangent;
 layout(location = 4) in vec3 aBitangent;
 
 // Uniforms
-uniform mat4 uModel;
-uniform mat4 uView;
 uniform bool  uOrthogonize;
 
 out VS_OUT {
@@ -227,8 +239,6 @@ static const char* gGDebugShaderStr = R"GLSL(
 layout(points) in;
 layout(line_strip, max_vertices = 6) out;
 
-uniform mat4 uProjection;
-
 in VS_OUT {
     vec3 tangent;
     vec3 bitangent;
@@ -299,17 +309,22 @@ demo_normal::demo_normal(GL::cache& GLCache, GL::debug& GLDebug)
                 gFragmentShaderStr,
             };
 
-            Program.push_back(GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT));
-
+            Programs.push_back(new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS, gFeatureNames));
 
-            glUseProgram(Program[i]);
-            glUniform1i(glGetUniformLocation(Program[i], "uDiffuseTexture"), 0);
-            glUniform1i(glGetUniformLocation(Program[i], "uEmissiveTexture"), 1);
-            glUniform1i(glGetUniformLocation(Program[i], "uNormalTexture"), 2);
-            glUniformBlockBinding(Program[i], glGetUniformBlockIndex(Program[i], "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+            Programs[i]->SetProgramSetup([](GLuint Program)
+            {
+                glUseProgram(Program);
+                glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
+                glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
+                glUniform1i(glGetUniformLocation(Program, "uNormalTexture"), 2);
+                glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+            });
+
+            // Default UI state, other combinations are compiled on demand
+            Programs[i]->Precompile({ FEATURE_HAS_NORMAL | FEATURE_USE_TANGENT_SPACE });
         }
 
-        this->Debug = GL::CreateProgramEx(gVDebugShaderStr, gFDebugShaderStr, gGDebugShaderStr);
+        this->Debug = GL::CreateProgramEx(gVDebugShaderStr, gFDebugShaderStr, gGDebugShaderStr, GLINCLUDE_FRAMECONSTANTS);
         //this->Debug = GL::CreateProgramEx(1,&gVDebugShaderStr,1, &gFDebugShaderStr);
     }
 }
@@ -323,10 +338,10 @@ demo_normal::~demo_normal()
         scenes.pop_back();
     }
 
-    while (!Program.empty())
+    while (!Programs.empty())
     {
-        glDeleteProgram(Program.back());
-        Program.pop_back();
+        delete Programs.back();
+        Programs.pop_back();
     }
     glDeleteProgram(Debug);
 }
@@ -359,7 +374,7 @@ void demo_normal::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(scenes[currentScene]->MeshBuffer, scenes[currentScene]->MeshDesc.Stride, scenes[currentScene]->MeshDesc.PositionOffset, scenes[currentScene]->MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(scenes[currentScene]->MeshPositionBuffer, sizeof(v3), 0, scenes[currentScene]->MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, scenes[currentScene]->MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -402,6 +417,8 @@ void demo_normal::DisplayDebugUI()
 
         ImGui::Checkbox("Show Normal Colors", &ShowNormals);
 
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs[currentScene]->GetVariantCount(), Programs[currentScene]->GetCompileTimeMs());
+
         ImGui::Checkbox("Wireframe", &Wireframe);
 
         if (ImGui::TreeNodeEx("Camera"))
@@ -423,23 +440,19 @@ void demo_normal::Render(const mat4& ProjectionMatrix, const mat4& ViewMatrix, c
     glEnable(GL_DEPTH_TEST);
 
     // Use shader and configure its uniforms
-    glUseProgram(Program[currentScene]);
+    uint32_t Features = (UseNormalMap ? FEATURE_HAS_NORMAL : 0)
+        | (ShowNormals ? FEATURE_SHOW_NORMAL : 0)
+        | (UseTangentSpace ? FEATURE_USE_TANGENT_SPACE : 0);
+    GLuint Program = Programs[currentScene]->GetProgram(Features);
+    glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program[currentScene], "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-
-    glUniform3fv(glGetUniformLocation(Program[currentScene], "uViewPosition"), 1, Camera.Position.e);
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uHasNormal"), UseNormalMap);
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uShowNormal"), ShowNormals);
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uShowHalfNormal"), ShowHalfNormal);
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uOrthogonize"), Orthogonize); 
-    glUniform1i(glGetUniformLocation(Program[currentScene], "uUseSlider"), UseSlider);
-    glUniform1f(glGetUniformLocation(Program[currentScene], "uSliderValue"), Slider); 
-    glUniform1f(glGetUniformLocation(Program[currentScene], "uUseTangentSpace"), UseTangentSpace); 
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+    glUniform1i(glGetUniformLocation(Program, "uShowHalfNormal"), ShowHalfNormal);
+    glUniform1i(glGetUniformLocation(Program, "uOrthogonize"), Orthogonize); 
+    glUniform1i(glGetUniformLocation(Program, "uUseSlider"), UseSlider);
+    glUniform1f(glGetUniformLocation(Program, "uSliderValue"), Slider); 
     
 
     // Bind uniform buffer and textures
@@ -460,11 +473,7 @@ void demo_normal::Render(const mat4& ProjectionMatrix, const mat4& ViewMatrix, c
     //  DEBUG
     glUseProgram(Debug);
 
-    // Set uniforms
-    glUniformMatrix4fv(glGetUniformLocation(Debug, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Debug, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Debug, "uView"), 1, GL_FALSE, ViewMatrix.e);
-
+    // Set uniforms (frame and draw blocks are still bound)
     glUniform1i(glGetUniformLocation(Debug, "uOrthogonize"), Orthogonize);
 
     // Draw mesh
@@ -31,7 +31,7 @@ private:
     int currentScene = 0;
 
     // GL objects needed by this demo
-    std::vector<GLuint> Program;
+    std::vector<GL::shader_permutations*> Programs;
     GLuint Debug = 0;
     std::vector<scene*> scenes;
 
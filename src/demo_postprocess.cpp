@@ -21,12 +21,6 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
@@ -50,9 +44,6 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 
@@ -126,7 +117,6 @@ static const char* gPostprocessFragmentShaderStr = R"GLSL(
 in vec2 vUV;
 
 //  Uniforms
-uniform int uMode;
 uniform bool uShake;
 uniform sampler2D uScreenTexture;
 
@@ -135,28 +125,20 @@ out vec4 oColor;
 
 void main()
 {    
-    if(uMode == 0)
-    {
-        oColor = texture(uScreenTexture, vUV);
-    }
-    else if (uMode == 1)
-    {
-        oColor = vec4(vec3(1.0 - texture(uScreenTexture, vUV)), 1.0);
-    }
-    else if (uMode == 2)
-    {
-        oColor = texture(uScreenTexture, vUV);
-        float average = (oColor.r + oColor.g + oColor.b) / 3.0;
-        oColor = vec4(average, average, average, 1.0);
-    }
-    else if (uMode == 3)
-    {    
-        oColor = ApplyKernel(kernelBlur,uScreenTexture,vUV);
-    }
-    else if (uMode == 4)
-    {    
-        oColor = ApplyKernel(kernelEdge,uScreenTexture,vUV);
-    }
+    // Mode is selected at compile time (see demo_postprocess::GetModeFeatures)
+#if defined(MODE_INVERSE)
+    oColor = vec4(vec3(1.0 - texture(uScreenTexture, vUV)), 1.0);
+#elif defined(MODE_GRAYSCALE)
+    oColor = texture(uScreenTexture, vUV);
+    float average = (oColor.r + oColor.g + oColor.b) / 3.0;
+    oColor = vec4(average, average, average, 1.0);
+#elif defined(MODE_KERNEL_BLUR)
+    oColor = ApplyKernel(kernelBlur,uScreenTexture,vUV);
+#elif defined(MODE_KERNEL_EDGE)
+    oColor = ApplyKernel(kernelEdge,uScreenTexture,vUV);
+#else
+    oColor = texture(uScreenTexture, vUV);
+#endif
 
     if(uShake)
     {
@@ -188,6 +170,20 @@ enum modes
     COUNT = 6
 };
 
+// Post process shader features (one bit per mode, MODE_NORMAL has none)
+static const std::vector<const char*> gPostProcessFeatureNames =
+{
+    "MODE_INVERSE",
+    "MODE_GRAYSCALE",
+    "MODE_KERNEL_BLUR",
+    "MODE_KERNEL_EDGE",
+};
+
+static uint32_t GetModeFeatures(int Mode)
+{
+    return Mode == MODE_NORMAL ? 0 : 1u << (Mode - 1);
+}
+
 
 demo_postprocess::demo_postprocess(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), TavernScene(GLCache)
@@ -202,9 +198,9 @@ demo_postprocess::demo_postprocess(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS);
 
-        this->PostProcessProgram = GL::CreateProgramEx(1, &gPostprocessVertexShaderStr, 1, &gPostprocessFragmentShaderStr, GLINCLUDE_KERNELS);
+        this->PostProcessPrograms = new GL::shader_permutations(1, &gPostprocessVertexShaderStr, 1, &gPostprocessFragmentShaderStr, GLINCLUDE_KERNELS, gPostProcessFeatureNames);
     }
     
     //  Create post-process quad
@@ -246,8 +242,14 @@ demo_postprocess::demo_postprocess(GL::cache& GLCache, GL::debug& GLDebug)
         glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
         glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
 
-        glUseProgram(PostProcessProgram);
-        glUniform1i(glGetUniformLocation(Program, "uScreenTexture"), 0);
+        PostProcessPrograms->SetProgramSetup([](GLuint PostProcessProgram)
+        {
+            glUseProgram(PostProcessProgram);
+            glUniform1i(glGetUniformLocation(PostProcessProgram, "uScreenTexture"), 0);
+        });
+
+        // Every mode is reachable from the UI, compile them now rather than on first click
+        PostProcessPrograms->Precompile({ GetModeFeatures(MODE_NORMAL), GetModeFeatures(MODE_INVERSE), GetModeFeatures(MODE_GRAYSCALE), GetModeFeatures(MODE_KERNEL_BLUR), GetModeFeatures(MODE_KERNEL_EDGE) });
     }
 
     //  Generate postprocess frame buffer
@@ -290,6 +292,7 @@ demo_postprocess::~demo_postprocess()
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
     glDeleteProgram(Program);
+    delete PostProcessPrograms;
 }
 
 void demo_postprocess::Update(const platform_io& IO)
@@ -330,7 +333,7 @@ void demo_postprocess::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -385,6 +388,8 @@ void demo_postprocess::DisplayDebugUI()
             
         }
 
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", PostProcessPrograms->GetVariantCount(), PostProcessPrograms->GetCompileTimeMs());
+
 
         if (ImGui::TreeNodeEx("Camera"))
         {
@@ -417,14 +422,13 @@ void demo_postprocess::PostProcess()
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    GLuint PostProcessProgram = PostProcessPrograms->GetProgram(GetModeFeatures(Mode));
     glUseProgram(PostProcessProgram);
 
     int inShake = (int)Shake;
     glUniform1iv(glGetUniformLocation(PostProcessProgram, "uShake"), 1, &inShake);
     if(Shake) glUniform1fv(glGetUniformLocation(PostProcessProgram, "uShakeTime"), 1, &ElapsedTimeShaking);
 
-    glUniform1iv(glGetUniformLocation(PostProcessProgram, "uMode"), 1, &Mode);
-
     glBindVertexArray(ScreenVAO);
     glBindTexture(GL_TEXTURE_2D, ScreenTexture);	// use the color attachment texture as the texture of the quad plane
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -437,12 +441,8 @@ void demo_postprocess::RenderScene(const mat4& ProjectionMatrix, const mat4& Vie
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
     
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
@@ -30,7 +30,7 @@ private:
 
     // GL objects needed by this demo
     GLuint Program = 0;
-    GLuint PostProcessProgram = 0;
+    GL::shader_permutations* PostProcessPrograms = nullptr;
     GLuint VAO = 0;
 
     GLuint ScreenVAO = 0;
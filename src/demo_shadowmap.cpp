@@ -10,9 +10,23 @@
 #include "maths.h"
 #include "mesh.h"
 
+#include "maths_frustum.h"
+#include "opengl_helpers_extensions.h"
+
 #include "demo_shadowmap.h"
 
 const int LIGHT_BLOCK_BINDING_POINT = 0;
+const int SHADOW_ATLAS_TEXTURE_UNIT = 2; // And 3 (raw depths)
+const int SHADOW_MOMENTS_TEXTURE_UNIT = 4;
+
+const float CAMERA_FOV_Y = Math::ToRadians(60.f);
+const float CAMERA_NEAR = 0.1f;
+
+const float SPOT_SHADOW_FAR = 50.f;
+const float POINT_SHADOW_FAR = 25.f;
+
+const int CASTER_LON = 24;
+const int CASTER_LAT = 16;
 
 #pragma region DefaultVertexShader
 static const char* gVertexShaderStr = R"GLSL(
@@ -22,10 +36,6 @@ layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
 //uniform mat4 uMVPDepthMap;
 
 // Varyings
@@ -33,6 +43,9 @@ out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
 out vec3 vNormal; // Vertex normal in view-space
 
+// Matches the depth pre-pass
+invariant gl_Position;
+
 void main()
 {
     vUV = aUV;
@@ -51,33 +64,9 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-uniform float uFarPlane;
-uniform mat4 uMVPDepthMap[8];
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 
-//  DepthTextures
-uniform sampler2D uDepthMap00;
-uniform sampler2D uDepthMap01;
-uniform sampler2D uDepthMap02;
-uniform sampler2D uDepthMap03;
-uniform sampler2D uDepthMap04;
-uniform sampler2D uDepthMap05;
-uniform sampler2D uDepthMap06;
-uniform sampler2D uDepthMap07;
-
-uniform samplerCube uDepthCubeMap00;
-uniform samplerCube uDepthCubeMap01;
-uniform samplerCube uDepthCubeMap02;
-uniform samplerCube uDepthCubeMap03;
-uniform samplerCube uDepthCubeMap04;
-uniform samplerCube uDepthCubeMap05;
-uniform samplerCube uDepthCubeMap06;
-uniform samplerCube uDepthCubeMap07;
-
 // Uniform blocks
 layout(std140) uniform uLightBlock
 {
@@ -87,61 +76,43 @@ layout(std140) uniform uLightBlock
 // Shader outputs
 out vec4 oColor;
 
+//  Shadows Functions in opengl_helpers.cpp (shadow atlas)
 
-sampler2D GetDepthMap(int i)
-{
-    if (i == 0) return uDepthMap00;
-    else if (i == 1) return uDepthMap01;
-    else if (i == 2)  return uDepthMap02;
-    else if (i == 3) return uDepthMap03;
-    else if (i == 4) return uDepthMap04;
-    else if (i == 5) return uDepthMap05;
-    else if (i == 6) return uDepthMap06;
-    else if (i == 7) return uDepthMap07;
-}
-
-samplerCube GetDepthCubeMap(int i)
-{
-    if (i == 0) return uDepthCubeMap00;
-    else if (i == 1) return uDepthCubeMap01;
-    else if (i == 2) return uDepthCubeMap02;
-    else if (i == 3) return uDepthCubeMap03;
-    else if (i == 4) return uDepthCubeMap04;
-    else if (i == 5) return uDepthCubeMap05;
-    else if (i == 6) return uDepthCubeMap06;
-    else if (i == 7) return uDepthCubeMap07;
-}
-
-//  Shadows Functions in opengl_helpers.cpp
-
-float compute_visibility(int current)
+float compute_visibility(int current, vec3 normal, vec3 positionDx, vec3 positionDy)
 {
     if(uLight[current].shadow == false || uLight[current].shadowGenerated == false) return 1.0;
+    if(current >= SHADOW_ATLAS_MAX_TILES / SHADOW_ATLAS_TILES_PER_LIGHT) return 1.0;
 
-    float visibility =1.0;
-
-    if(uLight[current].type == 0 || uLight[current].type == 2)
+    int firstTile = current * SHADOW_ATLAS_TILES_PER_LIGHT;
+    if(uLight[current].type == 0)
     {
-        visibility = 1.0 - shadow_compute_directionnal(GetDepthMap(current), uMVPDepthMap[current], vPos, vNormal, uLight[current].direction);
+        float bias = max(0.005 * (1.0 - dot(normal, normalize(-uLight[current].direction))), 0.005);
+        float viewDepth = -(uView * vec4(vPos, 1.0)).z;
+        return 1.0 - shadow_atlas_compute_cascaded(firstTile, vPos, positionDx, positionDy, viewDepth, bias);
     }
-    else
+
+    if(uLight[current].type == 1)
     {
-        visibility = 1.0 - shadow_compute_point(GetDepthCubeMap(current), vPos,uViewPosition,  uLight[current].position, uFarPlane);
+        vec3 lightDir = normalize(uLight[current].position - vPos);
+        float bias = max(0.001 * (1.0 - dot(normal, lightDir)), 0.0002);
+        return 1.0 - shadow_atlas_compute_point(firstTile, vPos, positionDx, positionDy, uLight[current].position, bias);
     }
 
-    return visibility;
+    float bias = max(0.005 * (1.0 - dot(normal, normalize(-uLight[current].direction))), 0.005);
+    return 1.0 - shadow_atlas_compute(firstTile, vPos, positionDx, positionDy, bias);
 }
 
-light_shade_result get_lights_shading()
+light_shade_result get_lights_shading(vec3 positionDx, vec3 positionDy)
 {
     light_shade_result lightResult = light_shade_result(vec3(0.0), vec3(0.0), vec3(0.0));
 	for (int i = 0; i < LIGHT_COUNT; ++i)
     {
         
-        light_shade_result light = light_shade(uLight[i], gDefaultMaterial.shininess, uViewPosition, vPos, normalize(vNormal));
+        vec3 normal = normalize(vNormal);
+        light_shade_result light = light_shade(uLight[i], gDefaultMaterial.shininess, uViewPosition, vPos, normal);
         lightResult.ambient  += light.ambient;
 
-        float visibility = compute_visibility(i);
+        float visibility = compute_visibility(i, normal, positionDx, positionDy);
 
         lightResult.diffuse  += light.diffuse * visibility;
         lightResult.specular += light.specular * visibility;
@@ -151,8 +122,12 @@ light_shade_result get_lights_shading()
 
 void main()
 {
+    // Derivatives for the shadow filters, taken before any per-light branch
+    vec3 positionDx = dFdx(vPos);
+    vec3 positionDy = dFdy(vPos);
+
     // Compute phong shading
-    light_shade_result lightResult = get_lights_shading();
+    light_shade_result lightResult = get_lights_shading(positionDx, positionDy);
     
     vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * texture(uDiffuseTexture, vUV).rgb;
     vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient * texture(uDiffuseTexture, vUV).rgb;
@@ -178,82 +153,35 @@ void main()
 })GLSL";
 #pragma endregion
 
-#pragma region DepthMapFragmentShader
-static const char* gDepthMapFragmentShaderStr = R"GLSL(
-layout(location = 0) out float aFragDepth;
-
-void main()
-{
-    //aFragDepth = gl_FragCoord.z;
-})GLSL";
-#pragma endregion
+#pragma region LayeredDepthMapVertexShader
+static const char* gLayeredDepthMapVertexShaderStr = R"GLSL(
+#extension GL_ARB_shader_viewport_layer_array : require
 
-#pragma region DepthCubeMapVertexShader
-static const char* gDepthCubeMapVertexShaderStr = R"GLSL(
 // Attributes
 layout(location = 0) in vec3 aPosition;
 
 // Uniforms
-uniform mat4 uModel;
-
-void main()
-{
-    gl_Position = uModel * vec4(aPosition, 1.0);
-})GLSL";
-#pragma endregion
-
-#pragma region DepthCubeMapGeometryShader
-static const char* gDepthCubeMapGeometryShaderStr = R"GLSL(
-layout (triangles) in;
-layout (triangle_strip, max_vertices=18) out;
-
-
-//  Uniforms
 uniform mat4 uMVPDepthMap[6];
-
-//  Shader Outputs
-out vec4 oPosition;
+uniform int uFaces[6]; // Cube face of each instance
 
 void main()
 {
-    for(int face = 0; face < 6; ++face)
-    {
-        gl_Layer = face; // built-in variable that specifies to which face we render.
-        for(int i = 0; i < 3; ++i) // for each triangle vertex
-        {
-            oPosition = gl_in[i].gl_Position;
-            gl_Position = uMVPDepthMap[face] * oPosition;
-            EmitVertex();
-        }    
-        EndPrimitive();
-    }
+    int face = uFaces[gl_InstanceID];
+    gl_ViewportIndex = face;
+    gl_Position = uMVPDepthMap[face] * vec4(aPosition, 1.0);
 })GLSL";
 #pragma endregion
 
-#pragma region DepthCubeMapFragmentShader
-static const char* gDepthCubeMapFragmentShaderStr = R"GLSL(
-
-//  Varyings
-in vec4 oPosition;
-
-//  Uniforms
-uniform vec3 uPosition;
-uniform float uFarPlane;
+#pragma region DepthMapFragmentShader
+static const char* gDepthMapFragmentShaderStr = R"GLSL(
+layout(location = 0) out float aFragDepth;
 
 void main()
 {
-    // get distance between fragment and light source
-    float lightDistance = length(oPosition.xyz - uPosition);
-    
-    // map to [0;1] range by dividing by far_plane
-    lightDistance = lightDistance / uFarPlane;
-    
-    // write this as modified depth
-    gl_FragDepth = lightDistance;
+    //aFragDepth = gl_FragCoord.z;
 })GLSL";
 #pragma endregion
 
-
 demo_shadowmap::demo_shadowmap(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), TavernScene(GLCache)
 {
@@ -267,9 +195,10 @@ demo_shadowmap::demo_shadowmap(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_SHADOW);
+        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_SHADOW_ATLAS | GLINCLUDE_FRAMECONSTANTS);
         this->DepthMapProgram = GL::CreateProgramEx(1, &gDepthMapVertexShaderStr, 1, &gDepthMapFragmentShaderStr);
-        this->DepthCubeMapProgram = GL::CreateProgramEx(gDepthCubeMapVertexShaderStr, gDepthCubeMapFragmentShaderStr, gDepthCubeMapGeometryShaderStr);
+        if (GL::GetExtensions().ShaderViewportLayerArray)
+            this->LayeredDepthMapProgram = GL::CreateProgramEx(1, &gLayeredDepthMapVertexShaderStr, 1, &gDepthMapFragmentShaderStr);
     }
 
     // Create a vertex array and bind attribs onto the vertex buffer
@@ -288,88 +217,8 @@ demo_shadowmap::demo_shadowmap(GL::cache& GLCache, GL::debug& GLDebug)
         glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
     }
 
+    CreateCaster();
 
-    {
-
-        for (int i = 0; i < 8; i++)
-        {
-            //  DEPTH - MAP
-            //  ---------------
-
-            DepthMapFBO.push_back(0);
-            glGenFramebuffers(1, &DepthMapFBO[i]);
-            //glBindFramebuffer(GL_FRAMEBUFFER, DepthMapFBO[i]);
-
-
-            DepthMap.push_back(0);
-
-            glGenTextures(1, &DepthMap[i]);
-            glBindTexture(GL_TEXTURE_2D, DepthMap[i]);
-
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-            float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, DepthMapFBO[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, DepthMap[i], 0);
-
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
-
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            {
-                std::printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!");
-            }
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        }
-
-        for (int i = 0; i < 8; i++)
-        {
-            //  DEPTH - CUBEMAP
-            //  ---------------------
-
-            DepthCubeMapFBO.push_back(0);
-            glGenFramebuffers(1, &DepthCubeMapFBO[i]);
-
-            DepthCubeMap.push_back(0);
-            glGenTextures(1, &DepthCubeMap[i]);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, DepthCubeMap[i]);
-
-            for (unsigned int i = 0; i < 6; ++i)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-            }
-
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, DepthCubeMapFBO[i]);
-            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, DepthCubeMap[i], 0);
-
-            glDrawBuffer(GL_NONE);
-            glReadBuffer(GL_NONE);
-
-            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            {
-                std::printf("ERROR::FRAMEBUFFER:: Framebuffer is not complete!");
-            }
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        }
-        for (int i = 0; i < 8; i++)
-        {
-            DepthMVP.push_back(std::vector<mat4>());
-        }
-    }
 
     // Set uniforms that won't change
     {
@@ -377,30 +226,22 @@ demo_shadowmap::demo_shadowmap(GL::cache& GLCache, GL::debug& GLDebug)
         glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
         glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
 
-        for (int i = 0; i < 8; i++)
-        {
-            std::string name = "uDepthMap0" + std::to_string(i);
-            glUniform1i(glGetUniformLocation(Program, name.c_str()), 2 + i);
-        }
-
-        for (int i = 0; i < 8; i++)
-        {
-            std::string name = "uDepthCubeMap0" + std::to_string(i);
-            glUniform1i(glGetUniformLocation(Program, name.c_str()), 2 + 8 + i);
-        }
+        ShadowAtlas.SetupProgram(Program, SHADOW_ATLAS_TEXTURE_UNIT);
+        Moments.SetupProgram(Program, SHADOW_MOMENTS_TEXTURE_UNIT);
 
         glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
     }
-    DepthMapsGeneration();
 }
 
 demo_shadowmap::~demo_shadowmap()
 {
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &CasterVAO);
+    glDeleteBuffers(1, &CasterBuffer);
     glDeleteProgram(Program);
     glDeleteProgram(DepthMapProgram);
-    glDeleteProgram(DepthCubeMapProgram);
+    glDeleteProgram(LayeredDepthMapProgram);
 }
 
 void demo_shadowmap::Update(const platform_io& IO)
@@ -409,27 +250,29 @@ void demo_shadowmap::Update(const platform_io& IO)
 
     Camera = CameraUpdateFreefly(Camera, IO.CameraInputs);
 
-    // Clear screen
-    glClearColor(0.f, 0.f, 0.f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    mat4 ProjectionMatrix = Mat4::Perspective(CAMERA_FOV_Y, AspectRatio, CAMERA_NEAR, 100.f);
+    mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
+
+    UpdateCaster((float)IO.DeltaTime);
 
-    DepthMapsGeneration();
+    // Shadow tiles and cascades are fitted to this view
+    DepthMapsGeneration(ProjectionMatrix, ViewMatrix, AspectRatio);
 
+    // Clear screen
     glViewport(0, 0, IO.WindowWidth, IO.WindowHeight);
+    glClearColor(0.f, 0.f, 0.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     {
-        mat4 ProjectionMatrix = Mat4::Perspective(Math::ToRadians(60.f), AspectRatio, 0.1f, 100.f);
-        mat4 ViewMatrix = CameraGetInverseMatrix(Camera);
         mat4 ModelMatrix = Mat4::Translate({ 0.f, 0.f, 0.f });
 
         // Render tavern
-        this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix, DepthMVP);
+        this->RenderTavern(ProjectionMatrix, ViewMatrix, ModelMatrix);
 
         // Render tavern wireframe
         if (Wireframe)
         {
-            GLDebug.Wireframe.BindBuffer(TavernScene.MeshBuffer, TavernScene.MeshDesc.Stride, TavernScene.MeshDesc.PositionOffset, TavernScene.MeshVertexCount);
+            GLDebug.Wireframe.BindBuffer(TavernScene.MeshPositionBuffer, sizeof(v3), 0, TavernScene.MeshVertexCount);
             GLDebug.Wireframe.DrawArray(0, TavernScene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
         }
     }
@@ -444,18 +287,24 @@ void demo_shadowmap::DisplayDebugUI()
     {
         // Debug display
         ImGui::Checkbox("Wireframe", &Wireframe);
+        Prepass.DisplayDebugUI();
 
-        static int i = 0;
-        ImGui::SliderInt("Light DepthMap", &i, 0, TavernScene.LightCount - 1);
+        ShadowAtlas.DisplayDebugUI();
+        if (ShadowAtlas.FilterMode == SHADOW_FILTER_EVSM)
+            Moments.DisplayDebugUI();
+        Cascades.DisplayDebugUI();
+        Scheduler.DisplayDebugUI();
 
-        if (TavernScene.GetLight(i)->Type == LIGHT_POINT)
-        {
-            ImGui::Text("CUBEMAP TEXTURE WON'T BE DSIPLAYED");
-        }
+        if (LayeredDepthMapProgram)
+            ImGui::Checkbox("Point shadows in one draw per run (gl_ViewportIndex)", &UseLayeredPointShadows);
         else
-        {
-            ImGui::Image((void*)(intptr_t)DepthMap[i], ImVec2(128, 128));
-        }
+            ImGui::Text("Point shadows: one pass per face (no ARB_shader_viewport_layer_array)");
+        ImGui::Text("Shadow vertices: %d (%d without chunk culling)", ShadowVertexCount, ShadowVertexCountUnculled);
+
+        ImGui::Checkbox("Dynamic caster", &ShowCaster);
+        ImGui::SameLine();
+        ImGui::Checkbox("Animate", &AnimateCaster);
+        ImGui::Text("Shadow tiles: %d static drawn, %d composited", StaticTilesRendered, TilesComposited);
 
         if (ImGui::TreeNodeEx("Camera"))
         {
@@ -472,107 +321,414 @@ void demo_shadowmap::DisplayDebugUI()
 
 
 
-void demo_shadowmap::DepthMapsGeneration()
+void demo_shadowmap::DepthMapsGeneration(const mat4& ProjectionMatrix, const mat4& ViewMatrix, float AspectRatio)
 {
-    glEnable(GL_DEPTH_TEST);
-    glViewport(0, 0, 1024, 1024);
+    int LightCount = Math::Min(TavernScene.LightCount, (int)shadow_atlas::MAX_LIGHT_COUNT);
+    ShadowAtlas.CascadeCount = Math::Clamp(Cascades.CascadeCount, 1, (int)shadow_cascades::MAX_CASCADE_COUNT);
+    ShadowAtlas.Allocate(TavernScene.GetLight(0), LightCount, ViewMatrix, ProjectionMatrix);
+
+    ShadowVertexCount = 0;
+    ShadowVertexCountUnculled = 0;
+    StaticTilesRendered = 0;
+    TilesComposited = 0;
+    UpdatedTiles.clear();
+
+    // Moved tiles hold their static layer only
+    for (int Tile = 0; Tile < shadow_atlas::MAX_TILE_COUNT; Tile++)
+    {
+        if (!ShadowAtlas.HasTileMoved(Tile)) continue;
+        TileHasCaster[Tile] = false;
+        if (ShadowAtlas.HasTileContent(Tile))
+            UpdatedTiles.push_back(Tile);
+    }
 
-    for (int i = 0; i < TavernScene.LightCount; i++)
+    frustum ViewFrustum = Frustum::FromMatrix(ProjectionMatrix * ViewMatrix);
+
+    // Updates needed by the lights in view, ranked by the scheduler
+    Scheduler.BeginFrame();
+    ShadowUpdates.clear();
+    for (int i = 0; i < LightCount; i++)
     {
         GL::light* currentLight = TavernScene.GetLight(i);
-        if (currentLight->Shadow == CASTSHADOW_NONE) continue;
-        if (currentLight->Shadow == CASTSHADOW_STATIC && currentLight->ShadowGenerated) continue;
+        int FirstTile = i * shadow_atlas::TILES_PER_LIGHT;
+        if (!ShadowAtlas.IsTileAllocated(FirstTile)) continue;
+
+        // One update per cascade, one for the other lights
+        shadow_update Updates[shadow_cascades::MAX_CASCADE_COUNT] = {};
+        float Contributions[shadow_cascades::MAX_CASCADE_COUNT];
+        int UpdateCount = 1;
+        Updates[0].Light = i;
+        Updates[0].FirstTile = FirstTile;
+        Updates[0].TileCount = 1;
+
+        if (currentLight->Type == LIGHT_DIRECTIONNAL)
+        {
+            // Cascades follow the camera, their static layer is kept while the snapped projections do not move
+            Cascades.Update(ViewMatrix, CAMERA_FOV_Y, AspectRatio, CAMERA_NEAR, currentLight->Direction,
+                            TavernScene.MeshBoundsMin, TavernScene.MeshBoundsMax, ShadowAtlas.GetTileSize(FirstTile));
+
+            // Near cascades first
+            UpdateCount = ShadowAtlas.CascadeCount;
+            for (int Cascade = 0; Cascade < UpdateCount; Cascade++)
+            {
+                Updates[Cascade].Light = i;
+                Updates[Cascade].FirstTile = FirstTile + Cascade;
+                Updates[Cascade].TileCount = 1;
+                Updates[Cascade].DepthMVPs[0] = Cascades.GetViewProjection(Cascade);
+                Contributions[Cascade] = 1.f / (float)(Cascade + 1);
+            }
+        }
+        else
+        {
+            bool IsPoint = currentLight->Type == LIGHT_POINT;
+            float Range = GetLightShadowRange(currentLight, IsPoint ? POINT_SHADOW_FAR : SPOT_SHADOW_FAR);
+
+            // Lights out of view do not light anything visible
+            if (!Frustum::TestSphere(ViewFrustum, currentLight->Position, Range)) continue;
+
+            // Screen contribution from the distance and the light range
+            float SquaredDistance = Vec3::SquaredLength(currentLight->Position - Camera.Position);
+            Contributions[0] = Math::Min(1.f, Range * Range / Math::Max(SquaredDistance, 0.0001f));
+
+            Updates[0].Range = Range;
+            if (IsPoint)
+            {
+                std::vector<mat4> FaceMVPs = GetPointLightMVP(currentLight);
+                Updates[0].TileCount = 6;
+                for (int Face = 0; Face < 6; Face++)
+                    Updates[0].DepthMVPs[Face] = FaceMVPs[Face];
+            }
+            else
+            {
+                Updates[0].DepthMVPs[0] = GetLightMVP(currentLight);
+            }
+        }
 
+        for (int u = 0; u < UpdateCount; u++)
+        {
+            shadow_update& Update = Updates[u];
+
+            // Static layer out of date, or caster entering, moving in or leaving the tiles.
+            // Only lights not flagged as generated (never drawn or edited) and tiles without content skip
+            // the queue, moved and resized tiles keep a copy of their content
+            bool Needed = false;
+            bool Required = !currentLight->ShadowGenerated;
+            for (int t = 0; t < Update.TileCount; t++)
+            {
+                int Tile = Update.FirstTile + t;
+                Update.DrawCaster[t] = ShowCaster && currentLight->Shadow == CASTSHADOW_DYNAMIC
+                    && IsCasterInView(Update.DepthMVPs[t], currentLight->Position, Update.Range, CasterPosition);
+
+                Required |= !ShadowAtlas.HasTileContent(Tile);
+                Needed |= !ShadowAtlas.IsStaticTileValid(Tile, Update.DepthMVPs[t], Update.Range);
+                Needed |= IsCasterOutdated(Tile, Update.DrawCaster[t]);
+            }
+
+            // Edits that leave the tiles valid still have to set ShadowGenerated back
+            Needed |= Required;
+
+            if (Needed)
+            {
+                Scheduler.AddUpdate(Update.FirstTile, Update.TileCount, Contributions[u], Required);
+                ShadowUpdates.push_back(Update);
+            }
+        }
+    }
+    Scheduler.Schedule();
+
+    glEnable(GL_DEPTH_TEST);
+    Scheduler.BeginUpdates();
+
+    bool LightsChanged = false;
+    for (const shadow_update& Update : ShadowUpdates)
+    {
+        // Tiles waiting for a later frame keep the matrices they were drawn with
+        if (!Scheduler.IsScheduled(Update.FirstTile)) continue;
+
+        GL::light* currentLight = TavernScene.GetLight(Update.Light);
+
+        // Static layer, drawn again only when the light transform or the tiles change
+        bool StaticDirty[6] = {};
+        bool AnyStaticDirty = false;
+        for (int t = 0; t < Update.TileCount; t++)
+        {
+            StaticDirty[t] = !ShadowAtlas.IsStaticTileValid(Update.FirstTile + t, Update.DepthMVPs[t], Update.Range);
+            AnyStaticDirty |= StaticDirty[t];
+            ShadowAtlas.SetTileMatrix(Update.FirstTile + t, Update.DepthMVPs[t]);
+        }
 
         if (currentLight->Type == LIGHT_POINT)
         {
-            DepthMVP[i] = GetPointLightMVP(currentLight);
-            GenerateDepthCubeMap(DepthMVP[i], i);
+            // The faces are drawn together
+            if (AnyStaticDirty)
+            {
+                GenerateDepthCubeMap(std::vector<mat4>(Update.DepthMVPs, Update.DepthMVPs + 6), Update.FirstTile, currentLight->Position, Update.Range);
+                for (int Face = 0; Face < 6; Face++)
+                    StaticDirty[Face] = true;
+            }
         }
-        else
+        else if (AnyStaticDirty)
         {
-            DepthMVP[i].push_back(mat4());
-            DepthMVP[i][0] = GetLightMVP(currentLight);
-            GenerateDepthMap(DepthMVP[i][0], i);
+            GenerateDepthMap(Update.DepthMVPs[0], Update.FirstTile, currentLight->Position, Update.Range);
+        }
+
+        // Atlas tiles, copied from the static layer when it changed or when the caster enters, moves in or leaves them
+        for (int t = 0; t < Update.TileCount; t++)
+        {
+            int Tile = Update.FirstTile + t;
+            if (StaticDirty[t])
+                ShadowAtlas.ValidateStaticTile(Tile, Update.Range);
+
+            if (StaticDirty[t] || IsCasterOutdated(Tile, Update.DrawCaster[t]))
+            {
+                CompositeDepthMap(Update.DepthMVPs[t], Tile, Update.DrawCaster[t]);
+                TileHasCaster[Tile] = Update.DrawCaster[t];
+                TileCasterPositions[Tile] = CasterPosition;
+            }
         }
 
         if (currentLight->ShadowGenerated == false)
         {
             currentLight->ShadowGenerated = true;
-            glBindBuffer(GL_UNIFORM_BUFFER, TavernScene.LightsUniformBuffer);
-            glBufferSubData(GL_UNIFORM_BUFFER, i * sizeof(GL::light), sizeof(GL::light), currentLight);
-            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            LightsChanged = true;
         }
     }
+    ShadowAtlas.EndTiles();
+
+    // Moments of the tiles drawn
+    if (ShadowAtlas.FilterMode == SHADOW_FILTER_EVSM)
+        Moments.Update(ShadowAtlas, UpdatedTiles);
+    else
+        Moments.Invalidate();
+
+    Scheduler.EndUpdates();
+    ShadowAtlas.Upload();
+
+    if (LightsChanged)
+        TavernScene.UploadLights();
     glDisable(GL_DEPTH_TEST);
 }
 
-void demo_shadowmap::GenerateDepthMap(const mat4& DepthMVP, const int current)
+float demo_shadowmap::GetLightShadowRange(const GL::light* light, float FarPlane) const
+{
+    // Nothing past the light range or the far plane can cast a visible shadow
+    float Range = GL::GetLightRange(*light, ShadowAtlas.LightCutoff);
+    return (Range < 0.f) ? FarPlane : Math::Min(Range, FarPlane);
+}
+
+void demo_shadowmap::GenerateDepthMap(const mat4& DepthMVP, const int Tile, const v3& LightPosition, float LightRange)
 {
     glUseProgram(DepthMapProgram);
 
     glCullFace(GL_FRONT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, DepthMapFBO[current]);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    ShadowAtlas.BeginTile(Tile, true);
 
     glUniformMatrix4fv(glGetUniformLocation(DepthMapProgram, "uMVPDepthMap"), 1, GL_FALSE, DepthMVP.e);
 
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Draw the chunks inside the light volume (position stream only)
+    TavernScene.CullChunks(&DepthMVP, 1, LightPosition, LightRange, ChunkMasks);
+    ShadowVertexCount += TavernScene.DrawChunksPositions(ChunkMasks, 0);
+    ShadowVertexCountUnculled += TavernScene.MeshVertexCount;
+    StaticTilesRendered++;
 
     glCullFace(GL_BACK);
 }
 
-void demo_shadowmap::GenerateDepthCubeMap(const std::vector<mat4>& DepthMVP, const int current)
+void demo_shadowmap::GenerateDepthCubeMap(const std::vector<mat4>& DepthMVP, const int FirstTile, const v3& LightPosition, float LightRange)
 {
-    glUseProgram(DepthCubeMapProgram);
+    // Chunks in the light range, then in each face frustum (bit per face)
+    TavernScene.CullChunks(DepthMVP.data(), 6, LightPosition, LightRange, ChunkMasks);
+    ShadowVertexCountUnculled += 6 * TavernScene.MeshVertexCount;
+    StaticTilesRendered += 6;
 
     glCullFace(GL_FRONT);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, DepthCubeMapFBO[current]);
-    glClear(GL_DEPTH_BUFFER_BIT);
-
+    if (UseLayeredPointShadows && LayeredDepthMapProgram && ShadowAtlas.BeginLayeredTiles(FirstTile, 6, true))
+    {
+        // Runs of consecutive chunks seen by the same faces, instanced once per face
+        glUseProgram(LayeredDepthMapProgram);
+        for (int Face = 0; Face < 6; Face++)
+        {
+            std::string name = "uMVPDepthMap[" + std::to_string(Face) + "]";
+            glUniformMatrix4fv(glGetUniformLocation(LayeredDepthMapProgram, name.c_str()), 1, GL_FALSE, DepthMVP[Face].e);
+        }
+        GLint FacesLocation = glGetUniformLocation(LayeredDepthMapProgram, "uFaces");
 
-    glUniformMatrix4fv(glGetUniformLocation(DepthCubeMapProgram, "uModel"), 1, GL_FALSE, Mat4::Identity().e);
-    glUniform1f(glGetUniformLocation(DepthCubeMapProgram, "uFarPlane"), 25.0f);
-    glUniform3fv(glGetUniformLocation(DepthCubeMapProgram, "uPosition"), 1, TavernScene.GetLight(current)->Position.e);
+        glBindVertexArray(TavernScene.PositionVAO);
+        uint8_t CurrentMask = 0;
+        const std::vector<mesh_chunk>& Chunks = TavernScene.MeshChunks;
+        for (size_t i = 0; i < Chunks.size();)
+        {
+            uint8_t Mask = ChunkMasks[i];
+            size_t End = i + 1;
+            while (End < Chunks.size() && ChunkMasks[End] == Mask)
+                End++;
 
-    for (int i = 0; i < 6; i++)
+            if (Mask)
+            {
+                GLint Faces[6];
+                int FaceCount = 0;
+                for (int Face = 0; Face < 6; Face++)
+                {
+                    if (Mask & (1 << Face))
+                        Faces[FaceCount++] = Face;
+                }
+                if (Mask != CurrentMask)
+                {
+                    glUniform1iv(FacesLocation, FaceCount, Faces);
+                    CurrentMask = Mask;
+                }
+
+                int First = Chunks[i].FirstVertex;
+                int Count = Chunks[End - 1].FirstVertex + Chunks[End - 1].VertexCount - First;
+                glDrawArraysInstanced(GL_TRIANGLES, First, Count, FaceCount);
+                ShadowVertexCount += Count * FaceCount;
+            }
+            i = End;
+        }
+    }
+    else
     {
-        std::string name = "uMVPDepthMap[" + std::to_string(i) + "]";
-        glUniformMatrix4fv(glGetUniformLocation(DepthCubeMapProgram, name.c_str()), 1, GL_FALSE, DepthMVP[i].e);
+        // One atlas tile per cube face, with only the chunks of this face
+        glUseProgram(DepthMapProgram);
+        for (int Face = 0; Face < 6; Face++)
+        {
+            ShadowAtlas.BeginTile(FirstTile + Face, true);
+            glUniformMatrix4fv(glGetUniformLocation(DepthMapProgram, "uMVPDepthMap"), 1, GL_FALSE, DepthMVP[Face].e);
+            ShadowVertexCount += TavernScene.DrawChunksPositions(ChunkMasks, Face);
+        }
     }
 
+    glCullFace(GL_BACK);
+}
 
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+void demo_shadowmap::CompositeDepthMap(const mat4& DepthMVP, const int Tile, bool DrawCaster)
+{
+    // Static shadows, then the caster on top
+    ShadowAtlas.CompositeTile(Tile);
+    TilesComposited++;
+    UpdatedTiles.push_back(Tile);
+
+    if (!DrawCaster)
+        return;
+
+    glUseProgram(DepthMapProgram);
+    glCullFace(GL_FRONT);
+
+    mat4 CasterMVP = DepthMVP * GetCasterModel();
+    glUniformMatrix4fv(glGetUniformLocation(DepthMapProgram, "uMVPDepthMap"), 1, GL_FALSE, CasterMVP.e);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindVertexArray(CasterVAO);
+    glDrawArrays(GL_TRIANGLES, 0, CasterVertexCount);
+    ShadowVertexCount += CasterVertexCount;
 
     glCullFace(GL_BACK);
 }
 
+void demo_shadowmap::CreateCaster()
+{
+    CasterVertexCount = CASTER_LON * CASTER_LAT * 6;
+    std::vector<vertex_full> Vertices(CasterVertexCount);
+
+    vertex_descriptor Descriptor = {};
+    Descriptor.Stride = sizeof(vertex_full);
+    Descriptor.HasNormal = true;
+    Descriptor.HasUV = true;
+    Descriptor.PositionOffset = OFFSETOF(vertex_full, Position);
+    Descriptor.NormalOffset = OFFSETOF(vertex_full, Normal);
+    Descriptor.UVOffset = OFFSETOF(vertex_full, UV);
+    Mesh::BuildSphere(Vertices.data(), Vertices.data() + CasterVertexCount, Descriptor, CASTER_LON, CASTER_LAT);
+
+    glGenBuffers(1, &CasterBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, CasterBuffer);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(vertex_full), Vertices.data(), GL_STATIC_DRAW);
+
+    // Same attributes than the scene (the depth programs only read the positions)
+    glGenVertexArrays(1, &CasterVAO);
+    glBindVertexArray(CasterVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Descriptor.Stride, (void*)(size_t)Descriptor.PositionOffset);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Descriptor.Stride, (void*)(size_t)Descriptor.UVOffset);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Descriptor.Stride, (void*)(size_t)Descriptor.NormalOffset);
+    glBindVertexArray(0);
+
+    // Sized from the scene, orbiting around its center low above the floor
+    v3 Min = TavernScene.MeshBoundsMin;
+    v3 Max = TavernScene.MeshBoundsMax;
+    v3 Center = (Min + Max) * 0.5f;
+    float OrbitRadius = Math::Min(Max.x - Min.x, Max.z - Min.z) * 0.25f;
+    CasterRadius = Vec3::Length(Max - Min) * 0.02f;
+
+    transform Pivot = Transform::Identity();
+    Pivot.Translation = { Center.x, Min.y + (Max.y - Min.y) * 0.25f, Center.z };
+    CasterPivot = SceneGraph.CreateNode(SCENE_NODE_NONE, Pivot);
+
+    transform Caster = Transform::Identity();
+    Caster.Translation = { OrbitRadius, 0.f, 0.f };
+    Caster.Scale = { CasterRadius, CasterRadius, CasterRadius };
+    CasterNode = SceneGraph.CreateNode(CasterPivot, Caster);
+
+    UpdateCaster(0.f);
+}
+
+void demo_shadowmap::UpdateCaster(float DeltaTime)
+{
+    if (AnimateCaster)
+        CasterTime += DeltaTime;
+
+    SceneGraph.SetLocalRotation(CasterPivot, Quat::AxisAngle({ 0.f, 1.f, 0.f }, -CasterTime * 0.5f));
+    SceneGraph.Update();
+
+    const mat4& CasterModel = GetCasterModel();
+    CasterPosition = CasterModel.c[3].xyz;
+}
+
+bool demo_shadowmap::IsCasterOutdated(int Tile, bool DrawCaster) const
+{
+    if (DrawCaster != TileHasCaster[Tile])
+        return true;
+    return DrawCaster && Vec3::SquaredLength(CasterPosition - TileCasterPositions[Tile]) > 0.f;
+}
+
+bool demo_shadowmap::IsCasterInView(const mat4& DepthMVP, const v3& LightPosition, float LightRange, const v3& Position) const
+{
+    v3 Min = Position - CasterRadius;
+    v3 Max = Position + CasterRadius;
+
+    // Light range (no range for directional lights)
+    if (LightRange > 0.f)
+    {
+        v3 Closest = { Math::Clamp(LightPosition.x, Min.x, Max.x), Math::Clamp(LightPosition.y, Min.y, Max.y), Math::Clamp(LightPosition.z, Min.z, Max.z) };
+        if (Vec3::SquaredLength(LightPosition - Closest) > LightRange * LightRange)
+            return false;
+    }
+
+    return Frustum::TestAABB(Frustum::FromMatrix(DepthMVP), Min, Max);
+}
+
 
 
-void demo_shadowmap::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, const std::vector< std::vector<mat4>>&  DepthMVP)
+void demo_shadowmap::RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix)
 {
     glEnable(GL_DEPTH_TEST);
 
+    // Set uniforms
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
+
+    // Optional depth only pass
+    if (Prepass.BeginPrepass())
+        TavernScene.DrawScenePositions();
+    glBindVertexArray(VAO);
+
     // Use shader and configure its uniforms
     glUseProgram(Program);
-
-    // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
+    Cascades.SetUniforms(Program);
+    ShadowAtlas.SetFilterUniforms(Program);
+    Moments.SetUniforms(Program);
 
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, TavernScene.LightsUniformBuffer);
@@ -583,34 +739,26 @@ void demo_shadowmap::RenderTavern(const mat4& ProjectionMatrix, const mat4& View
 
     glActiveTexture(GL_TEXTURE0); // Reset active texture
 
-    //      Lights
-
-    for (int i = 0; i < TavernScene.LightCount; i++)
-    {
-        if (TavernScene.GetLight(i)->Shadow == CASTSHADOW_NONE) continue;
-
-        if (TavernScene.GetLight(i)->Type == LIGHT_POINT)
-        {
-            glUniform1f(glGetUniformLocation(Program, "uFarPlane"), 25.0f);
+    // Shadow atlas and its tiles
+    ShadowAtlas.Bind(SHADOW_ATLAS_TEXTURE_UNIT);
+    Moments.Bind(SHADOW_MOMENTS_TEXTURE_UNIT);
 
-            glActiveTexture(GL_TEXTURE2 + 8 + i);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, DepthCubeMap[i]);
-        }
-        else
-        {
-            std::string name = "uMVPDepthMap[" + std::to_string(i) + "]";
-            glUniformMatrix4fv(glGetUniformLocation(Program, name.c_str()), 1, GL_FALSE, DepthMVP[i][0].e);
+    // Draw mesh
+    Prepass.BeginMainPass();
+    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    Prepass.EndMainPass();
 
-            glActiveTexture(GL_TEXTURE2 + i);
-            glBindTexture(GL_TEXTURE_2D, DepthMap[i]);
-        }
+    // Dynamic caster (not in the pre-pass)
+    if (ShowCaster)
+    {
+        GL::SetDrawConstants(GetCasterModel());
+        glBindVertexArray(CasterVAO);
+        glDrawArrays(GL_TRIANGLES, 0, CasterVertexCount);
+        GL::SetDrawConstants(ModelMatrix);
+        glBindVertexArray(VAO);
     }
 
-    glActiveTexture(GL_TEXTURE0);// Reset active texture
-
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, TavernScene.MeshVertexCount);
+    ShadowAtlas.Unbind(SHADOW_ATLAS_TEXTURE_UNIT);
 
     glDisable(GL_DEPTH_TEST);
 }
@@ -618,21 +766,6 @@ void demo_shadowmap::RenderTavern(const mat4& ProjectionMatrix, const mat4& View
 
 mat4 demo_shadowmap::GetLightMVP(const GL::light* light)
 {
-    //  Directionnal Lights
-
-    if (light->Type == LIGHT_DIRECTIONNAL)
-    {
-        v3 eye = { 0.0,2.0,0.0 };
-        v3 at = eye + light->Direction;
-        v3 up = { 0.f,1.f,0.f };
-        mat4 depthProj = Mat4::Orthographic(-10, 10, -10, 10, -10, 20);
-        mat4 depthView = Mat4::LookAt(eye, at, Vec3::Normalize(up));
-        mat4 depthModel = Mat4::Identity();
-        mat4 depthMVP = depthProj * depthView * depthModel;
-
-        return depthMVP;
-    }
-
     //  Spot lights
 
     if(light->Type == LIGHT_SPOT)
@@ -640,7 +773,7 @@ mat4 demo_shadowmap::GetLightMVP(const GL::light* light)
          v3 target = light->Position + light->Direction;
         //v3 lightDir = light.Position.xyz;
     
-         mat4 depthProj = Mat4::Perspective(Math::Acos(light->CutOff.y) * 2.f, 1.0f, 2.0f, 50.0f);
+         mat4 depthProj = Mat4::Perspective(Math::Acos(light->CutOff.y) * 2.f, 1.0f, 2.0f, SPOT_SHADOW_FAR);
          mat4 depthView = Mat4::LookAt(light->Position, target, { 0.f,1.f,0.f });
          mat4 depthModel = Mat4::Identity();
          mat4 depthMVP = depthProj * depthView * depthModel;
@@ -676,7 +809,7 @@ std::vector<mat4> demo_shadowmap::GetPointLightMVP(const GL::light* light)
     {
         v3 target = light->Position + gCameraDirections[i].Target;
 
-        mat4 depthProj = Mat4::Perspective(Math::ToRadians(90.0f), 1.0f, 1.0f, 25.0f);
+        mat4 depthProj = Mat4::Perspective(Math::ToRadians(90.0f), 1.0f, 1.0f, POINT_SHADOW_FAR);
         mat4 depthView = Mat4::LookAt(light->Position, target, gCameraDirections[i].Up);
         mat4 depthModel = Mat4::Identity();
         mat4 depthMVP = depthProj * depthView * depthModel;
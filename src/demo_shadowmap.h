@@ -7,7 +7,12 @@
 #include "opengl_headers.h"
 
 #include "camera.h"
+#include "scene_graph.h"
 
+#include "shadow_atlas.h"
+#include "shadow_cascades.h"
+#include "shadow_moments.h"
+#include "shadow_scheduler.h"
 #include "tavern_scene.h"
 
 class demo_shadowmap : public demo
@@ -17,16 +22,26 @@ public:
     virtual ~demo_shadowmap();
     virtual void Update(const platform_io& IO);
 
-    void DepthMapsGeneration();
-    void GenerateDepthMap(const mat4& DepthMVP, const int lightIndex);
-    void GenerateDepthCubeMap(const std::vector<mat4>& DepthMVP, const int lightIndex);
-    void RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix, const std::vector< std::vector<mat4>>& DepthMVP);
+    void DepthMapsGeneration(const mat4& ProjectionMatrix, const mat4& ViewMatrix, float AspectRatio);
+    void GenerateDepthMap(const mat4& DepthMVP, const int Tile, const v3& LightPosition, float LightRange);
+    void GenerateDepthCubeMap(const std::vector<mat4>& DepthMVP, const int FirstTile, const v3& LightPosition, float LightRange);
+    void CompositeDepthMap(const mat4& DepthMVP, const int Tile, bool DrawCaster);
+    void RenderTavern(const mat4& ProjectionMatrix, const mat4& ViewMatrix, const mat4& ModelMatrix);
     void DisplayDebugUI();
 private:
 
     mat4 GetLightMVP(const GL::light* light); 
+    float GetLightShadowRange(const GL::light* light, float FarPlane) const;
     std::vector<mat4> GetPointLightMVP(const GL::light* light);
 
+    void CreateCaster();
+    void UpdateCaster(float DeltaTime);
+    const mat4& GetCasterModel() const { return SceneGraph.GetWorldMatrix(CasterNode); }
+    // True when the caster (its bounds at this position) can be seen by the light view
+    bool IsCasterInView(const mat4& DepthMVP, const v3& LightPosition, float LightRange, const v3& Position) const;
+    // True when the caster in the atlas tile is not where it should be (or should not be there)
+    bool IsCasterOutdated(int Tile, bool DrawCaster) const;
+
     GL::debug& GLDebug;
 
     // 3d camera
@@ -37,17 +52,66 @@ private:
     GLuint VAO = 0;
 
     GLuint DepthMapProgram = 0;
-    GLuint DepthCubeMapProgram = 0;
+    GLuint LayeredDepthMapProgram = 0; // Six faces in one instanced draw, when gl_ViewportIndex can be written by the vertex shader
+
+    // Depth of every shadow casting light (one tile per light, six for point lights)
+    shadow_atlas ShadowAtlas;
+
+    // Prefiltered atlas of the EVSM filter, and the atlas tiles drawn this frame
+    shadow_moments Moments;
+    std::vector<int> UpdatedTiles;
 
-    std::vector<GLuint> DepthMapFBO;
-    std::vector<GLuint> DepthMap;
+    // Directional lights projections, one atlas tile per cascade
+    shadow_cascades Cascades;
 
-    std::vector<GLuint> DepthCubeMapFBO;
-    std::vector<GLuint> DepthCubeMap;
+    // Shadow updates of the frame within a budget
+    shadow_scheduler Scheduler;
 
-    std::vector<std::vector<mat4>> DepthMVP;
+    // Tiles of a light drawn together (spot light, point light faces or one cascade)
+    struct shadow_update
+    {
+        int Light;
+        int FirstTile;
+        int TileCount;
+        float Range;
+        mat4 DepthMVPs[6];
+        bool DrawCaster[6];
+    };
+    std::vector<shadow_update> ShadowUpdates;
 
     tavern_scene TavernScene;
+    GL::depth_prepass Prepass;
+
+    // Visibility of the scene chunks in the faces/tiles being rendered
+    std::vector<uint8_t> ChunkMasks;
+    bool UseLayeredPointShadows = true;
+
+    // Shadow vertices of the last frame, and without chunk culling
+    int ShadowVertexCount = 0;
+    int ShadowVertexCountUnculled = 0;
+
+    // Animated sphere drawn over the cached static shadows of dynamic lights
+    GLuint CasterBuffer = 0;
+    GLuint CasterVAO = 0;
+    int CasterVertexCount = 0;
+    bool ShowCaster = true;
+    bool AnimateCaster = true;
+    float CasterTime = 0.f;
+    float CasterRadius = 0.f;
+    v3 CasterPosition = {};
+
+    // Dynamic objects: the caster is the child of a pivot turning at the scene center
+    scene_graph SceneGraph;
+    scene_node CasterPivot = SCENE_NODE_NONE;
+    scene_node CasterNode = SCENE_NODE_NONE;
+
+    // Atlas tiles holding the caster and where (to be drawn again when it moves, leaves or the light becomes static)
+    bool TileHasCaster[shadow_atlas::MAX_TILE_COUNT] = {};
+    v3 TileCasterPositions[shadow_atlas::MAX_TILE_COUNT] = {};
+
+    // Tiles of the last frame drawn from the scene (static layer) or only composited with the caster
+    int StaticTilesRendered = 0;
+    int TilesComposited = 0;
 
     bool Wireframe = false;
 };
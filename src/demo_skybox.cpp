@@ -21,12 +21,6 @@ layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec2 aUV;
 layout(location = 2) in vec3 aNormal;
 
-// Uniforms
-uniform mat4 uProjection;
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uModelNormalMatrix;
-
 // Varyings
 out vec2 vUV;
 out vec3 vPos;    // Vertex position in view-space
@@ -50,10 +44,6 @@ in vec3 vPos;
 in vec3 vNormal;
 
 // Uniforms
-uniform mat4 uProjection;
-uniform vec3 uViewPosition;
-uniform int uMode;
-
 uniform sampler2D uDiffuseTexture;
 uniform sampler2D uEmissiveTexture;
 uniform samplerCube uSkyboxCubemap;
@@ -97,28 +87,23 @@ vec4 GetRefractionColor()
 
 void main()
 {
-    if (uMode <= 0)
-    {
-        // Compute phong shading
-        light_shade_result lightResult = get_lights_shading();
-    
-
-        vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * texture(uDiffuseTexture, vUV).rgb;
-        vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient* texture(uDiffuseTexture, vUV).rgb;
-        vec3 specularColor = gDefaultMaterial.specular * lightResult.specular;
-        vec3 emissiveColor = gDefaultMaterial.emission + texture(uEmissiveTexture, vUV).rgb;
-    
-        // Apply light color
-        oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
-    }
-    else if (uMode == 1)
-    {
-        oColor = GetReflectionColor();
-    }
-    else
-    {
-        oColor = GetRefractionColor();
-    }
+#if defined(MODE_REFLECTION)
+    oColor = GetReflectionColor();
+#elif defined(MODE_REFRACTION)
+    oColor = GetRefractionColor();
+#else
+    // Compute phong shading
+    light_shade_result lightResult = get_lights_shading();
+
+
+    vec3 diffuseColor  = gDefaultMaterial.diffuse * lightResult.diffuse * texture(uDiffuseTexture, vUV).rgb;
+    vec3 ambientColor  = gDefaultMaterial.ambient * lightResult.ambient* texture(uDiffuseTexture, vUV).rgb;
+    vec3 specularColor = gDefaultMaterial.specular * lightResult.specular;
+    vec3 emissiveColor = gDefaultMaterial.emission + texture(uEmissiveTexture, vUV).rgb;
+
+    // Apply light color
+    oColor = vec4((ambientColor + diffuseColor + specularColor + emissiveColor), 1.0);
+#endif
 })GLSL";
 #pragma endregion
 
@@ -214,6 +199,18 @@ enum modes
     COUNT = 3
 };
 
+// Scene shader features (one bit per mode, MODE_NORMAL has none)
+static const std::vector<const char*> gSceneFeatureNames =
+{
+    "MODE_REFLECTION",
+    "MODE_REFRACTION",
+};
+
+static uint32_t GetModeFeatures(int Mode)
+{
+    return Mode == MODE_NORMAL ? 0 : 1u << (Mode - 1);
+}
+
 demo_skybox::demo_skybox(GL::cache& GLCache, GL::debug& GLDebug)
     : GLDebug(GLDebug), Scene(GLCache)
 {
@@ -227,7 +224,7 @@ demo_skybox::demo_skybox(GL::cache& GLCache, GL::debug& GLDebug)
             gFragmentShaderStr,
         };
 
-        this->Program = GL::CreateProgramEx(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT);
+        this->Programs = new GL::shader_permutations(1, &gVertexShaderStr, 2, FragmentShaderStrs, GLINCLUDE_PHONGLIGHT | GLINCLUDE_FRAMECONSTANTS, gSceneFeatureNames);
 
 
         this->SkyboxProgram = GL::CreateProgramEx(1, &gSkyboxVertexShaderStr, 1, &gSkyboxFragmentShaderStr, false);
@@ -262,11 +259,15 @@ demo_skybox::demo_skybox(GL::cache& GLCache, GL::debug& GLDebug)
 
     // Set uniforms that won't change
     {
-        glUseProgram(Program);
-        glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
-        glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
-        glUniform1i(glGetUniformLocation(Program, "uSkyboxCubemap"), 2);
-        glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        Programs->SetProgramSetup([](GLuint Program)
+        {
+            glUseProgram(Program);
+            glUniform1i(glGetUniformLocation(Program, "uDiffuseTexture"), 0);
+            glUniform1i(glGetUniformLocation(Program, "uEmissiveTexture"), 1);
+            glUniform1i(glGetUniformLocation(Program, "uSkyboxCubemap"), 2);
+            glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uLightBlock"), LIGHT_BLOCK_BINDING_POINT);
+        });
+        Programs->Precompile({ GetModeFeatures(MODE_NORMAL), GetModeFeatures(MODE_REFLECTION), GetModeFeatures(MODE_REFRACTION) });
 
         glUseProgram(SkyboxProgram);
         glUniform1i(glGetUniformLocation(SkyboxProgram, "uSkyboxCubemap"), 0);
@@ -277,7 +278,8 @@ demo_skybox::~demo_skybox()
 {
     // Cleanup GL
     glDeleteVertexArrays(1, &VAO);
-    glDeleteProgram(Program);
+    delete Programs;
+    glDeleteProgram(SkyboxProgram);
 }
 
 void demo_skybox::Update(const platform_io& IO)
@@ -301,7 +303,7 @@ void demo_skybox::Update(const platform_io& IO)
     // Render tavern wireframe
     if (Wireframe)
     {
-        GLDebug.Wireframe.BindBuffer(Scene.MeshBuffer, Scene.MeshDesc.Stride, Scene.MeshDesc.PositionOffset, Scene.MeshVertexCount);
+        GLDebug.Wireframe.BindBuffer(Scene.MeshPositionBuffer, sizeof(v3), 0, Scene.MeshVertexCount);
         GLDebug.Wireframe.DrawArray(0, Scene.MeshVertexCount, ProjectionMatrix * ViewMatrix * ModelMatrix);
     }
 
@@ -329,6 +331,7 @@ void demo_skybox::DisplayDebugUI()
         {
             Mode = (int)MODE_REFRACTION;
         }
+        ImGui::Text("Shader variants: %d (%.2f ms compile)", Programs->GetVariantCount(), Programs->GetCompileTimeMs());
         
 
 
@@ -367,17 +370,12 @@ void demo_skybox::RenderScene(const mat4& ProjectionMatrix, const mat4& ViewMatr
     glEnable(GL_DEPTH_TEST);
 
     // Use shader and configure its uniforms
+    GLuint Program = Programs->GetProgram(GetModeFeatures(Mode));
     glUseProgram(Program);
 
     // Set uniforms
-    mat4 NormalMatrix = Mat4::Transpose(Mat4::Inverse(ModelMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uProjection"), 1, GL_FALSE, ProjectionMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModel"), 1, GL_FALSE, ModelMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uView"), 1, GL_FALSE, ViewMatrix.e);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "uModelNormalMatrix"), 1, GL_FALSE, NormalMatrix.e);
-    glUniform3fv(glGetUniformLocation(Program, "uViewPosition"), 1, Camera.Position.e);
-
-    glUniform1iv(glGetUniformLocation(Program, "uMode"), 1, &Mode);
+    GL::SetFrameConstants(ProjectionMatrix, ViewMatrix, Camera.Position);
+    GL::SetDrawConstants(ModelMatrix);
     
     // Bind uniform buffer and textures
     glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING_POINT, Scene.LightsUniformBuffer);
@@ -28,7 +28,7 @@ private:
     camera Camera = {};
 
     // GL objects needed by this demo
-    GLuint Program = 0;
+    GL::shader_permutations* Programs = nullptr;
     GLuint SkyboxProgram = 0;
     GLuint VAO = 0;
     GLuint SkyboxVAO = 0;
@@ -0,0 +1,353 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include <imgui.h>
+
+#include "maths.h"
+#include "opengl_helpers.h"
+#include "platform.h"
+
+#include "impostor_atlas.h"
+
+#pragma region BakeShaders
+static const char* gBakeVertexShaderStr = R"GLSL(
+// Attributes
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec2 aUV;
+layout(location = 2) in vec3 aNormal;
+
+// Uniforms
+uniform mat4 uViewProjection; // Orthographic camera of the frame
+uniform vec3 uDirection;      // From the mesh center toward the frame camera
+uniform vec4 uSphere;
+
+// Varyings
+out vec2 vUV;
+out vec3 vNormal;
+out float vDepth;
+
+void main()
+{
+    vUV = aUV;
+    vNormal = aNormal;
+    vDepth = dot(aPosition - uSphere.xyz, uDirection) / uSphere.w;
+    gl_Position = uViewProjection * vec4(aPosition, 1.0);
+})GLSL";
+
+static const char* gBakeFragmentShaderStr = R"GLSL(
+// Varyings
+in vec2 vUV;
+in vec3 vNormal;
+in float vDepth;
+
+// Uniforms
+uniform sampler2D uDiffuseTexture;
+uniform sampler2D uEmissiveTexture;
+
+// Shader outputs
+layout(location = 0) out vec4 oAlbedo;
+layout(location = 1) out vec4 oEmissive;
+layout(location = 2) out vec4 oNormalDepth;
+
+void main()
+{
+    oAlbedo = vec4(texture(uDiffuseTexture, vUV).rgb, 1.0);
+    oEmissive = vec4(texture(uEmissiveTexture, vUV).rgb, 1.0);
+    oNormalDepth = vec4(normalize(vNormal), vDepth);
+})GLSL";
+#pragma endregion
+
+#pragma region SamplingShader
+static const char* gImpostorShaderStr = R"GLSL(
+// Impostor atlas (see impostor_atlas)
+uniform sampler2D uImpostorAlbedo;
+uniform sampler2D uImpostorEmissive;
+uniform sampler2D uImpostorNormalDepth;
+uniform vec4 uImpostorSphere; // Bounding sphere in mesh space
+uniform int uImpostorFrameCount;
+uniform bool uImpostorBlendFrames;
+
+struct impostor_sample
+{
+    vec3 albedo;
+    vec3 emissive;
+    vec3 normal;   // Mesh space
+    vec3 position; // Mesh space
+    float coverage;
+};
+
+vec2 impostor_sign(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Direction to atlas uv, +Y at the center and -Y at the corners
+vec2 impostor_oct_encode(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    vec2 p = d.xz;
+    if (d.y < 0.0)
+        p = (1.0 - abs(p.yx)) * impostor_sign(p);
+    return p * 0.5 + 0.5;
+}
+
+vec3 impostor_oct_decode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 d = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (d.y < 0.0)
+        d.xz = (1.0 - abs(d.zx)) * impostor_sign(d.xz);
+    return normalize(d);
+}
+
+// Camera ray in mesh space
+impostor_sample impostor_sample_atlas(vec3 rayOrigin, vec3 rayDirection)
+{
+    float frameCount = float(uImpostorFrameCount);
+    vec3 toCamera = normalize(rayOrigin - uImpostorSphere.xyz);
+    vec2 grid = impostor_oct_encode(toCamera) * frameCount - 0.5;
+    vec2 base = floor(grid);
+    vec2 blend = grid - base;
+    if (!uImpostorBlendFrames)
+    {
+        base = floor(grid + 0.5);
+        blend = vec2(0.0);
+    }
+
+    impostor_sample result = impostor_sample(vec3(0.0), vec3(0.0), vec3(0.0), vec3(0.0), 0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 offset = vec2(i & 1, i >> 1);
+        vec2 weights = mix(1.0 - blend, blend, offset);
+        float weight = weights.x * weights.y;
+        if (weight <= 0.0)
+            continue;
+        weightSum += weight;
+
+        // Frame camera basis (Mat4::LookAt toward the center, +Y up)
+        vec2 frame = clamp(base + offset, vec2(0.0), vec2(frameCount - 1.0));
+        vec3 direction = impostor_oct_decode((frame + 0.5) / frameCount);
+        vec3 right = normalize(cross(vec3(0.0, 1.0, 0.0), direction));
+        vec3 up = cross(direction, right);
+
+        // Where the ray crosses the frame plane
+        float t = dot(uImpostorSphere.xyz - rayOrigin, direction) / dot(rayDirection, direction);
+        vec3 local = rayOrigin + rayDirection * t - uImpostorSphere.xyz;
+        vec2 uv = vec2(dot(local, right), dot(local, up)) / uImpostorSphere.w * 0.5 + 0.5;
+        if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+            continue;
+
+        // Texels are premultiplied by the coverage (cleared to zero, mips average the edges)
+        vec2 atlasUV = (frame + uv) / frameCount;
+        vec4 albedo = texture(uImpostorAlbedo, atlasUV);
+        vec4 normalDepth = texture(uImpostorNormalDepth, atlasUV);
+        result.albedo += albedo.rgb * weight;
+        result.emissive += texture(uImpostorEmissive, atlasUV).rgb * weight;
+        result.normal += normalDepth.xyz * weight;
+        result.position += (local * albedo.a + direction * normalDepth.w * uImpostorSphere.w) * weight;
+        result.coverage += albedo.a * weight;
+    }
+
+    if (result.coverage > 0.0)
+    {
+        result.albedo /= result.coverage;
+        result.emissive /= result.coverage;
+        result.normal = normalize(result.normal);
+        result.position = uImpostorSphere.xyz + result.position / result.coverage;
+        result.coverage /= max(weightSum, 1e-4);
+    }
+    return result;
+}
+)GLSL";
+#pragma endregion
+
+// Inverse of impostor_oct_encode
+static v3 OctahedronDecode(float U, float V)
+{
+    float X = U * 2.f - 1.f;
+    float Z = V * 2.f - 1.f;
+    float Y = 1.f - std::fabs(X) - std::fabs(Z);
+    if (Y < 0.f)
+    {
+        float FoldedX = (1.f - std::fabs(Z)) * (X >= 0.f ? 1.f : -1.f);
+        float FoldedZ = (1.f - std::fabs(X)) * (Z >= 0.f ? 1.f : -1.f);
+        X = FoldedX;
+        Z = FoldedZ;
+    }
+    return Vec3::Normalize({ X, Y, Z });
+}
+
+impostor_atlas::impostor_atlas()
+{
+    this->BakeProgram = GL::CreateProgram(gBakeVertexShaderStr, gBakeFragmentShaderStr);
+    glUseProgram(this->BakeProgram);
+    glUniform1i(glGetUniformLocation(this->BakeProgram, "uDiffuseTexture"), 0);
+    glUniform1i(glGetUniformLocation(this->BakeProgram, "uEmissiveTexture"), 1);
+}
+
+impostor_atlas::~impostor_atlas()
+{
+    glDeleteProgram(this->BakeProgram);
+    glDeleteFramebuffers(1, &this->FBO);
+    glDeleteRenderbuffers(1, &this->DepthRenderbuffer);
+    glDeleteTextures(1, &this->AlbedoTexture);
+    glDeleteTextures(1, &this->EmissiveTexture);
+    glDeleteTextures(1, &this->NormalDepthTexture);
+}
+
+void impostor_atlas::CreateTargets()
+{
+    GLuint* Textures[] = { &this->AlbedoTexture, &this->EmissiveTexture, &this->NormalDepthTexture };
+    GLenum Formats[] = { GL_RGBA8, GL_RGBA8, GL_RGBA16F };
+
+    glGenFramebuffers(1, &this->FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+    for (int i = 0; i < 3; ++i)
+    {
+        glGenTextures(1, Textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *Textures[i]);
+        for (int Level = 0; Level < MIP_COUNT; ++Level)
+            glTexImage2D(GL_TEXTURE_2D, Level, Formats[i], ATLAS_SIZE >> Level, ATLAS_SIZE >> Level, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MIP_COUNT - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, *Textures[i], 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &this->DepthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->DepthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->DepthRenderbuffer);
+
+    GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(ARRAY_SIZE(DrawBuffers), DrawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::printf("ERROR::FRAMEBUFFER:: Impostor framebuffer is not complete!\n");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void impostor_atlas::Bake(GLuint MeshBuffer, const vertex_descriptor& Desc, int VertexCount, v3 BoundsMin, v3 BoundsMax,
+    GLuint DiffuseTexture, GLuint EmissiveTexture)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    if (this->FBO == 0)
+        this->CreateTargets();
+
+    this->Center = (BoundsMin + BoundsMax) * 0.5f;
+    this->Radius = Math::Max(Vec3::Length(BoundsMax - BoundsMin) * 0.5f, 1e-4f);
+
+    // Only the attributes the bake needs
+    GLuint VAO = 0;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, MeshBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.PositionOffset);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.UVOffset);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, Desc.Stride, (void*)(size_t)Desc.NormalOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLboolean PrevDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+    glViewport(0, 0, ATLAS_SIZE, ATLAS_SIZE);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(this->BakeProgram);
+    glUniform4f(glGetUniformLocation(this->BakeProgram, "uSphere"), this->Center.x, this->Center.y, this->Center.z, this->Radius);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, DiffuseTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, EmissiveTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Orthographic camera on the bounding sphere, looking at its center from each frame direction
+    mat4 Projection = Mat4::Orthographic(-this->Radius, this->Radius, -this->Radius, this->Radius, 0.f, 2.f * this->Radius);
+    for (int Y = 0; Y < FRAME_COUNT; ++Y)
+    {
+        for (int X = 0; X < FRAME_COUNT; ++X)
+        {
+            v3 Direction = OctahedronDecode((X + 0.5f) / FRAME_COUNT, (Y + 0.5f) / FRAME_COUNT);
+            mat4 ViewProjection = Projection * Mat4::LookAt(this->Center + Direction * this->Radius, this->Center);
+
+            glViewport(X * FRAME_SIZE, Y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+            glUniformMatrix4fv(glGetUniformLocation(this->BakeProgram, "uViewProjection"), 1, GL_FALSE, ViewProjection.e);
+            glUniform3f(glGetUniformLocation(this->BakeProgram, "uDirection"), Direction.x, Direction.y, Direction.z);
+            glDrawArrays(GL_TRIANGLES, 0, VertexCount);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &VAO);
+    if (!PrevDepthTest)
+        glDisable(GL_DEPTH_TEST);
+
+    for (GLuint Texture : { this->AlbedoTexture, this->EmissiveTexture, this->NormalDepthTexture })
+    {
+        glBindTexture(GL_TEXTURE_2D, Texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    this->Baked = true;
+    this->BakeTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+const char* impostor_atlas::GetShaderStr()
+{
+    return gImpostorShaderStr;
+}
+
+void impostor_atlas::SetupProgram(GLuint Program, int FirstTextureUnit) const
+{
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uImpostorAlbedo"), FirstTextureUnit);
+    glUniform1i(glGetUniformLocation(Program, "uImpostorEmissive"), FirstTextureUnit + 1);
+    glUniform1i(glGetUniformLocation(Program, "uImpostorNormalDepth"), FirstTextureUnit + 2);
+    glUniform1i(glGetUniformLocation(Program, "uImpostorFrameCount"), FRAME_COUNT);
+}
+
+void impostor_atlas::SetUniforms(GLuint Program) const
+{
+    glUniform4f(glGetUniformLocation(Program, "uImpostorSphere"), this->Center.x, this->Center.y, this->Center.z, this->Radius);
+    glUniform1i(glGetUniformLocation(Program, "uImpostorBlendFrames"), this->BlendFrames);
+}
+
+void impostor_atlas::Bind(int FirstTextureUnit) const
+{
+    GLuint Textures[] = { this->AlbedoTexture, this->EmissiveTexture, this->NormalDepthTexture };
+    for (int i = 0; i < 3; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + FirstTextureUnit + i);
+        glBindTexture(GL_TEXTURE_2D, Textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void impostor_atlas::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Impostor atlas"))
+    {
+        ImGui::Checkbox("Blend frames", &this->BlendFrames);
+        ImGui::Text("%dx%d frames of %dx%d texels, baked in %.2f ms", FRAME_COUNT, FRAME_COUNT, FRAME_SIZE, FRAME_SIZE, this->BakeTimeMs);
+        if (this->AlbedoTexture)
+        {
+            ImGui::Image((void*)(intptr_t)this->AlbedoTexture, ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+            ImGui::SameLine();
+            ImGui::Image((void*)(intptr_t)this->NormalDepthTexture, ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+        }
+        ImGui::TreePop();
+    }
+}
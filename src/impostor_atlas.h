@@ -0,0 +1,89 @@
+#pragma once
+
+#include "opengl_headers.h"
+#include "mesh.h"
+
+// Octahedral impostor of a mesh: the mesh is rendered from FRAME_COUNT x FRAME_COUNT directions laid
+// out on an octahedron (full sphere, +Y at the center of the atlas), each view in its own square
+// frame of the atlas with an orthographic camera fitting the bounding sphere. Three atlases are
+// baked: albedo with coverage, emissive, and mesh-space normal with the depth along the view
+// direction (in bounding sphere radii).
+//
+// Shaders using GetShaderStr() cast the camera ray in mesh space and blend the 4 frames around the
+// view direction (impostor_sample_atlas), each frame sampled where the ray crosses its plane. The
+// blended depth gives the mesh-space surface position, for lighting and gl_FragDepth.
+class impostor_atlas
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int FRAME_COUNT = 12; // Frames per side
+    static const int FRAME_SIZE = 128; // Texels per frame side
+    static const int ATLAS_SIZE = FRAME_COUNT * FRAME_SIZE;
+
+    // Mips kept small enough not to mix the frames
+    static const int MIP_COUNT = 4;
+
+    bool BlendFrames = true;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    impostor_atlas();
+    ~impostor_atlas();
+
+    impostor_atlas(const impostor_atlas&) = delete;
+    impostor_atlas& operator=(const impostor_atlas&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Render the frames of a triangle list (position, uv and normal from the descriptor) with its textures
+    void Bake(GLuint MeshBuffer, const vertex_descriptor& Desc, int VertexCount, v3 BoundsMin, v3 BoundsMax,
+        GLuint DiffuseTexture, GLuint EmissiveTexture);
+
+    bool IsBaked() const { return this->Baked; }
+
+    // GLSL of the impostor uniforms and impostor_sample_atlas() (fragment shaders)
+    static const char* GetShaderStr();
+
+    // Sampler units (3 consecutive units from FirstTextureUnit) of a program using GetShaderStr()
+    void SetupProgram(GLuint Program, int FirstTextureUnit) const;
+
+    // Set the impostor uniforms of a program using GetShaderStr() (in use)
+    void SetUniforms(GLuint Program) const;
+
+    void Bind(int FirstTextureUnit) const;
+
+    // Bounding sphere of the baked mesh, in mesh space
+    v3 GetCenter() const { return this->Center; }
+    float GetRadius() const { return this->Radius; }
+
+    // ImGui debug function (bake time and atlas preview)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    void CreateTargets();
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    GLuint AlbedoTexture = 0;      // RGB albedo, A coverage
+    GLuint EmissiveTexture = 0;    // RGB emissive
+    GLuint NormalDepthTexture = 0; // XYZ mesh-space normal, W depth toward the frame camera in radii
+    GLuint DepthRenderbuffer = 0;
+    GLuint FBO = 0;
+
+    GLuint BakeProgram = 0;
+
+    v3 Center = {};
+    float Radius = 1.f;
+    bool Baked = false;
+    double BakeTimeMs = 0.0;
+};
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jobs.h"
+
+namespace
+{
+    struct job_pool
+    {
+        std::vector<std::thread> Workers;
+
+        std::mutex Mutex;
+        std::condition_variable WakeCondition;
+        std::condition_variable DoneCondition;
+
+        // Current job, written under Mutex while no worker is active
+        const std::function<void(int, int)>* Function = nullptr;
+        int Count = 0;
+        int BatchSize = 0;
+        int BatchCount = 0;
+        unsigned int Generation = 0;
+
+        std::atomic<int> NextBatch{ 0 };
+        std::atomic<int> DoneBatches{ 0 };
+        int ActiveWorkers = 0;
+        bool Quit = false;
+
+        // Only one job in flight, other threads fall back to a serial loop
+        std::mutex SubmitMutex;
+
+        job_pool();
+        ~job_pool();
+    };
+}
+
+static thread_local bool gInsideJob = false;
+
+static void RunBatches(job_pool& Pool, const std::function<void(int, int)>* Function, int Count, int BatchSize, int BatchCount)
+{
+    while (true)
+    {
+        int Batch = Pool.NextBatch.fetch_add(1);
+        if (Batch >= BatchCount)
+            break;
+
+        int Begin = Batch * BatchSize;
+        (*Function)(Begin, std::min(Begin + BatchSize, Count));
+
+        if (Pool.DoneBatches.fetch_add(1) + 1 == BatchCount)
+        {
+            std::lock_guard<std::mutex> Lock(Pool.Mutex);
+            Pool.DoneCondition.notify_all();
+        }
+    }
+}
+
+static void WorkerLoop(job_pool* Pool)
+{
+    gInsideJob = true;
+    unsigned int SeenGeneration = 0;
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> Lock(Pool->Mutex);
+        Pool->WakeCondition.wait(Lock, [&]() { return Pool->Quit || Pool->Generation != SeenGeneration; });
+        if (Pool->Quit)
+            return;
+
+        // Snapshot the job, the submitter does not reuse the pool while ActiveWorkers > 0
+        SeenGeneration = Pool->Generation;
+        const std::function<void(int, int)>* Function = Pool->Function;
+        int Count = Pool->Count;
+        int BatchSize = Pool->BatchSize;
+        int BatchCount = Pool->BatchCount;
+        Pool->ActiveWorkers++;
+        Lock.unlock();
+
+        RunBatches(*Pool, Function, Count, BatchSize, BatchCount);
+
+        Lock.lock();
+        if (--Pool->ActiveWorkers == 0)
+            Pool->DoneCondition.notify_all();
+    }
+}
+
+job_pool::job_pool()
+{
+    int ThreadCount = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < ThreadCount; ++i)
+        Workers.emplace_back(WorkerLoop, this);
+}
+
+job_pool::~job_pool()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Quit = true;
+    }
+    WakeCondition.notify_all();
+
+    for (std::thread& Worker : Workers)
+        Worker.join();
+}
+
+static job_pool& GetPool()
+{
+    static job_pool Pool;
+    return Pool;
+}
+
+int Jobs::GetWorkerCount()
+{
+    return (int)GetPool().Workers.size();
+}
+
+void Jobs::ParallelFor(int Count, int MinBatchSize, const std::function<void(int Begin, int End)>& Function)
+{
+    if (Count <= 0)
+        return;
+
+    job_pool& Pool = GetPool();
+    int MaxBatchCount = Count / std::max(MinBatchSize, 1);
+    if (Pool.Workers.empty() || MaxBatchCount < 2 || gInsideJob || !Pool.SubmitMutex.try_lock())
+    {
+        Function(0, Count);
+        return;
+    }
+
+    // A few batches per thread to balance uneven work
+    int BatchCount = std::min(MaxBatchCount, (int)(Pool.Workers.size() + 1) * 4);
+    int BatchSize = (Count + BatchCount - 1) / BatchCount;
+    BatchCount = (Count + BatchSize - 1) / BatchSize;
+
+    {
+        std::unique_lock<std::mutex> Lock(Pool.Mutex);
+        Pool.DoneCondition.wait(Lock, [&]() { return Pool.ActiveWorkers == 0; });
+
+        Pool.Function = &Function;
+        Pool.Count = Count;
+        Pool.BatchSize = BatchSize;
+        Pool.BatchCount = BatchCount;
+        Pool.NextBatch = 0;
+        Pool.DoneBatches = 0;
+        Pool.Generation++;
+    }
+    Pool.WakeCondition.notify_all();
+
+    gInsideJob = true;
+    RunBatches(Pool, &Function, Count, BatchSize, BatchCount);
+    gInsideJob = false;
+
+    {
+        // Workers that picked up this job must leave before Function goes out of scope
+        std::unique_lock<std::mutex> Lock(Pool.Mutex);
+        Pool.DoneCondition.wait(Lock, [&]() { return Pool.DoneBatches == BatchCount && Pool.ActiveWorkers == 0; });
+
+        // Late wakers of this generation find nothing to run
+        Pool.Function = nullptr;
+        Pool.BatchCount = 0;
+    }
+
+    Pool.SubmitMutex.unlock();
+}
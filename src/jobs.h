@@ -0,0 +1,15 @@
+#pragma once
+
+#include <functional>
+
+// Minimal fork/join helper over a persistent pool of worker threads
+// (hardware threads - 1, started on first use, the calling thread works too).
+namespace Jobs
+{
+    int GetWorkerCount();
+
+    // Calls Function(Begin, End) on batches of at least MinBatchSize items covering [0, Count)
+    // and returns once every batch is done. Batches run in any order and on any thread.
+    // Nested calls (from inside a batch) and calls from several threads at once run serially.
+    void ParallelFor(int Count, int MinBatchSize, const std::function<void(int Begin, int End)>& Function);
+}
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "jobs.h"
+
+#include "light_clusters.h"
+
+light_clusters::light_clusters()
+{
+    GLuint Buffers[3];
+    GLuint Textures[3];
+    glGenBuffers(3, Buffers);
+    glGenTextures(3, Textures);
+
+    this->LightsBuffer = Buffers[0];
+    this->GridBuffer = Buffers[1];
+    this->IndicesBuffer = Buffers[2];
+    this->LightsTexture = Textures[0];
+    this->GridTexture = Textures[1];
+    this->IndicesTexture = Textures[2];
+
+    // A texture buffer needs a data store before glTexBuffer
+    const GLenum Formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+    for (int i = 0; i < 3; ++i)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, Buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, Textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, Formats[i], Buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    this->SliceFirstLight.resize(SLICE_COUNT + 1);
+    this->SliceIndices.resize(SLICE_COUNT);
+    this->SliceRects.resize(SLICE_COUNT);
+    this->SliceMaxLightCount.resize(SLICE_COUNT);
+    this->Grid.resize(CLUSTER_COUNT * 2);
+}
+
+light_clusters::~light_clusters()
+{
+    GLuint Buffers[3] = { LightsBuffer, GridBuffer, IndicesBuffer };
+    GLuint Textures[3] = { LightsTexture, GridTexture, IndicesTexture };
+    glDeleteTextures(3, Textures);
+    glDeleteBuffers(3, Buffers);
+}
+
+void light_clusters::Build(const std::vector<clustered_light>& Lights, const mat4& ViewMatrix, const mat4& ProjectionMatrix, float Near, float Far)
+{
+    auto Start = std::chrono::high_resolution_clock::now();
+
+    this->LightCount = Math::Min((int)Lights.size(), MAX_LIGHT_COUNT);
+    if ((int)Lights.size() > MAX_LIGHT_COUNT)
+        fprintf(stderr, "light_clusters: %d lights, only the first %d are used\n", (int)Lights.size(), MAX_LIGHT_COUNT);
+
+    // Exponential slices: Slice = log(Depth) * SliceScale + SliceBias
+    this->ProjectionX = ProjectionMatrix.c[0].e[0];
+    this->ProjectionY = ProjectionMatrix.c[1].e[1];
+    this->SliceScale = SLICE_COUNT / logf(Far / Near);
+    this->SliceBias = -logf(Near) * this->SliceScale;
+    for (int i = 0; i <= SLICE_COUNT; ++i)
+        this->SliceDepths[i] = Near * powf(Far / Near, (float)i / SLICE_COUNT);
+
+    // View-space bounds and depth range of every light
+    this->Bounds.resize(this->LightCount);
+    Jobs::ParallelFor(this->LightCount, 256, [&](int Begin, int End)
+    {
+        for (int i = Begin; i < End; ++i)
+        {
+            const clustered_light& Light = Lights[i];
+            light_bounds& LightBounds = this->Bounds[i];
+
+            v4 Center = ViewMatrix * Vec4::vec4(Light.Position, 1.f);
+            LightBounds.Center = { Center.x, Center.y, Center.z };
+            LightBounds.Radius = Light.Radius;
+            LightBounds.FirstSlice = -1;
+            LightBounds.LastSlice = -1;
+
+            float Depth = -Center.z;
+            float MinDepth = std::max(Depth - Light.Radius, Near);
+            float MaxDepth = std::min(Depth + Light.Radius, Far);
+            if (MinDepth > MaxDepth)
+                continue;
+
+            LightBounds.FirstSlice = Math::Clamp((int)(logf(MinDepth) * this->SliceScale + this->SliceBias), 0, SLICE_COUNT - 1);
+            LightBounds.LastSlice = Math::Clamp((int)(logf(MaxDepth) * this->SliceScale + this->SliceBias), 0, SLICE_COUNT - 1);
+        }
+    });
+
+    // Bucket the lights by slice
+    std::fill(this->SliceFirstLight.begin(), this->SliceFirstLight.end(), 0);
+    for (const light_bounds& LightBounds : this->Bounds)
+    {
+        for (int Slice = LightBounds.FirstSlice; LightBounds.FirstSlice >= 0 && Slice <= LightBounds.LastSlice; ++Slice)
+            this->SliceFirstLight[Slice + 1]++;
+    }
+    for (int Slice = 0; Slice < SLICE_COUNT; ++Slice)
+        this->SliceFirstLight[Slice + 1] += this->SliceFirstLight[Slice];
+
+    this->SliceLights.resize(this->SliceFirstLight[SLICE_COUNT]);
+    {
+        int Cursors[SLICE_COUNT];
+        std::copy(this->SliceFirstLight.begin(), this->SliceFirstLight.end() - 1, Cursors);
+        for (int i = 0; i < this->LightCount; ++i)
+        {
+            const light_bounds& LightBounds = this->Bounds[i];
+            for (int Slice = LightBounds.FirstSlice; LightBounds.FirstSlice >= 0 && Slice <= LightBounds.LastSlice; ++Slice)
+                this->SliceLights[Cursors[Slice]++] = i;
+        }
+    }
+
+    // Per slice tile lists, slices are independent
+    Jobs::ParallelFor(SLICE_COUNT, 1, [this](int Begin, int End)
+    {
+        for (int Slice = Begin; Slice < End; ++Slice)
+            BuildSlice(Slice);
+    });
+
+    // Merge the slice lists into the final index list
+    int SliceOffsets[SLICE_COUNT];
+    int IndexCount = 0;
+    this->MaxClusterLightCount = 0;
+    for (int Slice = 0; Slice < SLICE_COUNT; ++Slice)
+    {
+        SliceOffsets[Slice] = IndexCount;
+        IndexCount += (int)this->SliceIndices[Slice].size();
+        this->MaxClusterLightCount = std::max(this->MaxClusterLightCount, this->SliceMaxLightCount[Slice]);
+    }
+
+    this->Indices.resize(IndexCount);
+    Jobs::ParallelFor(SLICE_COUNT, 1, [&](int Begin, int End)
+    {
+        const int TilesPerSlice = TILE_COUNT_X * TILE_COUNT_Y;
+        for (int Slice = Begin; Slice < End; ++Slice)
+        {
+            std::copy(this->SliceIndices[Slice].begin(), this->SliceIndices[Slice].end(), this->Indices.begin() + SliceOffsets[Slice]);
+
+            uint32_t* SliceGrid = &this->Grid[Slice * TilesPerSlice * 2];
+            for (int Tile = 0; Tile < TilesPerSlice; ++Tile)
+                SliceGrid[Tile * 2] += SliceOffsets[Slice];
+        }
+    });
+
+    std::chrono::duration<double, std::milli> Duration = std::chrono::high_resolution_clock::now() - Start;
+    this->BuildTimeMs = Duration.count();
+}
+
+void light_clusters::BuildSlice(int Slice)
+{
+    const int TilesPerSlice = TILE_COUNT_X * TILE_COUNT_Y;
+    const float SliceNear = this->SliceDepths[Slice];
+    const float SliceFar = this->SliceDepths[Slice + 1];
+
+    int Counts[TilesPerSlice] = {};
+    std::vector<uint16_t>& SliceIndices = this->SliceIndices[Slice];
+
+    // First pass: tile rectangle of each light (x0, x1, y0, y1 packed on 8 bits each)
+    int FirstLight = this->SliceFirstLight[Slice];
+    int LastLight = this->SliceFirstLight[Slice + 1];
+    std::vector<uint32_t>& Rects = this->SliceRects[Slice];
+    Rects.resize(LastLight - FirstLight);
+    for (int i = FirstLight; i < LastLight; ++i)
+    {
+        const light_bounds& LightBounds = this->Bounds[this->SliceLights[i]];
+        uint32_t& Rect = Rects[i - FirstLight];
+        Rect = 0xFFFFFFFF;
+
+        // Depth range of the light inside the slice
+        float Depth = -LightBounds.Center.z;
+        float MinDepth = std::max(SliceNear, Depth - LightBounds.Radius);
+        float MaxDepth = std::min(SliceFar, Depth + LightBounds.Radius);
+        if (MinDepth > MaxDepth)
+            continue;
+
+        // Widest section of the sphere in that range
+        float DepthGap = Depth < MinDepth ? MinDepth - Depth : (Depth > MaxDepth ? Depth - MaxDepth : 0.f);
+        float Radius = sqrtf(std::max(LightBounds.Radius * LightBounds.Radius - DepthGap * DepthGap, 0.f));
+
+        // Conservative NDC extents of the section box over [MinDepth, MaxDepth]
+        float X0 = LightBounds.Center.x - Radius;
+        float X1 = LightBounds.Center.x + Radius;
+        float Y0 = LightBounds.Center.y - Radius;
+        float Y1 = LightBounds.Center.y + Radius;
+        float NdcX0 = this->ProjectionX * X0 / (X0 < 0.f ? MinDepth : MaxDepth);
+        float NdcX1 = this->ProjectionX * X1 / (X1 > 0.f ? MinDepth : MaxDepth);
+        float NdcY0 = this->ProjectionY * Y0 / (Y0 < 0.f ? MinDepth : MaxDepth);
+        float NdcY1 = this->ProjectionY * Y1 / (Y1 > 0.f ? MinDepth : MaxDepth);
+        if (NdcX1 < -1.f || NdcX0 > 1.f || NdcY1 < -1.f || NdcY0 > 1.f)
+            continue;
+
+        int TileX0 = Math::Clamp((int)floorf((NdcX0 * 0.5f + 0.5f) * TILE_COUNT_X), 0, TILE_COUNT_X - 1);
+        int TileX1 = Math::Clamp((int)floorf((NdcX1 * 0.5f + 0.5f) * TILE_COUNT_X), 0, TILE_COUNT_X - 1);
+        int TileY0 = Math::Clamp((int)floorf((NdcY0 * 0.5f + 0.5f) * TILE_COUNT_Y), 0, TILE_COUNT_Y - 1);
+        int TileY1 = Math::Clamp((int)floorf((NdcY1 * 0.5f + 0.5f) * TILE_COUNT_Y), 0, TILE_COUNT_Y - 1);
+        Rect = TileX0 | (TileX1 << 8) | (TileY0 << 16) | (TileY1 << 24);
+
+        for (int y = TileY0; y <= TileY1; ++y)
+            for (int x = TileX0; x <= TileX1; ++x)
+                Counts[y * TILE_COUNT_X + x]++;
+    }
+
+    // Offsets inside the slice (made global by Build())
+    uint32_t* SliceGrid = &this->Grid[Slice * TilesPerSlice * 2];
+    int IndexCount = 0;
+    int MaxCount = 0;
+    for (int Tile = 0; Tile < TilesPerSlice; ++Tile)
+    {
+        SliceGrid[Tile * 2 + 0] = IndexCount;
+        SliceGrid[Tile * 2 + 1] = 0;
+        IndexCount += Counts[Tile];
+        MaxCount = std::max(MaxCount, Counts[Tile]);
+    }
+    this->SliceMaxLightCount[Slice] = MaxCount;
+
+    // Second pass: fill the tile lists
+    SliceIndices.resize(IndexCount);
+    for (int i = FirstLight; i < LastLight; ++i)
+    {
+        uint32_t Rect = Rects[i - FirstLight];
+        if (Rect == 0xFFFFFFFF)
+            continue;
+
+        int TileX0 = Rect & 0xFF;
+        int TileX1 = (Rect >> 8) & 0xFF;
+        int TileY0 = (Rect >> 16) & 0xFF;
+        int TileY1 = (Rect >> 24) & 0xFF;
+        for (int y = TileY0; y <= TileY1; ++y)
+        {
+            for (int x = TileX0; x <= TileX1; ++x)
+            {
+                uint32_t* Cluster = &SliceGrid[(y * TILE_COUNT_X + x) * 2];
+                SliceIndices[Cluster[0] + Cluster[1]++] = (uint16_t)this->SliceLights[i];
+            }
+        }
+    }
+}
+
+void light_clusters::Upload(const std::vector<clustered_light>& Lights)
+{
+    // glBufferData respecifies (orphans) the stores, no wait on the previous frames
+    glBindBuffer(GL_TEXTURE_BUFFER, LightsBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max(LightCount, 1) * sizeof(clustered_light), LightCount ? Lights.data() : nullptr, GL_STREAM_DRAW);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, GridBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, Grid.size() * sizeof(uint32_t), Grid.data(), GL_STREAM_DRAW);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, IndicesBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max((int)Indices.size(), 1) * sizeof(uint16_t), Indices.empty() ? nullptr : Indices.data(), GL_STREAM_DRAW);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void light_clusters::SetupProgram(GLuint Program, int FirstUnit) const
+{
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uClusterLights"), FirstUnit + 0);
+    glUniform1i(glGetUniformLocation(Program, "uClusterGrid"), FirstUnit + 1);
+    glUniform1i(glGetUniformLocation(Program, "uClusterIndices"), FirstUnit + 2);
+    glUniform3i(glGetUniformLocation(Program, "uClusterDims"), TILE_COUNT_X, TILE_COUNT_Y, SLICE_COUNT);
+}
+
+void light_clusters::Bind(GLuint Program, int FirstUnit, int ViewportWidth, int ViewportHeight) const
+{
+    glActiveTexture(GL_TEXTURE0 + FirstUnit + 0);
+    glBindTexture(GL_TEXTURE_BUFFER, LightsTexture);
+    glActiveTexture(GL_TEXTURE0 + FirstUnit + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, GridTexture);
+    glActiveTexture(GL_TEXTURE0 + FirstUnit + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, IndicesTexture);
+    glActiveTexture(GL_TEXTURE0); // Reset active texture just in case
+
+    glUniform2f(glGetUniformLocation(Program, "uClusterTileScale"), (float)TILE_COUNT_X / ViewportWidth, (float)TILE_COUNT_Y / ViewportHeight);
+    glUniform2f(glGetUniformLocation(Program, "uClusterSliceScaleBias"), SliceScale, SliceBias);
+    glUniform1i(glGetUniformLocation(Program, "uClusterLightCount"), LightCount);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "opengl_headers.h"
+#include "maths.h"
+
+// Point light handled by the clusters, same memory layout than the 3 texels read by
+// 'cluster_fetch_light' in glsl shader (GLINCLUDE_CLUSTERED_LIGHTS)
+struct clustered_light
+{
+    v3 Position;    // World space
+    float Radius;   // No contribution beyond (culling range)
+    v3 Color;       // Diffuse color
+    float Specular; // Specular color = Color * Specular
+    v3 Attenuation; // Same terms than GL::light::Attenuation
+    float Unused;
+};
+
+// View-space cluster grid (screen tiles x exponential depth slices) with the list of
+// lights touching each cluster, built on the CPU and read by the fragment shaders
+// through texture buffers, so each fragment only loops over the lights of its cluster.
+class light_clusters
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int TILE_COUNT_X = 16;
+    static const int TILE_COUNT_Y = 9;
+    static const int SLICE_COUNT = 24;
+    static const int CLUSTER_COUNT = TILE_COUNT_X * TILE_COUNT_Y * SLICE_COUNT;
+
+    // Light indices are stored on 16 bits
+    static const int MAX_LIGHT_COUNT = 65535;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    light_clusters();
+    ~light_clusters();
+
+    light_clusters(const light_clusters&) = delete;
+    light_clusters& operator=(const light_clusters&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Assign the lights to the clusters of the view (symmetric perspective projection), spread over the worker threads
+    void Build(const std::vector<clustered_light>& Lights, const mat4& ViewMatrix, const mat4& ProjectionMatrix, float Near, float Far);
+
+    // Send the lights and the last build to the texture buffers (same lights than Build())
+    void Upload(const std::vector<clustered_light>& Lights);
+
+    // Sampler units of a program using GLINCLUDE_CLUSTERED_LIGHTS (uses FirstUnit to FirstUnit + 2)
+    void SetupProgram(GLuint Program, int FirstUnit) const;
+
+    // Bind the texture buffers and set the per-frame uniforms of Program (in use)
+    void Bind(GLuint Program, int FirstUnit, int ViewportWidth, int ViewportHeight) const;
+
+    // Stats of the last build
+    int GetLightCount() const { return this->LightCount; }
+    int GetIndexCount() const { return (int)this->Indices.size(); }
+    int GetMaxClusterLightCount() const { return this->MaxClusterLightCount; }
+    double GetBuildTimeMs() const { return this->BuildTimeMs; }
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    void BuildSlice(int Slice);
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    // Per light, in view space
+    struct light_bounds
+    {
+        v3 Center;
+        float Radius;
+        int FirstSlice; // -1 when culled
+        int LastSlice;
+    };
+
+    int LightCount = 0;
+    std::vector<light_bounds> Bounds;
+
+    // Projection terms
+    float ProjectionX = 1.f;
+    float ProjectionY = 1.f;
+    float SliceScale = 0.f;
+    float SliceBias = 0.f;
+    float SliceDepths[SLICE_COUNT + 1];
+
+    // Lights overlapping each slice (CSR)
+    std::vector<int> SliceFirstLight;
+    std::vector<int> SliceLights;
+
+    // Per slice results, merged at the end of Build()
+    std::vector<std::vector<uint16_t>> SliceIndices;
+    std::vector<std::vector<uint32_t>> SliceRects;
+    std::vector<int> SliceMaxLightCount;
+
+    // Per cluster (first index, count), then light indices
+    std::vector<uint32_t> Grid;
+    std::vector<uint16_t> Indices;
+
+    int MaxClusterLightCount = 0;
+    double BuildTimeMs = 0.0;
+
+    // Texture buffers
+    GLuint LightsBuffer = 0;
+    GLuint GridBuffer = 0;
+    GLuint IndicesBuffer = 0;
+    GLuint LightsTexture = 0;
+    GLuint GridTexture = 0;
+    GLuint IndicesTexture = 0;
+};
@@ -14,6 +14,7 @@
 
 #include "opengl_helpers.h"
 #include "opengl_helpers_wireframe.h"
+#include "opengl_helpers_extensions.h"
 #include "maths.h"
 #include "camera.h"
 #include "platform.h"
@@ -21,7 +22,6 @@
 #include "pg.h"
 /*
 #include "demo_minimal.h"
-#include "demo_base.h"
 #include "demo_pg_skybox.h"
 #include "demo_pg_billboard.h"
 #include "demo_pg_billboard2.h"
@@ -39,6 +39,8 @@
 #include "demo_mix.h"
 #include "demo_hdr.h"
 #include "demo_PBR.h"
+#include "demo_clustered.h"
+#include "demo_base.h"
 
 #if 0
 // Run on laptop high perf GPU
@@ -217,6 +219,7 @@ int main(int argc, char* argv[])
         glfwTerminate();
         return 1;
     }
+    GL::LoadExtensions((GLADloadproc)glfwGetProcAddress);
 
     // Setup KHR debug
     glDebugMessageCallback(OpenGLErrorCallback, nullptr);
@@ -246,6 +249,7 @@ int main(int argc, char* argv[])
     // Demo scope
     {
         PG::Init();
+        GL::InitFrameConstants();
         GL::cache GLCache;
         GL::debug GLDebug;
 
@@ -256,7 +260,6 @@ int main(int argc, char* argv[])
         std::unique_ptr<demo> Demos[] = 
         {
             /*
-            std::make_unique<demo_base>(GLCache, GLDebug),
             std::make_unique<demo_minimal>(),
             std::make_unique<demo_pg_skybox>(GLCache, GLDebug),
             std::make_unique<demo_pg_billboard>(GLCache, GLDebug),
@@ -275,6 +278,8 @@ int main(int argc, char* argv[])
             std::make_unique<demo_PBR>(GLCache, GLDebug),
 
             std::make_unique<demo_mix>(GLCache, GLDebug),
+            std::make_unique<demo_clustered>(GLCache, GLDebug),
+            std::make_unique<demo_base>(GLCache, GLDebug),
         };
 
         // Main loop
@@ -347,13 +352,18 @@ int main(int argc, char* argv[])
                 ImGui::Text("GL_VERSION: %s", glGetString(GL_VERSION));
                 ImGui::Text("GL_RENDERER: %s", glGetString(GL_RENDERER));
                 ImGui::Text("GL_SHADING_LANGUAGE_VERSION: %s", glGetString(GL_SHADING_LANGUAGE_VERSION));
+                ImGui::Text("Shader variants: %d (%.2f ms compile)", GL::shader_permutations::GetTotalVariantCount(), GL::shader_permutations::GetTotalCompileTimeMs());
+                const GL::stream_ring& FrameRing = GL::GetFrameRing();
+                ImGui::Text("Frame constants ring: %s, %d/%d bytes", FrameRing.IsPersistent() ? "persistent" : "orphaned", (int)FrameRing.GetFrameUsage(), (int)FrameRing.GetFrameCapacity());
             }
             
             if (ShowDemoWindow)
                 ImGui::ShowDemoWindow(&ShowDemoWindow);
 
             // Display demo
+            GL::BeginFrameConstants(App.IO.Time);
             Demos[DemoId]->Update(App.IO);
+            GL::EndFrameConstants();
 
             GLDebug.Wireframe.Flush();
 
@@ -367,6 +377,7 @@ int main(int argc, char* argv[])
 
         PG::Destroy();
     }
+    GL::DestroyFrameConstants();
 
     double Duration = glfwGetTime() - StartTime;
     printf("Duration %.2fs\n", Duration);
@@ -4,6 +4,19 @@
 
 #include <cmath>
 
+// SIMD backend, selected at compile time: SSE2 on x86/x64, NEON on ARM, scalar otherwise.
+// Define MATHS_SCALAR to force the scalar path (reference results, debugging).
+// Loads and stores are unaligned: v4/mat4 are alignas(16) but heap blocks may not be.
+#if !defined(MATHS_SCALAR)
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATHS_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define MATHS_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 #define EPSILON 0.00001
 
 namespace Math
@@ -227,6 +240,8 @@ namespace Vec4
 // ========================================================================
 // MAT4 FUNCTIONS
 // ========================================================================
+// Single vectors stay scalar on every backend: the cost is the 64 bytes of matrix loaded per call, and
+// compilers vectorize this form as well as the column splats (measured equal or faster, see Mat4::TransformV4s)
 inline v4 operator*(const mat4& M, v4 V)
 {
     v4 R;
@@ -237,13 +252,54 @@ inline v4 operator*(const mat4& M, v4 V)
     return R;
 }
 
+#if defined(MATHS_SSE)
+// Columns C0..C3 transforming V, same summation order than the scalar path: x*c0 + y*c1 + z*c2 + w*c3
+inline __m128 TransformColumnsSSE(__m128 C0, __m128 C1, __m128 C2, __m128 C3, __m128 V)
+{
+    __m128 Res =            _mm_mul_ps(C0, _mm_shuffle_ps(V, V, _MM_SHUFFLE(0, 0, 0, 0)));
+    Res = _mm_add_ps(Res, _mm_mul_ps(C1, _mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 1, 1, 1))));
+    Res = _mm_add_ps(Res, _mm_mul_ps(C2, _mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 2, 2, 2))));
+    Res = _mm_add_ps(Res, _mm_mul_ps(C3, _mm_shuffle_ps(V, V, _MM_SHUFFLE(3, 3, 3, 3))));
+    return Res;
+}
+#elif defined(MATHS_NEON)
+inline float32x4_t TransformColumnsNEON(float32x4_t C0, float32x4_t C1, float32x4_t C2, float32x4_t C3, float32x4_t V)
+{
+    float32x2_t Low = vget_low_f32(V);
+    float32x2_t High = vget_high_f32(V);
+    float32x4_t Res =   vmulq_lane_f32(C0, Low, 0);
+    Res = vmlaq_lane_f32(Res, C1, Low, 1);
+    Res = vmlaq_lane_f32(Res, C2, High, 0);
+    Res = vmlaq_lane_f32(Res, C3, High, 1);
+    return Res;
+}
+#endif
+
 inline mat4 operator*(const mat4& A, const mat4& B)
 {
-    mat4 Res = {};
+    mat4 Res;
+#if defined(MATHS_SSE)
+    // Each column of the result is A transforming the matching column of B, A is loaded once
+    __m128 C0 = _mm_loadu_ps(A.c[0].e);
+    __m128 C1 = _mm_loadu_ps(A.c[1].e);
+    __m128 C2 = _mm_loadu_ps(A.c[2].e);
+    __m128 C3 = _mm_loadu_ps(A.c[3].e);
+    for (int c = 0; c < 4; ++c)
+        _mm_storeu_ps(Res.c[c].e, TransformColumnsSSE(C0, C1, C2, C3, _mm_loadu_ps(B.c[c].e)));
+#elif defined(MATHS_NEON)
+    float32x4_t C0 = vld1q_f32(A.c[0].e);
+    float32x4_t C1 = vld1q_f32(A.c[1].e);
+    float32x4_t C2 = vld1q_f32(A.c[2].e);
+    float32x4_t C3 = vld1q_f32(A.c[3].e);
+    for (int c = 0; c < 4; ++c)
+        vst1q_f32(Res.c[c].e, TransformColumnsNEON(C0, C1, C2, C3, vld1q_f32(B.c[c].e)));
+#else
+    Res = {};
     for (int c = 0; c < 4; ++c)
         for (int r = 0; r < 4; ++r)
             for (int i = 0; i < 4; ++i)
                 Res.c[c].e[r] += A.c[i].e[r] * B.c[c].e[i];
+#endif
     return Res;
 }
 
@@ -375,18 +431,82 @@ namespace Mat4
     
     inline mat4 Transpose(mat4 M)
     {
+#if defined(MATHS_SSE)
+        __m128 C0 = _mm_loadu_ps(M.c[0].e);
+        __m128 C1 = _mm_loadu_ps(M.c[1].e);
+        __m128 C2 = _mm_loadu_ps(M.c[2].e);
+        __m128 C3 = _mm_loadu_ps(M.c[3].e);
+        _MM_TRANSPOSE4_PS(C0, C1, C2, C3);
+        mat4 R;
+        _mm_storeu_ps(R.c[0].e, C0);
+        _mm_storeu_ps(R.c[1].e, C1);
+        _mm_storeu_ps(R.c[2].e, C2);
+        _mm_storeu_ps(R.c[3].e, C3);
+        return R;
+#else
         return {
             M.c[0].e[0], M.c[1].e[0], M.c[2].e[0], M.c[3].e[0],
             M.c[0].e[1], M.c[1].e[1], M.c[2].e[1], M.c[3].e[1],
             M.c[0].e[2], M.c[1].e[2], M.c[2].e[2], M.c[3].e[2],
             M.c[0].e[3], M.c[1].e[3], M.c[2].e[3], M.c[3].e[3]
         };
+#endif
     }
     
     inline mat4 Inverse(const mat4& M)
     {
         mat4 R;
 
+#if defined(MATHS_SSE)
+        // Same cofactor expansion than the scalar path, four output rows at a time.
+        // Lanes are ordered (1, 0, 3, 2) so every result column shares one sign pattern.
+        __m128 C0 = _mm_loadu_ps(M.c[0].e);
+        __m128 C1 = _mm_loadu_ps(M.c[1].e);
+        __m128 C2 = _mm_loadu_ps(M.c[2].e);
+        __m128 C3 = _mm_loadu_ps(M.c[3].e);
+
+        // Element k of columns (2, 2, 0, 0) and (3, 3, 1, 1)
+        __m128 Lo[4], Hi[4];
+        Lo[0] = _mm_shuffle_ps(C2, C0, _MM_SHUFFLE(0, 0, 0, 0)); Hi[0] = _mm_shuffle_ps(C3, C1, _MM_SHUFFLE(0, 0, 0, 0));
+        Lo[1] = _mm_shuffle_ps(C2, C0, _MM_SHUFFLE(1, 1, 1, 1)); Hi[1] = _mm_shuffle_ps(C3, C1, _MM_SHUFFLE(1, 1, 1, 1));
+        Lo[2] = _mm_shuffle_ps(C2, C0, _MM_SHUFFLE(2, 2, 2, 2)); Hi[2] = _mm_shuffle_ps(C3, C1, _MM_SHUFFLE(2, 2, 2, 2));
+        Lo[3] = _mm_shuffle_ps(C2, C0, _MM_SHUFFLE(3, 3, 3, 3)); Hi[3] = _mm_shuffle_ps(C3, C1, _MM_SHUFFLE(3, 3, 3, 3));
+
+        // F[k] = (C[k], C[k], S[k], S[k]), 2x2 sub-determinants of the scalar path
+        const int Pairs[6][2] = { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+        __m128 F[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            int P = Pairs[k][0], Q = Pairs[k][1];
+            F[k] = _mm_sub_ps(_mm_mul_ps(Lo[P], Hi[Q]), _mm_mul_ps(Hi[P], Lo[Q]));
+        }
+
+        // X, Y, Z, W = element 0..3 of columns (1, 0, 3, 2)
+        __m128 X = C1, Y = C0, Z = C3, W = C2;
+        _MM_TRANSPOSE4_PS(X, Y, Z, W);
+
+        const __m128 SignA = _mm_setr_ps(+1.f, -1.f, +1.f, -1.f);
+        const __m128 SignB = _mm_setr_ps(-1.f, +1.f, -1.f, +1.f);
+
+        __m128 R0 = _mm_mul_ps(SignA, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(Y, F[5]), _mm_mul_ps(Z, F[4])), _mm_mul_ps(W, F[3])));
+        __m128 R1 = _mm_mul_ps(SignB, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(X, F[5]), _mm_mul_ps(Z, F[2])), _mm_mul_ps(W, F[1])));
+        __m128 R2 = _mm_mul_ps(SignA, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(X, F[4]), _mm_mul_ps(Y, F[2])), _mm_mul_ps(W, F[0])));
+        __m128 R3 = _mm_mul_ps(SignB, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(X, F[3]), _mm_mul_ps(Y, F[1])), _mm_mul_ps(Z, F[0])));
+
+        // Determinant = first row of M dot first column of the adjugate
+        __m128 Row0 = _mm_shuffle_ps(X, X, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 Dot = _mm_mul_ps(Row0, R0);
+        Dot = _mm_add_ps(Dot, _mm_shuffle_ps(Dot, Dot, _MM_SHUFFLE(2, 3, 0, 1)));
+        Dot = _mm_add_ss(Dot, _mm_movehl_ps(Dot, Dot));
+
+        // Assuming it is invertible
+        __m128 InvDet = _mm_set1_ps(1.0f / _mm_cvtss_f32(Dot));
+
+        _mm_storeu_ps(R.c[0].e, _mm_mul_ps(R0, InvDet));
+        _mm_storeu_ps(R.c[1].e, _mm_mul_ps(R1, InvDet));
+        _mm_storeu_ps(R.c[2].e, _mm_mul_ps(R2, InvDet));
+        _mm_storeu_ps(R.c[3].e, _mm_mul_ps(R3, InvDet));
+#else
         float S[6];
         S[0] = M.c[0].e[0] * M.c[1].e[1] - M.c[1].e[0] * M.c[0].e[1];
         S[1] = M.c[0].e[0] * M.c[1].e[2] - M.c[1].e[0] * M.c[0].e[2];
@@ -425,10 +545,34 @@ namespace Mat4
         R.c[3].e[1] = +(M.c[0].e[0] * C[3] - M.c[0].e[1] * C[1] + M.c[0].e[2] * C[0]) * InvDet;
         R.c[3].e[2] = -(M.c[3].e[0] * S[3] - M.c[3].e[1] * S[1] + M.c[3].e[2] * S[0]) * InvDet;
         R.c[3].e[3] = +(M.c[2].e[0] * S[3] - M.c[2].e[1] * S[1] + M.c[2].e[2] * S[0]) * InvDet;
+#endif
 
         return R;
     }
 
+    // Out[i] = M * In[i], the matrix stays in registers for the whole array (In and Out may alias)
+    inline void TransformV4s(const mat4& M, const v4* In, v4* Out, int Count)
+    {
+#if defined(MATHS_SSE)
+        __m128 C0 = _mm_loadu_ps(M.c[0].e);
+        __m128 C1 = _mm_loadu_ps(M.c[1].e);
+        __m128 C2 = _mm_loadu_ps(M.c[2].e);
+        __m128 C3 = _mm_loadu_ps(M.c[3].e);
+        for (int i = 0; i < Count; ++i)
+            _mm_storeu_ps(Out[i].e, TransformColumnsSSE(C0, C1, C2, C3, _mm_loadu_ps(In[i].e)));
+#elif defined(MATHS_NEON)
+        float32x4_t C0 = vld1q_f32(M.c[0].e);
+        float32x4_t C1 = vld1q_f32(M.c[1].e);
+        float32x4_t C2 = vld1q_f32(M.c[2].e);
+        float32x4_t C3 = vld1q_f32(M.c[3].e);
+        for (int i = 0; i < Count; ++i)
+            vst1q_f32(Out[i].e, TransformColumnsNEON(C0, C1, C2, C3, vld1q_f32(In[i].e)));
+#else
+        for (int i = 0; i < Count; ++i)
+            Out[i] = M * In[i];
+#endif
+    }
+
     inline mat4 Frustum(float Left, float Right, float Bottom, float Top, float Near, float Far)
     {
         return
@@ -496,4 +640,236 @@ namespace Mat4
     }
 };
 
+// ========================================================================
+// QUATERNION FUNCTIONS
+// ========================================================================
+
+inline quat operator*(const quat& A, const quat& B)
+{
+    return {
+        A.w * B.x + A.x * B.w + A.y * B.z - A.z * B.y,
+        A.w * B.y - A.x * B.z + A.y * B.w + A.z * B.x,
+        A.w * B.z + A.x * B.y - A.y * B.x + A.z * B.w,
+        A.w * B.w - A.x * B.x - A.y * B.y - A.z * B.z,
+    };
+}
+
+inline quat operator+(const quat& A, const quat& B) { return { A.x + B.x, A.y + B.y, A.z + B.z, A.w + B.w }; }
+inline quat operator*(const quat& Q, float S) { return { Q.x * S, Q.y * S, Q.z * S, Q.w * S }; }
+
+namespace Quat
+{
+    inline quat Identity() { return { 0.f, 0.f, 0.f, 1.f }; }
+
+    // Rotation of AngleRadians around a normalized Axis, same handedness than Mat4::RotateX/RotateZ
+    inline quat AxisAngle(v3 Axis, float AngleRadians)
+    {
+        float S = Math::Sin(AngleRadians * 0.5f);
+        return { Axis.x * S, Axis.y * S, Axis.z * S, Math::Cos(AngleRadians * 0.5f) };
+    }
+
+    inline float Dot(const quat& A, const quat& B) { return A.x * B.x + A.y * B.y + A.z * B.z + A.w * B.w; }
+
+    inline quat Normalize(const quat& Q) { return Q * (1.f / Math::Sqrt(Quat::Dot(Q, Q))); }
+
+    inline quat Conjugate(const quat& Q) { return { -Q.x, -Q.y, -Q.z, Q.w }; }
+
+    // Inverse of a unit quaternion is its conjugate
+    inline quat Inverse(const quat& Q) { return Quat::Conjugate(Q) * (1.f / Quat::Dot(Q, Q)); }
+
+    // Q * V * Q^-1 for a unit quaternion, expanded (15 mul instead of 2 quaternion products)
+    inline v3 Rotate(const quat& Q, v3 V)
+    {
+        v3 T = 2.f * Vec3::Cross(Q.xyz, V);
+        return V + Q.w * T + Vec3::Cross(Q.xyz, T);
+    }
+
+    // Normalized linear interpolation along the shortest path
+    inline quat Nlerp(const quat& A, const quat& B, float T)
+    {
+        float Sign = Quat::Dot(A, B) < 0.f ? -1.f : 1.f;
+        return Quat::Normalize(A * (1.f - T) + B * (Sign * T));
+    }
+
+    inline quat Slerp(const quat& A, const quat& B, float T)
+    {
+        float CosTheta = Quat::Dot(A, B);
+        quat End = B;
+        if (CosTheta < 0.f)
+        {
+            CosTheta = -CosTheta;
+            End = B * -1.f;
+        }
+
+        // Nearly parallel, sin(theta) is too small to divide by
+        if (CosTheta > 0.9995f)
+            return Quat::Nlerp(A, End, T);
+
+        float Theta = Math::Acos(CosTheta);
+        float InvSin = 1.f / Math::Sin(Theta);
+        return A * (Math::Sin((1.f - T) * Theta) * InvSin) + End * (Math::Sin(T * Theta) * InvSin);
+    }
+
+    inline mat3 ToMat3(const quat& Q)
+    {
+        float XX = Q.x * Q.x, YY = Q.y * Q.y, ZZ = Q.z * Q.z;
+        float XY = Q.x * Q.y, XZ = Q.x * Q.z, YZ = Q.y * Q.z;
+        float WX = Q.w * Q.x, WY = Q.w * Q.y, WZ = Q.w * Q.z;
+        return {
+            1.f - 2.f * (YY + ZZ), 2.f * (XY + WZ),       2.f * (XZ - WY),
+            2.f * (XY - WZ),       1.f - 2.f * (XX + ZZ), 2.f * (YZ + WX),
+            2.f * (XZ + WY),       2.f * (YZ - WX),       1.f - 2.f * (XX + YY),
+        };
+    }
+
+    inline mat4 ToMat4(const quat& Q) { return Mat4::Mat4(Quat::ToMat3(Q)); }
+}
+
+// ========================================================================
+// DUAL QUATERNION FUNCTIONS
+// ========================================================================
+
+inline dualquat operator*(const dualquat& A, const dualquat& B)
+{
+    return { A.Real * B.Real, A.Real * B.Dual + A.Dual * B.Real };
+}
+
+namespace DualQuat
+{
+    inline dualquat Identity() { return { Quat::Identity(), { 0.f, 0.f, 0.f, 0.f } }; }
+
+    // Rotate then translate
+    inline dualquat RotationTranslation(const quat& Rotation, v3 Translation)
+    {
+        quat T = { Translation.x, Translation.y, Translation.z, 0.f };
+        return { Rotation, (T * Rotation) * 0.5f };
+    }
+
+    inline v3 GetTranslation(const dualquat& D)
+    {
+        return ((D.Dual * Quat::Conjugate(D.Real)) * 2.f).xyz;
+    }
+
+    // Inverse of a unit dual quaternion
+    inline dualquat Inverse(const dualquat& D)
+    {
+        return { Quat::Conjugate(D.Real), Quat::Conjugate(D.Dual) };
+    }
+
+    inline dualquat Normalize(const dualquat& D)
+    {
+        float InvLength = 1.f / Math::Sqrt(Quat::Dot(D.Real, D.Real));
+        return { D.Real * InvLength, D.Dual * InvLength };
+    }
+
+    inline v3 TransformPoint(const dualquat& D, v3 P)
+    {
+        return Quat::Rotate(D.Real, P) + DualQuat::GetTranslation(D);
+    }
+
+    // Dual quaternion linear blending (no skew/scale artifacts unlike matrix blending)
+    inline dualquat Lerp(const dualquat& A, const dualquat& B, float T)
+    {
+        float WeightB = Quat::Dot(A.Real, B.Real) < 0.f ? -T : T;
+        dualquat R = { A.Real * (1.f - T) + B.Real * WeightB, A.Dual * (1.f - T) + B.Dual * WeightB };
+        return DualQuat::Normalize(R);
+    }
+
+    inline mat4 ToMat4(const dualquat& D)
+    {
+        mat4 M = Quat::ToMat4(D.Real);
+        M.c[3].xyz = DualQuat::GetTranslation(D);
+        return M;
+    }
+}
+
+// ========================================================================
+// TRANSFORM FUNCTIONS
+// ========================================================================
+
+namespace Transform
+{
+    inline transform Identity() { return { Quat::Identity(), Vec3::Zero(), Vec3::One() }; }
+
+    inline v3 TransformPoint(const transform& T, v3 P) { return T.Translation + Quat::Rotate(T.Rotation, T.Scale * P); }
+    inline v3 TransformVector(const transform& T, v3 V) { return Quat::Rotate(T.Rotation, T.Scale * V); }
+
+    // Parent * Child. Exact when the parent scale is uniform, otherwise the skew
+    // that a matrix product would produce is dropped (as in most scene graphs)
+    inline transform Compose(const transform& Parent, const transform& Child)
+    {
+        return {
+            Quat::Normalize(Parent.Rotation * Child.Rotation),
+            Transform::TransformPoint(Parent, Child.Translation),
+            Parent.Scale * Child.Scale,
+        };
+    }
+
+    // Exact for uniform scale, see Transform::ToInverseMat4 for the general case
+    inline transform Inverse(const transform& T)
+    {
+        transform R;
+        R.Rotation = Quat::Conjugate(T.Rotation);
+        R.Scale = Vec3::One() / T.Scale;
+        R.Translation = -(R.Scale * Quat::Rotate(R.Rotation, T.Translation));
+        return R;
+    }
+
+    inline transform Lerp(const transform& A, const transform& B, float T)
+    {
+        return {
+            Quat::Slerp(A.Rotation, B.Rotation, T),
+            Math::Lerp(A.Translation, B.Translation, T),
+            Math::Lerp(A.Scale, B.Scale, T),
+        };
+    }
+
+    inline dualquat ToDualQuat(const transform& T) { return DualQuat::RotationTranslation(T.Rotation, T.Translation); }
+
+    // Translation * Rotation * Scale
+    inline mat4 ToMat4(const transform& T)
+    {
+        mat3 R = Quat::ToMat3(T.Rotation);
+        return {
+            R.c[0].x * T.Scale.x, R.c[0].y * T.Scale.x, R.c[0].z * T.Scale.x, 0.f,
+            R.c[1].x * T.Scale.y, R.c[1].y * T.Scale.y, R.c[1].z * T.Scale.y, 0.f,
+            R.c[2].x * T.Scale.z, R.c[2].y * T.Scale.z, R.c[2].z * T.Scale.z, 0.f,
+            T.Translation.x,      T.Translation.y,      T.Translation.z,      1.f,
+        };
+    }
+
+    // Inverse(ToMat4(T)) = Scale^-1 * Rotation^T * Translate(-T), without a generic 4x4 inverse
+    inline mat4 ToInverseMat4(const transform& T)
+    {
+        mat3 R = Quat::ToMat3(T.Rotation);
+        v3 InvScale = Vec3::One() / T.Scale;
+
+        mat4 M;
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int r = 0; r < 3; ++r)
+                M.c[c].e[r] = R.c[r].e[c] * InvScale.e[r];
+            M.c[c].e[3] = 0.f;
+        }
+
+        for (int r = 0; r < 3; ++r)
+            M.c[3].e[r] = -(M.c[0].e[r] * T.Translation.x + M.c[1].e[r] * T.Translation.y + M.c[2].e[r] * T.Translation.z);
+        M.c[3].e[3] = 1.f;
+        return M;
+    }
+
+    // Transpose(Inverse(ToMat4(T))) = Rotation * Scale^-1, the translation is dropped
+    inline mat4 ToNormalMat4(const transform& T)
+    {
+        mat3 R = Quat::ToMat3(T.Rotation);
+        v3 InvScale = Vec3::One() / T.Scale;
+        return {
+            R.c[0].x * InvScale.x, R.c[0].y * InvScale.x, R.c[0].z * InvScale.x, 0.f,
+            R.c[1].x * InvScale.y, R.c[1].y * InvScale.y, R.c[1].z * InvScale.y, 0.f,
+            R.c[2].x * InvScale.z, R.c[2].y * InvScale.z, R.c[2].z * InvScale.z, 0.f,
+            0.f,                   0.f,                   0.f,                   1.f,
+        };
+    }
+}
+
 #include "maths_extension.h"
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "maths_batch.h"
+
+#include "maths_batch_lanes.h"
+
+using namespace Lane;
+
+const char* Batch::GetBackendName()
+{
+#if defined(MATHS_BATCH_AVX2)
+    return "AVX2";
+#elif defined(MATHS_SSE)
+    return "SSE";
+#elif defined(MATHS_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+void Batch::PackPoints(const v3* Points, int Count, v3_block* Blocks)
+{
+    if (Count <= 0)
+        return;
+
+    int Padded = Batch::GetBlockCount(Count) * MATHS_BATCH_LANES;
+    for (int i = 0; i < Padded; ++i)
+        Batch::SetPoint(Blocks, i, Points[Math::Min(i, Count - 1)]);
+}
+
+void Batch::UnpackPoints(const v3_block* Blocks, int Count, v3* Points)
+{
+    for (int i = 0; i < Count; ++i)
+        Points[i] = Batch::GetPoint(Blocks, i);
+}
+
+void Batch::TransformPoints(const mat4& M, const v3_block* In, v3_block* Out, int BlockCount)
+{
+    lane_mat4 L = Broadcast(M);
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane X = Load(In[b].X + o);
+            lane Y = Load(In[b].Y + o);
+            lane Z = Load(In[b].Z + o);
+
+            lane R[3];
+            for (int r = 0; r < 3; ++r)
+                R[r] = Add(Add(Add(Mul(L.m[0][r], X), Mul(L.m[1][r], Y)), Mul(L.m[2][r], Z)), L.m[3][r]);
+
+            Store(Out[b].X + o, R[0]);
+            Store(Out[b].Y + o, R[1]);
+            Store(Out[b].Z + o, R[2]);
+        }
+    }
+}
+
+void Batch::TransformAABBs(const mat4& M, const aabb_block* In, aabb_block* Out, int BlockCount)
+{
+    lane_mat4 L = Broadcast(M);
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane Min0[3] = { Load(In[b].MinX + o), Load(In[b].MinY + o), Load(In[b].MinZ + o) };
+            lane Max0[3] = { Load(In[b].MaxX + o), Load(In[b].MaxY + o), Load(In[b].MaxZ + o) };
+
+            // Arvo: start from the translation, then for each matrix term
+            // add the smallest/largest of its products with the min and max of the box
+            lane Min1[3], Max1[3];
+            for (int r = 0; r < 3; ++r)
+            {
+                Min1[r] = L.m[3][r];
+                Max1[r] = L.m[3][r];
+                for (int c = 0; c < 3; ++c)
+                {
+                    lane A = Mul(L.m[c][r], Min0[c]);
+                    lane B = Mul(L.m[c][r], Max0[c]);
+                    Min1[r] = Add(Min1[r], Min(A, B));
+                    Max1[r] = Add(Max1[r], Max(A, B));
+                }
+            }
+
+            Store(Out[b].MinX + o, Min1[0]);
+            Store(Out[b].MinY + o, Min1[1]);
+            Store(Out[b].MinZ + o, Min1[2]);
+            Store(Out[b].MaxX + o, Max1[0]);
+            Store(Out[b].MaxY + o, Max1[1]);
+            Store(Out[b].MaxZ + o, Max1[2]);
+        }
+    }
+}
+
+void Batch::TransformSpheres(const mat4& M, const sphere_block* In, sphere_block* Out, int BlockCount)
+{
+    lane_mat4 L = Broadcast(M);
+
+    // Non-uniform scale: the largest axis scale keeps the sphere conservative
+    float MaxScaleSq = 0.f;
+    for (int c = 0; c < 3; ++c)
+        MaxScaleSq = Math::Max(MaxScaleSq, Vec3::SquaredLength(M.c[c].xyz));
+    lane Scale = Set1(Math::Sqrt(MaxScaleSq));
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane X = Load(In[b].X + o);
+            lane Y = Load(In[b].Y + o);
+            lane Z = Load(In[b].Z + o);
+
+            lane R[3];
+            for (int r = 0; r < 3; ++r)
+                R[r] = Add(Add(Add(Mul(L.m[0][r], X), Mul(L.m[1][r], Y)), Mul(L.m[2][r], Z)), L.m[3][r]);
+
+            Store(Out[b].X + o, R[0]);
+            Store(Out[b].Y + o, R[1]);
+            Store(Out[b].Z + o, R[2]);
+            Store(Out[b].Radius + o, Mul(Load(In[b].Radius + o), Scale));
+        }
+    }
+}
+
+void Batch::ComputeBoundingSpheres(const aabb_block* In, sphere_block* Out, int BlockCount)
+{
+    lane Half = Set1(0.5f);
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane MinX = Load(In[b].MinX + o), MaxX = Load(In[b].MaxX + o);
+            lane MinY = Load(In[b].MinY + o), MaxY = Load(In[b].MaxY + o);
+            lane MinZ = Load(In[b].MinZ + o), MaxZ = Load(In[b].MaxZ + o);
+
+            // Half extents
+            lane EX = Mul(Sub(MaxX, MinX), Half);
+            lane EY = Mul(Sub(MaxY, MinY), Half);
+            lane EZ = Mul(Sub(MaxZ, MinZ), Half);
+
+            Store(Out[b].X + o, Mul(Add(MinX, MaxX), Half));
+            Store(Out[b].Y + o, Mul(Add(MinY, MaxY), Half));
+            Store(Out[b].Z + o, Mul(Add(MinZ, MaxZ), Half));
+            Store(Out[b].Radius + o, Sqrt(Add(Add(Mul(EX, EX), Mul(EY, EY)), Mul(EZ, EZ))));
+        }
+    }
+}
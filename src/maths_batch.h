@@ -0,0 +1,112 @@
+#pragma once
+
+#include "maths.h"
+
+// Batched kernels over AoSoA blocks (arrays of small structures of arrays).
+// A block stores MATHS_BATCH_LANES values per component, so one block maps to one AVX2 register
+// per component (or two SSE registers). The layout does not depend on the backend compiled in.
+#define MATHS_BATCH_LANES 8
+
+// Backend used by maths_batch.cpp, picked at compile time (/arch:AVX2 or -mavx2 enables AVX2)
+#if !defined(MATHS_SCALAR) && defined(__AVX2__)
+#define MATHS_BATCH_AVX2
+#endif
+
+struct alignas(32) v3_block
+{
+    float X[MATHS_BATCH_LANES];
+    float Y[MATHS_BATCH_LANES];
+    float Z[MATHS_BATCH_LANES];
+};
+
+struct alignas(32) aabb_block
+{
+    float MinX[MATHS_BATCH_LANES];
+    float MinY[MATHS_BATCH_LANES];
+    float MinZ[MATHS_BATCH_LANES];
+    float MaxX[MATHS_BATCH_LANES];
+    float MaxY[MATHS_BATCH_LANES];
+    float MaxZ[MATHS_BATCH_LANES];
+};
+
+struct alignas(32) sphere_block
+{
+    float X[MATHS_BATCH_LANES];
+    float Y[MATHS_BATCH_LANES];
+    float Z[MATHS_BATCH_LANES];
+    float Radius[MATHS_BATCH_LANES];
+};
+
+namespace Batch
+{
+    // Name of the compiled backend ("AVX2", "SSE", "NEON" or "Scalar")
+    const char* GetBackendName();
+
+    inline int GetBlockCount(int Count) { return (Count + MATHS_BATCH_LANES - 1) / MATHS_BATCH_LANES; }
+
+    // Lane accessors, Index is the flat element index (block = Index / LANES)
+    inline void SetPoint(v3_block* Blocks, int Index, v3 P)
+    {
+        v3_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        B.X[L] = P.x; B.Y[L] = P.y; B.Z[L] = P.z;
+    }
+
+    inline v3 GetPoint(const v3_block* Blocks, int Index)
+    {
+        const v3_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        return { B.X[L], B.Y[L], B.Z[L] };
+    }
+
+    inline void SetAABB(aabb_block* Blocks, int Index, v3 Min, v3 Max)
+    {
+        aabb_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        B.MinX[L] = Min.x; B.MinY[L] = Min.y; B.MinZ[L] = Min.z;
+        B.MaxX[L] = Max.x; B.MaxY[L] = Max.y; B.MaxZ[L] = Max.z;
+    }
+
+    inline void GetAABB(const aabb_block* Blocks, int Index, v3* Min, v3* Max)
+    {
+        const aabb_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        *Min = { B.MinX[L], B.MinY[L], B.MinZ[L] };
+        *Max = { B.MaxX[L], B.MaxY[L], B.MaxZ[L] };
+    }
+
+    inline void SetSphere(sphere_block* Blocks, int Index, v3 Center, float Radius)
+    {
+        sphere_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        B.X[L] = Center.x; B.Y[L] = Center.y; B.Z[L] = Center.z; B.Radius[L] = Radius;
+    }
+
+    inline void GetSphere(const sphere_block* Blocks, int Index, v3* Center, float* Radius)
+    {
+        const sphere_block& B = Blocks[Index / MATHS_BATCH_LANES];
+        int L = Index % MATHS_BATCH_LANES;
+        *Center = { B.X[L], B.Y[L], B.Z[L] };
+        *Radius = B.Radius[L];
+    }
+
+    // Convert AoS points to blocks, unused lanes of the last block repeat the last point
+    // so kernels can always process full blocks. Blocks must hold GetBlockCount(Count) elements.
+    void PackPoints(const v3* Points, int Count, v3_block* Blocks);
+    void UnpackPoints(const v3_block* Blocks, int Count, v3* Points);
+
+    // Kernels below process whole blocks, In and Out may alias.
+    // Blocks do not need to be 32-byte aligned (std::vector storage before C++17 is fine).
+
+    // Out = M * (In, 1), assuming an affine M (no perspective divide)
+    void TransformPoints(const mat4& M, const v3_block* In, v3_block* Out, int BlockCount);
+
+    // World-space AABBs of the transformed boxes (Arvo's method, affine M)
+    void TransformAABBs(const mat4& M, const aabb_block* In, aabb_block* Out, int BlockCount);
+
+    // Spheres transformed by M, radius scaled by the largest axis scale of M
+    void TransformSpheres(const mat4& M, const sphere_block* In, sphere_block* Out, int BlockCount);
+
+    // Bounding spheres of boxes (center of the box, half diagonal as radius)
+    void ComputeBoundingSpheres(const aabb_block* In, sphere_block* Out, int BlockCount);
+}
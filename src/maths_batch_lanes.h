@@ -0,0 +1,208 @@
+#pragma once
+
+// Internal to the batch kernels (maths_batch.cpp, maths_frustum.cpp).
+// Minimal lane type so every kernel is written once for all backends.
+// A block of MATHS_BATCH_LANES floats is processed LANE_WIDTH floats at a time.
+
+#include <cstdint>
+#include <cstring>
+
+#include "maths_batch.h"
+
+#if defined(MATHS_BATCH_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace Lane
+{
+#if defined(MATHS_BATCH_AVX2)
+    const int LANE_WIDTH = 8;
+    typedef __m256 lane;
+    typedef __m256 lane_mask;
+    inline lane Load(const float* P) { return _mm256_loadu_ps(P); }
+    inline void Store(float* P, lane A) { _mm256_storeu_ps(P, A); }
+    inline lane Set1(float V) { return _mm256_set1_ps(V); }
+    inline lane Add(lane A, lane B) { return _mm256_add_ps(A, B); }
+    inline lane Sub(lane A, lane B) { return _mm256_sub_ps(A, B); }
+    inline lane Mul(lane A, lane B) { return _mm256_mul_ps(A, B); }
+    inline lane Min(lane A, lane B) { return _mm256_min_ps(A, B); }
+    inline lane Max(lane A, lane B) { return _mm256_max_ps(A, B); }
+    inline lane Sqrt(lane A) { return _mm256_sqrt_ps(A); }
+    inline lane_mask GreaterEqual(lane A, lane B) { return _mm256_cmp_ps(A, B, _CMP_GE_OQ); }
+    inline lane_mask LessEqual(lane A, lane B) { return _mm256_cmp_ps(A, B, _CMP_LE_OQ); }
+    inline lane_mask And(lane_mask A, lane_mask B) { return _mm256_and_ps(A, B); }
+    inline lane_mask AllTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    inline int MoveMask(lane_mask A) { return _mm256_movemask_ps(A); }
+    typedef __m256i lane_int;
+    inline lane Div(lane A, lane B) { return _mm256_div_ps(A, B); }
+    inline lane Abs(lane A) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), A); }
+    inline lane RsqrtEstimate(lane A) { return _mm256_rsqrt_ps(A); }
+    inline lane_mask Greater(lane A, lane B) { return _mm256_cmp_ps(A, B, _CMP_GT_OQ); }
+    inline lane Select(lane_mask M, lane A, lane B) { return _mm256_blendv_ps(B, A, M); }
+    inline lane_int RoundToInt(lane A) { return _mm256_cvtps_epi32(A); }
+    inline lane ToFloat(lane_int A) { return _mm256_cvtepi32_ps(A); }
+    inline lane_int CastToInt(lane A) { return _mm256_castps_si256(A); }
+    inline lane CastToFloat(lane_int A) { return _mm256_castsi256_ps(A); }
+    inline lane_int IntSet1(int V) { return _mm256_set1_epi32(V); }
+    inline lane_int IntAdd(lane_int A, lane_int B) { return _mm256_add_epi32(A, B); }
+    inline lane_int IntSub(lane_int A, lane_int B) { return _mm256_sub_epi32(A, B); }
+    inline lane_int IntAnd(lane_int A, lane_int B) { return _mm256_and_si256(A, B); }
+    inline lane_int IntOr(lane_int A, lane_int B) { return _mm256_or_si256(A, B); }
+    inline lane_int IntXor(lane_int A, lane_int B) { return _mm256_xor_si256(A, B); }
+    inline lane_mask IntEqual(lane_int A, lane_int B) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(A, B)); }
+    template<int N> inline lane_int ShiftLeft(lane_int A) { return _mm256_slli_epi32(A, N); }
+    template<int N> inline lane_int ShiftRight(lane_int A) { return _mm256_srli_epi32(A, N); }
+#elif defined(MATHS_SSE)
+    const int LANE_WIDTH = 4;
+    typedef __m128 lane;
+    typedef __m128 lane_mask;
+    inline lane Load(const float* P) { return _mm_loadu_ps(P); }
+    inline void Store(float* P, lane A) { _mm_storeu_ps(P, A); }
+    inline lane Set1(float V) { return _mm_set1_ps(V); }
+    inline lane Add(lane A, lane B) { return _mm_add_ps(A, B); }
+    inline lane Sub(lane A, lane B) { return _mm_sub_ps(A, B); }
+    inline lane Mul(lane A, lane B) { return _mm_mul_ps(A, B); }
+    inline lane Min(lane A, lane B) { return _mm_min_ps(A, B); }
+    inline lane Max(lane A, lane B) { return _mm_max_ps(A, B); }
+    inline lane Sqrt(lane A) { return _mm_sqrt_ps(A); }
+    inline lane_mask GreaterEqual(lane A, lane B) { return _mm_cmpge_ps(A, B); }
+    inline lane_mask LessEqual(lane A, lane B) { return _mm_cmple_ps(A, B); }
+    inline lane_mask And(lane_mask A, lane_mask B) { return _mm_and_ps(A, B); }
+    inline lane_mask AllTrue() { return _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); }
+    inline int MoveMask(lane_mask A) { return _mm_movemask_ps(A); }
+    typedef __m128i lane_int;
+    inline lane Div(lane A, lane B) { return _mm_div_ps(A, B); }
+    inline lane Abs(lane A) { return _mm_andnot_ps(_mm_set1_ps(-0.f), A); }
+    inline lane RsqrtEstimate(lane A) { return _mm_rsqrt_ps(A); }
+    inline lane_mask Greater(lane A, lane B) { return _mm_cmpgt_ps(A, B); }
+    inline lane Select(lane_mask M, lane A, lane B) { return _mm_or_ps(_mm_and_ps(M, A), _mm_andnot_ps(M, B)); }
+    inline lane_int RoundToInt(lane A) { return _mm_cvtps_epi32(A); }
+    inline lane ToFloat(lane_int A) { return _mm_cvtepi32_ps(A); }
+    inline lane_int CastToInt(lane A) { return _mm_castps_si128(A); }
+    inline lane CastToFloat(lane_int A) { return _mm_castsi128_ps(A); }
+    inline lane_int IntSet1(int V) { return _mm_set1_epi32(V); }
+    inline lane_int IntAdd(lane_int A, lane_int B) { return _mm_add_epi32(A, B); }
+    inline lane_int IntSub(lane_int A, lane_int B) { return _mm_sub_epi32(A, B); }
+    inline lane_int IntAnd(lane_int A, lane_int B) { return _mm_and_si128(A, B); }
+    inline lane_int IntOr(lane_int A, lane_int B) { return _mm_or_si128(A, B); }
+    inline lane_int IntXor(lane_int A, lane_int B) { return _mm_xor_si128(A, B); }
+    inline lane_mask IntEqual(lane_int A, lane_int B) { return _mm_castsi128_ps(_mm_cmpeq_epi32(A, B)); }
+    template<int N> inline lane_int ShiftLeft(lane_int A) { return _mm_slli_epi32(A, N); }
+    template<int N> inline lane_int ShiftRight(lane_int A) { return _mm_srli_epi32(A, N); }
+#elif defined(MATHS_NEON)
+    const int LANE_WIDTH = 4;
+    typedef float32x4_t lane;
+    typedef uint32x4_t lane_mask;
+    inline lane Load(const float* P) { return vld1q_f32(P); }
+    inline void Store(float* P, lane A) { vst1q_f32(P, A); }
+    inline lane Set1(float V) { return vdupq_n_f32(V); }
+    inline lane Add(lane A, lane B) { return vaddq_f32(A, B); }
+    inline lane Sub(lane A, lane B) { return vsubq_f32(A, B); }
+    inline lane Mul(lane A, lane B) { return vmulq_f32(A, B); }
+    inline lane Min(lane A, lane B) { return vminq_f32(A, B); }
+    inline lane Max(lane A, lane B) { return vmaxq_f32(A, B); }
+    inline lane Sqrt(lane A)
+    {
+        float T[4];
+        vst1q_f32(T, A);
+        for (int i = 0; i < 4; ++i)
+            T[i] = std::sqrt(T[i]);
+        return vld1q_f32(T);
+    }
+    inline lane_mask GreaterEqual(lane A, lane B) { return vcgeq_f32(A, B); }
+    inline lane_mask LessEqual(lane A, lane B) { return vcleq_f32(A, B); }
+    inline lane_mask And(lane_mask A, lane_mask B) { return vandq_u32(A, B); }
+    inline lane_mask AllTrue() { return vdupq_n_u32(0xFFFFFFFFu); }
+    inline int MoveMask(lane_mask A)
+    {
+        uint32_t T[4];
+        vst1q_u32(T, A);
+        return (T[0] >> 31) | ((T[1] >> 31) << 1) | ((T[2] >> 31) << 2) | ((T[3] >> 31) << 3);
+    }
+    typedef int32x4_t lane_int;
+    inline lane Div(lane A, lane B)
+    {
+        // Reciprocal estimate refined twice (no vdivq_f32 on 32-bit ARM)
+        float32x4_t R = vrecpeq_f32(B);
+        R = vmulq_f32(R, vrecpsq_f32(B, R));
+        R = vmulq_f32(R, vrecpsq_f32(B, R));
+        return vmulq_f32(A, R);
+    }
+    inline lane Abs(lane A) { return vabsq_f32(A); }
+    inline lane RsqrtEstimate(lane A)
+    {
+        // 8 bits estimate, one step here to match the 12 bits of SSE
+        float32x4_t R = vrsqrteq_f32(A);
+        return vmulq_f32(R, vrsqrtsq_f32(vmulq_f32(A, R), R));
+    }
+    inline lane_mask Greater(lane A, lane B) { return vcgtq_f32(A, B); }
+    inline lane Select(lane_mask M, lane A, lane B) { return vbslq_f32(M, A, B); }
+    inline lane_int RoundToInt(lane A) { return vcvtq_s32_f32(vaddq_f32(A, vbslq_f32(vcgeq_f32(A, vdupq_n_f32(0.f)), vdupq_n_f32(0.5f), vdupq_n_f32(-0.5f)))); }
+    inline lane ToFloat(lane_int A) { return vcvtq_f32_s32(A); }
+    inline lane_int CastToInt(lane A) { return vreinterpretq_s32_f32(A); }
+    inline lane CastToFloat(lane_int A) { return vreinterpretq_f32_s32(A); }
+    inline lane_int IntSet1(int V) { return vdupq_n_s32(V); }
+    inline lane_int IntAdd(lane_int A, lane_int B) { return vaddq_s32(A, B); }
+    inline lane_int IntSub(lane_int A, lane_int B) { return vsubq_s32(A, B); }
+    inline lane_int IntAnd(lane_int A, lane_int B) { return vandq_s32(A, B); }
+    inline lane_int IntOr(lane_int A, lane_int B) { return vorrq_s32(A, B); }
+    inline lane_int IntXor(lane_int A, lane_int B) { return veorq_s32(A, B); }
+    inline lane_mask IntEqual(lane_int A, lane_int B) { return vceqq_s32(A, B); }
+    template<int N> inline lane_int ShiftLeft(lane_int A) { return vshlq_n_s32(A, N); }
+    template<int N> inline lane_int ShiftRight(lane_int A) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(A), N)); }
+#else
+    const int LANE_WIDTH = 1;
+    typedef float lane;
+    typedef bool lane_mask;
+    inline lane Load(const float* P) { return *P; }
+    inline void Store(float* P, lane A) { *P = A; }
+    inline lane Set1(float V) { return V; }
+    inline lane Add(lane A, lane B) { return A + B; }
+    inline lane Sub(lane A, lane B) { return A - B; }
+    inline lane Mul(lane A, lane B) { return A * B; }
+    inline lane Min(lane A, lane B) { return Math::Min(A, B); }
+    inline lane Max(lane A, lane B) { return Math::Max(A, B); }
+    inline lane Sqrt(lane A) { return std::sqrt(A); }
+    inline lane_mask GreaterEqual(lane A, lane B) { return A >= B; }
+    inline lane_mask LessEqual(lane A, lane B) { return A <= B; }
+    inline lane_mask And(lane_mask A, lane_mask B) { return A && B; }
+    inline lane_mask AllTrue() { return true; }
+    inline int MoveMask(lane_mask A) { return A ? 1 : 0; }
+    typedef int32_t lane_int;
+    inline lane Div(lane A, lane B) { return A / B; }
+    inline lane Abs(lane A) { return fabsf(A); }
+    inline lane RsqrtEstimate(lane A) { return 1.f / std::sqrt(A); }
+    inline lane_mask Greater(lane A, lane B) { return A > B; }
+    inline lane Select(lane_mask M, lane A, lane B) { return M ? A : B; }
+    inline lane_int RoundToInt(lane A) { return (int32_t)floorf(A + 0.5f); }
+    inline lane ToFloat(lane_int A) { return (float)A; }
+    inline lane_int CastToInt(lane A) { lane_int R; memcpy(&R, &A, sizeof(R)); return R; }
+    inline lane CastToFloat(lane_int A) { lane R; memcpy(&R, &A, sizeof(R)); return R; }
+    inline lane_int IntSet1(int V) { return V; }
+    inline lane_int IntAdd(lane_int A, lane_int B) { return A + B; }
+    inline lane_int IntSub(lane_int A, lane_int B) { return A - B; }
+    inline lane_int IntAnd(lane_int A, lane_int B) { return A & B; }
+    inline lane_int IntOr(lane_int A, lane_int B) { return A | B; }
+    inline lane_int IntXor(lane_int A, lane_int B) { return A ^ B; }
+    inline lane_mask IntEqual(lane_int A, lane_int B) { return A == B; }
+    template<int N> inline lane_int ShiftLeft(lane_int A) { return (lane_int)((uint32_t)A << N); }
+    template<int N> inline lane_int ShiftRight(lane_int A) { return (lane_int)((uint32_t)A >> N); }
+#endif
+
+    static_assert(MATHS_BATCH_LANES % LANE_WIDTH == 0, "Block size must be a multiple of the SIMD width");
+
+    // M broadcasted once per kernel call (M.c[Col].e[Row])
+    struct lane_mat4
+    {
+        lane m[4][4];
+    };
+
+    inline lane_mat4 Broadcast(const mat4& M)
+    {
+        lane_mat4 R;
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                R.m[c][r] = Set1(M.c[c].e[r]);
+        return R;
+    }
+}
@@ -0,0 +1,145 @@
+#include "maths_fast.h"
+
+#include "maths_batch_lanes.h"
+
+using namespace Lane;
+using namespace Math::Fast::Poly;
+
+// Each batch function runs the scalar algorithm of maths_fast.h on LANE_WIDTH values,
+// the remaining Count % LANE_WIDTH values go through the scalar version.
+
+void Math::Fast::SinCos(const float* X, float* Sin, float* Cos, int Count)
+{
+    int i = 0;
+    for (; i + LANE_WIDTH <= Count; i += LANE_WIDTH)
+    {
+        lane V = Load(X + i);
+
+        lane_int Quadrant = RoundToInt(Mul(V, Set1(TwoOverPi)));
+        lane K = ToFloat(Quadrant);
+        lane R = Sub(Sub(Sub(V, Mul(K, Set1(PiOver2Part1))), Mul(K, Set1(PiOver2Part2))), Mul(K, Set1(PiOver2Part3)));
+        lane R2 = Mul(R, R);
+
+        lane SinPoly = Add(Set1(SinCoeffs[1]), Mul(R2, Set1(SinCoeffs[2])));
+        SinPoly = Add(Set1(SinCoeffs[0]), Mul(R2, SinPoly));
+        lane S = Add(R, Mul(Mul(R, R2), SinPoly));
+
+        lane CosPoly = Add(Set1(CosCoeffs[1]), Mul(R2, Set1(CosCoeffs[2])));
+        CosPoly = Add(Set1(CosCoeffs[0]), Mul(R2, CosPoly));
+        lane C = Add(Sub(Set1(1.f), Mul(Set1(0.5f), R2)), Mul(Mul(R2, R2), CosPoly));
+
+        // Rotate by the quadrant: odd quadrants swap sin/cos, quadrants 2 and 3 flip both signs
+        lane_mask Swap = IntEqual(IntAnd(Quadrant, IntSet1(1)), IntSet1(1));
+        lane SwappedS = Select(Swap, C, S);
+        lane SwappedC = Select(Swap, Sub(Set1(0.f), S), C);
+
+        lane_int SignBit = ShiftLeft<30>(IntAnd(Quadrant, IntSet1(2)));
+        Store(Sin + i, CastToFloat(IntXor(CastToInt(SwappedS), SignBit)));
+        Store(Cos + i, CastToFloat(IntXor(CastToInt(SwappedC), SignBit)));
+    }
+
+    for (; i < Count; ++i)
+        Math::Fast::SinCos(X[i], &Sin[i], &Cos[i]);
+}
+
+void Math::Fast::Atan2(const float* Y, const float* X, float* Result, int Count)
+{
+    int i = 0;
+    for (; i + LANE_WIDTH <= Count; i += LANE_WIDTH)
+    {
+        lane VX = Load(X + i);
+        lane VY = Load(Y + i);
+        lane AbsX = Abs(VX);
+        lane AbsY = Abs(VY);
+
+        lane MaxXY = Max(AbsX, AbsY);
+        lane A = Select(Greater(MaxXY, Set1(0.f)), Div(Min(AbsX, AbsY), MaxXY), Set1(0.f));
+        lane S = Mul(A, A);
+
+        lane P = Add(Set1(AtanCoeffs[4]), Mul(S, Set1(AtanCoeffs[5])));
+        P = Add(Set1(AtanCoeffs[3]), Mul(S, P));
+        P = Add(Set1(AtanCoeffs[2]), Mul(S, P));
+        P = Add(Set1(AtanCoeffs[1]), Mul(S, P));
+        P = Add(Set1(AtanCoeffs[0]), Mul(S, P));
+        lane R = Mul(A, P);
+
+        R = Select(Greater(AbsY, AbsX), Sub(Set1(1.57079637f), R), R);
+        R = Select(Greater(Set1(0.f), VX), Sub(Set1(3.14159274f), R), R);
+        R = Select(Greater(Set1(0.f), VY), Sub(Set1(0.f), R), R);
+        Store(Result + i, R);
+    }
+
+    for (; i < Count; ++i)
+        Result[i] = Math::Fast::Atan2(Y[i], X[i]);
+}
+
+void Math::Fast::Rsqrt(const float* X, float* Result, int Count)
+{
+    int i = 0;
+    for (; i + LANE_WIDTH <= Count; i += LANE_WIDTH)
+    {
+        lane V = Load(X + i);
+        lane R = RsqrtEstimate(V);
+
+        // One Newton-Raphson step
+        R = Mul(R, Sub(Set1(1.5f), Mul(Mul(Set1(0.5f), V), Mul(R, R))));
+        Store(Result + i, R);
+    }
+
+    for (; i < Count; ++i)
+        Result[i] = Math::Fast::Rsqrt(X[i]);
+}
+
+void Math::Fast::Exp2(const float* X, float* Result, int Count)
+{
+    int i = 0;
+    for (; i + LANE_WIDTH <= Count; i += LANE_WIDTH)
+    {
+        lane V = Min(Max(Load(X + i), Set1(-126.f)), Set1(127.f));
+
+        lane_int K = RoundToInt(V);
+        lane F = Sub(V, ToFloat(K));
+
+        lane P = Add(Set1(ExpCoeffs[4]), Mul(F, Set1(ExpCoeffs[5])));
+        P = Add(Set1(ExpCoeffs[3]), Mul(F, P));
+        P = Add(Set1(ExpCoeffs[2]), Mul(F, P));
+        P = Add(Set1(ExpCoeffs[1]), Mul(F, P));
+        P = Add(Set1(ExpCoeffs[0]), Mul(F, P));
+        P = Add(Set1(1.f), Mul(F, P));
+
+        // 2^K built directly in the exponent bits
+        lane Scale = CastToFloat(ShiftLeft<23>(IntAdd(K, IntSet1(127))));
+        Store(Result + i, Mul(P, Scale));
+    }
+
+    for (; i < Count; ++i)
+        Result[i] = Math::Fast::Exp2(X[i]);
+}
+
+void Math::Fast::Log2(const float* X, float* Result, int Count)
+{
+    int i = 0;
+    for (; i + LANE_WIDTH <= Count; i += LANE_WIDTH)
+    {
+        lane_int Bits = CastToInt(Load(X + i));
+        lane E = ToFloat(IntSub(IntAnd(ShiftRight<23>(Bits), IntSet1(0xFF)), IntSet1(127)));
+        lane M = CastToFloat(IntOr(IntAnd(Bits, IntSet1(0x007FFFFF)), IntSet1(0x3F800000)));
+
+        // Mantissa in [sqrt(2)/2, sqrt(2)]
+        lane_mask Big = Greater(M, Set1(1.41421356f));
+        M = Select(Big, Mul(M, Set1(0.5f)), M);
+        E = Select(Big, Add(E, Set1(1.f)), E);
+
+        lane T = Div(Sub(M, Set1(1.f)), Add(M, Set1(1.f)));
+        lane T2 = Mul(T, T);
+
+        lane P = Add(Set1(LogCoeffs[3]), Mul(T2, Set1(LogCoeffs[4])));
+        P = Add(Set1(LogCoeffs[2]), Mul(T2, P));
+        P = Add(Set1(LogCoeffs[1]), Mul(T2, P));
+        P = Add(Set1(LogCoeffs[0]), Mul(T2, P));
+        Store(Result + i, Add(E, Mul(T, P)));
+    }
+
+    for (; i < Count; ++i)
+        Result[i] = Math::Fast::Log2(X[i]);
+}
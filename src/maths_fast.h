@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "maths.h"
+
+// Polynomial approximations of the transcendental functions, for hot CPU paths
+// (mesh generation, loaders, per-instance updates) where std:: precision is not needed.
+// Maximum errors below are measured against double precision std:: over the whole stated domain
+// (checked by the accuracy sweep of benchmark/benchmark.cpp).
+// Out of domain inputs are not checked.
+namespace Math
+{
+    namespace Fast
+    {
+        // Coefficients shared by the scalar and batch versions
+        namespace Poly
+        {
+            // Cody-Waite split of Pi/2 (first parts are exact in float, k * Part exact while |k| < 2^16)
+            const float PiOver2Part1 = 1.5703125f;
+            const float PiOver2Part2 = 4.837512969970703125e-4f;
+            const float PiOver2Part3 = 7.54978995489188216e-8f;
+            const float TwoOverPi = 0.636619772367581f;
+
+            // Minimax on [-Pi/4, Pi/4] (Cephes)
+            const float SinCoeffs[3] = {
+                -1.6666654611e-1f,
+                 8.3321608736e-3f,
+                -1.9515295891e-4f,
+            };
+            const float CosCoeffs[3] = {
+                 4.166664568298827e-2f,
+                -1.388731625493765e-3f,
+                 2.443315711809948e-5f,
+            };
+
+            // atan(a) on [0, 1], odd polynomial
+            const float AtanCoeffs[6] = {
+                 0.99997726f,
+                -0.33262347f,
+                 0.19354346f,
+                -0.11643287f,
+                 0.05265332f,
+                -0.01172120f,
+            };
+
+            // 2^f on [-0.5, 0.5], Taylor terms ln(2)^n / n!
+            const float ExpCoeffs[6] = {
+                 6.9314718055994529e-01f,
+                 2.4022650695910069e-01f,
+                 5.5504108664821576e-02f,
+                 9.6181291076284769e-03f,
+                 1.3333558146428441e-03f,
+                 1.5403530393381606e-04f,
+            };
+
+            // log2(m) = t * (LogCoeffs[0] + t^2 * (LogCoeffs[1] + ...)), t = (m - 1) / (m + 1), m in [sqrt(2)/2, sqrt(2)]
+            const float LogCoeffs[5] = {
+                 2.885390081777927f,  // 2 / ln(2)
+                 0.961796693925976f,  // 2 / (3 ln(2))
+                 0.577078016355585f,  // 2 / (5 ln(2))
+                 0.412198583111132f,  // 2 / (7 ln(2))
+                 0.320598897975325f,  // 2 / (9 ln(2))
+            };
+        }
+
+        inline uint32_t AsUint(float V) { uint32_t R; memcpy(&R, &V, sizeof(R)); return R; }
+        inline float AsFloat(uint32_t V) { float R; memcpy(&R, &V, sizeof(R)); return R; }
+
+        // Max absolute error 1e-7 for |X| <= 8192, 1e-6 for |X| <= 65536 (range reduction loses bits past that)
+        // The quadrant branches make a single call slower than std:: on varied angles, the batch version is the fast one
+        inline void SinCos(float X, float* Sin, float* Cos)
+        {
+            using namespace Poly;
+
+            // Quadrant and remainder in [-Pi/4, Pi/4]
+            float K = floorf(X * TwoOverPi + 0.5f);
+            int Quadrant = (int)K;
+            float R = ((X - K * PiOver2Part1) - K * PiOver2Part2) - K * PiOver2Part3;
+            float R2 = R * R;
+
+            float S = R + R * R2 * (SinCoeffs[0] + R2 * (SinCoeffs[1] + R2 * SinCoeffs[2]));
+            float C = 1.f - 0.5f * R2 + R2 * R2 * (CosCoeffs[0] + R2 * (CosCoeffs[1] + R2 * CosCoeffs[2]));
+
+            // Rotate by the quadrant
+            if (Quadrant & 1)
+            {
+                float T = S;
+                S = C;
+                C = -T;
+            }
+            if (Quadrant & 2)
+            {
+                S = -S;
+                C = -C;
+            }
+
+            *Sin = S;
+            *Cos = C;
+        }
+
+        // Same error and domain as SinCos
+        inline float Sin(float X) { float S, C; SinCos(X, &S, &C); return S; }
+        inline float Cos(float X) { float S, C; SinCos(X, &S, &C); return C; }
+
+        // Max absolute error 2e-6 radians, any finite inputs, Atan2(0, 0) = 0
+        inline float Atan2(float Y, float X)
+        {
+            using namespace Poly;
+
+            float AbsX = fabsf(X);
+            float AbsY = fabsf(Y);
+            float MaxXY = Math::Max(AbsX, AbsY);
+            float A = MaxXY == 0.f ? 0.f : Math::Min(AbsX, AbsY) / MaxXY;
+            float S = A * A;
+            float R = A * (AtanCoeffs[0] + S * (AtanCoeffs[1] + S * (AtanCoeffs[2] + S * (AtanCoeffs[3] + S * (AtanCoeffs[4] + S * AtanCoeffs[5])))));
+
+            if (AbsY > AbsX)
+                R = 1.57079637f - R;
+            if (X < 0.f)
+                R = 3.14159274f - R;
+            return Y < 0.f ? -R : R;
+        }
+
+        // Max relative error 3e-7 for positive normal floats
+        inline float Rsqrt(float X)
+        {
+#if defined(MATHS_SSE)
+            // Hardware estimate (12 bits) refined by one Newton-Raphson step
+            float R = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(X)));
+            return R * (1.5f - 0.5f * X * R * R);
+#else
+            float R = AsFloat(0x5F375A86u - (AsUint(X) >> 1));
+            R = R * (1.5f - 0.5f * X * R * R);
+            R = R * (1.5f - 0.5f * X * R * R);
+            return R * (1.5f - 0.5f * X * R * R);
+#endif
+        }
+
+        // Max relative error 2.5e-7 for X in [-126, 127], clamped outside
+        inline float Exp2(float X)
+        {
+            using namespace Poly;
+
+            X = Math::Clamp(X, -126.f, 127.f);
+            float K = floorf(X + 0.5f);
+            float F = X - K;
+            float P = 1.f + F * (ExpCoeffs[0] + F * (ExpCoeffs[1] + F * (ExpCoeffs[2] + F * (ExpCoeffs[3] + F * (ExpCoeffs[4] + F * ExpCoeffs[5])))));
+            return P * AsFloat((uint32_t)((int)K + 127) << 23);
+        }
+
+        // Max error 1.2e-7 * Max(1, |Log2(X)|) for positive normal floats (absolute near 1, relative elsewhere)
+        inline float Log2(float X)
+        {
+            using namespace Poly;
+
+            // X = M * 2^E, M in [sqrt(2)/2, sqrt(2)]
+            uint32_t Bits = AsUint(X);
+            int E = (int)((Bits >> 23) & 0xFF) - 127;
+            float M = AsFloat((Bits & 0x007FFFFFu) | 0x3F800000u);
+            if (M > 1.41421356f)
+            {
+                M *= 0.5f;
+                E += 1;
+            }
+
+            float T = (M - 1.f) / (M + 1.f);
+            float T2 = T * T;
+            return (float)E + T * (LogCoeffs[0] + T2 * (LogCoeffs[1] + T2 * (LogCoeffs[2] + T2 * (LogCoeffs[3] + T2 * LogCoeffs[4]))));
+        }
+
+        // Batch versions (SIMD, same errors as the scalar ones), arrays may alias
+        void SinCos(const float* X, float* Sin, float* Cos, int Count);
+        void Atan2(const float* Y, const float* X, float* Result, int Count);
+        void Rsqrt(const float* X, float* Result, int Count);
+        void Exp2(const float* X, float* Result, int Count);
+        void Log2(const float* X, float* Result, int Count);
+    }
+}
@@ -0,0 +1,403 @@
+#include "maths_frustum.h"
+
+#include "maths_batch_lanes.h"
+
+using namespace Lane;
+
+frustum Frustum::FromMatrix(const mat4& ViewProjection)
+{
+    frustum F;
+
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows (GL clip space, -w <= z <= w)
+    v4 Rows[4];
+    for (int r = 0; r < 4; ++r)
+        Rows[r] = { ViewProjection.c[0].e[r], ViewProjection.c[1].e[r], ViewProjection.c[2].e[r], ViewProjection.c[3].e[r] };
+
+    F.Planes[FRUSTUM_PLANE_LEFT]   = Rows[3] + Rows[0];
+    F.Planes[FRUSTUM_PLANE_RIGHT]  = Rows[3] - Rows[0];
+    F.Planes[FRUSTUM_PLANE_BOTTOM] = Rows[3] + Rows[1];
+    F.Planes[FRUSTUM_PLANE_TOP]    = Rows[3] - Rows[1];
+    F.Planes[FRUSTUM_PLANE_NEAR]   = Rows[3] + Rows[2];
+    F.Planes[FRUSTUM_PLANE_FAR]    = Rows[3] - Rows[2];
+
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+        F.Planes[i] = F.Planes[i] / Vec3::Length(F.Planes[i].xyz);
+
+    // Corners are the NDC cube brought back to world space
+    mat4 InvViewProjection = Mat4::Inverse(ViewProjection);
+    F.CornersMin = {  INFINITY,  INFINITY,  INFINITY };
+    F.CornersMax = { -INFINITY, -INFINITY, -INFINITY };
+    for (int i = 0; i < 8; ++i)
+    {
+        v4 NDC = { (i & 1) ? 1.f : -1.f, (i & 2) ? 1.f : -1.f, (i & 4) ? 1.f : -1.f, 1.f };
+        v4 World = InvViewProjection * NDC;
+        F.Corners[i] = World.xyz / World.w;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            F.CornersMin.e[a] = Math::Min(F.CornersMin.e[a], F.Corners[i].e[a]);
+            F.CornersMax.e[a] = Math::Max(F.CornersMax.e[a], F.Corners[i].e[a]);
+        }
+    }
+
+    return F;
+}
+
+static bool BoxesOverlap(v3 MinA, v3 MaxA, v3 MinB, v3 MaxB)
+{
+    return MinA.x <= MaxB.x && MaxA.x >= MinB.x
+        && MinA.y <= MaxB.y && MaxA.y >= MinB.y
+        && MinA.z <= MaxB.z && MaxA.z >= MinB.z;
+}
+
+// Corner pairs of the 12 frustum edges (corners differing by one NDC axis)
+static const int FrustumEdges[12][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+};
+
+// Last part of the separating axis test of a box (Center, half-size Axes) against the frustum:
+// the cross products of the box axes with the frustum edges. Plane normals and box axes are tested
+// by the conservative and corners passes. All 12 edges are used since near and far rectangles are
+// not parallel with an oblique projection.
+static bool SeparatedOnEdgeAxes(const frustum& F, v3 Center, const v3 Axes[3])
+{
+    for (int e = 0; e < 12; ++e)
+    {
+        v3 Edge = F.Corners[FrustumEdges[e][1]] - F.Corners[FrustumEdges[e][0]];
+        for (int a = 0; a < 3; ++a)
+        {
+            // Parallel edges (or a flat box axis) do not give an axis
+            v3 L = Vec3::Cross(Axes[a], Edge);
+            if (Vec3::SquaredLength(L) <= 1e-12f * Vec3::SquaredLength(Axes[a]) * Vec3::SquaredLength(Edge))
+                continue;
+
+            float BoxCenter = Vec3::Dot(L, Center);
+            float BoxRadius = fabsf(Vec3::Dot(L, Axes[0])) + fabsf(Vec3::Dot(L, Axes[1])) + fabsf(Vec3::Dot(L, Axes[2]));
+
+            float Min = INFINITY;
+            float Max = -INFINITY;
+            for (int i = 0; i < 8; ++i)
+            {
+                float D = Vec3::Dot(L, F.Corners[i]);
+                Min = Math::Min(Min, D);
+                Max = Math::Max(Max, D);
+            }
+
+            if (BoxCenter + BoxRadius < Min || BoxCenter - BoxRadius > Max)
+                return true;
+        }
+    }
+    return false;
+}
+
+// With world-aligned boxes the edge axes and the frustum extents along them are the same for every
+// box, batch tests compute them once
+struct aabb_edge_axes
+{
+    v3 Axes[36];
+    float Min[36];
+    float Max[36];
+    int Count;
+};
+
+static aabb_edge_axes ComputeAABBEdgeAxes(const frustum& F)
+{
+    aabb_edge_axes Result = {};
+    for (int e = 0; e < 12; ++e)
+    {
+        v3 Edge = F.Corners[FrustumEdges[e][1]] - F.Corners[FrustumEdges[e][0]];
+        v3 Crosses[3] = { { 0.f, -Edge.z, Edge.y }, { Edge.z, 0.f, -Edge.x }, { -Edge.y, Edge.x, 0.f } };
+        for (int a = 0; a < 3; ++a)
+        {
+            v3 L = Crosses[a];
+            if (Vec3::SquaredLength(L) <= 1e-12f * Vec3::SquaredLength(Edge))
+                continue;
+
+            // Edges along NDC x (and along NDC y) are parallel when near and far planes are, skip repeated axes
+            bool Duplicate = false;
+            for (int i = 0; i < Result.Count && !Duplicate; ++i)
+                Duplicate = Vec3::SquaredLength(Vec3::Cross(L, Result.Axes[i])) <= 1e-10f * Vec3::SquaredLength(L) * Vec3::SquaredLength(Result.Axes[i]);
+            if (Duplicate)
+                continue;
+
+            float Min = INFINITY;
+            float Max = -INFINITY;
+            for (int i = 0; i < 8; ++i)
+            {
+                float D = Vec3::Dot(L, F.Corners[i]);
+                Min = Math::Min(Min, D);
+                Max = Math::Max(Max, D);
+            }
+
+            Result.Axes[Result.Count] = L;
+            Result.Min[Result.Count] = Min;
+            Result.Max[Result.Count] = Max;
+            Result.Count++;
+        }
+    }
+    return Result;
+}
+
+// Distance from the center to the frustum against the radius
+static bool SphereTouchesFrustum(const frustum& F, v3 Center, float Radius)
+{
+    float Distances[FRUSTUM_PLANE_COUNT];
+    bool Inside = true;
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        Distances[i] = Vec3::Dot(F.Planes[i].xyz, Center) + F.Planes[i].w;
+        Inside = Inside && Distances[i] >= 0.f;
+    }
+    if (Inside)
+        return true;
+
+    // Closest point inside a face: the center projected on the plane is inside the other planes
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        if (Distances[i] >= 0.f)
+            continue;
+
+        v3 P = Center - F.Planes[i].xyz * Distances[i];
+        bool InFace = true;
+        for (int j = 0; j < FRUSTUM_PLANE_COUNT && InFace; ++j)
+            InFace = (j == i) || Vec3::Dot(F.Planes[j].xyz, P) + F.Planes[j].w >= 0.f;
+        if (InFace)
+            return -Distances[i] <= Radius;
+    }
+
+    // Otherwise it is on an edge (or a corner, end of an edge)
+    for (int e = 0; e < 12; ++e)
+    {
+        v3 A = F.Corners[FrustumEdges[e][0]];
+        v3 Edge = F.Corners[FrustumEdges[e][1]] - A;
+        float T = Math::Clamp(Vec3::Dot(Center - A, Edge) / Vec3::SquaredLength(Edge), 0.f, 1.f);
+        if (Vec3::SquaredLength(A + Edge * T - Center) <= Radius * Radius)
+            return true;
+    }
+    return false;
+}
+
+bool Frustum::TestSphere(const frustum& F, v3 Center, float Radius, frustum_test_mode Mode)
+{
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        if (Vec3::Dot(F.Planes[i].xyz, Center) + F.Planes[i].w < -Radius)
+            return false;
+    }
+
+    if (Mode == FRUSTUM_TEST_CORNERS)
+        return BoxesOverlap(Center - Radius, Center + Radius, F.CornersMin, F.CornersMax);
+
+    if (Mode == FRUSTUM_TEST_EXACT)
+        return SphereTouchesFrustum(F, Center, Radius);
+
+    return true;
+}
+
+bool Frustum::TestAABB(const frustum& F, v3 Min, v3 Max, frustum_test_mode Mode)
+{
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        // Corner furthest along the plane normal
+        v4 Plane = F.Planes[i];
+        v3 P = { Plane.x > 0.f ? Max.x : Min.x, Plane.y > 0.f ? Max.y : Min.y, Plane.z > 0.f ? Max.z : Min.z };
+        if (Vec3::Dot(Plane.xyz, P) + Plane.w < 0.f)
+            return false;
+    }
+
+    // The box axes are the world axes, separating on them is comparing with the corners bounds
+    if (Mode != FRUSTUM_TEST_CONSERVATIVE && !BoxesOverlap(Min, Max, F.CornersMin, F.CornersMax))
+        return false;
+
+    if (Mode == FRUSTUM_TEST_EXACT)
+    {
+        v3 Extents = (Max - Min) * 0.5f;
+        v3 Axes[3] = { { Extents.x, 0.f, 0.f }, { 0.f, Extents.y, 0.f }, { 0.f, 0.f, Extents.z } };
+        return !SeparatedOnEdgeAxes(F, (Min + Max) * 0.5f, Axes);
+    }
+
+    return true;
+}
+
+bool Frustum::TestOBB(const frustum& F, const mat4& Transform, v3 LocalMin, v3 LocalMax, frustum_test_mode Mode)
+{
+    v3 LocalCenter = (LocalMin + LocalMax) * 0.5f;
+    v3 LocalExtents = (LocalMax - LocalMin) * 0.5f;
+
+    v3 Center = (Transform * Vec4::vec4(LocalCenter, 1.f)).xyz;
+    v3 Axes[3] = {
+        Transform.c[0].xyz * LocalExtents.x,
+        Transform.c[1].xyz * LocalExtents.y,
+        Transform.c[2].xyz * LocalExtents.z,
+    };
+
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        v3 N = F.Planes[i].xyz;
+        float Radius = fabsf(Vec3::Dot(N, Axes[0])) + fabsf(Vec3::Dot(N, Axes[1])) + fabsf(Vec3::Dot(N, Axes[2]));
+        if (Vec3::Dot(N, Center) + F.Planes[i].w < -Radius)
+            return false;
+    }
+
+    if (Mode != FRUSTUM_TEST_CONSERVATIVE)
+    {
+        // Separate on the box axes: frustum corners in box space against the local bounds
+        mat4 InvTransform = Mat4::Inverse(Transform);
+        v3 Min = {  INFINITY,  INFINITY,  INFINITY };
+        v3 Max = { -INFINITY, -INFINITY, -INFINITY };
+        for (int i = 0; i < 8; ++i)
+        {
+            v3 P = (InvTransform * Vec4::vec4(F.Corners[i], 1.f)).xyz;
+            for (int a = 0; a < 3; ++a)
+            {
+                Min.e[a] = Math::Min(Min.e[a], P.e[a]);
+                Max.e[a] = Math::Max(Max.e[a], P.e[a]);
+            }
+        }
+        if (!BoxesOverlap(LocalMin, LocalMax, Min, Max))
+            return false;
+    }
+
+    if (Mode == FRUSTUM_TEST_EXACT)
+        return !SeparatedOnEdgeAxes(F, Center, Axes);
+
+    return true;
+}
+
+void Frustum::TestSpheres(const frustum& F, const sphere_block* Spheres, int BlockCount, uint8_t* VisibleMasks, frustum_test_mode Mode)
+{
+    lane PlaneX[FRUSTUM_PLANE_COUNT], PlaneY[FRUSTUM_PLANE_COUNT], PlaneZ[FRUSTUM_PLANE_COUNT], PlaneW[FRUSTUM_PLANE_COUNT];
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        PlaneX[i] = Set1(F.Planes[i].x);
+        PlaneY[i] = Set1(F.Planes[i].y);
+        PlaneZ[i] = Set1(F.Planes[i].z);
+        PlaneW[i] = Set1(F.Planes[i].w);
+    }
+
+    lane CornersMin[3] = { Set1(F.CornersMin.x), Set1(F.CornersMin.y), Set1(F.CornersMin.z) };
+    lane CornersMax[3] = { Set1(F.CornersMax.x), Set1(F.CornersMax.y), Set1(F.CornersMax.z) };
+    lane Zero = Set1(0.f);
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        int Mask = 0;
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane C[3] = { Load(Spheres[b].X + o), Load(Spheres[b].Y + o), Load(Spheres[b].Z + o) };
+            lane Radius = Load(Spheres[b].Radius + o);
+            lane NegRadius = Sub(Zero, Radius);
+
+            lane_mask Visible = AllTrue();
+            for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+            {
+                lane Distance = Add(Add(Add(Mul(PlaneX[i], C[0]), Mul(PlaneY[i], C[1])), Mul(PlaneZ[i], C[2])), PlaneW[i]);
+                Visible = And(Visible, GreaterEqual(Distance, NegRadius));
+            }
+
+            if (Mode != FRUSTUM_TEST_CONSERVATIVE)
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    Visible = And(Visible, LessEqual(Sub(C[a], Radius), CornersMax[a]));
+                    Visible = And(Visible, GreaterEqual(Add(C[a], Radius), CornersMin[a]));
+                }
+            }
+
+            Mask |= MoveMask(Visible) << o;
+        }
+
+        // Few lanes survive the corners test, refine them one by one
+        if (Mode == FRUSTUM_TEST_EXACT)
+        {
+            for (int l = 0; l < MATHS_BATCH_LANES; ++l)
+            {
+                const sphere_block& Block = Spheres[b];
+                if ((Mask & (1 << l)) && !SphereTouchesFrustum(F, { Block.X[l], Block.Y[l], Block.Z[l] }, Block.Radius[l]))
+                    Mask &= ~(1 << l);
+            }
+        }
+        VisibleMasks[b] = (uint8_t)Mask;
+    }
+}
+
+void Frustum::TestAABBs(const frustum& F, const aabb_block* Boxes, int BlockCount, uint8_t* VisibleMasks, frustum_test_mode Mode)
+{
+    lane PlaneX[FRUSTUM_PLANE_COUNT], PlaneY[FRUSTUM_PLANE_COUNT], PlaneZ[FRUSTUM_PLANE_COUNT], PlaneW[FRUSTUM_PLANE_COUNT];
+    bool PositiveX[FRUSTUM_PLANE_COUNT], PositiveY[FRUSTUM_PLANE_COUNT], PositiveZ[FRUSTUM_PLANE_COUNT];
+    for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+    {
+        PlaneX[i] = Set1(F.Planes[i].x);
+        PlaneY[i] = Set1(F.Planes[i].y);
+        PlaneZ[i] = Set1(F.Planes[i].z);
+        PlaneW[i] = Set1(F.Planes[i].w);
+        PositiveX[i] = F.Planes[i].x > 0.f;
+        PositiveY[i] = F.Planes[i].y > 0.f;
+        PositiveZ[i] = F.Planes[i].z > 0.f;
+    }
+
+    lane CornersMin[3] = { Set1(F.CornersMin.x), Set1(F.CornersMin.y), Set1(F.CornersMin.z) };
+    lane CornersMax[3] = { Set1(F.CornersMax.x), Set1(F.CornersMax.y), Set1(F.CornersMax.z) };
+    lane Zero = Set1(0.f);
+    lane Half = Set1(0.5f);
+
+    aabb_edge_axes EdgeAxes = {};
+    if (Mode == FRUSTUM_TEST_EXACT)
+        EdgeAxes = ComputeAABBEdgeAxes(F);
+
+    for (int b = 0; b < BlockCount; ++b)
+    {
+        int Mask = 0;
+        for (int o = 0; o < MATHS_BATCH_LANES; o += LANE_WIDTH)
+        {
+            lane Min[3] = { Load(Boxes[b].MinX + o), Load(Boxes[b].MinY + o), Load(Boxes[b].MinZ + o) };
+            lane Max[3] = { Load(Boxes[b].MaxX + o), Load(Boxes[b].MaxY + o), Load(Boxes[b].MaxZ + o) };
+
+            lane_mask Visible = AllTrue();
+            for (int i = 0; i < FRUSTUM_PLANE_COUNT; ++i)
+            {
+                // Plane normals are the same for every lane, so the furthest corner is picked once per plane
+                lane PX = PositiveX[i] ? Max[0] : Min[0];
+                lane PY = PositiveY[i] ? Max[1] : Min[1];
+                lane PZ = PositiveZ[i] ? Max[2] : Min[2];
+                lane Distance = Add(Add(Add(Mul(PlaneX[i], PX), Mul(PlaneY[i], PY)), Mul(PlaneZ[i], PZ)), PlaneW[i]);
+                Visible = And(Visible, GreaterEqual(Distance, Zero));
+            }
+
+            if (Mode != FRUSTUM_TEST_CONSERVATIVE)
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    Visible = And(Visible, LessEqual(Min[a], CornersMax[a]));
+                    Visible = And(Visible, GreaterEqual(Max[a], CornersMin[a]));
+                }
+            }
+
+            // Most lanes are already culled, the edge axes only run when some survived
+            if (Mode == FRUSTUM_TEST_EXACT && MoveMask(Visible) != 0)
+            {
+                lane Center[3], Extents[3];
+                for (int a = 0; a < 3; ++a)
+                {
+                    Center[a] = Mul(Add(Min[a], Max[a]), Half);
+                    Extents[a] = Mul(Sub(Max[a], Min[a]), Half);
+                }
+
+                for (int i = 0; i < EdgeAxes.Count; ++i)
+                {
+                    v3 L = EdgeAxes.Axes[i];
+                    lane BoxCenter = Add(Add(Mul(Set1(L.x), Center[0]), Mul(Set1(L.y), Center[1])), Mul(Set1(L.z), Center[2]));
+                    lane BoxRadius = Add(Add(Mul(Set1(fabsf(L.x)), Extents[0]), Mul(Set1(fabsf(L.y)), Extents[1])), Mul(Set1(fabsf(L.z)), Extents[2]));
+                    Visible = And(Visible, GreaterEqual(Add(BoxCenter, BoxRadius), Set1(EdgeAxes.Min[i])));
+                    Visible = And(Visible, LessEqual(Sub(BoxCenter, BoxRadius), Set1(EdgeAxes.Max[i])));
+                }
+            }
+
+            Mask |= MoveMask(Visible) << o;
+        }
+
+        VisibleMasks[b] = (uint8_t)Mask;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "maths_batch.h"
+
+// Conservative: plane tests only, a few volumes near the frustum edges/corners pass while outside.
+// Corners: also separates on the volume own axes using the frustum corners, which removes
+// most of those false positives (large boxes near corners) for a few more instructions.
+// Still conservative: the edge cross-product axes of a full separating axis test are not tried.
+// Exact: boxes are also separated on the cross products of their edges with the frustum edges
+// (full separating axis test), spheres are compared with their distance to the frustum.
+// Batch sphere tests refine the lanes visible after the corners test one by one.
+enum frustum_test_mode
+{
+    FRUSTUM_TEST_CONSERVATIVE,
+    FRUSTUM_TEST_CORNERS,
+    FRUSTUM_TEST_EXACT,
+};
+
+enum frustum_plane
+{
+    FRUSTUM_PLANE_LEFT,
+    FRUSTUM_PLANE_RIGHT,
+    FRUSTUM_PLANE_BOTTOM,
+    FRUSTUM_PLANE_TOP,
+    FRUSTUM_PLANE_NEAR,
+    FRUSTUM_PLANE_FAR,
+    FRUSTUM_PLANE_COUNT,
+};
+
+struct frustum
+{
+    // Normalized planes pointing inward: Dot(Plane.xyz, P) + Plane.w >= 0 inside
+    v4 Planes[FRUSTUM_PLANE_COUNT];
+
+    // World-space corners and their bounding box (used by FRUSTUM_TEST_CORNERS and FRUSTUM_TEST_EXACT),
+    // corner i is the NDC corner (i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1)
+    v3 Corners[8];
+    v3 CornersMin;
+    v3 CornersMax;
+};
+
+namespace Frustum
+{
+    // Works with any GL clip-space matrix: camera or light view-projection, ortho, cube faces...
+    frustum FromMatrix(const mat4& ViewProjection);
+
+    bool TestSphere(const frustum& F, v3 Center, float Radius, frustum_test_mode Mode = FRUSTUM_TEST_CONSERVATIVE);
+    bool TestAABB(const frustum& F, v3 Min, v3 Max, frustum_test_mode Mode = FRUSTUM_TEST_CONSERVATIVE);
+
+    // Local box [LocalMin, LocalMax] placed by an affine Transform (e.g. mesh bounds and model matrix)
+    bool TestOBB(const frustum& F, const mat4& Transform, v3 LocalMin, v3 LocalMax, frustum_test_mode Mode = FRUSTUM_TEST_CONSERVATIVE);
+
+    // Batch tests, one visibility byte per block: bit i set when lane i is visible
+    void TestSpheres(const frustum& F, const sphere_block* Spheres, int BlockCount, uint8_t* VisibleMasks, frustum_test_mode Mode = FRUSTUM_TEST_CONSERVATIVE);
+    void TestAABBs(const frustum& F, const aabb_block* Boxes, int BlockCount, uint8_t* VisibleMasks, frustum_test_mode Mode = FRUSTUM_TEST_CONSERVATIVE);
+}
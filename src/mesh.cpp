@@ -9,10 +9,16 @@
 #include <tiny_obj_loader.h>
 
 #include "maths.h"
+#include "maths_fast.h"
 #include "mesh.h"
 
 #define TANGENTSPACE_COMPUTE_DEBUG
 
+// Defined by the benchmark, which loads the same files thousands of times
+#ifndef MESH_NO_CACHE_LOG
+#define MESH_CACHE_LOG
+#endif
+
 using namespace Mesh;
 
 static void* ConvertVertices(void* VerticesDst, const vertex_descriptor& Descriptor, vertex_full* VerticesSrc, int Count)
@@ -184,28 +190,32 @@ void* Mesh::BuildSphere(void* Vertices, void* End, const vertex_descriptor& Desc
         return Vertices;
     }
 
+    // Sin/cos of every ring and segment angle, computed once instead of per quad
+    // Theta varies from 0 to 180, Phi varies from 0 to 360
+    std::vector<float> Theta(Lat + 1), ThetaSinTable(Lat + 1), ThetaCosTable(Lat + 1);
+    for (int i = 0; i <= Lat; ++i)
+        Theta[i] = Math::Pi() * (float)i / Lat;
+    Math::Fast::SinCos(Theta.data(), ThetaSinTable.data(), ThetaCosTable.data(), Lat + 1);
+
+    std::vector<float> Phi(Lon + 1), PhiSinTable(Lon + 1), PhiCosTable(Lon + 1);
+    for (int j = 0; j <= Lon; ++j)
+        Phi[j] = Math::TwoPi() * (float)j / Lon;
+    Math::Fast::SinCos(Phi.data(), PhiSinTable.data(), PhiCosTable.data(), Lon + 1);
+
     uint8_t* Cur = (uint8_t*)Vertices;
     for (int i = 0; i < Lat; ++i)
     {
-        // Theta varies from 0 to 180
-        float Theta        = Math::Pi() * (float)(i+0) / Lat;
-        float ThetaCos     = Math::Cos(Theta);
-        float ThetaSin     = Math::Sin(Theta);
-        
-        float ThetaNext    = Math::Pi() * (float)(i+1) / Lat;
-        float ThetaNextCos = Math::Cos(ThetaNext);
-        float ThetaNextSin = Math::Sin(ThetaNext);
+        float ThetaCos     = ThetaCosTable[i+0];
+        float ThetaSin     = ThetaSinTable[i+0];
+        float ThetaNextCos = ThetaCosTable[i+1];
+        float ThetaNextSin = ThetaSinTable[i+1];
 
         for (int j = 0; j < Lon; ++j)
         {
-            // Phi varies from 0 to 360
-            float Phi        = Math::TwoPi() * (float)(j+0) / Lon;
-            float PhiCos     = Math::Cos(Phi);
-            float PhiSin     = Math::Sin(Phi);
-            
-            float PhiNext    = Math::TwoPi() * (float)(j+1) / Lon;
-            float PhiNextCos = Math::Cos(PhiNext);
-            float PhiNextSin = Math::Sin(PhiNext);
+            float PhiCos     = PhiCosTable[j+0];
+            float PhiSin     = PhiSinTable[j+0];
+            float PhiNextCos = PhiCosTable[j+1];
+            float PhiNextSin = PhiSinTable[j+1];
 
             // Compute positions
             v3 P0 = {     ThetaSin * PhiCos,         ThetaCos,     ThetaSin * PhiSin     };
@@ -261,7 +271,9 @@ bool LoadObjFromCache(std::vector<vertex_full>& Mesh, const char* Filename)
     fread(&Mesh[0], sizeof(vertex_full), VertexCount, File);
     fclose(File);
 
+#ifdef MESH_CACHE_LOG
     printf("Loaded from cache: %s (%d vertices)\n", Filename, (int)VertexCount);
+#endif
 
     return true;
 }
@@ -279,7 +291,9 @@ void SaveObjToCache(const std::vector<vertex_full>& Mesh, const char* Filename)
     fwrite(&Mesh[0], sizeof(vertex_full), VertexCount, File);
     fclose(File);
 
+#ifdef MESH_CACHE_LOG
     printf("Saved to cache: %s (%d vertices)\n", Filename, (int)VertexCount);
+#endif
 }
 
 
@@ -379,7 +393,7 @@ bool Mesh::LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filen
                 if (Length != 0.f)
                 {
                     v3 Pos = V.Position / Length;
-                    V.UV.x = 0.5f + Math::Atan2(Pos.z, Pos.x);
+                    V.UV.x = 0.5f + Math::Fast::Atan2(Pos.z, Pos.x);
                     V.UV.y = Pos.y;
                 }
             }
@@ -552,4 +566,27 @@ void Mesh::ComputeTangentBasis(std::vector<vertex_full>& mesh)
             current->Bitangents = bitangents[i] ;
         }
     }
-}
\ No newline at end of file
+}
+
+void Mesh::BuildChunks(std::vector<mesh_chunk>& Chunks, const vertex_full* Vertices, int VertexCount, int TrianglesPerChunk)
+{
+    Chunks.clear();
+
+    int VerticesPerChunk = TrianglesPerChunk * 3;
+    for (int First = 0; First < VertexCount; First += VerticesPerChunk)
+    {
+        mesh_chunk Chunk;
+        Chunk.FirstVertex = First;
+        Chunk.VertexCount = Math::Min(VerticesPerChunk, VertexCount - First);
+        Chunk.BoundsMin = Chunk.BoundsMax = Vertices[First].Position;
+        for (int i = First + 1; i < First + Chunk.VertexCount; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                Chunk.BoundsMin.e[j] = Math::Min(Chunk.BoundsMin.e[j], Vertices[i].Position.e[j]);
+                Chunk.BoundsMax.e[j] = Math::Max(Chunk.BoundsMax.e[j], Vertices[i].Position.e[j]);
+            }
+        }
+        Chunks.push_back(Chunk);
+    }
+}
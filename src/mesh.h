@@ -31,6 +31,15 @@ struct vertex_full
 	v3 Bitangents = { 0.f , 0.f , 1.f };
 };
 
+// Range of consecutive vertices of a triangle list and their bounding box (culling of mesh parts)
+struct mesh_chunk
+{
+	int FirstVertex;
+	int VertexCount;
+	v3 BoundsMin;
+	v3 BoundsMax;
+};
+
 namespace Mesh
 {
 	void* Transform(void* Vertices, void* End, const vertex_descriptor& Descriptor, const mat4& Transform);
@@ -48,4 +57,7 @@ namespace Mesh
 	bool LoadObjNoConvertion(std::vector<vertex_full>& Mesh, const char* Filename, float Scale);
 
 	void ComputeTangentBasis(std::vector<vertex_full>& mesh);
+
+	// Split a triangle list in chunks of TrianglesPerChunk consecutive triangles (the last one may be smaller)
+	void BuildChunks(std::vector<mesh_chunk>& Chunks, const vertex_full* Vertices, int VertexCount, int TrianglesPerChunk);
 }
\ No newline at end of file
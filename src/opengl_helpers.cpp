@@ -149,6 +149,32 @@ light_shade_result light_shade(light light, float shininess, vec3 eyePosition, v
 )GLSL";
 #pragma endregion
 
+#pragma region ShaderShadowDisk
+// Shadow filtering disks, shared by the shadow includes
+static const char* ShadowDiskStr = R"GLSL(
+#line 66
+// =================================
+// SHADOW DISK START ===============
+
+// Point i of a Vogel disk of count points (unit radius, even density), rotated by phi
+vec2 shadow_vogel_disk(int i, int count, float phi)
+{
+	float r = sqrt((float(i) + 0.5) / float(count));
+	float theta = float(i) * 2.39996323 + phi;
+	return r * vec2(cos(theta), sin(theta));
+}
+
+// Disk rotation per pixel (interleaved gradient noise), the banding of a few taps becomes noise
+float shadow_disk_rotation()
+{
+	return 6.28318531 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+}
+
+// SHADOW DISK STOP ===============
+// =================================
+)GLSL";
+#pragma endregion
+
 #pragma region ShaderShadows
 // Shadows shader function
 static const char* ShadowStr = R"GLSL(
@@ -156,67 +182,58 @@ static const char* ShadowStr = R"GLSL(
 // =================================
 // SHADOW SHADER START ===============
 
-vec3 gridSamplingDisk[20] = vec3[]
-(
-   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
-   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
-
+// Taps of the rotated disks, each one is a bilinear 2x2 PCF (depth comparison samplers)
+#ifndef SHADOW_TAPS
+#define SHADOW_TAPS 8
+#endif
 
-float shadow_compute_directionnal(sampler2D Text, mat4 MVPDepthMap, vec3 Pos, vec3 Normal, vec3 Direction)
+// Text must use GL_COMPARE_REF_TO_TEXTURE with linear filtering
+float shadow_compute_directionnal(sampler2DShadow Text, mat4 MVPDepthMap, vec3 Pos, vec3 Normal, vec3 Direction)
 {
     vec4 FragPosLightSpace = MVPDepthMap * vec4(Pos.xyz, 1.0);
     vec3 projCoords = FragPosLightSpace.xyz / FragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
 
     //if(projCoords.z > 1.0) return 0.0;
-    
-    float closestDepth = texture(Text, projCoords.xy).r;
-    float currentDepth = projCoords.z;
-    
+
     float bias = max(0.005 * (1.0 - dot(Normal, normalize(-Direction))), 0.005);
-    float shadow = 0.0;
-   
-    //  
+    float currentDepth = projCoords.z - bias;
 
     vec2 texelSize = 1.0 / textureSize(Text, 0);
-   
-    for(int x = -1; x <= 1; ++x)
+    float phi = shadow_disk_rotation();
+
+    float lit = 0.0;
+    for(int i = 0; i < SHADOW_TAPS; ++i)
     {
-        for(int y = -1; y <= 1; ++y)
-        {
-            float pcfDepth = texture(Text, projCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-        }    
-    }    
-    return shadow / 9.0;
+        vec2 offset = shadow_vogel_disk(i, SHADOW_TAPS, phi) * 1.5 * texelSize;
+        lit += texture(Text, vec3(projCoords.xy + offset, currentDepth));
+    }
+    return 1.0 - lit / float(SHADOW_TAPS);
 }
 
-
-float shadow_compute_point(samplerCube Text, vec3 Pos, vec3 ViewPosition, vec3 LightPos, float FarPlane)
+// Text stores the distance to the light divided by FarPlane, with GL_COMPARE_REF_TO_TEXTURE and linear filtering
+float shadow_compute_point(samplerCubeShadow Text, vec3 Pos, vec3 ViewPosition, vec3 LightPos, float FarPlane)
 {
     vec3 lightToFrag = Pos - LightPos;
-    float closestDepth = texture(Text, lightToFrag).r * FarPlane;
     float currentDepth = length(lightToFrag);
 
-    float shadow = 0.0;
     float bias = 0.15;
-    float samples = 20.0;
     float viewDistance = length(ViewPosition - Pos);
     float diskRadius = (1.0 + (viewDistance / FarPlane)) / 25.0;
 
-    for(int i = 0; i < samples; ++i)
+    // Disk facing the light
+    vec3 dir = lightToFrag / currentDepth;
+    vec3 tangent = normalize(cross(dir, abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(dir, tangent);
+    float phi = shadow_disk_rotation();
+
+    float lit = 0.0;
+    for(int i = 0; i < SHADOW_TAPS; ++i)
     {
-        float closestDepth = texture(Text, lightToFrag + gridSamplingDisk[i] * diskRadius).r;
-        closestDepth *= FarPlane;   // undo mapping [0;1]
-        if(currentDepth - bias > closestDepth)
-            shadow += 1.0;
+        vec2 offset = shadow_vogel_disk(i, SHADOW_TAPS, phi) * diskRadius;
+        lit += texture(Text, vec4(lightToFrag + tangent * offset.x + bitangent * offset.y, (currentDepth - bias) / FarPlane));
     }
-
-    return shadow / float(samples);
+    return 1.0 - lit / float(SHADOW_TAPS);
 }
 // SHADOW SHADER STOP ===============
 // =================================
@@ -393,6 +410,367 @@ vec3 compute_PBR_lighting(light currentLight, vec3 worldPos, vec3 normal, vec3 v
 
 #pragma endregion
 
+#pragma region ShaderClusteredLights
+// Clustered lights access functions (data built by light_clusters)
+static const char* ClusteredLightsStr = R"GLSL(
+#line 66
+// =================================
+// CLUSTERED LIGHTS START ===============
+
+uniform samplerBuffer uClusterLights;   // 3 texels per light (see clustered_light)
+uniform usamplerBuffer uClusterGrid;    // First index and count per cluster
+uniform usamplerBuffer uClusterIndices; // Light indices of every cluster
+uniform vec2 uClusterTileScale;         // Tiles per pixel
+uniform vec2 uClusterSliceScaleBias;    // Slice = log(depth) * scale + bias
+uniform ivec3 uClusterDims;
+uniform int uClusterLightCount;
+
+// Range of uClusterIndices affecting a fragment (x: first, y: count)
+uvec2 cluster_get_range(vec2 fragCoord, float viewDepth)
+{
+	ivec2 tile = min(ivec2(fragCoord * uClusterTileScale), uClusterDims.xy - 1);
+	int slice = clamp(int(log(viewDepth) * uClusterSliceScaleBias.x + uClusterSliceScaleBias.y), 0, uClusterDims.z - 1);
+	return texelFetch(uClusterGrid, (slice * uClusterDims.y + tile.y) * uClusterDims.x + tile.x).xy;
+}
+
+// Clustered light as a point 'light' (no ambient), for the light_shade/compute_PBR_lighting functions
+light cluster_fetch_light(int lightIndex, out float radius)
+{
+	vec4 positionRadius = texelFetch(uClusterLights, lightIndex * 3 + 0);
+	vec4 colorSpecular  = texelFetch(uClusterLights, lightIndex * 3 + 1);
+	vec4 attenuation    = texelFetch(uClusterLights, lightIndex * 3 + 2);
+	radius = positionRadius.w;
+	return light(1, true, false, false,
+		positionRadius.xyz, vec3(0.0, -1.0, 0.0),
+		vec3(0.0), colorSpecular.rgb, colorSpecular.rgb * colorSpecular.a, attenuation.xyz,
+		vec2(0.0));
+}
+
+light cluster_get_light(uint listIndex, out float radius)
+{
+	return cluster_fetch_light(int(texelFetch(uClusterIndices, int(listIndex)).r), radius);
+}
+
+// Smooth falloff to zero at the light radius (the light attenuation never reaches zero)
+float cluster_light_fade(vec3 lightPosition, float radius, vec3 position)
+{
+	float d = length(lightPosition - position) / radius;
+	float fade = clamp(1.0 - d * d * d * d, 0.0, 1.0);
+	return fade * fade;
+}
+
+// CLUSTERED LIGHTS STOP ===============
+// =================================
+)GLSL";
+#pragma endregion
+
+#pragma region ShaderGBuffer
+// G-buffer packing functions (targets of deferred_renderer)
+static const char* GBufferStr = R"GLSL(
+#line 66
+// =================================
+// GBUFFER START ===============
+
+// Targets: albedo (sRGB) + roughness, octahedral normal (10:10) + metallic, depth (positions are reconstructed)
+uniform sampler2D uGBufferAlbedoRoughness;
+uniform sampler2D uGBufferNormalMetallic;
+uniform sampler2D uGBufferDepth;
+uniform mat4 uGBufferInverseViewProjection;
+
+vec2 gbuffer_sign_not_zero(vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to [0,1]^2 (octahedron unfolded on a square)
+vec2 gbuffer_encode_normal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * gbuffer_sign_not_zero(n.xy);
+	return e * 0.5 + 0.5;
+}
+
+vec3 gbuffer_decode_normal(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * gbuffer_sign_not_zero(n.xy);
+	return normalize(n);
+}
+
+// Geometry pass outputs (world space normal)
+void gbuffer_pack(vec3 albedo, float roughness, float metallic, vec3 normal, out vec4 albedoRoughness, out vec4 normalMetallic)
+{
+	albedoRoughness = vec4(albedo, roughness);
+	normalMetallic = vec4(gbuffer_encode_normal(normal), metallic, 0.0);
+}
+
+struct gbuffer_sample
+{
+	vec3 albedo;
+	float roughness;
+	vec3 normal;
+	float metallic;
+	vec3 position; // World space
+	float depth;   // 1.0 on background
+};
+
+gbuffer_sample gbuffer_fetch(ivec2 pixel)
+{
+	vec4 albedoRoughness = texelFetch(uGBufferAlbedoRoughness, pixel, 0);
+	vec4 normalMetallic  = texelFetch(uGBufferNormalMetallic, pixel, 0);
+
+	gbuffer_sample s;
+	s.albedo    = albedoRoughness.rgb;
+	s.roughness = albedoRoughness.a;
+	s.normal    = gbuffer_decode_normal(normalMetallic.xy);
+	s.metallic  = normalMetallic.z;
+	s.depth     = texelFetch(uGBufferDepth, pixel, 0).r;
+
+	// Back to world space from the pixel center and its depth
+	vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(uGBufferDepth, 0));
+	vec4 position = uGBufferInverseViewProjection * vec4(vec3(uv, s.depth) * 2.0 - 1.0, 1.0);
+	s.position = position.xyz / position.w;
+	return s;
+}
+
+// GBUFFER STOP ===============
+// =================================
+)GLSL";
+#pragma endregion
+
+#pragma region ShaderShadowAtlas
+// Shadow atlas access functions (tiles allocated by shadow_atlas)
+static const char* ShadowAtlasStr = R"GLSL(
+#line 66
+// =================================
+// SHADOW ATLAS START ===============
+
+// Same values than shadow_atlas::TILES_PER_LIGHT and shadow_atlas::MAX_TILE_COUNT
+#define SHADOW_ATLAS_TILES_PER_LIGHT 6
+#define SHADOW_ATLAS_MAX_TILES 48
+// Same value than shadow_moments::MIP_COUNT
+#define SHADOW_MOMENTS_MIP_COUNT 4
+
+struct shadow_tile
+{
+	mat4 viewProjection; // World to light clip space
+	vec4 rect;           // Atlas uv offset (xy) and size (zw), zero size when not allocated
+	vec4 depthRange;     // Near and far planes (xy) of perspective tiles, zero for orthographic tiles
+};
+
+layout(std140) uniform uShadowAtlasBlock
+{
+	shadow_tile uShadowTiles[SHADOW_ATLAS_MAX_TILES];
+};
+
+uniform sampler2DShadow uShadowAtlas; // Depth comparison with bilinear filtering: each tap is a 2x2 PCF
+uniform sampler2D uShadowAtlasDepth;   // Same texture without comparison (PCSS blocker search)
+
+// Filtering (set by shadow_atlas::SetFilterUniforms)
+uniform int uShadowFilterMode;     // 0: one tap, 1: rotated Vogel disk, 2: PCSS
+uniform int uShadowFilterTaps;
+uniform float uShadowFilterRadius; // Disk radius in texels
+uniform int uShadowBlockerTaps;
+uniform float uShadowLightSize;    // PCSS blocker search radius and penumbra scale, in texels
+
+// Prefiltered moments of the atlas, same uv layout (set by shadow_moments)
+uniform sampler2D uShadowMoments;
+uniform vec2 uShadowExponents;     // Positive and negative warps
+uniform float uShadowBleedReduction;
+
+// Cascades of the directional lights (set by shadow_cascades)
+uniform vec4 uShadowCascadeSplits; // View depth at the far end of each cascade
+uniform int uShadowCascadeCount;
+uniform float uShadowCascadeBlend;  // Part of a cascade blended with the next one
+
+// Cube face looking toward a light-to-position vector (+X, -X, +Y, -Y, +Z, -Z)
+int shadow_atlas_cube_face(vec3 v)
+{
+	vec3 a = abs(v);
+	if (a.x >= a.y && a.x >= a.z)
+		return v.x > 0.0 ? 0 : 1;
+	if (a.y >= a.z)
+		return v.y > 0.0 ? 2 : 3;
+	return v.z > 0.0 ? 4 : 5;
+}
+
+// Upper bound of the lit fraction at depth from the mean and variance of the occluder depths (Chebyshev)
+float shadow_chebyshev(vec2 moments, float depth, float minVariance)
+{
+	if (depth <= moments.x)
+		return 1.0;
+
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float d = depth - moments.x;
+	float pMax = variance / (variance + d * d);
+	return clamp((pMax - uShadowBleedReduction) / (1.0 - uShadowBleedReduction), 0.0, 1.0);
+}
+
+// Exponential variance shadow of a depth (0 to 1) from one filtered fetch of the moments (uv gradients given)
+float shadow_atlas_evsm(vec2 uv, vec2 dx, vec2 dy, float depth)
+{
+	vec4 moments = textureGrad(uShadowMoments, uv, dx, dy);
+
+	float z = depth * 2.0 - 1.0;
+	float pos = exp(uShadowExponents.x * z);
+	float neg = -exp(-uShadowExponents.y * z);
+
+	// Minimum variance scaled by the slope of the warps
+	vec2 depthScale = 0.0001 * uShadowExponents * vec2(pos, -neg);
+	vec2 minVariance = depthScale * depthScale;
+
+	return 1.0 - min(shadow_chebyshev(moments.xy, pos, minVariance.x), shadow_chebyshev(moments.zw, neg, minVariance.y));
+}
+
+// Distance to the light of a stored depth (0 to 1) of a perspective tile, orthographic depths are already linear
+float shadow_atlas_linear_depth(float depth, vec2 planes)
+{
+	if (planes.y <= 0.0)
+		return depth;
+
+	float z = depth * 2.0 - 1.0;
+	return 2.0 * planes.x * planes.y / (planes.y + planes.x - z * (planes.y - planes.x));
+}
+
+// Shadowing of a world position by a tile (0: lit, 1: shadowed), taps clamped inside the tile.
+// positionDx/Dy are the screen derivatives of the position, taken by the caller in uniform control flow
+// (tiles differ between neighbour pixels at cube face seams and cascade splits), used by the EVSM filter
+float shadow_atlas_compute(int tile, vec3 position, vec3 positionDx, vec3 positionDy, float bias)
+{
+	vec4 rect = uShadowTiles[tile].rect;
+	if (rect.z <= 0.0)
+		return 0.0;
+
+	vec4 lightClip = uShadowTiles[tile].viewProjection * vec4(position, 1.0);
+	if (lightClip.w <= 0.0)
+		return 0.0;
+
+	vec3 projCoords = lightClip.xyz / lightClip.w * 0.5 + 0.5;
+	if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0))))
+		return 0.0;
+
+	vec2 texelSize = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+	vec2 uvMin = rect.xy + texelSize * 0.5;
+	vec2 uvMax = rect.xy + rect.zw - texelSize * 0.5;
+	vec2 uv = rect.xy + projCoords.xy * rect.zw;
+	float depth = projCoords.z - bias;
+
+	if (uShadowFilterMode == 3)
+	{
+		// Mip level of the fetch kept where the tile still has 8 texels, and the filter footprint (half a texel
+		// of the coarsest level blended) kept inside the tile: the mips of a tile never read its neighbours
+		// uv derivatives from the position ones through the tile projection (quotient rule on the divide by w)
+		vec2 momentsSize = vec2(textureSize(uShadowMoments, 0));
+		vec4 clipDx = uShadowTiles[tile].viewProjection * vec4(positionDx, 0.0);
+		vec4 clipDy = uShadowTiles[tile].viewProjection * vec4(positionDy, 0.0);
+		vec2 dx = (clipDx.xy * lightClip.w - lightClip.xy * clipDx.w) / (lightClip.w * lightClip.w) * 0.5 * rect.zw;
+		vec2 dy = (clipDy.xy * lightClip.w - lightClip.xy * clipDy.w) / (lightClip.w * lightClip.w) * 0.5 * rect.zw;
+		float lod = log2(max(length(dx * momentsSize), length(dy * momentsSize)));
+		float maxLod = clamp(log2(rect.z * momentsSize.x) - 3.0, 0.0, float(SHADOW_MOMENTS_MIP_COUNT - 1));
+		if (lod > maxLod)
+		{
+			float scale = exp2(maxLod - lod);
+			dx *= scale;
+			dy *= scale;
+		}
+		vec2 inset = exp2(ceil(clamp(lod, 0.0, maxLod))) * 0.5 / momentsSize;
+		return shadow_atlas_evsm(clamp(uv, rect.xy + inset, rect.xy + rect.zw - inset), dx, dy, depth);
+	}
+
+	if (uShadowFilterMode == 0)
+		return 1.0 - texture(uShadowAtlas, vec3(clamp(uv, uvMin, uvMax), depth));
+
+	float phi = shadow_disk_rotation();
+	float radius = uShadowFilterRadius;
+	if (uShadowFilterMode == 2)
+	{
+		// Average distance of the occluders seen from the light area
+		vec2 planes = uShadowTiles[tile].depthRange.xy;
+		float blockerSum = 0.0;
+		int blockerCount = 0;
+		for (int i = 0; i < uShadowBlockerTaps; ++i)
+		{
+			vec2 offset = shadow_vogel_disk(i, uShadowBlockerTaps, phi) * uShadowLightSize * texelSize;
+			float blocker = texture(uShadowAtlasDepth, clamp(uv + offset, uvMin, uvMax)).r;
+			if (blocker < depth)
+			{
+				blockerSum += shadow_atlas_linear_depth(blocker, planes);
+				++blockerCount;
+			}
+		}
+		if (blockerCount == 0)
+			return 0.0;
+
+		// Penumbra from the receiver to occluder distance (similar triangles, linear distances)
+		float blockerDepth = blockerSum / float(blockerCount);
+		float receiverDepth = shadow_atlas_linear_depth(depth, planes);
+		radius = clamp((receiverDepth - blockerDepth) / max(blockerDepth, 0.0001) * uShadowLightSize, 1.0, uShadowLightSize);
+	}
+
+	float lit = 0.0;
+	for (int i = 0; i < uShadowFilterTaps; ++i)
+	{
+		vec2 offset = shadow_vogel_disk(i, uShadowFilterTaps, phi) * radius * texelSize;
+		lit += texture(uShadowAtlas, vec3(clamp(uv + offset, uvMin, uvMax), depth));
+	}
+	return 1.0 - lit / float(uShadowFilterTaps);
+}
+
+// Point lights use six tiles from firstTile, one per cube face
+float shadow_atlas_compute_point(int firstTile, vec3 position, vec3 positionDx, vec3 positionDy, vec3 lightPosition, float bias)
+{
+	return shadow_atlas_compute(firstTile + shadow_atlas_cube_face(position - lightPosition), position, positionDx, positionDy, bias);
+}
+
+// Directional lights use one tile per cascade from firstTile, selected by the view depth
+float shadow_atlas_compute_cascaded(int firstTile, vec3 position, vec3 positionDx, vec3 positionDy, float viewDepth, float bias)
+{
+	int last = uShadowCascadeCount - 1;
+	if (viewDepth > uShadowCascadeSplits[last])
+		return 0.0;
+
+	int cascade = 0;
+	while (cascade < last && viewDepth > uShadowCascadeSplits[cascade])
+		++cascade;
+
+	float shadow = shadow_atlas_compute(firstTile + cascade, position, positionDx, positionDy, bias);
+	if (uShadowCascadeBlend > 0.0 && cascade < last)
+	{
+		float start = cascade == 0 ? 0.0 : uShadowCascadeSplits[cascade - 1];
+		float end = uShadowCascadeSplits[cascade];
+		float blendStart = end - (end - start) * uShadowCascadeBlend;
+		if (viewDepth > blendStart)
+			shadow = mix(shadow, shadow_atlas_compute(firstTile + cascade + 1, position, positionDx, positionDy, bias), (viewDepth - blendStart) / (end - blendStart));
+	}
+	return shadow;
+}
+
+// SHADOW ATLAS STOP ===============
+// =================================
+)GLSL";
+#pragma endregion
+
+float GL::GetLightRange(const light& Light, float Cutoff)
+{
+	float Intensity = 0.f;
+	for (int i = 0; i < 3; ++i)
+	{
+		Intensity = Math::Max(Intensity, Light.Ambient.e[i]);
+		Intensity = Math::Max(Intensity, Light.Diffuse.e[i]);
+		Intensity = Math::Max(Intensity, Light.Specular.e[i]);
+	}
+
+	// Same attenuation than light_shade/compute_PBR_lighting: 1 / (a0 + (a1 + a2 * a2) * dist)
+	float Constant = Light.Attenuation.e[0];
+	float Slope = Light.Attenuation.e[1] + Light.Attenuation.e[2] * Light.Attenuation.e[2];
+	if (Slope <= 0.f)
+		return -1.f;
+
+	return Math::Max((Intensity / Cutoff - Constant) / Slope, 0.f);
+}
+
 void GL::UniformLight(GLuint Program, const char* LightUniformName, const light& Light)
 {
 	glUseProgram(Program);
@@ -456,10 +834,14 @@ void GL::UniformMaterial(GLuint Program, const char* MaterialUniformName, const
 
 void GL::InjectIncludes(std::vector<const char*>& Sources, const int Includes)
 {
-	if (Includes)
+	if (Includes & ~GLINCLUDE_FRAMECONSTANTS)
 	{
 		Sources.push_back(ShaderStructsDefinitionsStr);
 	}
+	if (Includes & GLINCLUDE_FRAMECONSTANTS)
+	{
+		Sources.push_back(GetFrameBlocksDefinitions());
+	}
 	if (Includes & GLINCLUDE_KERNELS)
 	{
 		Sources.push_back(KernelStr);
@@ -470,6 +852,11 @@ void GL::InjectIncludes(std::vector<const char*>& Sources, const int Includes)
 		Sources.push_back(PhongLightingStr);
 	}
 
+	if (Includes & (GLINCLUDE_SHADOW | GLINCLUDE_SHADOW_ATLAS))
+	{
+		Sources.push_back(ShadowDiskStr);
+	}
+
 	if (Includes & GLINCLUDE_SHADOW)
 	{
 		Sources.push_back(ShadowStr);
@@ -479,6 +866,21 @@ void GL::InjectIncludes(std::vector<const char*>& Sources, const int Includes)
 	{
 		Sources.push_back(PBRStr);
 	}
+
+	if (Includes & GLINCLUDE_CLUSTERED_LIGHTS)
+	{
+		Sources.push_back(ClusteredLightsStr);
+	}
+
+	if (Includes & GLINCLUDE_GBUFFER)
+	{
+		Sources.push_back(GBufferStr);
+	}
+
+	if (Includes & GLINCLUDE_SHADOW_ATLAS)
+	{
+		Sources.push_back(ShadowAtlasStr);
+	}
 	
 }
 
@@ -519,7 +921,7 @@ GLuint GL::CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStr
 {
 	GLuint Program = glCreateProgram();
 
-	GLuint VertexShader = GL::CompileShaderEx(GL_VERTEX_SHADER, VSStringsCount, VSStrings);
+	GLuint VertexShader = GL::CompileShaderEx(GL_VERTEX_SHADER, VSStringsCount, VSStrings, Includes & GLINCLUDE_FRAMECONSTANTS);
 	GLuint FragmentShader = GL::CompileShaderEx(GL_FRAGMENT_SHADER, FSStringsCount, FSStrings,  Includes );
 
 	glAttachShader(Program, VertexShader);
@@ -534,6 +936,10 @@ GLuint GL::CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStr
 		glGetProgramInfoLog(Program, ARRAY_SIZE(Infolog), nullptr, Infolog);
 		fprintf(stderr, "Program link error: %s\n", Infolog);
 	}
+
+	if (Includes & GLINCLUDE_FRAMECONSTANTS)
+		GL::SetupFrameBlocks(Program);
+
 	glDeleteShader(VertexShader);
 	glDeleteShader(FragmentShader);
 
@@ -544,9 +950,9 @@ GLuint GL::CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStr
 {
 	GLuint Program = glCreateProgram();
 
-	GLuint VertexShader = GL::CompileShaderEx(GL_VERTEX_SHADER, VSStringsCount, VSStrings);
+	GLuint VertexShader = GL::CompileShaderEx(GL_VERTEX_SHADER, VSStringsCount, VSStrings, Includes & GLINCLUDE_FRAMECONSTANTS);
 	GLuint FragmentShader = GL::CompileShaderEx(GL_FRAGMENT_SHADER, FSStringsCount, FSStrings,  Includes );
-	GLuint GeometryShader = GL::CompileShaderEx(GL_GEOMETRY_SHADER, GSStringsCount, GSStrings);
+	GLuint GeometryShader = GL::CompileShaderEx(GL_GEOMETRY_SHADER, GSStringsCount, GSStrings, Includes & GLINCLUDE_FRAMECONSTANTS);
 
 	glAttachShader(Program, VertexShader);
 	glAttachShader(Program, FragmentShader);
@@ -562,6 +968,9 @@ GLuint GL::CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStr
 		fprintf(stderr, "Program link error: %s\n", Infolog);
 	}
 
+	if (Includes & GLINCLUDE_FRAMECONSTANTS)
+		GL::SetupFrameBlocks(Program);
+
 
 	glDeleteShader(VertexShader);
 	glDeleteShader(FragmentShader);
@@ -576,6 +985,40 @@ GLuint GL::CreateProgramEx(const char* VSStrings, const char* FSStrings, const c
 	return CreateProgramEx(1, &VSStrings, 1, &FSStrings, 1, &GSStrings,  Includes );
 }
 
+GLuint GL::CreateTransformFeedbackProgram(int VSStringsCount, const char** VSStrings, int GSStringsCount, const char** GSStrings, int VaryingCount, const char** Varyings, const int Includes)
+{
+	GLuint Program = glCreateProgram();
+
+	GLuint VertexShader = GL::CompileShaderEx(GL_VERTEX_SHADER, VSStringsCount, VSStrings, Includes & GLINCLUDE_FRAMECONSTANTS);
+	GLuint GeometryShader = (GSStringsCount > 0) ? GL::CompileShaderEx(GL_GEOMETRY_SHADER, GSStringsCount, GSStrings, Includes & GLINCLUDE_FRAMECONSTANTS) : 0;
+
+	glAttachShader(Program, VertexShader);
+	if (GeometryShader)
+		glAttachShader(Program, GeometryShader);
+
+	// Captured outputs are part of the link
+	glTransformFeedbackVaryings(Program, VaryingCount, Varyings, GL_INTERLEAVED_ATTRIBS);
+
+	glLinkProgram(Program);
+	GLint LinkStatus;
+	glGetProgramiv(Program, GL_LINK_STATUS, &LinkStatus);
+	if (LinkStatus == GL_FALSE)
+	{
+		char Infolog[1024];
+		glGetProgramInfoLog(Program, ARRAY_SIZE(Infolog), nullptr, Infolog);
+		fprintf(stderr, "Program link error: %s\n", Infolog);
+	}
+
+	if (Includes & GLINCLUDE_FRAMECONSTANTS)
+		GL::SetupFrameBlocks(Program);
+
+	glDeleteShader(VertexShader);
+	if (GeometryShader)
+		glDeleteShader(GeometryShader);
+
+	return Program;
+}
+
 GLuint GL::CreateProgram(const char* VSString, const char* FSString, const int Includes)
 {
 	return GL::CreateProgramEx(1, &VSString, 1, &FSString,  Includes );
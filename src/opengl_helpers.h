@@ -4,6 +4,9 @@
 #include "types.h"
 #include "opengl_helpers_cache.h"
 #include "opengl_helpers_wireframe.h"
+#include "opengl_helpers_permutation.h"
+#include "opengl_helpers_frame.h"
+#include "opengl_helpers_prepass.h"
 
 enum image_flags
 {
@@ -23,6 +26,10 @@ enum GLSL_Include
     GLINCLUDE_SHADOW = 2 << 0,
     GLINCLUDE_KERNELS = 3 << 0,
     GLINCLUDE_PBR = 4 << 0,
+    GLINCLUDE_FRAMECONSTANTS = 1 << 3, // uFrameBlock/uDrawBlock, also injected in the vertex and geometry stages
+    GLINCLUDE_CLUSTERED_LIGHTS = 1 << 4, // Texture buffers built by light_clusters
+    GLINCLUDE_GBUFFER = 1 << 5, // Packing/unpacking of the deferred_renderer G-buffer
+    GLINCLUDE_SHADOW_ATLAS = 1 << 6, // Tiles of the shadow_atlas texture
 };
 
 enum lightType
@@ -89,6 +96,8 @@ namespace GL
     };
 
     void UniformLight(GLuint Program, const char* LightUniformName, const light& Light);
+    // Distance at which a point/spot light intensity falls under Cutoff (negative when unbounded)
+    float GetLightRange(const light& Light, float Cutoff);
     void UniformMaterial(GLuint Program, const char* MaterialUniformName, const material& Material);
     void InjectIncludes(std::vector<const char*>& Sources, const int Includes);
     GLuint CompileShader(GLenum ShaderType, const char* ShaderStr, const int Includes = 0);
@@ -97,6 +106,8 @@ namespace GL
     GLuint CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStringCount, const char** FSString, const int Includes = 0);
     GLuint CreateProgramEx(int VSStringsCount, const char** VSStrings, int FSStringsCount, const char** FSStrings, int GSStringsCount, const char** GSStrings, const int Includes = 0);
     GLuint CreateProgramEx(const char* VSStrings, const char* FSStrings, const char* GSStrings, const int Includes = 0);
+    // Program without fragment stage (GL_RASTERIZER_DISCARD), its Varyings are captured interleaved by transform feedback (GSStringsCount 0: no geometry stage)
+    GLuint CreateTransformFeedbackProgram(int VSStringsCount, const char** VSStrings, int GSStringsCount, const char** GSStrings, int VaryingCount, const char** Varyings, const int Includes = 0);
     const char* GetShaderStructsDefinitions();
     void UploadTexture(const char* Filename, int ImageFlags = 0, int* WidthOut = nullptr, int* HeightOut = nullptr);
     void UploadCheckerboardTexture(int Width, int Height, int SquareSize);
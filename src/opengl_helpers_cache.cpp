@@ -3,6 +3,9 @@
 
 #include "opengl_helpers_cache.h"
 
+// Triangles per mesh chunk (culling granularity)
+static const int MESH_CHUNK_TRIANGLES = 256;
+
 GL::cache::cache()
 {
 }
@@ -13,17 +16,46 @@ GL::cache::~cache()
 		glDeleteTextures(1, &KeyValue.second.TextureID);
 
 	for (const auto& KeyValue : this->VertexBufferMap)
+	{
 		glDeleteBuffers(1, &KeyValue.second.VertexBuffer);
+		glDeleteBuffers(1, &KeyValue.second.PositionBuffer);
+	}
+}
+
+GLuint GL::cache::UploadPositions(const vertex_full* Vertices, int Count)
+{
+	this->TmpPositions.resize(Count);
+	for (int i = 0; i < Count; ++i)
+		this->TmpPositions[i] = Vertices[i].Position;
+
+	GLuint PositionBuffer = 0;
+	glGenBuffers(1, &PositionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, PositionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, Count * sizeof(v3), this->TmpPositions.data(), GL_STATIC_DRAW);
+
+	return PositionBuffer;
 }
 
-GLuint GL::cache::LoadObj(const char* Filename, float Scale, int* VertexCountOut)
+GLuint GL::cache::LoadObj(const char* Filename, float Scale, int* VertexCountOut, GLuint* PositionBufferOut)
 {
 	auto Found = this->VertexBufferMap.find(Filename);
 	if (Found != this->VertexBufferMap.end())
 	{
+		mesh& Mesh = Found->second;
+		if (PositionBufferOut && Mesh.PositionBuffer == 0)
+		{
+			// First request of the position stream for this mesh, read the positions back from the interleaved buffer
+			this->TmpBuffer.resize(Mesh.Size);
+			glBindBuffer(GL_ARRAY_BUFFER, Mesh.VertexBuffer);
+			glGetBufferSubData(GL_ARRAY_BUFFER, 0, Mesh.Size * sizeof(vertex_full), this->TmpBuffer.data());
+			Mesh.PositionBuffer = this->UploadPositions(this->TmpBuffer.data(), Mesh.Size);
+		}
+
 		if (VertexCountOut)
-			*VertexCountOut = Found->second.Size;
-		return Found->second.VertexBuffer;
+			*VertexCountOut = Mesh.Size;
+		if (PositionBufferOut)
+			*PositionBufferOut = Mesh.PositionBuffer;
+		return Mesh.VertexBuffer;
 	}
 
 	this->TmpBuffer.clear();
@@ -35,14 +67,54 @@ GLuint GL::cache::LoadObj(const char* Filename, float Scale, int* VertexCountOut
 	glBindBuffer(GL_ARRAY_BUFFER, MeshBuffer);
 	glBufferData(GL_ARRAY_BUFFER, this->TmpBuffer.size() * sizeof(vertex_full), &this->TmpBuffer[0], GL_STATIC_DRAW);
 
+	// Position only stream for depth, shadow and wireframe passes (12 bytes per vertex instead of 56)
+	GLuint PositionBuffer = 0;
+	if (PositionBufferOut)
+		PositionBuffer = this->UploadPositions(this->TmpBuffer.data(), (int)this->TmpBuffer.size());
+
 	if (VertexCountOut)
 		*VertexCountOut = (int)this->TmpBuffer.size();
+	if (PositionBufferOut)
+		*PositionBufferOut = PositionBuffer;
 	
-	this->VertexBufferMap[Filename] = { MeshBuffer, (int)this->TmpBuffer.size() };
+	// Bounds of the whole mesh and of its parts
+	mesh NewMesh = { MeshBuffer, PositionBuffer, (int)this->TmpBuffer.size(), {}, {}, {} };
+	Mesh::BuildChunks(NewMesh.Chunks, this->TmpBuffer.data(), NewMesh.Size, MESH_CHUNK_TRIANGLES);
+	for (size_t i = 0; i < NewMesh.Chunks.size(); ++i)
+	{
+		const mesh_chunk& Chunk = NewMesh.Chunks[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			NewMesh.BoundsMin.e[j] = i == 0 ? Chunk.BoundsMin.e[j] : Math::Min(NewMesh.BoundsMin.e[j], Chunk.BoundsMin.e[j]);
+			NewMesh.BoundsMax.e[j] = i == 0 ? Chunk.BoundsMax.e[j] : Math::Max(NewMesh.BoundsMax.e[j], Chunk.BoundsMax.e[j]);
+		}
+	}
+
+	this->VertexBufferMap[Filename] = std::move(NewMesh);
 
 	return MeshBuffer;
 }
 
+const std::vector<mesh_chunk>* GL::cache::GetObjChunks(const char* Filename) const
+{
+	auto Found = this->VertexBufferMap.find(Filename);
+	if (Found == this->VertexBufferMap.end())
+		return nullptr;
+
+	return &Found->second.Chunks;
+}
+
+bool GL::cache::GetObjBounds(const char* Filename, v3* MinOut, v3* MaxOut) const
+{
+	auto Found = this->VertexBufferMap.find(Filename);
+	if (Found == this->VertexBufferMap.end())
+		return false;
+
+	*MinOut = Found->second.BoundsMin;
+	*MaxOut = Found->second.BoundsMax;
+	return true;
+}
+
 GLuint GL::cache::LoadTexture(const char* Filename, int ImageFlags, int* WidthOut, int* HeightOut)
 {
 	texture_identifier TextureIdentifier = { Filename, ImageFlags };
@@ -14,15 +14,26 @@ namespace GL
 	public:
         cache();
         ~cache();
-        GLuint LoadObj(const char* Filename, float Scale, int* VertexCountOut);
+        // Interleaved vertex_full buffer, PositionBufferOut optionally receives a tightly packed v3 position stream
+        GLuint LoadObj(const char* Filename, float Scale, int* VertexCountOut, GLuint* PositionBufferOut = nullptr);
+        // Bounding box of the positions of a mesh loaded by LoadObj, false when not loaded
+        bool GetObjBounds(const char* Filename, v3* MinOut, v3* MaxOut) const;
+        // Chunks of a mesh loaded by LoadObj (MESH_CHUNK_TRIANGLES triangles each), nullptr when not loaded
+        const std::vector<mesh_chunk>* GetObjChunks(const char* Filename) const;
         GLuint LoadTexture(const char* Filename, int ImageFlags = 0, int* WidthOut = nullptr, int* HeightOut = nullptr);
 		GLuint LoadCubemapTexture(std::vector<const char*> Filenames, int ImageFlags = 1 << 7, std::vector<int>* WidthOut = nullptr, std::vector<int>* HeightOut = nullptr);
 
 	private:
+		GLuint UploadPositions(const vertex_full* Vertices, int Count);
+
 		struct mesh
 		{
 			GLuint VertexBuffer;
+			GLuint PositionBuffer; // 0 until requested
 			int Size;
+			v3 BoundsMin;
+			v3 BoundsMax;
+			std::vector<mesh_chunk> Chunks;
 		};
 
 		struct texture_identifier
@@ -52,6 +63,7 @@ namespace GL
 		};
 
 		std::vector<vertex_full> TmpBuffer;
+		std::vector<v3> TmpPositions;
 		std::map<std::string, mesh> VertexBufferMap;
 		std::map<texture_identifier, texture> TextureMap;
 		std::map<texture_identifier, textureCubemap> TextureCubeMap;
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <cstring>
+
+#include "opengl_helpers_extensions.h"
+
+static GL::extensions gExtensions;
+
+bool GL::HasExtension(const char* Name)
+{
+	GLint ExtensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+	for (int i = 0; i < ExtensionCount; ++i)
+	{
+		const char* Extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (Extension && strcmp(Extension, Name) == 0)
+			return true;
+	}
+	return false;
+}
+
+void GL::LoadExtensions(GLADloadproc Load)
+{
+	gExtensions = {};
+
+	// Core since 4.4, the glad loader stops at 3.3
+	if (HasExtension("GL_ARB_buffer_storage"))
+	{
+		gExtensions.BufferStorageProc = (PFNGLBUFFERSTORAGEPROC)Load("glBufferStorage");
+		gExtensions.BufferStorage = gExtensions.BufferStorageProc != nullptr;
+	}
+
+	// Core since 4.6, only new query targets
+	gExtensions.PipelineStatisticsQuery = HasExtension("GL_ARB_pipeline_statistics_query");
+
+	// Core since 4.1 and 4.6 (gl_ViewportIndex in the vertex shader)
+	if (HasExtension("GL_ARB_viewport_array"))
+		gExtensions.ViewportIndexedfProc = (PFNGLVIEWPORTINDEXEDFPROC)Load("glViewportIndexedf");
+	gExtensions.ShaderViewportLayerArray = gExtensions.ViewportIndexedfProc != nullptr && HasExtension("GL_ARB_shader_viewport_layer_array");
+
+	// Core since 4.6, only new texture parameters
+	if (HasExtension("GL_EXT_texture_filter_anisotropic") || HasExtension("GL_ARB_texture_filter_anisotropic"))
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &gExtensions.MaxAnisotropy);
+
+	// Core since 4.0 (transform feedback objects) and 4.2 (instanced draws of their content)
+	if (HasExtension("GL_ARB_transform_feedback2") && HasExtension("GL_ARB_transform_feedback_instanced"))
+	{
+		gExtensions.GenTransformFeedbacksProc = (PFNGLGENTRANSFORMFEEDBACKSPROC)Load("glGenTransformFeedbacks");
+		gExtensions.DeleteTransformFeedbacksProc = (PFNGLDELETETRANSFORMFEEDBACKSPROC)Load("glDeleteTransformFeedbacks");
+		gExtensions.BindTransformFeedbackProc = (PFNGLBINDTRANSFORMFEEDBACKPROC)Load("glBindTransformFeedback");
+		gExtensions.DrawTransformFeedbackProc = (PFNGLDRAWTRANSFORMFEEDBACKPROC)Load("glDrawTransformFeedback");
+		gExtensions.DrawTransformFeedbackInstancedProc = (PFNGLDRAWTRANSFORMFEEDBACKINSTANCEDPROC)Load("glDrawTransformFeedbackInstanced");
+		gExtensions.TransformFeedbackInstanced = gExtensions.GenTransformFeedbacksProc && gExtensions.DeleteTransformFeedbacksProc
+			&& gExtensions.BindTransformFeedbackProc && gExtensions.DrawTransformFeedbackProc && gExtensions.DrawTransformFeedbackInstancedProc;
+	}
+
+	printf("GL_ARB_buffer_storage: %s\n", gExtensions.BufferStorage ? "yes" : "no");
+	printf("GL_ARB_pipeline_statistics_query: %s\n", gExtensions.PipelineStatisticsQuery ? "yes" : "no");
+	printf("GL_ARB_shader_viewport_layer_array: %s\n", gExtensions.ShaderViewportLayerArray ? "yes" : "no");
+	printf("Max anisotropy: %.0f\n", gExtensions.MaxAnisotropy);
+	printf("GL_ARB_transform_feedback_instanced: %s\n", gExtensions.TransformFeedbackInstanced ? "yes" : "no");
+}
+
+const GL::extensions& GL::GetExtensions()
+{
+	return gExtensions;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "opengl_headers.h"
+
+// Enums and entry points missing from the glad loader (generated for core 3.3 only)
+
+// ARB_buffer_storage
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// ARB_pipeline_statistics_query (query target of glBeginQuery)
+#ifndef GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
+
+// EXT/ARB_texture_filter_anisotropic
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+// ARB_viewport_array
+typedef void (APIENTRYP PFNGLVIEWPORTINDEXEDFPROC)(GLuint index, GLfloat x, GLfloat y, GLfloat w, GLfloat h);
+
+// ARB_transform_feedback2 and ARB_transform_feedback_instanced
+#ifndef GL_TRANSFORM_FEEDBACK
+#define GL_TRANSFORM_FEEDBACK 0x8E22
+#endif
+typedef void (APIENTRYP PFNGLGENTRANSFORMFEEDBACKSPROC)(GLsizei n, GLuint* ids);
+typedef void (APIENTRYP PFNGLDELETETRANSFORMFEEDBACKSPROC)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRYP PFNGLBINDTRANSFORMFEEDBACKPROC)(GLenum target, GLuint id);
+typedef void (APIENTRYP PFNGLDRAWTRANSFORMFEEDBACKPROC)(GLenum mode, GLuint id);
+typedef void (APIENTRYP PFNGLDRAWTRANSFORMFEEDBACKINSTANCEDPROC)(GLenum mode, GLuint id, GLsizei instancecount);
+
+namespace GL
+{
+	// Optional features of the current context, filled by LoadExtensions()
+	struct extensions
+	{
+		bool BufferStorage = false;
+		PFNGLBUFFERSTORAGEPROC BufferStorageProc = nullptr;
+		bool PipelineStatisticsQuery = false;
+		// gl_ViewportIndex written from the vertex shader (ARB_shader_viewport_layer_array over ARB_viewport_array)
+		bool ShaderViewportLayerArray = false;
+		PFNGLVIEWPORTINDEXEDFPROC ViewportIndexedfProc = nullptr;
+		// Highest GL_TEXTURE_MAX_ANISOTROPY_EXT, 1 when anisotropic filtering is not supported
+		float MaxAnisotropy = 1.f;
+		// Draws sized by the vertex count captured in a transform feedback object, without reading it back
+		bool TransformFeedbackInstanced = false;
+		PFNGLGENTRANSFORMFEEDBACKSPROC GenTransformFeedbacksProc = nullptr;
+		PFNGLDELETETRANSFORMFEEDBACKSPROC DeleteTransformFeedbacksProc = nullptr;
+		PFNGLBINDTRANSFORMFEEDBACKPROC BindTransformFeedbackProc = nullptr;
+		PFNGLDRAWTRANSFORMFEEDBACKPROC DrawTransformFeedbackProc = nullptr;
+		PFNGLDRAWTRANSFORMFEEDBACKINSTANCEDPROC DrawTransformFeedbackInstancedProc = nullptr;
+	};
+
+	// Call once after gladLoadGL() with the same loader (e.g. glfwGetProcAddress)
+	void LoadExtensions(GLADloadproc Load);
+	const extensions& GetExtensions();
+	bool HasExtension(const char* Name);
+}
@@ -0,0 +1,135 @@
+#include <cstring>
+
+#include "opengl_helpers_frame.h"
+
+static const char* FrameBlocksDefinitionsStr = R"GLSL(
+// Frame constants (see GL::frame_constants)
+layout(std140) uniform uFrameBlock
+{
+	mat4 uProjection;
+	mat4 uView;
+	mat4 uViewProjection;
+	vec3 uViewPosition;
+	float uTime;
+};
+
+// Draw constants (see GL::draw_constants)
+layout(std140) uniform uDrawBlock
+{
+	mat4 uModel;
+	mat4 uModelNormalMatrix;
+};
+)GLSL";
+
+// Room for a few hundred draws per frame
+static const GLsizeiptr FRAME_RING_CAPACITY = 256 * 1024;
+
+namespace
+{
+	struct frame_state
+	{
+		GL::stream_ring Ring;
+		double Time = 0.0;
+
+		// Last pushed blocks of the frame, to skip redundant pushes
+		GL::frame_constants Frame;
+		GL::draw_constants Draw;
+		GLintptr FrameOffset = -1;
+		GLintptr DrawOffset = -1;
+	};
+}
+
+static frame_state* gFrameState = nullptr;
+
+void GL::InitFrameConstants()
+{
+	DestroyFrameConstants();
+
+	GLint Alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+
+	gFrameState = new frame_state();
+	gFrameState->Ring.Init(GL_UNIFORM_BUFFER, FRAME_RING_CAPACITY, Alignment);
+}
+
+void GL::DestroyFrameConstants()
+{
+	delete gFrameState;
+	gFrameState = nullptr;
+}
+
+void GL::BeginFrameConstants(double Time)
+{
+	gFrameState->Ring.BeginFrame();
+	gFrameState->Time = Time;
+	gFrameState->FrameOffset = -1;
+	gFrameState->DrawOffset = -1;
+}
+
+void GL::EndFrameConstants()
+{
+	gFrameState->Ring.EndFrame();
+}
+
+void GL::SetFrameConstants(const mat4& Projection, const mat4& View, const v3& ViewPosition)
+{
+	frame_constants Frame = {};
+	Frame.Projection = Projection;
+	Frame.View = View;
+	Frame.ViewProjection = Projection * View;
+	Frame.ViewPosition = ViewPosition;
+	Frame.Time = (float)gFrameState->Time;
+
+	if (gFrameState->FrameOffset < 0 || memcmp(&Frame, &gFrameState->Frame, sizeof(Frame)) != 0)
+	{
+		GLintptr Offset = gFrameState->Ring.Push(&Frame, sizeof(Frame));
+		if (Offset < 0)
+			return;
+
+		gFrameState->Frame = Frame;
+		gFrameState->FrameOffset = Offset;
+	}
+
+	// Rebind anyway, the binding point may have been changed by a non-ring buffer
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING_POINT, gFrameState->Ring.GetBuffer(), gFrameState->FrameOffset, sizeof(frame_constants));
+}
+
+void GL::SetDrawConstants(const mat4& Model)
+{
+	if (gFrameState->DrawOffset < 0 || memcmp(&Model, &gFrameState->Draw.Model, sizeof(Model)) != 0)
+	{
+		draw_constants Draw = {};
+		Draw.Model = Model;
+		Draw.ModelNormalMatrix = Mat4::Transpose(Mat4::Inverse(Model));
+
+		GLintptr Offset = gFrameState->Ring.Push(&Draw, sizeof(Draw));
+		if (Offset < 0)
+			return;
+
+		gFrameState->Draw = Draw;
+		gFrameState->DrawOffset = Offset;
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_BLOCK_BINDING_POINT, gFrameState->Ring.GetBuffer(), gFrameState->DrawOffset, sizeof(draw_constants));
+}
+
+void GL::SetupFrameBlocks(GLuint Program)
+{
+	GLuint FrameBlockIndex = glGetUniformBlockIndex(Program, "uFrameBlock");
+	if (FrameBlockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(Program, FrameBlockIndex, FRAME_BLOCK_BINDING_POINT);
+
+	GLuint DrawBlockIndex = glGetUniformBlockIndex(Program, "uDrawBlock");
+	if (DrawBlockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(Program, DrawBlockIndex, DRAW_BLOCK_BINDING_POINT);
+}
+
+const char* GL::GetFrameBlocksDefinitions()
+{
+	return FrameBlocksDefinitionsStr;
+}
+
+const GL::stream_ring& GL::GetFrameRing()
+{
+	return gFrameState->Ring;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "opengl_headers.h"
+#include "maths.h"
+#include "opengl_helpers_ring.h"
+
+namespace GL
+{
+	// Fixed bindings of the shared blocks (the demos keep 0 for their light block)
+	const int FRAME_BLOCK_BINDING_POINT = 1;
+	const int DRAW_BLOCK_BINDING_POINT = 2;
+
+	// Same memory layout than 'uFrameBlock' in glsl shader (std140)
+	struct frame_constants
+	{
+		mat4 Projection;
+		mat4 View;
+		mat4 ViewProjection;
+		alignas(16) v3 ViewPosition;
+		float Time;
+	};
+
+	// Same memory layout than 'uDrawBlock' in glsl shader (std140)
+	struct draw_constants
+	{
+		mat4 Model;
+		mat4 ModelNormalMatrix;
+	};
+
+	// Camera and per-draw constants shared by every program compiled with GLINCLUDE_FRAMECONSTANTS,
+	// written once into a stream ring and bound by offset instead of glUniform calls per program.
+	void InitFrameConstants();
+	void DestroyFrameConstants();
+	void BeginFrameConstants(double Time);
+	void EndFrameConstants();
+
+	// Push and bind a new block (skipped when equal to the bound one), bindings stay valid until EndFrameConstants()
+	void SetFrameConstants(const mat4& Projection, const mat4& View, const v3& ViewPosition);
+	void SetDrawConstants(const mat4& Model);
+
+	// Block bindings of a linked program (done by CreateProgramEx for GLINCLUDE_FRAMECONSTANTS)
+	void SetupFrameBlocks(GLuint Program);
+	const char* GetFrameBlocksDefinitions();
+
+	const stream_ring& GetFrameRing();
+}
@@ -0,0 +1,158 @@
+#include <cstdio>
+
+#include "opengl_helpers.h"
+
+#include "opengl_helpers_hiz.h"
+
+// Triangle covering the viewport, from the vertex index
+static const char* gHiZVertexShaderStr = R"GLSL(
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+})GLSL";
+
+static const char* gHiZFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uSource; // Framebuffer depth copy, or the previous level (base level of the pyramid)
+uniform bool uReduce;
+
+// Shader outputs
+out float oDepth;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    if (!uReduce)
+    {
+        oDepth = texelFetch(uSource, texel, 0).r;
+        return;
+    }
+
+    // 2x2 source texels, 3 on the last row/column of odd sizes
+    ivec2 sourceSize = textureSize(uSource, 0);
+    ivec2 size = max(sourceSize / 2, ivec2(1));
+    ivec2 taps = ivec2(2) + ivec2(equal(texel, size - 1)) * (sourceSize & 1);
+
+    float depth = 0.0;
+    for (int y = 0; y < taps.y; ++y)
+    {
+        for (int x = 0; x < taps.x; ++x)
+            depth = max(depth, texelFetch(uSource, min(texel * 2 + ivec2(x, y), sourceSize - 1), 0).r);
+    }
+    oDepth = depth;
+})GLSL";
+
+GL::hiz_pyramid::hiz_pyramid()
+{
+	this->Program = GL::CreateProgram(gHiZVertexShaderStr, gHiZFragmentShaderStr);
+	glUseProgram(this->Program);
+	glUniform1i(glGetUniformLocation(this->Program, "uSource"), 0);
+
+	glGenVertexArrays(1, &this->EmptyVAO);
+	glGenFramebuffers(1, &this->FBO);
+}
+
+GL::hiz_pyramid::~hiz_pyramid()
+{
+	glDeleteVertexArrays(1, &this->EmptyVAO);
+	glDeleteProgram(this->Program);
+	glDeleteFramebuffers(1, &this->FBO);
+	glDeleteTextures(1, &this->DepthTexture);
+	glDeleteTextures(1, &this->Texture);
+}
+
+void GL::hiz_pyramid::CreateTargets(int Width, int Height)
+{
+	glDeleteTextures(1, &this->DepthTexture);
+	glDeleteTextures(1, &this->Texture);
+
+	this->Width = Width;
+	this->Height = Height;
+	this->LevelCount = 1;
+	while ((Width >> this->LevelCount) > 0 || (Height >> this->LevelCount) > 0)
+		++this->LevelCount;
+
+	glGenTextures(1, &this->DepthTexture);
+	glBindTexture(GL_TEXTURE_2D, this->DepthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, Width, Height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &this->Texture);
+	glBindTexture(GL_TEXTURE_2D, this->Texture);
+	for (int Level = 0; Level < this->LevelCount; ++Level)
+	{
+		int LevelWidth = Width >> Level;
+		int LevelHeight = Height >> Level;
+		glTexImage2D(GL_TEXTURE_2D, Level, GL_R32F, LevelWidth > 0 ? LevelWidth : 1, LevelHeight > 0 ? LevelHeight : 1, 0, GL_RED, GL_FLOAT, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->LevelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GL::hiz_pyramid::Build(int Width, int Height)
+{
+	if (Width <= 0 || Height <= 0)
+		return;
+
+	if (Width != this->Width || Height != this->Height)
+		this->CreateTargets(Width, Height);
+
+	GLboolean PrevDepthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+
+	// Depth of the frame (the read buffer of the default framebuffer)
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, this->DepthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, Width, Height);
+
+	glUseProgram(this->Program);
+	glBindVertexArray(this->EmptyVAO);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+
+	for (int Level = 0; Level < this->LevelCount; ++Level)
+	{
+		// Each level reads the previous one, the only level visible to the sampler
+		if (Level > 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, this->Texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, Level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Level - 1);
+		}
+		glUniform1i(glGetUniformLocation(this->Program, "uReduce"), Level > 0);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture, Level);
+		if (Level == 0 && glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::printf("ERROR::FRAMEBUFFER:: Hi-Z framebuffer is not complete!\n");
+
+		int LevelWidth = Width >> Level;
+		int LevelHeight = Height >> Level;
+		glViewport(0, 0, LevelWidth > 0 ? LevelWidth : 1, LevelHeight > 0 ? LevelHeight : 1);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, this->Texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->LevelCount - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, Width, Height);
+	if (PrevDepthTest)
+		glEnable(GL_DEPTH_TEST);
+
+	this->Valid = true;
+}
+
+void GL::hiz_pyramid::Bind(int TextureUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, this->Texture);
+	glActiveTexture(GL_TEXTURE0);
+}
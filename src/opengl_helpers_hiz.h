@@ -0,0 +1,51 @@
+#pragma once
+
+#include "opengl_headers.h"
+
+namespace GL
+{
+	// Hierarchical depth (Hi-Z) of the default framebuffer: its depth is copied after a frame and
+	// reduced into a R32F mip chain where each texel holds the farthest depth of the texels it covers.
+	// A bounding volume whose nearest depth is behind the farthest depth of the 2x2 texels covering
+	// its screen rectangle (at the level where the rectangle is at most one texel wide) is occluded.
+	//
+	// Levels are halved (rounded down), the last row/column of a level with an odd size also reads
+	// the extra source row/column so every source texel is covered.
+	class hiz_pyramid
+	{
+	public:
+		hiz_pyramid();
+		~hiz_pyramid();
+
+		hiz_pyramid(const hiz_pyramid&) = delete;
+		hiz_pyramid& operator=(const hiz_pyramid&) = delete;
+
+		// Copy the depth of the default framebuffer (Width x Height) and build the mip chain
+		void Build(int Width, int Height);
+
+		// False until the first Build, and after Invalidate
+		bool IsValid() const { return this->Valid; }
+		void Invalidate() { this->Valid = false; }
+
+		void Bind(int TextureUnit) const;
+
+		int GetWidth() const { return this->Width; }
+		int GetHeight() const { return this->Height; }
+		int GetLevelCount() const { return this->LevelCount; }
+
+	private:
+		// Recreated when the framebuffer size changes
+		void CreateTargets(int Width, int Height);
+
+		GLuint DepthTexture = 0; // Copy of the framebuffer depth
+		GLuint Texture = 0;      // Farthest depths, LevelCount mips
+		GLuint FBO = 0;
+		GLuint Program = 0;
+		GLuint EmptyVAO = 0;
+
+		int Width = 0;
+		int Height = 0;
+		int LevelCount = 0;
+		bool Valid = false;
+	};
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+
+#include "opengl_helpers.h"
+
+#include "opengl_helpers_permutation.h"
+
+static int gTotalVariantCount = 0;
+static double gTotalCompileTimeMs = 0.0;
+
+GL::shader_permutations::shader_permutations(int VSStringsCount, const char** VSStrings, int FSStringsCount, const char** FSStrings, const int Includes, const std::vector<const char*>& FeatureNames)
+	: Includes(Includes)
+{
+	// Own the sources, variants can be compiled long after the caller's strings are gone
+	for (int i = 0; i < VSStringsCount; ++i)
+		this->VSSources.push_back(VSStrings[i]);
+
+	for (int i = 0; i < FSStringsCount; ++i)
+		this->FSSources.push_back(FSStrings[i]);
+
+	for (const char* Name : FeatureNames)
+		this->FeatureNames.push_back(Name);
+}
+
+GL::shader_permutations::~shader_permutations()
+{
+	for (const auto& KeyValue : this->Programs)
+		glDeleteProgram(KeyValue.second);
+
+	gTotalVariantCount -= (int)this->Programs.size();
+	gTotalCompileTimeMs -= this->CompileTimeMs;
+}
+
+void GL::shader_permutations::SetProgramSetup(std::function<void(GLuint)> Setup)
+{
+	this->ProgramSetup = Setup;
+
+	// Apply to variants already compiled
+	for (const auto& KeyValue : this->Programs)
+		this->ProgramSetup(KeyValue.second);
+}
+
+GLuint GL::shader_permutations::GetProgram(uint32_t FeatureBits)
+{
+	auto Found = this->Programs.find(FeatureBits);
+	if (Found != this->Programs.end())
+		return Found->second;
+
+	return this->CompileVariant(FeatureBits);
+}
+
+void GL::shader_permutations::Precompile(const std::vector<uint32_t>& FeatureBitsList)
+{
+	for (uint32_t FeatureBits : FeatureBitsList)
+		this->GetProgram(FeatureBits);
+}
+
+GLuint GL::shader_permutations::CompileVariant(uint32_t FeatureBits)
+{
+	auto Start = std::chrono::high_resolution_clock::now();
+
+	// Assemble defines of the enabled features
+	std::string Defines;
+	for (int i = 0; i < (int)this->FeatureNames.size(); ++i)
+	{
+		if (FeatureBits & (1u << i))
+			Defines += "#define " + this->FeatureNames[i] + "\n";
+	}
+
+	std::vector<const char*> VSStrings = { Defines.c_str() };
+	for (const std::string& Source : this->VSSources)
+		VSStrings.push_back(Source.c_str());
+
+	std::vector<const char*> FSStrings = { Defines.c_str() };
+	for (const std::string& Source : this->FSSources)
+		FSStrings.push_back(Source.c_str());
+
+	GLuint Program = GL::CreateProgramEx((int)VSStrings.size(), &VSStrings[0], (int)FSStrings.size(), &FSStrings[0], this->Includes);
+
+	if (this->ProgramSetup)
+		this->ProgramSetup(Program);
+
+	this->Programs[FeatureBits] = Program;
+
+	auto End = std::chrono::high_resolution_clock::now();
+	this->LastCompileTimeMs = std::chrono::duration<double, std::milli>(End - Start).count();
+	this->CompileTimeMs += this->LastCompileTimeMs;
+
+	gTotalVariantCount++;
+	gTotalCompileTimeMs += this->LastCompileTimeMs;
+
+	return Program;
+}
+
+int GL::shader_permutations::GetTotalVariantCount()
+{
+	return gTotalVariantCount;
+}
+
+double GL::shader_permutations::GetTotalCompileTimeMs()
+{
+	return gTotalCompileTimeMs;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "opengl_headers.h"
+
+namespace GL
+{
+	// Compile-time variants of one program.
+	// Bit i of a feature set is emitted as "#define FeatureNames[i]" in front of the vertex and fragment
+	// sources, so demos select a variant instead of branching per pixel on a mode uniform.
+	class shader_permutations
+	{
+	public:
+		shader_permutations(int VSStringsCount, const char** VSStrings, int FSStringsCount, const char** FSStrings, const int Includes, const std::vector<const char*>& FeatureNames);
+		~shader_permutations();
+
+		shader_permutations(const shader_permutations&) = delete;
+		shader_permutations& operator=(const shader_permutations&) = delete;
+
+		// Called once on every new variant (sampler units, uniform block bindings...)
+		void SetProgramSetup(std::function<void(GLuint)> Setup);
+
+		// Return the variant matching FeatureBits, compiled on first use
+		GLuint GetProgram(uint32_t FeatureBits);
+
+		// Compile variants up front to avoid hitches when switching
+		void Precompile(const std::vector<uint32_t>& FeatureBitsList);
+
+		int GetVariantCount() const { return (int)this->Programs.size(); }
+		double GetCompileTimeMs() const { return this->CompileTimeMs; }
+		double GetLastCompileTimeMs() const { return this->LastCompileTimeMs; }
+
+		// Totals over every permutation set of the app
+		static int GetTotalVariantCount();
+		static double GetTotalCompileTimeMs();
+
+	private:
+		GLuint CompileVariant(uint32_t FeatureBits);
+
+		std::vector<std::string> VSSources;
+		std::vector<std::string> FSSources;
+		std::vector<std::string> FeatureNames;
+		int Includes = 0;
+
+		std::function<void(GLuint)> ProgramSetup;
+		std::map<uint32_t, GLuint> Programs;
+
+		double CompileTimeMs = 0.0;
+		double LastCompileTimeMs = 0.0;
+	};
+}
@@ -0,0 +1,84 @@
+#include <imgui.h>
+
+#include "opengl_helpers.h"
+
+#include "opengl_helpers_prepass.h"
+
+static const char* gPrepassVertexShaderStr = R"GLSL(
+layout(location = 0) in vec3 aPosition;
+
+// Same expression and qualifier than the main vertex shaders, so GL_EQUAL passes
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = uProjection * uView * (uModel * vec4(aPosition, 1.0));
+})GLSL";
+
+static const char* gPrepassFragmentShaderStr = R"GLSL(
+void main()
+{
+})GLSL";
+
+GL::depth_prepass::depth_prepass()
+{
+	this->Program = GL::CreateProgram(gPrepassVertexShaderStr, gPrepassFragmentShaderStr, GLINCLUDE_FRAMECONSTANTS);
+}
+
+GL::depth_prepass::~depth_prepass()
+{
+	glDeleteProgram(this->Program);
+}
+
+bool GL::depth_prepass::BeginPrepass()
+{
+	this->PrepassDone = this->Enabled;
+	if (!this->Enabled)
+		return false;
+
+	glUseProgram(this->Program);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	return true;
+}
+
+void GL::depth_prepass::BeginMainPass()
+{
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	if (this->PrepassDone)
+	{
+		// Only the nearest surface is left to shade
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	this->Counter.Begin(this->PrepassDone ? 1 : 0);
+}
+
+void GL::depth_prepass::EndMainPass()
+{
+	this->Counter.End();
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	this->PrepassDone = false;
+
+	uint64_t Count = 0;
+	int Tag = 0;
+	if (this->Counter.GetResult(&Count, &Tag))
+		this->Counts[Tag] = Count;
+}
+
+void GL::depth_prepass::DisplayDebugUI()
+{
+	ImGui::Checkbox("Depth pre-pass", &this->Enabled);
+
+	const char* CounterName = this->Counter.IsShaderInvocations() ? "Fragment shader invocations" : "Samples passed";
+	ImGui::Text("%s (main pass):", CounterName);
+	ImGui::Text("  without pre-pass: %llu", (unsigned long long)this->Counts[0]);
+	ImGui::Text("  with pre-pass:    %llu", (unsigned long long)this->Counts[1]);
+	if (this->Counts[0] && this->Counts[1])
+		ImGui::Text("  ratio: %.2f", (double)this->Counts[1] / (double)this->Counts[0]);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "opengl_headers.h"
+#include "opengl_helpers_query.h"
+
+namespace GL
+{
+	// Optional depth-only pass in front of a demo main pass: depth is laid down by a position-only
+	// program, then the main pass runs with GL_EQUAL and no depth writes, so its fragment shader
+	// runs once per visible pixel instead of once per rasterized fragment.
+	//
+	// The main vertex shaders must compute "gl_Position = uProjection * uView * (uModel * position)"
+	// (frame constants) and declare "invariant gl_Position;" for the depths to match exactly.
+	class depth_prepass
+	{
+	public:
+		depth_prepass();
+		~depth_prepass();
+
+		depth_prepass(const depth_prepass&) = delete;
+		depth_prepass& operator=(const depth_prepass&) = delete;
+
+		bool Enabled = false;
+
+		// When enabled, binds the depth-only program and returns true: draw the opaque geometry
+		// (position on attribute 0, e.g. scene::DrawScenePositions, frame and draw constants set)
+		bool BeginPrepass();
+
+		// Around the main pass draws, measured by the fragment counter
+		void BeginMainPass();
+		void EndMainPass();
+
+		// ImGui debug function (toggle and fragment counts with/without the pre-pass)
+		void DisplayDebugUI();
+
+	private:
+		GLuint Program = 0;
+		bool PrepassDone = false;
+
+		fragment_counter Counter;
+		uint64_t Counts[2] = {}; // Last main pass count without/with the pre-pass
+	};
+}
@@ -0,0 +1,129 @@
+#include "opengl_helpers_extensions.h"
+
+#include "opengl_helpers_query.h"
+
+GL::fragment_counter::fragment_counter()
+{
+	if (GL::GetExtensions().PipelineStatisticsQuery)
+		this->Target = GL_FRAGMENT_SHADER_INVOCATIONS_ARB;
+
+	glGenQueries(QUERY_COUNT, this->Queries);
+}
+
+GL::fragment_counter::~fragment_counter()
+{
+	glDeleteQueries(QUERY_COUNT, this->Queries);
+}
+
+void GL::fragment_counter::Poll()
+{
+	// Oldest first, the slot after the last one used
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		int Index = (this->Current + i) % QUERY_COUNT;
+		if (!this->Pending[Index])
+			continue;
+
+		GLuint Available = GL_FALSE;
+		glGetQueryObjectuiv(this->Queries[Index], GL_QUERY_RESULT_AVAILABLE, &Available);
+		if (!Available)
+			break;
+
+		GLuint64 Count = 0;
+		glGetQueryObjectui64v(this->Queries[Index], GL_QUERY_RESULT, &Count);
+		this->Pending[Index] = false;
+		this->HasResult = true;
+		this->ResultCount = Count;
+		this->ResultTag = this->Tags[Index];
+	}
+}
+
+void GL::fragment_counter::Begin(int Tag)
+{
+	this->Poll();
+
+	// Every query still in flight, skip this frame rather than stall
+	this->Counting = !this->Pending[this->Current];
+	if (!this->Counting)
+		return;
+
+	this->Tags[this->Current] = Tag;
+	glBeginQuery(this->Target, this->Queries[this->Current]);
+}
+
+void GL::fragment_counter::End()
+{
+	if (!this->Counting)
+		return;
+
+	glEndQuery(this->Target);
+	this->Pending[this->Current] = true;
+	this->Current = (this->Current + 1) % QUERY_COUNT;
+	this->Counting = false;
+}
+
+bool GL::fragment_counter::GetResult(uint64_t* Count, int* Tag) const
+{
+	if (!this->HasResult)
+		return false;
+
+	*Count = this->ResultCount;
+	*Tag = this->ResultTag;
+	return true;
+}
+
+GL::gpu_timer::gpu_timer()
+{
+	glGenQueries(QUERY_COUNT, this->Queries);
+}
+
+GL::gpu_timer::~gpu_timer()
+{
+	glDeleteQueries(QUERY_COUNT, this->Queries);
+}
+
+void GL::gpu_timer::Begin(int Tag)
+{
+	// Every query still in flight, skip this frame rather than stall
+	this->Timing = !this->Pending[this->Current];
+	if (!this->Timing)
+		return;
+
+	this->Tags[this->Current] = Tag;
+	glBeginQuery(GL_TIME_ELAPSED, this->Queries[this->Current]);
+}
+
+void GL::gpu_timer::End()
+{
+	if (!this->Timing)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	this->Pending[this->Current] = true;
+	this->Current = (this->Current + 1) % QUERY_COUNT;
+	this->Timing = false;
+}
+
+bool GL::gpu_timer::PopResult(double* Milliseconds, int* Tag)
+{
+	// Oldest first, the slot after the last one used
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		int Index = (this->Current + i) % QUERY_COUNT;
+		if (!this->Pending[Index])
+			continue;
+
+		GLuint Available = GL_FALSE;
+		glGetQueryObjectuiv(this->Queries[Index], GL_QUERY_RESULT_AVAILABLE, &Available);
+		if (!Available)
+			return false;
+
+		GLuint64 Time = 0;
+		glGetQueryObjectui64v(this->Queries[Index], GL_QUERY_RESULT, &Time);
+		this->Pending[Index] = false;
+		*Milliseconds = (double)Time / 1000000.0;
+		*Tag = this->Tags[Index];
+		return true;
+	}
+	return false;
+}
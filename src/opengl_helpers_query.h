@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "opengl_headers.h"
+
+namespace GL
+{
+	// Number of fragment shader invocations of the draws between Begin() and End()
+	// (ARB_pipeline_statistics_query), or of samples passing the depth test when not supported.
+	// Results are read a few frames later without waiting for the GPU.
+	class fragment_counter
+	{
+	public:
+		fragment_counter();
+		~fragment_counter();
+
+		fragment_counter(const fragment_counter&) = delete;
+		fragment_counter& operator=(const fragment_counter&) = delete;
+
+		// Once per frame at most, Tag is returned with the result (e.g. the mode measured)
+		void Begin(int Tag = 0);
+		void End();
+
+		// Last available result, false when there is none yet
+		bool GetResult(uint64_t* Count, int* Tag) const;
+
+		bool IsShaderInvocations() const { return this->Target != GL_SAMPLES_PASSED; }
+
+	private:
+		static const int QUERY_COUNT = 4;
+
+		void Poll();
+
+		GLenum Target = GL_SAMPLES_PASSED;
+		GLuint Queries[QUERY_COUNT] = {};
+		int Tags[QUERY_COUNT] = {};
+		bool Pending[QUERY_COUNT] = {};
+		int Current = 0;
+		bool Counting = false;
+
+		bool HasResult = false;
+		uint64_t ResultCount = 0;
+		int ResultTag = 0;
+	};
+
+	// GPU time of the commands between Begin() and End() (GL_TIME_ELAPSED), read a few frames later
+	// without waiting for the GPU like fragment_counter.
+	class gpu_timer
+	{
+	public:
+		gpu_timer();
+		~gpu_timer();
+
+		gpu_timer(const gpu_timer&) = delete;
+		gpu_timer& operator=(const gpu_timer&) = delete;
+
+		// Once per frame at most, Tag is returned with the result (e.g. the work measured)
+		void Begin(int Tag = 0);
+		void End();
+
+		// Next available result in order, false when there is none (results are only returned once)
+		bool PopResult(double* Milliseconds, int* Tag);
+
+	private:
+		static const int QUERY_COUNT = 4;
+
+		GLuint Queries[QUERY_COUNT] = {};
+		int Tags[QUERY_COUNT] = {};
+		bool Pending[QUERY_COUNT] = {};
+		int Current = 0;
+		bool Timing = false;
+	};
+}
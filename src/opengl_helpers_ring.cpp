@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+
+#include "opengl_helpers_extensions.h"
+
+#include "opengl_helpers_ring.h"
+
+GL::stream_ring::~stream_ring()
+{
+	Destroy();
+}
+
+void GL::stream_ring::Init(GLenum Target, GLsizeiptr FrameCapacity, GLint Alignment)
+{
+	Destroy();
+
+	this->Target = Target;
+	this->Alignment = Alignment > 0 ? Alignment : 1;
+	this->FrameCapacity = (FrameCapacity + this->Alignment - 1) / this->Alignment * this->Alignment;
+
+	glGenBuffers(1, &this->Buffer);
+	glBindBuffer(Target, this->Buffer);
+
+	const GL::extensions& Extensions = GL::GetExtensions();
+	if (Extensions.BufferStorage)
+	{
+		GLsizeiptr Size = this->FrameCapacity * STREAM_RING_FRAME_COUNT;
+		GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		Extensions.BufferStorageProc(Target, Size, nullptr, Flags);
+		this->Mapped = (uint8_t*)glMapBufferRange(Target, 0, Size, Flags);
+		if (this->Mapped == nullptr)
+			fprintf(stderr, "Stream ring: persistent mapping failed, falling back to orphaning\n");
+	}
+
+	// Fallback: a single frame of storage, orphaned by BeginFrame()
+	if (this->Mapped == nullptr)
+	{
+		glDeleteBuffers(1, &this->Buffer);
+		glGenBuffers(1, &this->Buffer);
+		glBindBuffer(Target, this->Buffer);
+		glBufferData(Target, this->FrameCapacity, nullptr, GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(Target, 0);
+	this->Frame = 0;
+	this->Cursor = 0;
+}
+
+void GL::stream_ring::Destroy()
+{
+	for (GLsync& Fence : this->Fences)
+	{
+		if (Fence)
+			glDeleteSync(Fence);
+		Fence = nullptr;
+	}
+
+	if (this->Buffer)
+	{
+		if (this->Mapped)
+		{
+			glBindBuffer(this->Target, this->Buffer);
+			glUnmapBuffer(this->Target);
+			glBindBuffer(this->Target, 0);
+		}
+		glDeleteBuffers(1, &this->Buffer);
+	}
+
+	this->Buffer = 0;
+	this->Mapped = nullptr;
+}
+
+void GL::stream_ring::BeginFrame()
+{
+	this->Cursor = 0;
+
+	if (this->Mapped == nullptr)
+	{
+		// New storage, the driver keeps the previous one alive for the frames in flight
+		glBindBuffer(this->Target, this->Buffer);
+		glBufferData(this->Target, this->FrameCapacity, nullptr, GL_STREAM_DRAW);
+		return;
+	}
+
+	GLsync& Fence = this->Fences[this->Frame];
+	if (Fence == nullptr)
+		return;
+
+	// Only blocks when the CPU is STREAM_RING_FRAME_COUNT frames ahead
+	GLbitfield WaitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (true)
+	{
+		GLenum Result = glClientWaitSync(Fence, WaitFlags, 1000000000);
+		if (Result == GL_ALREADY_SIGNALED || Result == GL_CONDITION_SATISFIED || Result == GL_WAIT_FAILED)
+			break;
+		WaitFlags = 0;
+	}
+	glDeleteSync(Fence);
+	Fence = nullptr;
+}
+
+void GL::stream_ring::EndFrame()
+{
+	if (this->Mapped)
+	{
+		this->Fences[this->Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		this->Frame = (this->Frame + 1) % STREAM_RING_FRAME_COUNT;
+	}
+}
+
+GLintptr GL::stream_ring::Push(const void* Data, GLsizeiptr Size)
+{
+	if (this->Cursor + Size > this->FrameCapacity)
+	{
+		if (!this->OverflowReported)
+			fprintf(stderr, "Stream ring: frame capacity exceeded (%d bytes)\n", (int)this->FrameCapacity);
+		this->OverflowReported = true;
+		return -1;
+	}
+
+	GLintptr Offset = this->Cursor;
+	this->Cursor = (this->Cursor + Size + this->Alignment - 1) / this->Alignment * this->Alignment;
+
+	if (this->Mapped)
+	{
+		Offset += this->Frame * this->FrameCapacity;
+		memcpy(this->Mapped + Offset, Data, Size);
+	}
+	else
+	{
+		// Never overlaps a range read earlier in the frame, no implicit sync
+		glBindBuffer(this->Target, this->Buffer);
+		glBufferSubData(this->Target, Offset, Size, Data);
+	}
+
+	return Offset;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "opengl_headers.h"
+
+namespace GL
+{
+	// Frames the CPU can write ahead of the GPU
+	const int STREAM_RING_FRAME_COUNT = 3;
+
+	// Buffer for data written every frame (constants, per-draw data...), suballocated linearly.
+	// With ARB_buffer_storage the buffer is persistently mapped and split in one section per frame
+	// in flight, each guarded by a fence. Otherwise the storage is orphaned at the start of each frame.
+	// Data pushed during a frame stays valid until EndFrame(), bind it with its returned offset.
+	class stream_ring
+	{
+	public:
+		stream_ring() = default;
+		~stream_ring();
+
+		stream_ring(const stream_ring&) = delete;
+		stream_ring& operator=(const stream_ring&) = delete;
+
+		// Alignment of every pushed block (e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+		void Init(GLenum Target, GLsizeiptr FrameCapacity, GLint Alignment);
+		void Destroy();
+
+		// Waits until the GPU is done with the section reused by this frame
+		void BeginFrame();
+		void EndFrame();
+
+		// Copy Data into the current frame, returns its offset in GetBuffer() (-1 when the frame is full)
+		GLintptr Push(const void* Data, GLsizeiptr Size);
+
+		GLuint GetBuffer() const { return this->Buffer; }
+		bool IsPersistent() const { return this->Mapped != nullptr; }
+		GLsizeiptr GetFrameUsage() const { return this->Cursor; }
+		GLsizeiptr GetFrameCapacity() const { return this->FrameCapacity; }
+
+	private:
+		GLenum Target = GL_UNIFORM_BUFFER;
+		GLuint Buffer = 0;
+		uint8_t* Mapped = nullptr;
+
+		GLsizeiptr FrameCapacity = 0;
+		GLint Alignment = 1;
+
+		GLsync Fences[STREAM_RING_FRAME_COUNT] = {};
+		int Frame = 0;
+		GLsizeiptr Cursor = 0;
+		bool OverflowReported = false;
+	};
+}
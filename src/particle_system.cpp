@@ -0,0 +1,578 @@
+#include <cmath>
+#include <cstdio>
+
+#include <imgui.h>
+
+#include "opengl_helpers.h"
+#include "platform.h"
+
+#include "particle_system.h"
+
+// Particle state, interleaved outputs of the simulation (2 RGBA32F texels in the texture buffers)
+struct gpu_particle
+{
+    v4 PositionAge;
+    v4 VelocityLifetime; // Dead when age >= lifetime (zeroed particles are dead)
+};
+
+#pragma region SimulationShader
+static const char* gSimulationVertexShaderStr = R"GLSL(
+// Attributes (gpu_particle)
+layout(location = 0) in vec4 aPositionAge;
+layout(location = 1) in vec4 aVelocityLifetime;
+
+// Uniforms
+uniform float uDeltaTime;
+uniform float uTime;
+uniform int uParticleCount;
+uniform int uEmitStart; // Particles [uEmitStart, uEmitStart + uEmitCount) (wrapped) are respawned
+uniform int uEmitCount;
+uniform int uEmitterCount;
+uniform vec4 uEmitterPositions[8];  // Center and radius (particle_system::MAX_EMITTER_COUNT)
+uniform vec4 uEmitterVelocities[8]; // Velocity and spread
+uniform vec2 uLifetime;
+uniform vec3 uAcceleration;
+uniform float uDrag;
+uniform float uTurbulence;
+
+// Captured outputs
+out vec4 oPositionAge;
+out vec4 oVelocityLifetime;
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(inout uint state)
+{
+    state = hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+vec3 random_in_sphere(inout uint state)
+{
+    float z = random(state) * 2.0 - 1.0;
+    float angle = random(state) * 6.2831853;
+    float radius = pow(random(state), 1.0 / 3.0);
+    return vec3(sqrt(1.0 - z * z) * vec2(cos(angle), sin(angle)), z) * radius;
+}
+
+void main()
+{
+    vec3 position = aPositionAge.xyz;
+    float age = aPositionAge.w;
+    vec3 velocity = aVelocityLifetime.xyz;
+    float lifetime = aVelocityLifetime.w;
+
+    int emitOffset = (gl_VertexID - uEmitStart + uParticleCount) % uParticleCount;
+    if (emitOffset < uEmitCount)
+    {
+        uint state = hash(uint(gl_VertexID) ^ hash(floatBitsToUint(uTime)));
+        int emitter = int(hash(state) % uint(uEmitterCount));
+        position = uEmitterPositions[emitter].xyz + random_in_sphere(state) * uEmitterPositions[emitter].w;
+        velocity = uEmitterVelocities[emitter].xyz + random_in_sphere(state) * uEmitterVelocities[emitter].w;
+        age = 0.0;
+        lifetime = mix(uLifetime.x, uLifetime.y, random(state));
+    }
+    else if (age < lifetime)
+    {
+        // Cheap swirling field, varying in space and time
+        vec3 swirl = vec3(
+            sin(position.y * 5.1 + uTime * 1.7) + sin(position.z * 3.3 - uTime),
+            sin(position.z * 4.3 + uTime * 1.3),
+            sin(position.x * 4.7 - uTime * 1.1) + cos(position.y * 3.7 + uTime * 0.9));
+
+        velocity += (uAcceleration + swirl * uTurbulence) * uDeltaTime;
+        velocity *= exp(-uDrag * uDeltaTime);
+        position += velocity * uDeltaTime;
+        age += uDeltaTime;
+    }
+
+    oPositionAge = vec4(position, age);
+    oVelocityLifetime = vec4(velocity, lifetime);
+})GLSL";
+#pragma endregion
+
+#pragma region RenderShaders
+static const char* gRenderVertexShaderStr = R"GLSL(
+// Uniforms
+uniform samplerBuffer uParticles; // gpu_particle, 2 texels each
+uniform sampler2D uSortedKeys;    // (key, index) ordered back to front
+uniform bool uSorted;
+uniform int uSortWidth;
+uniform vec2 uSize;
+uniform vec4 uStartColor;
+uniform vec4 uEndColor;
+
+// Varyings
+out vec2 vCorner;
+out vec4 vColor;
+out float vViewDepth;
+
+void main()
+{
+    int index = gl_InstanceID;
+    if (uSorted)
+        index = int(texelFetch(uSortedKeys, ivec2(gl_InstanceID % uSortWidth, gl_InstanceID / uSortWidth), 0).y);
+
+    vec4 positionAge = texelFetch(uParticles, index * 2);
+    float lifetime = texelFetch(uParticles, index * 2 + 1).w;
+
+    // Triangle strip corner, collapsed outside the clip volume when dead
+    vCorner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    if (positionAge.w >= lifetime)
+    {
+        vColor = vec4(0.0);
+        vViewDepth = 0.0;
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    float t = positionAge.w / lifetime;
+    vColor = mix(uStartColor, uEndColor, t);
+
+    vec4 viewPos = uView * vec4(positionAge.xyz, 1.0);
+    viewPos.xy += vCorner * mix(uSize.x, uSize.y, t);
+    vViewDepth = -viewPos.z;
+    gl_Position = uProjection * viewPos;
+})GLSL";
+
+static const char* gRenderFragmentShaderStr = R"GLSL(
+// Varyings
+in vec2 vCorner;
+in vec4 vColor;
+in float vViewDepth;
+
+// Uniforms
+uniform sampler2D uSceneDepth;
+uniform float uSoftDistance;
+uniform bool uAdditive;
+
+// Shader outputs
+out vec4 oColor;
+
+void main()
+{
+    float alpha = max(1.0 - dot(vCorner, vCorner), 0.0);
+    alpha *= alpha * vColor.a;
+
+    // Fade in front of the scene instead of cutting the quad
+    if (uSoftDistance > 0.0)
+    {
+        float depth = texelFetch(uSceneDepth, ivec2(gl_FragCoord.xy), 0).r * 2.0 - 1.0;
+        float sceneDepth = uProjection[3][2] / (depth + uProjection[2][2]);
+        alpha *= clamp((sceneDepth - vViewDepth) / uSoftDistance, 0.0, 1.0);
+    }
+
+    // Premultiplied, no coverage when additive
+    oColor = vec4(vColor.rgb * alpha, uAdditive ? 0.0 : alpha);
+})GLSL";
+#pragma endregion
+
+#pragma region SortShaders
+// Triangle covering the viewport, from the vertex index
+static const char* gSortVertexShaderStr = R"GLSL(
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+})GLSL";
+
+static const char* gKeyFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform samplerBuffer uParticles;
+uniform int uParticleCount;
+uniform int uSortWidth;
+
+// Shader outputs
+out vec2 oKey;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int index = texel.y * uSortWidth + texel.x;
+
+    // Farthest first, dead particles and padding last
+    float key = 3.0e38;
+    if (index < uParticleCount)
+    {
+        vec4 positionAge = texelFetch(uParticles, index * 2);
+        if (positionAge.w < texelFetch(uParticles, index * 2 + 1).w)
+        {
+            vec3 toCamera = positionAge.xyz - uViewPosition;
+            key = -dot(toCamera, toCamera);
+        }
+    }
+    oKey = vec2(key, float(index));
+})GLSL";
+
+static const char* gSortFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uKeys;
+uniform int uSortWidth;
+uniform int uBlockSize; // Size of the bitonic sequences being merged
+uniform int uDistance;  // Compare distance of this pass
+
+// Shader outputs
+out vec2 oKey;
+
+// Indices are unique, both sides of a pair agree on the order
+bool key_less(vec2 a, vec2 b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int index = texel.y * uSortWidth + texel.x;
+    int partner = index ^ uDistance;
+
+    vec2 key = texelFetch(uKeys, texel, 0).xy;
+    vec2 partnerKey = texelFetch(uKeys, ivec2(partner % uSortWidth, partner / uSortWidth), 0).xy;
+
+    bool ascending = (index & uBlockSize) == 0;
+    bool keepMin = (index < partner) == ascending;
+    oKey = (key_less(key, partnerKey) == keepMin) ? key : partnerKey;
+})GLSL";
+#pragma endregion
+
+static int NextPowerOfTwo(int Value)
+{
+    int Result = 1;
+    while (Result < Value)
+        Result <<= 1;
+    return Result;
+}
+
+particle_system::particle_system(int ParticleCount)
+{
+    const char* Varyings[] = { "oPositionAge", "oVelocityLifetime" };
+    this->SimulationProgram = GL::CreateTransformFeedbackProgram(1, &gSimulationVertexShaderStr, 0, nullptr, ARRAY_SIZE(Varyings), Varyings);
+    this->RenderProgram = GL::CreateProgram(gRenderVertexShaderStr, gRenderFragmentShaderStr, GLINCLUDE_FRAMECONSTANTS);
+    this->KeyProgram = GL::CreateProgram(gSortVertexShaderStr, gKeyFragmentShaderStr, GLINCLUDE_FRAMECONSTANTS);
+    this->SortProgram = GL::CreateProgram(gSortVertexShaderStr, gSortFragmentShaderStr);
+
+    glUseProgram(this->RenderProgram);
+    glUniform1i(glGetUniformLocation(this->RenderProgram, "uParticles"), 0);
+    glUniform1i(glGetUniformLocation(this->RenderProgram, "uSceneDepth"), 1);
+    glUniform1i(glGetUniformLocation(this->RenderProgram, "uSortedKeys"), 2);
+    glUseProgram(this->KeyProgram);
+    glUniform1i(glGetUniformLocation(this->KeyProgram, "uParticles"), 0);
+    glUseProgram(this->SortProgram);
+    glUniform1i(glGetUniformLocation(this->SortProgram, "uKeys"), 0);
+
+    // 2 texels per particle in the texture buffers
+    GLint MaxTextureBufferSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &MaxTextureBufferSize);
+    this->MaxParticleCount = Math::Min(MAX_PARTICLE_COUNT, MaxTextureBufferSize / 2);
+
+    glGenBuffers(2, this->Buffers);
+    glGenTextures(2, this->BufferTextures);
+    glGenVertexArrays(2, this->SimulationVAOs);
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindVertexArray(this->SimulationVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, this->Buffers[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_particle), (void*)OFFSETOF(gpu_particle, PositionAge));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(gpu_particle), (void*)OFFSETOF(gpu_particle, VelocityLifetime));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenVertexArrays(1, &this->EmptyVAO);
+    glGenTextures(2, this->SortTextures);
+    glGenFramebuffers(2, this->SortFBOs);
+
+    this->SetParticleCount(ParticleCount);
+}
+
+particle_system::~particle_system()
+{
+    glDeleteProgram(this->SimulationProgram);
+    glDeleteProgram(this->RenderProgram);
+    glDeleteProgram(this->KeyProgram);
+    glDeleteProgram(this->SortProgram);
+    glDeleteVertexArrays(2, this->SimulationVAOs);
+    glDeleteVertexArrays(1, &this->EmptyVAO);
+    glDeleteTextures(2, this->BufferTextures);
+    glDeleteBuffers(2, this->Buffers);
+    glDeleteFramebuffers(2, this->SortFBOs);
+    glDeleteTextures(2, this->SortTextures);
+    glDeleteTextures(1, &this->SceneDepthTexture);
+}
+
+void particle_system::SetParticleCount(int ParticleCount)
+{
+    this->ParticleCount = Math::Max(1, Math::Min(ParticleCount, this->MaxParticleCount));
+    this->EmitCursor = 0;
+    this->EmitRemainder = 0.f;
+
+    // Zeroed particles are dead
+    std::vector<gpu_particle> Particles(this->ParticleCount, gpu_particle{});
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->Buffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, Particles.size() * sizeof(gpu_particle), Particles.data(), GL_DYNAMIC_COPY);
+        glBindTexture(GL_TEXTURE_BUFFER, this->BufferTextures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->Buffers[i]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // Power of two key count, passes of the bitonic sort: log2(n) * (log2(n) + 1) / 2
+    this->SortWidth = Math::Min(NextPowerOfTwo(this->ParticleCount), MAX_SORT_WIDTH);
+    this->SortHeight = NextPowerOfTwo((this->ParticleCount + this->SortWidth - 1) / this->SortWidth);
+    int Log2 = 0;
+    while ((1 << Log2) < this->SortWidth * this->SortHeight)
+        ++Log2;
+    this->SortPassCount = Log2 * (Log2 + 1) / 2;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, this->SortTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, this->SortWidth, this->SortHeight, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->SortFBOs[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->SortTextures[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::printf("ERROR::FRAMEBUFFER:: Particle sort framebuffer is not complete!\n");
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void particle_system::CreateTargets(int Width, int Height)
+{
+    glDeleteTextures(1, &this->SceneDepthTexture);
+    this->Width = Width;
+    this->Height = Height;
+
+    glGenTextures(1, &this->SceneDepthTexture);
+    glBindTexture(GL_TEXTURE_2D, this->SceneDepthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, Width, Height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void particle_system::Update(float DeltaTime)
+{
+    double Milliseconds = 0.0;
+    int Tag = 0;
+    while (this->SimulationTimer.PopResult(&Milliseconds, &Tag))
+        this->SimulationTimeMs = Milliseconds;
+
+    // Whole particles to spawn this frame, the fraction is kept for the next ones
+    int EmitterCount = Math::Min((int)this->Emitters.size(), MAX_EMITTER_COUNT);
+    float Emitted = this->EmissionRate * DeltaTime + this->EmitRemainder;
+    int EmitCount = (int)Emitted;
+    this->EmitRemainder = Emitted - (float)EmitCount;
+    EmitCount = (EmitterCount > 0) ? Math::Min(EmitCount, this->ParticleCount) : 0;
+
+    // Kept small for the precision of the swirl
+    this->Time = std::fmod(this->Time + DeltaTime, 3600.f);
+
+    v4 EmitterPositions[MAX_EMITTER_COUNT] = {};
+    v4 EmitterVelocities[MAX_EMITTER_COUNT] = {};
+    for (int i = 0; i < EmitterCount; ++i)
+    {
+        const particle_emitter& Emitter = this->Emitters[i];
+        EmitterPositions[i] = { Emitter.Position.x, Emitter.Position.y, Emitter.Position.z, Emitter.Radius };
+        EmitterVelocities[i] = { Emitter.Velocity.x, Emitter.Velocity.y, Emitter.Velocity.z, Emitter.Spread };
+    }
+
+    GLuint Program = this->SimulationProgram;
+    glUseProgram(Program);
+    glUniform1f(glGetUniformLocation(Program, "uDeltaTime"), DeltaTime);
+    glUniform1f(glGetUniformLocation(Program, "uTime"), this->Time);
+    glUniform1i(glGetUniformLocation(Program, "uParticleCount"), this->ParticleCount);
+    glUniform1i(glGetUniformLocation(Program, "uEmitStart"), this->EmitCursor);
+    glUniform1i(glGetUniformLocation(Program, "uEmitCount"), EmitCount);
+    glUniform1i(glGetUniformLocation(Program, "uEmitterCount"), EmitterCount);
+    glUniform4fv(glGetUniformLocation(Program, "uEmitterPositions"), MAX_EMITTER_COUNT, EmitterPositions[0].e);
+    glUniform4fv(glGetUniformLocation(Program, "uEmitterVelocities"), MAX_EMITTER_COUNT, EmitterVelocities[0].e);
+    glUniform2f(glGetUniformLocation(Program, "uLifetime"), this->Lifetime.x, this->Lifetime.y);
+    glUniform3f(glGetUniformLocation(Program, "uAcceleration"), this->Acceleration.x, this->Acceleration.y, this->Acceleration.z);
+    glUniform1f(glGetUniformLocation(Program, "uDrag"), this->Drag);
+    glUniform1f(glGetUniformLocation(Program, "uTurbulence"), this->Turbulence);
+
+    // Read the current state, write the other buffer
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->Buffers[1 - this->Current]);
+    this->SimulationTimer.Begin();
+
+    glBindVertexArray(this->SimulationVAOs[this->Current]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, this->ParticleCount);
+    glEndTransformFeedback();
+    glBindVertexArray(0);
+
+    this->SimulationTimer.End();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    this->Current = 1 - this->Current;
+    this->EmitCursor = (this->EmitCursor + EmitCount) % this->ParticleCount;
+}
+
+void particle_system::Sort()
+{
+    double Milliseconds = 0.0;
+    int Tag = 0;
+    while (this->SortTimer.PopResult(&Milliseconds, &Tag))
+        this->SortTimeMs = Milliseconds;
+
+    this->SortTimer.Begin();
+    glViewport(0, 0, this->SortWidth, this->SortHeight);
+    glBindVertexArray(this->EmptyVAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Keys of the current state
+    glBindFramebuffer(GL_FRAMEBUFFER, this->SortFBOs[0]);
+    glUseProgram(this->KeyProgram);
+    glUniform1i(glGetUniformLocation(this->KeyProgram, "uParticleCount"), this->ParticleCount);
+    glUniform1i(glGetUniformLocation(this->KeyProgram, "uSortWidth"), this->SortWidth);
+    glBindTexture(GL_TEXTURE_BUFFER, this->BufferTextures[this->Current]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    // Bitonic merges, each pass reads the last result and writes the other texture
+    glUseProgram(this->SortProgram);
+    glUniform1i(glGetUniformLocation(this->SortProgram, "uSortWidth"), this->SortWidth);
+    GLint BlockSizeLocation = glGetUniformLocation(this->SortProgram, "uBlockSize");
+    GLint DistanceLocation = glGetUniformLocation(this->SortProgram, "uDistance");
+
+    int Source = 0;
+    int KeyCount = this->SortWidth * this->SortHeight;
+    for (int BlockSize = 2; BlockSize <= KeyCount; BlockSize <<= 1)
+    {
+        for (int Distance = BlockSize >> 1; Distance > 0; Distance >>= 1)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, this->SortFBOs[1 - Source]);
+            glBindTexture(GL_TEXTURE_2D, this->SortTextures[Source]);
+            glUniform1i(BlockSizeLocation, BlockSize);
+            glUniform1i(DistanceLocation, Distance);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            Source = 1 - Source;
+        }
+    }
+    this->SortResult = Source;
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, this->Width, this->Height);
+    this->SortTimer.End();
+}
+
+void particle_system::Render(int ViewportWidth, int ViewportHeight)
+{
+    if (ViewportWidth <= 0 || ViewportHeight <= 0)
+        return;
+
+    if (ViewportWidth != this->Width || ViewportHeight != this->Height)
+        this->CreateTargets(ViewportWidth, ViewportHeight);
+
+    double Milliseconds = 0.0;
+    int Tag = 0;
+    while (this->RenderTimer.PopResult(&Milliseconds, &Tag))
+        this->RenderTimeMs = Milliseconds;
+
+    GLboolean PrevDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    // Depth of the scene (the read buffer of the default framebuffer)
+    bool Soft = this->SoftDistance > 0.f;
+    if (Soft)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, this->SceneDepthTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, ViewportWidth, ViewportHeight);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    bool Sorted = this->Blend == PARTICLE_BLEND_ALPHA && this->SortBackToFront;
+    if (Sorted)
+        this->Sort();
+
+    this->RenderTimer.Begin();
+
+    // Tested against the scene, not written, premultiplied blending
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    GLuint Program = this->RenderProgram;
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uSorted"), Sorted);
+    glUniform1i(glGetUniformLocation(Program, "uSortWidth"), this->SortWidth);
+    glUniform2f(glGetUniformLocation(Program, "uSize"), this->Size.x, this->Size.y);
+    glUniform4fv(glGetUniformLocation(Program, "uStartColor"), 1, this->StartColor.e);
+    glUniform4fv(glGetUniformLocation(Program, "uEndColor"), 1, this->EndColor.e);
+    glUniform1f(glGetUniformLocation(Program, "uSoftDistance"), this->SoftDistance);
+    glUniform1i(glGetUniformLocation(Program, "uAdditive"), this->Blend == PARTICLE_BLEND_ADDITIVE);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, this->BufferTextures[this->Current]);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, this->SceneDepthTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, this->SortTextures[this->SortResult]);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(this->EmptyVAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, this->ParticleCount);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    if (!PrevDepthTest)
+        glDisable(GL_DEPTH_TEST);
+
+    this->RenderTimer.End();
+}
+
+void particle_system::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Particles"))
+    {
+        int Count = this->ParticleCount;
+        if (ImGui::SliderInt("Particle count", &Count, 1024, this->MaxParticleCount))
+            this->SetParticleCount(Count);
+        ImGui::SliderFloat("Emission rate (per second)", &this->EmissionRate, 0.f, 500000.f, "%.0f", 2.f);
+        ImGui::SliderFloat2("Lifetime (s)", this->Lifetime.e, 0.05f, 5.f);
+        ImGui::SliderFloat2("Size (birth, death)", this->Size.e, 0.001f, 0.2f);
+        ImGui::ColorEdit4("Start color", this->StartColor.e);
+        ImGui::ColorEdit4("End color", this->EndColor.e);
+        ImGui::SliderFloat3("Acceleration", this->Acceleration.e, -10.f, 10.f);
+        ImGui::SliderFloat("Drag", &this->Drag, 0.f, 10.f);
+        ImGui::SliderFloat("Turbulence", &this->Turbulence, 0.f, 5.f);
+        ImGui::SliderFloat("Soft distance", &this->SoftDistance, 0.f, 1.f);
+
+        int BlendMode = this->Blend;
+        const char* BlendModes[] = { "Additive", "Alpha" };
+        if (ImGui::Combo("Blend", &BlendMode, BlendModes, ARRAY_SIZE(BlendModes)))
+            this->Blend = (particle_blend)BlendMode;
+        if (this->Blend == PARTICLE_BLEND_ALPHA)
+            ImGui::Checkbox("Back to front (GPU bitonic sort)", &this->SortBackToFront);
+
+        ImGui::Text("Emitters: %d (max %d)", Math::Min((int)this->Emitters.size(), MAX_EMITTER_COUNT), MAX_EMITTER_COUNT);
+        ImGui::Text("GPU simulation: %.3f ms, draw: %.3f ms", this->SimulationTimeMs, this->RenderTimeMs);
+        if (this->Blend == PARTICLE_BLEND_ALPHA && this->SortBackToFront)
+            ImGui::Text("GPU sort: %.3f ms (%dx%d keys, %d passes)", this->SortTimeMs, this->SortWidth, this->SortHeight, this->SortPassCount);
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+
+#include "opengl_headers.h"
+#include "opengl_helpers_query.h"
+#include "maths.h"
+
+// Sphere emitting particles toward a direction
+struct particle_emitter
+{
+    v3 Position;
+    float Radius;   // Spawn sphere
+    v3 Velocity;    // Initial velocity
+    float Spread;   // Random velocity added in any direction
+};
+
+enum particle_blend
+{
+    PARTICLE_BLEND_ADDITIVE, // Order independent
+    PARTICLE_BLEND_ALPHA,    // Over operator, sorted back to front when SortBackToFront is set
+};
+
+// GPU particles: the state of every particle lives in two buffers, a vertex shader reads one and
+// writes the other by transform feedback (rasterizer disabled), spawning, integrating and aging
+// each particle. Spawning follows a cursor running through the particles: every frame the next
+// EmissionRate * DeltaTime particles after the cursor are respawned from the emitters, so the CPU
+// only sets a few uniforms whatever the particle count.
+//
+// Particles are drawn as camera-facing quads, one draw instance per particle read from a texture
+// buffer (dead ones are collapsed), faded where they get close to the scene depth (copied from the
+// default framebuffer). Alpha blended particles can be sorted back to front on the GPU: keys (squared
+// distance, index) are written to a power of two texture and ordered by bitonic sort fragment passes.
+class particle_system
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int MAX_PARTICLE_COUNT = 1 << 20;
+    static const int MAX_EMITTER_COUNT = 8;
+    static const int MAX_SORT_WIDTH = 1024; // Sort texture width, rows are added for more particles
+
+    std::vector<particle_emitter> Emitters;
+
+    float EmissionRate = 20000.f; // Particles per second
+    v2 Lifetime = { 1.f, 2.f };   // Random range in seconds
+    v2 Size = { 0.02f, 0.005f };  // Half size of the quad at birth and death
+    v4 StartColor = { 1.f, 0.6f, 0.15f, 1.f };
+    v4 EndColor = { 0.4f, 0.05f, 0.f, 0.f };
+    v3 Acceleration = { 0.f, 0.5f, 0.f };
+    float Drag = 1.f;             // Velocity damping per second
+    float Turbulence = 0.5f;      // Acceleration of the swirling field
+
+    particle_blend Blend = PARTICLE_BLEND_ADDITIVE;
+    bool SortBackToFront = true;
+
+    // Fade over this distance in front of the scene (view units, 0 disables)
+    float SoftDistance = 0.1f;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    particle_system(int ParticleCount);
+    ~particle_system();
+
+    particle_system(const particle_system&) = delete;
+    particle_system& operator=(const particle_system&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Reallocate the particles (all dead), clamped to what the texture buffer size allows
+    void SetParticleCount(int ParticleCount);
+    int GetParticleCount() const { return this->ParticleCount; }
+
+    // Spawn and integrate on the GPU
+    void Update(float DeltaTime);
+
+    // Draw after the opaque scene in the default framebuffer (frame constants set)
+    void Render(int ViewportWidth, int ViewportHeight);
+
+    // ImGui debug function (settings and GPU timings)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    void CreateTargets(int Width, int Height);
+
+    // Sort keys of the alive particles, the result is left in SortTextures[SortResult]
+    void Sort();
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    int ParticleCount = 0;
+    int MaxParticleCount = MAX_PARTICLE_COUNT;
+
+    // Ping-pong particle state (gpu_particle), Current holds the last simulated frame
+    GLuint Buffers[2] = {};
+    GLuint BufferTextures[2] = {}; // RGBA32F texture buffers on Buffers, 2 texels per particle
+    GLuint SimulationVAOs[2] = {};
+    int Current = 0;
+
+    // Spawn cursor
+    int EmitCursor = 0;
+    float EmitRemainder = 0.f;
+    float Time = 0.f;
+
+    GLuint SimulationProgram = 0;
+    GLuint RenderProgram = 0;
+    GLuint KeyProgram = 0;
+    GLuint SortProgram = 0;
+    GLuint EmptyVAO = 0;
+
+    // Bitonic sort targets, SortWidth x SortHeight (powers of two) RG32F keys
+    GLuint SortTextures[2] = {};
+    GLuint SortFBOs[2] = {};
+    int SortWidth = 0;
+    int SortHeight = 0;
+    int SortResult = 0;
+    int SortPassCount = 0;
+
+    // Copy of the default framebuffer depth
+    GLuint SceneDepthTexture = 0;
+    int Width = 0;
+    int Height = 0;
+
+    GL::gpu_timer SimulationTimer;
+    GL::gpu_timer SortTimer;
+    GL::gpu_timer RenderTimer;
+    double SimulationTimeMs = 0.0;
+    double SortTimeMs = 0.0;
+    double RenderTimeMs = 0.0;
+};
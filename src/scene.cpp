@@ -4,6 +4,7 @@
 #include "platform.h"
 
 #include "color.h"
+#include "maths_frustum.h"
 
 #include "scene.h"
 
@@ -12,12 +13,16 @@ scene::~scene()
 {
     glDeleteBuffers(1, &LightsUniformBuffer);
     glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &PositionVAO);
 }
 
 void scene::CreateMesh(GL::cache& GLCache, const char* filepath)
 {
     // Use vbo from GLCache
-    MeshBuffer = GLCache.LoadObj(filepath, 1.f, &this->MeshVertexCount);
+    MeshBuffer = GLCache.LoadObj(filepath, 1.f, &this->MeshVertexCount, &this->MeshPositionBuffer);
+    GLCache.GetObjBounds(filepath, &MeshBoundsMin, &MeshBoundsMax);
+    if (const std::vector<mesh_chunk>* Chunks = GLCache.GetObjChunks(filepath))
+        MeshChunks = *Chunks;
 
     MeshDesc.Stride = sizeof(vertex_full);
     MeshDesc.HasNormal = true;
@@ -28,6 +33,14 @@ void scene::CreateMesh(GL::cache& GLCache, const char* filepath)
 
     MeshDesc.TangentOffset = OFFSETOF(vertex_full, Tangents);
     MeshDesc.BitangentOffset = OFFSETOF(vertex_full, Bitangents);
+
+    // Position only VAO
+    glGenVertexArrays(1, &PositionVAO);
+    glBindVertexArray(PositionVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, MeshPositionBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(v3), (void*)0);
+    glBindVertexArray(0);
 }
 
 static bool EditLight(GL::light* Light)
@@ -80,6 +93,7 @@ void scene::InspectLights()
 {
     if (ImGui::TreeNodeEx("Lights"))
     {
+        bool LightsChanged = false;
         for (int i = 0; i < LightCount; ++i)
         {
             if (ImGui::TreeNode(&Lights[i], "Light[%d]", i))
@@ -88,7 +102,7 @@ void scene::InspectLights()
                 if (EditLight(&Light))
                 {
                     Light.ShadowGenerated = false;
-                    glBufferSubData(GL_UNIFORM_BUFFER, i * sizeof(GL::light), sizeof(GL::light), &Light);
+                    LightsChanged = true;
                 }
 
                 // Calculate attenuation based on the light values
@@ -104,10 +118,22 @@ void scene::InspectLights()
                 ImGui::TreePop();
             }
         }
+
+        if (LightsChanged)
+            UploadLights();
+
         ImGui::TreePop();
     }
 }
 
+void scene::UploadLights()
+{
+    // Whole buffer respecified (orphaned) rather than patched, an edit never waits for the frames still reading it
+    glBindBuffer(GL_UNIFORM_BUFFER, LightsUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, LightCount * sizeof(GL::light), Lights.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 void scene::GenerateVAO()
 {
     glGenVertexArrays(1, &VAO);
@@ -138,4 +164,76 @@ void scene::DrawScene(GLenum mode)
 {
     glBindVertexArray(VAO);
     glDrawArrays(mode, 0, MeshVertexCount);
-}
\ No newline at end of file
+}
+
+void scene::DrawScenePositions(GLenum mode)
+{
+    glBindVertexArray(PositionVAO);
+    glDrawArrays(mode, 0, MeshVertexCount);
+}
+
+static bool SphereIntersectsAABB(const v3& Center, float Radius, const v3& Min, const v3& Max)
+{
+    float SquaredDistance = 0.f;
+    for (int i = 0; i < 3; ++i)
+    {
+        float Closest = Math::Clamp(Center.e[i], Min.e[i], Max.e[i]);
+        SquaredDistance += (Center.e[i] - Closest) * (Center.e[i] - Closest);
+    }
+    return SquaredDistance <= Radius * Radius;
+}
+
+void scene::CullChunks(const mat4* ViewProjections, int ViewCount, const v3& SphereCenter, float SphereRadius, std::vector<uint8_t>& ViewMasks) const
+{
+    frustum Frustums[8];
+    ViewCount = Math::Min(ViewCount, (int)ARRAY_SIZE(Frustums));
+    for (int View = 0; View < ViewCount; ++View)
+        Frustums[View] = Frustum::FromMatrix(ViewProjections[View]);
+
+    ViewMasks.resize(MeshChunks.size());
+    for (size_t i = 0; i < MeshChunks.size(); ++i)
+    {
+        const mesh_chunk& Chunk = MeshChunks[i];
+
+        uint8_t Mask = 0;
+        if (SphereRadius <= 0.f || SphereIntersectsAABB(SphereCenter, SphereRadius, Chunk.BoundsMin, Chunk.BoundsMax))
+        {
+            for (int View = 0; View < ViewCount; ++View)
+            {
+                if (Frustum::TestAABB(Frustums[View], Chunk.BoundsMin, Chunk.BoundsMax))
+                    Mask |= (uint8_t)(1 << View);
+            }
+        }
+        ViewMasks[i] = Mask;
+    }
+}
+
+int scene::DrawChunksPositions(const std::vector<uint8_t>& ViewMasks, int View)
+{
+    RunFirsts.clear();
+    RunCounts.clear();
+
+    int VertexCount = 0;
+    for (size_t i = 0; i < MeshChunks.size(); ++i)
+    {
+        if (!(ViewMasks[i] & (1 << View)))
+            continue;
+
+        const mesh_chunk& Chunk = MeshChunks[i];
+        if (!RunFirsts.empty() && RunFirsts.back() + RunCounts.back() == Chunk.FirstVertex)
+            RunCounts.back() += Chunk.VertexCount;
+        else
+        {
+            RunFirsts.push_back(Chunk.FirstVertex);
+            RunCounts.push_back(Chunk.VertexCount);
+        }
+        VertexCount += Chunk.VertexCount;
+    }
+
+    if (!RunFirsts.empty())
+    {
+        glBindVertexArray(PositionVAO);
+        glMultiDrawArrays(GL_TRIANGLES, RunFirsts.data(), RunCounts.data(), (GLsizei)RunFirsts.size());
+    }
+    return VertexCount;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "opengl_helpers.h"
@@ -43,6 +44,16 @@ public:
 
     vertex_descriptor MeshDesc;
 
+    // Bounding box of the mesh positions, and of its chunks of consecutive triangles
+    v3 MeshBoundsMin = {};
+    v3 MeshBoundsMax = {};
+    std::vector<mesh_chunk> MeshChunks;
+
+    // Tightly packed positions (v3) of the same vertices, and a VAO with only this stream on attribute 0.
+    // Used by the depth, shadow and wireframe passes which do not need the other attributes.
+    GLuint MeshPositionBuffer = 0;
+    GLuint PositionVAO = 0;
+
     // Lights buffer
     GLuint LightsUniformBuffer = 0;
     int LightCount = 8;
@@ -61,8 +72,19 @@ public:
 
     // ImGui debug function to edit lights
     void InspectLights();
+    // Send the CPU copy of the lights to LightsUniformBuffer
+    void UploadLights();
     void GenerateVAO();
     void DrawScene(GLenum mode = GL_TRIANGLES);
+    // Draw with PositionVAO (position only programs)
+    void DrawScenePositions(GLenum mode = GL_TRIANGLES);
+
+    // Visibility of each chunk in up to 8 views (bit i for ViewProjections[i]), chunks outside
+    // the sphere are culled from every view (no sphere test when SphereRadius <= 0)
+    void CullChunks(const mat4* ViewProjections, int ViewCount, const v3& SphereCenter, float SphereRadius, std::vector<uint8_t>& ViewMasks) const;
+
+    // Draw with PositionVAO the chunks visible in View (merged in runs of consecutive chunks), returns the vertex count drawn
+    int DrawChunksPositions(const std::vector<uint8_t>& ViewMasks, int View);
 
     GL::light* GetLight(const int& i)
     {
@@ -70,4 +92,13 @@ public:
 
         return &Lights[i];
     }
+
+private:
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    // Runs of chunks drawn by DrawChunksPositions
+    std::vector<GLint> RunFirsts;
+    std::vector<GLsizei> RunCounts;
 };
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "jobs.h"
+
+#include "scene_graph.h"
+
+scene_node scene_graph::CreateNode(scene_node Parent, const transform& Local)
+{
+    int ParentPosition = -1;
+    if (Parent != SCENE_NODE_NONE)
+    {
+        if (!IsValid(Parent))
+        {
+            fprintf(stderr, "Scene graph: invalid parent node %d\n", Parent);
+            return SCENE_NODE_NONE;
+        }
+        ParentPosition = Positions[Parent];
+    }
+
+    scene_node Node;
+    if (FreeNodes.empty())
+    {
+        Node = (scene_node)Positions.size();
+        Positions.push_back(-1);
+    }
+    else
+    {
+        Node = FreeNodes.back();
+        FreeNodes.pop_back();
+    }
+
+    int Position = (int)Nodes.size();
+    Positions[Node] = Position;
+    Nodes.push_back(Node);
+    LocalRotations.push_back(Local.Rotation);
+    LocalTranslations.push_back(Local.Translation);
+    LocalScales.push_back(Local.Scale);
+    WorldMatrices.push_back(Mat4::Identity());
+    Parents.push_back(ParentPosition);
+    SubtreeEnds.push_back(Position + 1);
+    Dirty.push_back(1);
+
+    // Appending keeps the depth-first order when the parent subtree is the last one
+    // (its ancestors then end at the same position and grow with it)
+    if (ParentPosition != -1 && !NeedsSort)
+    {
+        if (SubtreeEnds[ParentPosition] == Position)
+        {
+            for (int p = ParentPosition; p != -1; p = Parents[p])
+                SubtreeEnds[p] = Position + 1;
+        }
+        else
+        {
+            NeedsSort = true;
+        }
+    }
+
+    return Node;
+}
+
+void scene_graph::DestroyNode(scene_node Node)
+{
+    if (!IsValid(Node))
+        return;
+
+    // The subtree must be a contiguous range
+    if (NeedsSort)
+        Sort();
+
+    int Begin = Positions[Node];
+    int End = SubtreeEnds[Begin];
+    int Removed = End - Begin;
+
+    for (int i = Begin; i < End; ++i)
+    {
+        Positions[Nodes[i]] = -1;
+        FreeNodes.push_back(Nodes[i]);
+    }
+
+    LocalRotations.erase(LocalRotations.begin() + Begin, LocalRotations.begin() + End);
+    LocalTranslations.erase(LocalTranslations.begin() + Begin, LocalTranslations.begin() + End);
+    LocalScales.erase(LocalScales.begin() + Begin, LocalScales.begin() + End);
+    WorldMatrices.erase(WorldMatrices.begin() + Begin, WorldMatrices.begin() + End);
+    Parents.erase(Parents.begin() + Begin, Parents.begin() + End);
+    SubtreeEnds.erase(SubtreeEnds.begin() + Begin, SubtreeEnds.begin() + End);
+    Dirty.erase(Dirty.begin() + Begin, Dirty.begin() + End);
+    Nodes.erase(Nodes.begin() + Begin, Nodes.begin() + End);
+
+    // Shift the positions after the removed range (ancestors of Node end after it too)
+    for (int i = 0; i < (int)Nodes.size(); ++i)
+    {
+        if (Parents[i] >= End)
+            Parents[i] -= Removed;
+        if (SubtreeEnds[i] >= End)
+            SubtreeEnds[i] -= Removed;
+    }
+    for (int i = Begin; i < (int)Nodes.size(); ++i)
+        Positions[Nodes[i]] = i;
+}
+
+void scene_graph::Clear()
+{
+    LocalRotations.clear();
+    LocalTranslations.clear();
+    LocalScales.clear();
+    WorldMatrices.clear();
+    Parents.clear();
+    SubtreeEnds.clear();
+    Dirty.clear();
+    Nodes.clear();
+    Positions.clear();
+    FreeNodes.clear();
+    NeedsSort = false;
+}
+
+bool scene_graph::SetParent(scene_node Node, scene_node Parent)
+{
+    if (!IsValid(Node) || (Parent != SCENE_NODE_NONE && !IsValid(Parent)))
+        return false;
+
+    int Position = Positions[Node];
+    int ParentPosition = Parent == SCENE_NODE_NONE ? -1 : Positions[Parent];
+
+    // Walk up from the new parent, reaching Node would create a cycle
+    for (int p = ParentPosition; p != -1; p = Parents[p])
+    {
+        if (p == Position)
+        {
+            fprintf(stderr, "Scene graph: node %d cannot be parented to itself or its descendant %d\n", Node, Parent);
+            return false;
+        }
+    }
+
+    if (Parents[Position] == ParentPosition)
+        return true;
+
+    Dirty[Position] = 1;
+    if (NeedsSort)
+    {
+        // Already waiting for a full sort, which handles any number of changes at once
+        Parents[Position] = ParentPosition;
+        return true;
+    }
+
+    MoveSubtree(Position, ParentPosition);
+    return true;
+}
+
+void scene_graph::MoveSubtree(int Position, int ParentPosition)
+{
+    // The subtree moves at the end of its new parent subtree (or of the array for a root):
+    // only the range between the old and new places is rotated, the other nodes keep their position
+    int Begin = Position;
+    int End = SubtreeEnds[Position];
+    int Size = End - Begin;
+    int Target = ParentPosition == -1 ? (int)Nodes.size() : SubtreeEnds[ParentPosition];
+
+    int First, Middle, Last;
+    if (Target >= End)
+    {
+        First = Begin; Middle = End; Last = Target;
+    }
+    else
+    {
+        First = Target; Middle = Begin; Last = End;
+    }
+
+    // Nodes after the range whose parent is inside it: the following siblings of the ancestors of Last
+    MovedChildren.clear();
+    int Sibling = Last;
+    for (int p = Last < (int)Nodes.size() ? Parents[Last] : -1; p >= First; p = Parents[p])
+    {
+        for (int c = Sibling; c < SubtreeEnds[p]; c = SubtreeEnds[c])
+            MovedChildren.push_back(c);
+        Sibling = SubtreeEnds[p];
+    }
+
+    // Ancestors before the range: the old ones lose the subtree and the new ones gain it
+    // (both for the common ones, which keep their end like every other node before the range)
+    for (int p = Parents[Position]; p != -1; p = Parents[p])
+    {
+        if (p < First)
+            SubtreeEnds[p] -= Size;
+    }
+    for (int p = ParentPosition; p != -1; p = Parents[p])
+    {
+        if (p < First)
+            SubtreeEnds[p] += Size;
+    }
+
+    Parents[Position] = ParentPosition;
+    std::rotate(LocalRotations.begin() + First, LocalRotations.begin() + Middle, LocalRotations.begin() + Last);
+    std::rotate(LocalTranslations.begin() + First, LocalTranslations.begin() + Middle, LocalTranslations.begin() + Last);
+    std::rotate(LocalScales.begin() + First, LocalScales.begin() + Middle, LocalScales.begin() + Last);
+    std::rotate(WorldMatrices.begin() + First, WorldMatrices.begin() + Middle, WorldMatrices.begin() + Last);
+    std::rotate(Parents.begin() + First, Parents.begin() + Middle, Parents.begin() + Last);
+    std::rotate(Dirty.begin() + First, Dirty.begin() + Middle, Dirty.begin() + Last);
+    std::rotate(Nodes.begin() + First, Nodes.begin() + Middle, Nodes.begin() + Last);
+
+    // [First, Middle) and [Middle, Last) swapped places, only parents inside the range need to follow
+    auto Remap = [=](int& Parent) {
+        if (Parent >= First && Parent < Last)
+            Parent += Parent < Middle ? Last - Middle : First - Middle;
+    };
+    for (int i = First; i < Last; ++i)
+    {
+        Remap(Parents[i]);
+        Positions[Nodes[i]] = i;
+    }
+    for (int Child : MovedChildren)
+        Remap(Parents[Child]);
+
+    // Subtree ends inside the range, children after it first then backward like ComputeSubtreeEnds()
+    for (int i = First; i < Last; ++i)
+        SubtreeEnds[i] = i + 1;
+    for (int Child : MovedChildren)
+        SubtreeEnds[Parents[Child]] = Math::Max(SubtreeEnds[Parents[Child]], SubtreeEnds[Child]);
+    for (int i = Last - 1; i >= First; --i)
+    {
+        if (Parents[i] >= First)
+            SubtreeEnds[Parents[i]] = Math::Max(SubtreeEnds[Parents[i]], SubtreeEnds[i]);
+    }
+}
+
+scene_node scene_graph::GetParent(scene_node Node) const
+{
+    int ParentPosition = Parents[Positions[Node]];
+    return ParentPosition == -1 ? SCENE_NODE_NONE : Nodes[ParentPosition];
+}
+
+void scene_graph::SetLocalTransform(scene_node Node, const transform& Local)
+{
+    int Position = Positions[Node];
+    LocalRotations[Position] = Local.Rotation;
+    LocalTranslations[Position] = Local.Translation;
+    LocalScales[Position] = Local.Scale;
+    Dirty[Position] = 1;
+}
+
+void scene_graph::SetLocalTranslation(scene_node Node, v3 Translation)
+{
+    int Position = Positions[Node];
+    LocalTranslations[Position] = Translation;
+    Dirty[Position] = 1;
+}
+
+void scene_graph::SetLocalRotation(scene_node Node, const quat& Rotation)
+{
+    int Position = Positions[Node];
+    LocalRotations[Position] = Rotation;
+    Dirty[Position] = 1;
+}
+
+transform scene_graph::GetLocalTransform(scene_node Node) const
+{
+    int Position = Positions[Node];
+    return { LocalRotations[Position], LocalTranslations[Position], LocalScales[Position] };
+}
+
+void scene_graph::Sort()
+{
+    int Count = (int)Nodes.size();
+
+    // Children lists (CSR), siblings keep their current relative order
+    std::vector<int> FirstChild(Count + 1, 0);
+    for (int i = 0; i < Count; ++i)
+    {
+        if (Parents[i] != -1)
+            FirstChild[Parents[i] + 1]++;
+    }
+    for (int i = 0; i < Count; ++i)
+        FirstChild[i + 1] += FirstChild[i];
+
+    std::vector<int> Children(FirstChild[Count]);
+    std::vector<int> Fill(FirstChild.begin(), FirstChild.end() - 1);
+    for (int i = 0; i < Count; ++i)
+    {
+        if (Parents[i] != -1)
+            Children[Fill[Parents[i]]++] = i;
+    }
+
+    // Depth-first walk from every root, Order[NewPosition] = OldPosition
+    std::vector<int> Order;
+    Order.reserve(Count);
+    std::vector<int> Stack;
+    for (int Root = 0; Root < Count; ++Root)
+    {
+        if (Parents[Root] != -1)
+            continue;
+
+        Stack.push_back(Root);
+        while (!Stack.empty())
+        {
+            int Old = Stack.back();
+            Stack.pop_back();
+            Order.push_back(Old);
+            for (int c = FirstChild[Old + 1] - 1; c >= FirstChild[Old]; --c)
+                Stack.push_back(Children[c]);
+        }
+    }
+
+    std::vector<int> NewPositions(Count);
+    for (int i = 0; i < Count; ++i)
+        NewPositions[Order[i]] = i;
+
+    std::vector<quat> SortedRotations(Count);
+    std::vector<v3> SortedTranslations(Count);
+    std::vector<v3> SortedScales(Count);
+    std::vector<mat4> SortedWorldMatrices(Count);
+    std::vector<int> SortedParents(Count);
+    std::vector<uint8_t> SortedDirty(Count);
+    std::vector<scene_node> SortedNodes(Count);
+    for (int i = 0; i < Count; ++i)
+    {
+        int Old = Order[i];
+        SortedRotations[i] = LocalRotations[Old];
+        SortedTranslations[i] = LocalTranslations[Old];
+        SortedScales[i] = LocalScales[Old];
+        SortedWorldMatrices[i] = WorldMatrices[Old];
+        SortedParents[i] = Parents[Old] == -1 ? -1 : NewPositions[Parents[Old]];
+        SortedDirty[i] = Dirty[Old];
+        SortedNodes[i] = Nodes[Old];
+        Positions[Nodes[Old]] = i;
+    }
+
+    LocalRotations.swap(SortedRotations);
+    LocalTranslations.swap(SortedTranslations);
+    LocalScales.swap(SortedScales);
+    WorldMatrices.swap(SortedWorldMatrices);
+    Parents.swap(SortedParents);
+    Dirty.swap(SortedDirty);
+    Nodes.swap(SortedNodes);
+
+    ComputeSubtreeEnds();
+    NeedsSort = false;
+}
+
+void scene_graph::ComputeSubtreeEnds()
+{
+    // Children come after their parent, so a backward pass sees every subtree end before its parent
+    int Count = (int)Nodes.size();
+    for (int i = 0; i < Count; ++i)
+        SubtreeEnds[i] = i + 1;
+    for (int i = Count - 1; i >= 0; --i)
+    {
+        if (Parents[i] != -1)
+            SubtreeEnds[Parents[i]] = Math::Max(SubtreeEnds[Parents[i]], SubtreeEnds[i]);
+    }
+}
+
+void scene_graph::UpdateRange(int Begin, int End)
+{
+    for (int i = Begin; i < End; ++i)
+    {
+        // Columns of Transform::ToMat4(Local), the parent multiplies them directly
+        // (the last row of a TRS matrix is known, so no generic mat4 product)
+        mat3 R = Quat::ToMat3(LocalRotations[i]);
+        v3 S = LocalScales[i];
+        v4 Columns[4] = {
+            { R.c[0].x * S.x, R.c[0].y * S.x, R.c[0].z * S.x, 0.f },
+            { R.c[1].x * S.y, R.c[1].y * S.y, R.c[1].z * S.y, 0.f },
+            { R.c[2].x * S.z, R.c[2].y * S.z, R.c[2].z * S.z, 0.f },
+            Vec4::vec4(LocalTranslations[i], 1.f),
+        };
+
+        mat4& World = WorldMatrices[i];
+        int Parent = Parents[i];
+        if (Parent == -1)
+        {
+            for (int c = 0; c < 4; ++c)
+                World.c[c] = Columns[c];
+        }
+        else
+        {
+            const mat4& ParentWorld = WorldMatrices[Parent];
+            for (int c = 0; c < 4; ++c)
+                World.c[c] = ParentWorld * Columns[c];
+        }
+        Dirty[i] = 0;
+    }
+}
+
+// Cut a dirty subtree in ranges of about TargetSize nodes that can be updated independently.
+// A range that is too big gets its root updated now and its children subtrees split in turn;
+// consecutive small ranges are merged (their parents are outside or before them).
+void scene_graph::SplitRange(int Begin, int End, int TargetSize)
+{
+    // Explicit stack (deep hierarchies), children popped in depth-first order
+    std::vector<int> Stack = { Begin, End };
+    while (!Stack.empty())
+    {
+        End = Stack.back(); Stack.pop_back();
+        Begin = Stack.back(); Stack.pop_back();
+
+        if (End - Begin > TargetSize)
+        {
+            UpdateRange(Begin, Begin + 1);
+
+            size_t First = Stack.size();
+            for (int Child = Begin + 1; Child < End; Child = SubtreeEnds[Child])
+            {
+                Stack.push_back(Child);
+                Stack.push_back(SubtreeEnds[Child]);
+            }
+
+            // Reverse the (Begin, End) pairs pushed above
+            for (size_t i = First, j = Stack.size() - 2; i < j; i += 2, j -= 2)
+            {
+                std::swap(Stack[i], Stack[j]);
+                std::swap(Stack[i + 1], Stack[j + 1]);
+            }
+            continue;
+        }
+
+        if (!Chunks.empty() && Chunks.back() == Begin && End - Chunks[Chunks.size() - 2] <= TargetSize)
+        {
+            Chunks.back() = End;
+        }
+        else
+        {
+            Chunks.push_back(Begin);
+            Chunks.push_back(End);
+        }
+    }
+}
+
+void scene_graph::Update()
+{
+    if (NeedsSort)
+        Sort();
+
+    int Count = (int)Nodes.size();
+
+    // Roots of the dirty subtrees, each one covers its whole range
+    Chunks.clear();
+    int DirtyCount = 0;
+    for (int i = 0; i < Count;)
+    {
+        const uint8_t* Next = (const uint8_t*)memchr(&Dirty[i], 1, Count - i);
+        if (Next == nullptr)
+            break;
+
+        i = (int)(Next - Dirty.data());
+        Chunks.push_back(i);
+        Chunks.push_back(SubtreeEnds[i]);
+        DirtyCount += SubtreeEnds[i] - i;
+        i = SubtreeEnds[i];
+    }
+
+    int WorkerCount = Jobs::GetWorkerCount();
+    if (DirtyCount < ParallelThreshold || WorkerCount == 0)
+    {
+        for (size_t c = 0; c < Chunks.size(); c += 2)
+            UpdateRange(Chunks[c], Chunks[c + 1]);
+        return;
+    }
+
+    // A few chunks per thread so that uneven subtrees still balance
+    int TargetSize = Math::Max(1024, DirtyCount / ((WorkerCount + 1) * 4));
+    std::vector<int> Roots;
+    Roots.swap(Chunks);
+    for (size_t r = 0; r < Roots.size(); r += 2)
+        SplitRange(Roots[r], Roots[r + 1], TargetSize);
+
+    Jobs::ParallelFor((int)Chunks.size() / 2, 1, [this](int Begin, int End) {
+        for (int c = Begin; c < End; ++c)
+            UpdateRange(Chunks[2 * c], Chunks[2 * c + 1]);
+    });
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "maths.h"
+
+// Stable node handle (survives reparenting and the destruction of other nodes)
+typedef int scene_node;
+const scene_node SCENE_NODE_NONE = -1;
+
+// Transform hierarchy stored as flat arrays (SoA) in depth-first order:
+// every parent comes before its children and each subtree is a contiguous range.
+// Setting a local transform only flags the node, Update() recomputes the world
+// matrices of the flagged subtrees, spreading large updates over the worker threads.
+class scene_graph
+{
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    // Restore the depth-first order after out of order creations
+    void Sort();
+    void ComputeSubtreeEnds();
+    void MoveSubtree(int Position, int ParentPosition);
+    void UpdateRange(int Begin, int End);
+    void SplitRange(int Begin, int End, int TargetSize);
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    // Per node, indexed by storage position
+    std::vector<quat> LocalRotations;
+    std::vector<v3> LocalTranslations;
+    std::vector<v3> LocalScales;
+    std::vector<mat4> WorldMatrices;
+    std::vector<int> Parents;       // Storage position of the parent, -1 for roots
+    std::vector<int> SubtreeEnds;   // One past the last descendant
+    std::vector<uint8_t> Dirty;
+    std::vector<scene_node> Nodes;  // Handle of each position
+
+    // Per handle
+    std::vector<int> Positions;     // -1 when free
+    std::vector<scene_node> FreeNodes;
+
+    bool NeedsSort = false;
+
+    // Update() scratch: [Begin, End) ranges given to the worker threads
+    std::vector<int> Chunks;
+
+    // SetParent() scratch: nodes after the moved range whose parent is inside it
+    std::vector<int> MovedChildren;
+
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    // Dirty node count from which Update() uses the worker threads
+    int ParallelThreshold = 8192;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    scene_node CreateNode(scene_node Parent = SCENE_NODE_NONE, const transform& Local = Transform::Identity());
+    // Also destroys the children
+    void DestroyNode(scene_node Node);
+    void Clear();
+
+    // Fails (returns false) when Parent is inside the subtree of Node.
+    // The cost is the number of nodes between the old and new places of the subtree
+    bool SetParent(scene_node Node, scene_node Parent);
+    scene_node GetParent(scene_node Node) const;
+
+    void SetLocalTransform(scene_node Node, const transform& Local);
+    void SetLocalTranslation(scene_node Node, v3 Translation);
+    void SetLocalRotation(scene_node Node, const quat& Rotation);
+    transform GetLocalTransform(scene_node Node) const;
+
+    // Up to date after Update()
+    const mat4& GetWorldMatrix(scene_node Node) const { return WorldMatrices[Positions[Node]]; }
+
+    // Recompute the world matrices of the changed subtrees, parents first
+    void Update();
+
+    bool IsValid(scene_node Node) const { return Node >= 0 && Node < (int)Positions.size() && Positions[Node] >= 0; }
+    int GetNodeCount() const { return (int)Nodes.size(); }
+
+    // Storage order access (depth-first after Update()), e.g. to fill instance buffers
+    const mat4* GetWorldMatrices() const { return WorldMatrices.data(); }
+    scene_node GetNodeAt(int Position) const { return Nodes[Position]; }
+};
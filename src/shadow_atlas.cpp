@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <imgui.h>
+
+#include "platform.h"
+#include "maths_frustum.h"
+#include "opengl_helpers_extensions.h"
+
+#include "shadow_atlas.h"
+
+shadow_atlas::shadow_atlas()
+{
+    this->CreateLayer(&this->Texture, &this->FBO);
+    this->CreateLayer(&this->StaticTexture, &this->StaticFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    this->ResetQuadtree();
+
+    glGenBuffers(1, &this->UniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(this->Tiles), this->Tiles, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The texture itself keeps plain depth sampling (debug display)
+    glGenSamplers(1, &this->CompareSampler);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glSamplerParameteri(this->CompareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenSamplers(1, &this->DepthSampler);
+    glSamplerParameteri(this->DepthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(this->DepthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(this->DepthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(this->DepthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void shadow_atlas::CreateLayer(GLuint* LayerTexture, GLuint* LayerFBO)
+{
+    glGenTextures(1, LayerTexture);
+    glBindTexture(GL_TEXTURE_2D, *LayerTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, LayerFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, *LayerFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, *LayerTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::printf("ERROR::FRAMEBUFFER:: Shadow atlas framebuffer is not complete!\n");
+
+    // Clear once, tiles are then cleared when rendered
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+shadow_atlas::~shadow_atlas()
+{
+    glDeleteBuffers(1, &this->UniformBuffer);
+    glDeleteSamplers(1, &this->CompareSampler);
+    glDeleteSamplers(1, &this->DepthSampler);
+    glDeleteFramebuffers(1, &this->FBO);
+    glDeleteTextures(1, &this->Texture);
+    glDeleteFramebuffers(1, &this->StaticFBO);
+    glDeleteTextures(1, &this->StaticTexture);
+}
+
+int shadow_atlas::ComputeTileSize(const GL::light& Light, const mat4& ViewMatrix, const mat4& ProjectionMatrix, int PreviousSize) const
+{
+    if (Light.Type == LIGHT_DIRECTIONNAL)
+        return this->MaxTileSize;
+
+    float Range = GL::GetLightRange(Light, this->LightCutoff);
+    if (Range < 0.f)
+        return this->MaxTileSize;
+
+    // Off screen lights keep the smallest tile (their shadows can still fall in view)
+    frustum ViewFrustum = Frustum::FromMatrix(ProjectionMatrix * ViewMatrix);
+    if (!Frustum::TestSphere(ViewFrustum, Light.Position, Range))
+        return MIN_TILE_SIZE;
+
+    v4 ViewPosition = ViewMatrix * Vec4::vec4(Light.Position, 1.f);
+    float SquaredDistance = Vec3::SquaredLength(ViewPosition.xyz);
+    if (SquaredDistance <= Range * Range)
+        return this->MaxTileSize;
+
+    // Projected sphere radius over the screen half height
+    float Coverage = Math::Min(Range * ProjectionMatrix.c[1].y / Math::Sqrt(SquaredDistance - Range * Range), 1.f);
+    float Target = Coverage * (float)this->MaxTileSize;
+
+    // Keep the previous size while the target stays around its range (Size / 2, Size]
+    if (PreviousSize >= MIN_TILE_SIZE && PreviousSize <= this->MaxTileSize
+        && Target > 0.5f * (float)PreviousSize * (1.f - this->SizeHysteresis)
+        && Target <= (float)PreviousSize * (1.f + this->SizeHysteresis))
+        return PreviousSize;
+
+    int Size = MIN_TILE_SIZE;
+    while (Size < this->MaxTileSize && (float)Size < Target)
+        Size *= 2;
+    return Size;
+}
+
+void shadow_atlas::ResetQuadtree()
+{
+    for (std::vector<tile_rect>& Nodes : this->FreeNodes)
+        Nodes.clear();
+    this->FreeNodes[0].push_back({ 0, 0, ATLAS_SIZE });
+}
+
+bool shadow_atlas::AllocateNode(int Level, tile_rect* Rect)
+{
+    std::vector<tile_rect>& Nodes = this->FreeNodes[Level];
+    if (!Nodes.empty())
+    {
+        *Rect = Nodes.back();
+        Nodes.pop_back();
+        return true;
+    }
+
+    // Split a node of the level above: first child is used, the three others become free
+    tile_rect Parent;
+    if (Level == 0 || !this->AllocateNode(Level - 1, &Parent))
+        return false;
+
+    int Half = Parent.Size / 2;
+    Nodes.push_back({ Parent.X + Half, Parent.Y + Half, Half });
+    Nodes.push_back({ Parent.X,        Parent.Y + Half, Half });
+    Nodes.push_back({ Parent.X + Half, Parent.Y,        Half });
+    *Rect = { Parent.X, Parent.Y, Half };
+    return true;
+}
+
+void shadow_atlas::FreeNode(tile_rect Rect)
+{
+    // Merged with the three other children of its parent when they are free too
+    for (int Level = this->GetLevel(Rect.Size); Level > 0; --Level)
+    {
+        std::vector<tile_rect>& Nodes = this->FreeNodes[Level];
+        int ParentSize = Rect.Size * 2;
+        int ParentX = Rect.X - Rect.X % ParentSize;
+        int ParentY = Rect.Y - Rect.Y % ParentSize;
+
+        int Siblings[3];
+        int SiblingCount = 0;
+        for (int i = 0; i < (int)Nodes.size() && SiblingCount < 3; ++i)
+        {
+            if (Nodes[i].X - Nodes[i].X % ParentSize == ParentX && Nodes[i].Y - Nodes[i].Y % ParentSize == ParentY)
+                Siblings[SiblingCount++] = i;
+        }
+        if (SiblingCount < 3)
+            break;
+
+        // Highest index first, the swapped last node is never one of the others
+        for (int i = 2; i >= 0; --i)
+        {
+            Nodes[Siblings[i]] = Nodes.back();
+            Nodes.pop_back();
+        }
+        Rect = { ParentX, ParentY, ParentSize };
+    }
+
+    this->FreeNodes[this->GetLevel(Rect.Size)].push_back(Rect);
+}
+
+int shadow_atlas::GetLevel(int Size) const
+{
+    int Level = 0;
+    while ((ATLAS_SIZE >> Level) > Size && Level < LEVEL_COUNT - 1)
+        ++Level;
+    return Level;
+}
+
+void shadow_atlas::Allocate(const GL::light* Lights, int LightCount, const mat4& ViewMatrix, const mat4& ProjectionMatrix)
+{
+    // Requested sizes, 0 when no tile is needed
+    int Sizes[MAX_TILE_COUNT] = {};
+    for (int i = 0; i < Math::Min(LightCount, (int)MAX_LIGHT_COUNT); ++i)
+    {
+        const GL::light& Light = Lights[i];
+        if (!Light.Enabled || Light.Shadow == CASTSHADOW_NONE)
+        {
+            this->LightSizes[i] = 0;
+            continue;
+        }
+
+        int Size = this->ComputeTileSize(Light, ViewMatrix, ProjectionMatrix, this->LightSizes[i]);
+        this->LightSizes[i] = Size;
+        int TileCount = 1;
+        if (Light.Type == LIGHT_POINT)
+        {
+            // A face covers a quarter of the solid angle of a spot
+            Size = Math::Max(Size / 2, (int)MIN_TILE_SIZE);
+            TileCount = 6;
+        }
+        else if (Light.Type == LIGHT_DIRECTIONNAL && this->CascadeCount > 1)
+        {
+            // Same memory than a single map
+            Size = Math::Max(Size / 2, (int)MIN_TILE_SIZE);
+            TileCount = Math::Min(this->CascadeCount, (int)TILES_PER_LIGHT);
+        }
+
+        for (int Tile = 0; Tile < TileCount; ++Tile)
+            Sizes[i * TILES_PER_LIGHT + Tile] = Size;
+    }
+
+    // Halve the biggest tiles until everything fits
+    for (;;)
+    {
+        int Area = 0;
+        int Biggest = 0;
+        for (int i = 0; i < MAX_TILE_COUNT; ++i)
+        {
+            Area += Sizes[i] * Sizes[i];
+            if (Sizes[i] > Sizes[Biggest])
+                Biggest = i;
+        }
+
+        if (Area <= ATLAS_SIZE * ATLAS_SIZE || Sizes[Biggest] <= MIN_TILE_SIZE)
+            break;
+        Sizes[Biggest] /= 2;
+    }
+
+    // Tiles keep their rect while their size does not change, the others are freed then allocated again
+    tile_rect Rects[MAX_TILE_COUNT];
+    for (int i = 0; i < MAX_TILE_COUNT; ++i)
+    {
+        Rects[i] = this->TileRects[i];
+        if (Sizes[i] != Rects[i].Size && Rects[i].Size > 0)
+        {
+            this->FreeNode(Rects[i]);
+            Rects[i] = {};
+        }
+    }
+
+    // Biggest tiles first: with power of two sizes a quadtree filled in that order never fragments
+    int Order[MAX_TILE_COUNT];
+    for (int i = 0; i < MAX_TILE_COUNT; ++i)
+        Order[i] = i;
+    std::stable_sort(Order, Order + MAX_TILE_COUNT, [&Sizes](int A, int B) { return Sizes[A] > Sizes[B]; });
+
+    bool Packed = true;
+    for (int i : Order)
+    {
+        if (Sizes[i] != Rects[i].Size && !this->AllocateNode(this->GetLevel(Sizes[i]), &Rects[i]))
+        {
+            Packed = false;
+            break;
+        }
+    }
+
+    // Fragmented by the tiles left in place: pack everything again
+    if (!Packed)
+    {
+        this->ResetQuadtree();
+        for (int i : Order)
+        {
+            if (Sizes[i] == 0 || !this->AllocateNode(this->GetLevel(Sizes[i]), &Rects[i]))
+                Rects[i] = {};
+        }
+    }
+
+    tile_rect PreviousRects[MAX_TILE_COUNT];
+    memcpy(PreviousRects, this->TileRects, sizeof(PreviousRects));
+
+    this->AllocatedArea = 0;
+    for (int i = 0; i < MAX_TILE_COUNT; ++i)
+    {
+        const tile_rect& Rect = Rects[i];
+        const tile_rect& Previous = PreviousRects[i];
+        this->TileMoved[i] = Rect.X != Previous.X || Rect.Y != Previous.Y || Rect.Size != Previous.Size;
+        this->TileRects[i] = Rect;
+        this->AllocatedArea += Rect.Size * Rect.Size;
+
+        // Drawn at another resolution, the static layer is rendered again (resampled until then)
+        if (Rect.Size != Previous.Size)
+            this->StaticKeys[i].Valid = false;
+        if (Rect.Size == 0)
+            this->StaticKeys[i].HasContent = false;
+
+        const float InvAtlasSize = 1.f / (float)ATLAS_SIZE;
+        this->Tiles[i].Rect = { Rect.X * InvAtlasSize, Rect.Y * InvAtlasSize, Rect.Size * InvAtlasSize, Rect.Size * InvAtlasSize };
+    }
+
+    this->MoveTileContents(PreviousRects);
+}
+
+void shadow_atlas::MoveTileContents(const tile_rect* PreviousRects)
+{
+    int Moved[MAX_TILE_COUNT];
+    int MovedCount = 0;
+    for (int i = 0; i < MAX_TILE_COUNT; ++i)
+    {
+        if (this->TileMoved[i] && this->StaticKeys[i].HasContent)
+            Moved[MovedCount++] = i;
+    }
+    if (MovedCount == 0)
+        return;
+
+    // The previous rects of the moved tiles only overlap the new rects of other moved tiles, so the
+    // atlas can hold their static layer while it is copied to the new rects (the atlas tiles are then
+    // static only, the dynamic casters are composited again). Resized tiles are scaled.
+    glDisable(GL_SCISSOR_TEST);
+    for (int Pass = 0; Pass < 3; ++Pass)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, Pass == 1 ? this->FBO : this->StaticFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, Pass == 1 ? this->StaticFBO : this->FBO);
+        for (int m = 0; m < MovedCount; ++m)
+        {
+            const tile_rect& Src = Pass == 2 ? this->TileRects[Moved[m]] : PreviousRects[Moved[m]];
+            const tile_rect& Dst = Pass == 0 ? PreviousRects[Moved[m]] : this->TileRects[Moved[m]];
+            glBlitFramebuffer(Src.X, Src.Y, Src.X + Src.Size, Src.Y + Src.Size,
+                              Dst.X, Dst.Y, Dst.X + Dst.Size, Dst.Y + Dst.Size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (int m = 0; m < MovedCount; ++m)
+        this->StaticKeys[Moved[m]].Rect = this->TileRects[Moved[m]];
+}
+
+void shadow_atlas::BeginTile(int Tile, bool StaticLayer)
+{
+    const tile_rect& Rect = this->TileRects[Tile];
+
+    glBindFramebuffer(GL_FRAMEBUFFER, StaticLayer ? this->StaticFBO : this->FBO);
+    glViewport(Rect.X, Rect.Y, Rect.Size, Rect.Size);
+    glScissor(Rect.X, Rect.Y, Rect.Size, Rect.Size);
+    glEnable(GL_SCISSOR_TEST);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+bool shadow_atlas::BeginLayeredTiles(int FirstTile, int TileCount, bool StaticLayer)
+{
+    const GL::extensions& Extensions = GL::GetExtensions();
+    if (!Extensions.ShaderViewportLayerArray)
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, StaticLayer ? this->StaticFBO : this->FBO);
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < TileCount; ++i)
+    {
+        const tile_rect& Rect = this->TileRects[FirstTile + i];
+        glScissor(Rect.X, Rect.Y, Rect.Size, Rect.Size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        Extensions.ViewportIndexedfProc(i, (float)Rect.X, (float)Rect.Y, (float)Rect.Size, (float)Rect.Size);
+    }
+
+    // Primitives are clipped to their viewport
+    glDisable(GL_SCISSOR_TEST);
+    return true;
+}
+
+void shadow_atlas::SetTileMatrix(int Tile, const mat4& ViewProjection)
+{
+    shadow_tile& ShadowTile = this->Tiles[Tile];
+    ShadowTile.ViewProjection = ViewProjection;
+    ShadowTile.DepthRange = {};
+
+    // Rows of Projection * View: w = -z of the (rigid) view, z = A * z + B, so ndc depth = -A + B / w
+    const mat4& M = ViewProjection;
+    v3 RowW = { M.c[0].w, M.c[1].w, M.c[2].w };
+    v3 RowZ = { M.c[0].z, M.c[1].z, M.c[2].z };
+    float SquaredLength = Vec3::Dot(RowW, RowW);
+    if (SquaredLength <= 0.f)
+        return;
+
+    float A = -Vec3::Dot(RowZ, RowW) / SquaredLength;
+    float B = M.c[3].z + A * M.c[3].w;
+    ShadowTile.DepthRange = { B / (A - 1.f), B / (A + 1.f), 0.f, 0.f };
+}
+
+bool shadow_atlas::IsStaticTileValid(int Tile, const mat4& ViewProjection, float Range) const
+{
+    const static_key& Key = this->StaticKeys[Tile];
+    const tile_rect& Rect = this->TileRects[Tile];
+    return Key.Valid && Key.Range == Range
+        && Key.Rect.X == Rect.X && Key.Rect.Y == Rect.Y && Key.Rect.Size == Rect.Size
+        && memcmp(Key.ViewProjection.e, ViewProjection.e, sizeof(Key.ViewProjection.e)) == 0;
+}
+
+void shadow_atlas::ValidateStaticTile(int Tile, float Range)
+{
+    this->StaticKeys[Tile] = { this->Tiles[Tile].ViewProjection, this->TileRects[Tile], Range, true, true };
+}
+
+void shadow_atlas::CompositeTile(int Tile)
+{
+    const tile_rect& Rect = this->TileRects[Tile];
+
+    // Blits are scissored too
+    glViewport(Rect.X, Rect.Y, Rect.Size, Rect.Size);
+    glScissor(Rect.X, Rect.Y, Rect.Size, Rect.Size);
+    glEnable(GL_SCISSOR_TEST);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->StaticFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
+    glBlitFramebuffer(Rect.X, Rect.Y, Rect.X + Rect.Size, Rect.Y + Rect.Size,
+                      Rect.X, Rect.Y, Rect.X + Rect.Size, Rect.Y + Rect.Size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+}
+
+void shadow_atlas::EndTiles()
+{
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void shadow_atlas::Upload()
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UniformBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(this->Tiles), this->Tiles);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void shadow_atlas::SetupProgram(GLuint Program, int TextureUnit) const
+{
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uShadowAtlas"), TextureUnit);
+    glUniform1i(glGetUniformLocation(Program, "uShadowAtlasDepth"), TextureUnit + 1);
+    glUniformBlockBinding(Program, glGetUniformBlockIndex(Program, "uShadowAtlasBlock"), UNIFORM_BLOCK_BINDING_POINT);
+}
+
+void shadow_atlas::SetFilterUniforms(GLuint Program) const
+{
+    glUniform1i(glGetUniformLocation(Program, "uShadowFilterMode"), this->FilterMode);
+    glUniform1i(glGetUniformLocation(Program, "uShadowFilterTaps"), Math::Max(this->FilterTaps, 1));
+    glUniform1f(glGetUniformLocation(Program, "uShadowFilterRadius"), this->FilterRadius);
+    glUniform1i(glGetUniformLocation(Program, "uShadowBlockerTaps"), Math::Max(this->BlockerTaps, 1));
+    glUniform1f(glGetUniformLocation(Program, "uShadowLightSize"), Math::Max(this->LightSize, 1.f));
+}
+
+void shadow_atlas::Bind(int TextureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, this->Texture);
+    glBindSampler(TextureUnit, this->CompareSampler);
+    glActiveTexture(GL_TEXTURE0 + TextureUnit + 1);
+    glBindTexture(GL_TEXTURE_2D, this->Texture);
+    glBindSampler(TextureUnit + 1, this->DepthSampler);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING_POINT, this->UniformBuffer);
+}
+
+void shadow_atlas::Unbind(int TextureUnit) const
+{
+    glBindSampler(TextureUnit, 0);
+    glBindSampler(TextureUnit + 1, 0);
+}
+
+void shadow_atlas::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Shadow atlas"))
+    {
+        static const char* SizeNames[] = { "256", "512", "1024", "2048", "4096" };
+        int SizeIndex = 0;
+        while ((256 << SizeIndex) < this->MaxTileSize && SizeIndex < (int)ARRAY_SIZE(SizeNames) - 1)
+            ++SizeIndex;
+        if (ImGui::Combo("Max tile size", &SizeIndex, SizeNames, ARRAY_SIZE(SizeNames)))
+            this->MaxTileSize = 256 << SizeIndex;
+        ImGui::SliderFloat("Size hysteresis", &this->SizeHysteresis, 0.f, 0.5f);
+
+        ImGui::SliderFloat("Light cutoff", &this->LightCutoff, 1.f / 1024.f, 0.1f, "%.4f", 2.f);
+
+        static const char* FilterNames[] = { "Hardware PCF", "Vogel disk", "PCSS", "EVSM" };
+        ImGui::Combo("Filter", &this->FilterMode, FilterNames, ARRAY_SIZE(FilterNames));
+        if (this->FilterMode == SHADOW_FILTER_DISK || this->FilterMode == SHADOW_FILTER_PCSS)
+        {
+            ImGui::SliderInt("Filter taps", &this->FilterTaps, 1, 32);
+            if (this->FilterMode == SHADOW_FILTER_DISK)
+                ImGui::SliderFloat("Filter radius (texels)", &this->FilterRadius, 0.5f, 8.f);
+        }
+        if (this->FilterMode == SHADOW_FILTER_PCSS)
+        {
+            ImGui::SliderInt("Blocker taps", &this->BlockerTaps, 1, 32);
+            ImGui::SliderFloat("Light size (texels)", &this->LightSize, 1.f, 64.f);
+        }
+
+        ImGui::Text("Atlas: %dx%d (%d MB with the static layer), %.1f%% allocated", ATLAS_SIZE, ATLAS_SIZE,
+            2 * ATLAS_SIZE * ATLAS_SIZE * 4 / (1024 * 1024), 100.f * (float)this->AllocatedArea / (float)(ATLAS_SIZE * ATLAS_SIZE));
+
+        for (int i = 0; i < MAX_LIGHT_COUNT; ++i)
+        {
+            int Tile = i * TILES_PER_LIGHT;
+            if (!this->IsTileAllocated(Tile))
+                continue;
+
+            int TileCount = 1;
+            while (TileCount < TILES_PER_LIGHT && this->IsTileAllocated(Tile + TileCount))
+                ++TileCount;
+            ImGui::Text("Light %d: %d x %d", i, TileCount, this->TileRects[Tile].Size);
+        }
+
+        ImGui::Image((void*)(intptr_t)this->Texture, ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::SameLine();
+        ImGui::Image((void*)(intptr_t)this->StaticTexture, ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <vector>
+
+#include "opengl_helpers.h"
+#include "maths.h"
+
+// Atlas area given to one shadow view, same memory layout than 'shadow_tile' in glsl shader (GLINCLUDE_SHADOW_ATLAS)
+struct shadow_tile
+{
+    mat4 ViewProjection; // World to light clip space
+    v4 Rect;             // Atlas uv offset (xy) and size (zw), zero size when not allocated
+    v4 DepthRange;       // Near and far planes (xy) of perspective tiles, zero for orthographic tiles
+};
+
+// Filtering of the shadow taps (GLINCLUDE_SHADOW_ATLAS)
+enum shadow_filter
+{
+    SHADOW_FILTER_HARDWARE = 0, // One depth comparison tap (bilinear 2x2 PCF)
+    SHADOW_FILTER_DISK = 1,     // Rotated Vogel disk of comparison taps
+    SHADOW_FILTER_PCSS = 2,     // Blocker search then a disk sized by the penumbra
+    SHADOW_FILTER_EVSM = 3,     // One filtered fetch of the prefiltered moments (shadow_moments)
+};
+
+// Single depth texture shared by the shadows of all the lights. Every frame, each shadow casting
+// light gets a power of two tile size from its screen coverage (point lights get six tiles, one
+// per cube face) and the tiles are packed by a quadtree allocator, so memory stays fixed whatever
+// the lights. Tiles keep their place until their size changes (with some hysteresis), the whole
+// atlas is only packed again when the free space is too fragmented. Shaders read the tile matrices and rects from a uniform block and sample one texture.
+//
+// Tiles of light i start at i * TILES_PER_LIGHT: one per cube face for point lights, one per cascade
+// for directional lights and a single one for spot lights.
+//
+// A second texture with the same tiles caches the static geometry: a tile is only drawn again when
+// its size, matrix or range changes, then copied to the atlas before the dynamic casters are drawn.
+// Tiles moved to another rect take their static layer with them (resampled when resized, until drawn again).
+class shadow_atlas
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int ATLAS_SIZE = 4096;
+    static const int MIN_TILE_SIZE = 64;
+    static const int LEVEL_COUNT = 7; // Quadtree levels from ATLAS_SIZE to MIN_TILE_SIZE
+
+    static const int MAX_LIGHT_COUNT = 8;
+    static const int TILES_PER_LIGHT = 6;
+    static const int MAX_TILE_COUNT = MAX_LIGHT_COUNT * TILES_PER_LIGHT;
+
+    // Uniform block binding of the tiles (0 to 3 are used by the light/frame/draw/deferred light blocks)
+    static const int UNIFORM_BLOCK_BINDING_POINT = 4;
+
+    // Tile size of a light covering the whole screen (and of directional lights)
+    int MaxTileSize = 1024;
+
+    // Fraction of its coverage range a light must leave before its tile size changes
+    float SizeHysteresis = 0.2f;
+
+    // Tiles of a directional light (see shadow_cascades), several cascades share the area of MaxTileSize
+    int CascadeCount = 1;
+
+    // Light intensity under which a point/spot light is considered out of range (sizes the coverage)
+    float LightCutoff = 1.f / 256.f;
+
+    // Shadow filtering, radii in texels
+    int FilterMode = SHADOW_FILTER_DISK;
+    int FilterTaps = 8;
+    float FilterRadius = 1.5f;
+    int BlockerTaps = 8;
+    float LightSize = 16.f;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    shadow_atlas();
+    ~shadow_atlas();
+
+    shadow_atlas(const shadow_atlas&) = delete;
+    shadow_atlas& operator=(const shadow_atlas&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Size and pack the tiles of the shadow casting lights for this view (symmetric perspective projection)
+    void Allocate(const GL::light* Lights, int LightCount, const mat4& ViewMatrix, const mat4& ProjectionMatrix);
+
+    // Atlas area of a tile in texels
+    struct tile_rect
+    {
+        int X;
+        int Y;
+        int Size;
+    };
+
+    bool IsTileAllocated(int Tile) const { return this->Tiles[Tile].Rect.z > 0.f; }
+    const tile_rect& GetTileRect(int Tile) const { return this->TileRects[Tile]; }
+    int GetTileSize(int Tile) const { return this->TileRects[Tile].Size; }
+
+    // True when the tile rect is not the same than last frame (moved tiles keep their static layer,
+    // their atlas tile is reset to it: dynamic casters must be composited again)
+    bool HasTileMoved(int Tile) const { return this->TileMoved[Tile]; }
+
+    // Also finds the near and far planes of a perspective projection (linear depths of PCSS)
+    void SetTileMatrix(int Tile, const mat4& ViewProjection);
+
+    // Bind the atlas (or static layer) framebuffer restricted to the tile (viewport and scissor) and clear its depth
+    void BeginTile(int Tile, bool StaticLayer = false);
+    // Same for consecutive tiles drawn at once: viewport i is set to tile FirstTile + i (gl_ViewportIndex),
+    // false when the context cannot write gl_ViewportIndex from the vertex shader
+    bool BeginLayeredTiles(int FirstTile, int TileCount, bool StaticLayer = false);
+
+    // False when the tile was never drawn since it was allocated (resized tiles keep a resampled copy)
+    bool HasTileContent(int Tile) const { return this->StaticKeys[Tile].HasContent; }
+
+    // True when the static layer of the tile was drawn with the same rect, matrix and range
+    bool IsStaticTileValid(int Tile, const mat4& ViewProjection, float Range) const;
+    // Remember the key of a static layer tile just drawn (with the matrix set by SetTileMatrix)
+    void ValidateStaticTile(int Tile, float Range);
+
+    // Copy the static layer of the tile to the atlas, then bind the atlas restricted to the tile (dynamic casters are drawn on top)
+    void CompositeTile(int Tile);
+    // Unbind the atlas framebuffer and disable the scissor test
+    void EndTiles();
+
+    // Send the tiles to the uniform block
+    void Upload();
+
+    // Sampler units (TextureUnit and TextureUnit + 1) and block binding of a program using GLINCLUDE_SHADOW_ATLAS
+    void SetupProgram(GLuint Program, int TextureUnit) const;
+
+    // Set the filtering uniforms of a program using GLINCLUDE_SHADOW_ATLAS (in use)
+    void SetFilterUniforms(GLuint Program) const;
+
+    // Bind the texture with its comparison sampler (TextureUnit) and raw depth sampler (TextureUnit + 1), and the uniform block
+    void Bind(int TextureUnit) const;
+    // Restore the default samplers of the units
+    void Unbind(int TextureUnit) const;
+
+    // Depth texture of the atlas, plain sampling parameters
+    GLuint GetTexture() const { return this->Texture; }
+
+    // ImGui debug function (settings, tiles and atlas preview)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    // Requested tile size of a light (a face for point lights), kept at PreviousSize within the hysteresis
+    int ComputeTileSize(const GL::light& Light, const mat4& ViewMatrix, const mat4& ProjectionMatrix, int PreviousSize) const;
+
+    void CreateLayer(GLuint* LayerTexture, GLuint* LayerFBO);
+
+    // Quadtree allocation, the nodes of each level are split from the level above when none is free
+    void ResetQuadtree();
+    bool AllocateNode(int Level, tile_rect* Rect);
+    void FreeNode(tile_rect Rect);
+
+    // Copy the static layer of the moved tiles to their new rect (and to the atlas)
+    void MoveTileContents(const tile_rect* PreviousRects);
+    int GetLevel(int Size) const;
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    GLuint Texture = 0;
+    GLuint FBO = 0;
+    GLuint UniformBuffer = 0;
+
+    // Depth comparison (GL_COMPARE_REF_TO_TEXTURE, linear) and raw depth samplers of the atlas
+    GLuint CompareSampler = 0;
+    GLuint DepthSampler = 0;
+
+    // Static geometry layer, same tiles
+    GLuint StaticTexture = 0;
+    GLuint StaticFBO = 0;
+
+    // What the static layer tiles were drawn with
+    struct static_key
+    {
+        mat4 ViewProjection;
+        tile_rect Rect;
+        float Range;
+        bool Valid;
+        bool HasContent; // Drawn (or resampled from an older size) at Rect
+    };
+    static_key StaticKeys[MAX_TILE_COUNT] = {};
+
+    shadow_tile Tiles[MAX_TILE_COUNT] = {};
+    tile_rect TileRects[MAX_TILE_COUNT] = {};
+    bool TileMoved[MAX_TILE_COUNT] = {};
+
+    // Last requested size of each light, before the cube face/cascade split and the fitting
+    int LightSizes[MAX_LIGHT_COUNT] = {};
+
+    // Free nodes per quadtree level (level 0 is the whole atlas, each level halves the size)
+    std::vector<tile_rect> FreeNodes[LEVEL_COUNT];
+
+    int AllocatedArea = 0;
+};
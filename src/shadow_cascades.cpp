@@ -0,0 +1,102 @@
+#include <cfloat>
+#include <cmath>
+
+#include <imgui.h>
+
+#include "shadow_cascades.h"
+
+void shadow_cascades::Update(const mat4& ViewMatrix, float FovY, float AspectRatio, float Near, const v3& LightDirection,
+                             const v3& SceneMin, const v3& SceneMax, int TileSize)
+{
+    int Count = Math::Clamp(this->CascadeCount, 1, (int)MAX_CASCADE_COUNT);
+    float Far = Math::Max(this->ShadowDistance, Near * 2.f);
+
+    mat4 CameraMatrix = Mat4::Inverse(ViewMatrix);
+    float TanHalfFovY = Math::Tan(FovY * 0.5f);
+    float TanHalfFovX = TanHalfFovY * AspectRatio;
+
+    // Light space orientation around the origin, only the projections follow the camera
+    v3 Direction = Vec3::Normalize(LightDirection);
+    v3 Up = std::fabs(Direction.y) > 0.99f ? Vec3::Z() : Vec3::Y();
+    mat4 LightView = Mat4::LookAt({ 0.f, 0.f, 0.f }, Direction, Up);
+
+    // Depth range of the scene along the light direction (casters between the light and the slices)
+    float SceneNear = FLT_MAX;
+    float SceneFar = -FLT_MAX;
+    for (int i = 0; i < 8; ++i)
+    {
+        v3 Corner = { (i & 1) ? SceneMax.x : SceneMin.x, (i & 2) ? SceneMax.y : SceneMin.y, (i & 4) ? SceneMax.z : SceneMin.z };
+        float Depth = -(LightView * Vec4::vec4(Corner, 1.f)).z;
+        SceneNear = Math::Min(SceneNear, Depth);
+        SceneFar = Math::Max(SceneFar, Depth);
+    }
+
+    float SliceNear = Near;
+    for (int c = 0; c < Count; ++c)
+    {
+        // Practical split scheme
+        float t = (float)(c + 1) / (float)Count;
+        float LogSplit = Near * std::pow(Far / Near, t);
+        float UniformSplit = Near + (Far - Near) * t;
+        float SliceFar = Math::Lerp(UniformSplit, LogSplit, this->SplitLambda);
+        this->Splits[c] = SliceFar;
+
+        // Bounding sphere of the slice, its size does not change when the camera rotates
+        v3 Corners[8];
+        v3 Center = {};
+        for (int i = 0; i < 8; ++i)
+        {
+            float Depth = (i & 4) ? SliceFar : SliceNear;
+            v4 ViewCorner = { ((i & 1) ? 1.f : -1.f) * Depth * TanHalfFovX, ((i & 2) ? 1.f : -1.f) * Depth * TanHalfFovY, -Depth, 1.f };
+            Corners[i] = (CameraMatrix * ViewCorner).xyz;
+            Center += Corners[i] * (1.f / 8.f);
+        }
+
+        float Radius = 0.f;
+        for (int i = 0; i < 8; ++i)
+            Radius = Math::Max(Radius, Vec3::Length(Corners[i] - Center));
+        Radius = std::ceil(Radius * 16.f) / 16.f;
+
+        // Move the projection by whole texels only
+        v4 LightCenter = LightView * Vec4::vec4(Center, 1.f);
+        float TexelSize = 2.f * Radius / (float)Math::Max(TileSize, 1);
+        LightCenter.x = std::floor(LightCenter.x / TexelSize) * TexelSize;
+        LightCenter.y = std::floor(LightCenter.y / TexelSize) * TexelSize;
+
+        // From the nearest caster to the back of the slice
+        float ZNear = Math::Min(SceneNear, -LightCenter.z - Radius);
+        float ZFar = Math::Max(Math::Min(SceneFar, -LightCenter.z + Radius), ZNear + 0.01f);
+
+        mat4 Projection = Mat4::Orthographic(LightCenter.x - Radius, LightCenter.x + Radius,
+                                             LightCenter.y - Radius, LightCenter.y + Radius, ZNear, ZFar);
+        this->ViewProjections[c] = Projection * LightView;
+
+        SliceNear = SliceFar;
+    }
+
+    for (int c = Count; c < MAX_CASCADE_COUNT; ++c)
+        this->Splits[c] = this->Splits[Count - 1];
+}
+
+void shadow_cascades::SetUniforms(GLuint Program) const
+{
+    glUniform4fv(glGetUniformLocation(Program, "uShadowCascadeSplits"), 1, this->Splits);
+    glUniform1i(glGetUniformLocation(Program, "uShadowCascadeCount"), Math::Clamp(this->CascadeCount, 1, (int)MAX_CASCADE_COUNT));
+    glUniform1f(glGetUniformLocation(Program, "uShadowCascadeBlend"), this->BlendFraction);
+}
+
+void shadow_cascades::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Shadow cascades"))
+    {
+        ImGui::SliderInt("Cascade count", &this->CascadeCount, 1, MAX_CASCADE_COUNT);
+        ImGui::SliderFloat("Split lambda", &this->SplitLambda, 0.f, 1.f);
+        ImGui::SliderFloat("Shadow distance", &this->ShadowDistance, 5.f, 100.f);
+        ImGui::SliderFloat("Blend fraction", &this->BlendFraction, 0.f, 0.5f);
+
+        for (int c = 0; c < Math::Clamp(this->CascadeCount, 1, (int)MAX_CASCADE_COUNT); ++c)
+            ImGui::Text("Cascade %d: up to %.2f", c, this->Splits[c]);
+
+        ImGui::TreePop();
+    }
+}
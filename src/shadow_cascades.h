@@ -0,0 +1,54 @@
+#pragma once
+
+#include "opengl_headers.h"
+#include "maths.h"
+
+// Cascaded shadow maps of a directional light: the view frustum is split in depth (blend of
+// logarithmic and uniform splits) and each slice gets its own orthographic light projection,
+// fitted to the bounding sphere of the slice so the texel density follows the view distance.
+// The projections are snapped to whole texels of their tile to avoid shimmering when the camera moves.
+//
+// Shaders select the cascade from the view depth (shadow_atlas_compute_cascaded in GLINCLUDE_SHADOW_ATLAS).
+class shadow_cascades
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int MAX_CASCADE_COUNT = 4;
+
+    int CascadeCount = 4;
+
+    // 0: uniform splits, 1: logarithmic splits
+    float SplitLambda = 0.75f;
+
+    // View distance covered by the cascades (no shadow beyond)
+    float ShadowDistance = 40.f;
+
+    // Part of each cascade blended with the next one (0 disables blending)
+    float BlendFraction = 0.1f;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Fit the cascades to the view (symmetric perspective projection) and to the scene bounds (world space, shadow casters)
+    void Update(const mat4& ViewMatrix, float FovY, float AspectRatio, float Near, const v3& LightDirection,
+                const v3& SceneMin, const v3& SceneMax, int TileSize);
+
+    const mat4& GetViewProjection(int Cascade) const { return this->ViewProjections[Cascade]; }
+
+    // Set the cascade uniforms of a program using GLINCLUDE_SHADOW_ATLAS (in use)
+    void SetUniforms(GLuint Program) const;
+
+    // ImGui debug function (split settings and distances)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    float Splits[MAX_CASCADE_COUNT] = {}; // View depth at the far end of each cascade
+    mat4 ViewProjections[MAX_CASCADE_COUNT] = {};
+};
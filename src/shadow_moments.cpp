@@ -0,0 +1,284 @@
+#include <cstdio>
+
+#include <imgui.h>
+
+#include "maths.h"
+#include "opengl_helpers.h"
+#include "opengl_helpers_extensions.h"
+
+#include "shadow_moments.h"
+
+#pragma region MomentsShaders
+// Triangle covering the viewport (tile), from the vertex index
+static const char* gMomentsVertexShaderStr = R"GLSL(
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+})GLSL";
+
+static const char* gConvertFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uDepth;  // Shadow atlas, plain sampling
+uniform vec2 uExponents;
+
+// Shader outputs
+out vec4 oMoments;
+
+void main()
+{
+    // Average of the 2x2 depth texels under the moments texel
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    vec4 moments = vec4(0.0);
+    for (int i = 0; i < 4; ++i)
+    {
+        float depth = texelFetch(uDepth, texel + ivec2(i & 1, i >> 1), 0).r * 2.0 - 1.0;
+        float pos = exp(uExponents.x * depth);
+        float neg = -exp(-uExponents.y * depth);
+        moments += vec4(pos, pos * pos, neg, neg * neg);
+    }
+    oMoments = moments * 0.25;
+})GLSL";
+
+static const char* gBlurFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uMoments;
+uniform ivec2 uDirection;
+uniform int uRadius;
+uniform ivec4 uTileRect; // First and last texels of the tile
+
+// Shader outputs
+out vec4 oMoments;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float sigma = float(uRadius) * 0.5 + 0.5;
+
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int i = -uRadius; i <= uRadius; ++i)
+    {
+        float weight = exp(-float(i * i) / (2.0 * sigma * sigma));
+        sum += texelFetch(uMoments, clamp(texel + uDirection * i, uTileRect.xy, uTileRect.zw), 0) * weight;
+        weightSum += weight;
+    }
+    oMoments = sum / weightSum;
+})GLSL";
+
+static const char* gDownsampleFragmentShaderStr = R"GLSL(
+// Uniforms
+uniform sampler2D uMoments; // Base and max levels set to the level above
+uniform ivec4 uTileRect;    // First and last texels of the tile in the level above
+
+// Shader outputs
+out vec4 oMoments;
+
+void main()
+{
+    // Average of the 2x2 texels of the level above, never outside the tile
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    vec4 sum = vec4(0.0);
+    for (int i = 0; i < 4; ++i)
+        sum += texelFetch(uMoments, clamp(texel + ivec2(i & 1, i >> 1), uTileRect.xy, uTileRect.zw), 0);
+    oMoments = sum * 0.25;
+})GLSL";
+#pragma endregion
+
+shadow_moments::shadow_moments()
+{
+    this->ConvertProgram = GL::CreateProgramEx(1, &gMomentsVertexShaderStr, 1, &gConvertFragmentShaderStr);
+    this->BlurProgram = GL::CreateProgramEx(1, &gMomentsVertexShaderStr, 1, &gBlurFragmentShaderStr);
+    this->DownsampleProgram = GL::CreateProgramEx(1, &gMomentsVertexShaderStr, 1, &gDownsampleFragmentShaderStr);
+
+    glUseProgram(this->ConvertProgram);
+    glUniform1i(glGetUniformLocation(this->ConvertProgram, "uDepth"), 0);
+    glUseProgram(this->BlurProgram);
+    glUniform1i(glGetUniformLocation(this->BlurProgram, "uMoments"), 0);
+    glUseProgram(this->DownsampleProgram);
+    glUniform1i(glGetUniformLocation(this->DownsampleProgram, "uMoments"), 0);
+
+    glGenVertexArrays(1, &this->EmptyVAO);
+}
+
+shadow_moments::~shadow_moments()
+{
+    glDeleteVertexArrays(1, &this->EmptyVAO);
+    glDeleteProgram(this->ConvertProgram);
+    glDeleteProgram(this->BlurProgram);
+    glDeleteProgram(this->DownsampleProgram);
+    glDeleteFramebuffers(1, &this->FBO);
+    glDeleteFramebuffers(1, &this->MipFBO);
+    glDeleteFramebuffers(1, &this->ScratchFBO);
+    glDeleteTextures(1, &this->Texture);
+    glDeleteTextures(1, &this->ScratchTexture);
+}
+
+void shadow_moments::CreateTargets()
+{
+    GLuint* Textures[] = { &this->Texture, &this->ScratchTexture };
+    GLuint* FBOs[] = { &this->FBO, &this->ScratchFBO };
+    for (int i = 0; i < 2; ++i)
+    {
+        glGenTextures(1, Textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *Textures[i]);
+        int Levels = (i == 0) ? MIP_COUNT : 1;
+        for (int Level = 0; Level < Levels; ++Level)
+            glTexImage2D(GL_TEXTURE_2D, Level, GL_RGBA16F, MOMENTS_SIZE >> Level, MOMENTS_SIZE >> Level, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (i == 0) ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenFramebuffers(1, FBOs[i]);
+        glBindFramebuffer(GL_FRAMEBUFFER, *FBOs[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *Textures[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::printf("ERROR::FRAMEBUFFER:: Shadow moments framebuffer is not complete!\n");
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &this->MipFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void shadow_moments::Update(const shadow_atlas& Atlas, const std::vector<int>& UpdatedTiles)
+{
+    if (this->Texture == 0)
+        this->CreateTargets();
+
+    // Moments built with other settings are all converted again
+    bool SettingsChanged = this->BuiltExponents[0] != this->PositiveExponent || this->BuiltExponents[1] != this->NegativeExponent
+        || this->BuiltBlurRadius != this->BlurRadius;
+    if (!this->Valid || SettingsChanged)
+    {
+        this->Tiles.clear();
+        for (int Tile = 0; Tile < shadow_atlas::MAX_TILE_COUNT; ++Tile)
+        {
+            if (Atlas.IsTileAllocated(Tile))
+                this->Tiles.push_back(Tile);
+        }
+        this->Valid = true;
+        this->BuiltExponents[0] = this->PositiveExponent;
+        this->BuiltExponents[1] = this->NegativeExponent;
+        this->BuiltBlurRadius = this->BlurRadius;
+    }
+    else
+    {
+        this->Tiles = UpdatedTiles;
+    }
+
+    if (this->Tiles.empty())
+        return;
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_SCISSOR_TEST);
+    glBindVertexArray(this->EmptyVAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int Tile : this->Tiles)
+    {
+        const shadow_atlas::tile_rect& DepthRect = Atlas.GetTileRect(Tile);
+        int X = DepthRect.X / 2;
+        int Y = DepthRect.Y / 2;
+        int Size = DepthRect.Size / 2;
+        glViewport(X, Y, Size, Size);
+        glScissor(X, Y, Size, Size);
+
+        // Depth to moments
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glUseProgram(this->ConvertProgram);
+        glUniform2f(glGetUniformLocation(this->ConvertProgram, "uExponents"), this->PositiveExponent, this->NegativeExponent);
+        glBindTexture(GL_TEXTURE_2D, Atlas.GetTexture());
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        if (this->BlurRadius <= 0)
+            continue;
+
+        // Horizontal blur to the scratch texture, vertical blur back
+        glUseProgram(this->BlurProgram);
+        glUniform1i(glGetUniformLocation(this->BlurProgram, "uRadius"), this->BlurRadius);
+        glUniform4i(glGetUniformLocation(this->BlurProgram, "uTileRect"), X, Y, X + Size - 1, Y + Size - 1);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->ScratchFBO);
+        glUniform2i(glGetUniformLocation(this->BlurProgram, "uDirection"), 1, 0);
+        glBindTexture(GL_TEXTURE_2D, this->Texture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
+        glUniform2i(glGetUniformLocation(this->BlurProgram, "uDirection"), 0, 1);
+        glBindTexture(GL_TEXTURE_2D, this->ScratchTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // Mips of the updated tiles only, each level read from the one above (the only level visible
+    // while the next one is drawn) without crossing the tile borders
+    glBindFramebuffer(GL_FRAMEBUFFER, this->MipFBO);
+    glUseProgram(this->DownsampleProgram);
+    glBindTexture(GL_TEXTURE_2D, this->Texture);
+    for (int Level = 1; Level < MIP_COUNT; ++Level)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, Level - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Level - 1);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture, Level);
+
+        for (int Tile : this->Tiles)
+        {
+            const shadow_atlas::tile_rect& DepthRect = Atlas.GetTileRect(Tile);
+            int X = (DepthRect.X / 2) >> Level;
+            int Y = (DepthRect.Y / 2) >> Level;
+            int Size = (DepthRect.Size / 2) >> Level;
+            glViewport(X, Y, Size, Size);
+            glScissor(X, Y, Size, Size);
+            glUniform4i(glGetUniformLocation(this->DownsampleProgram, "uTileRect"), X * 2, Y * 2, X * 2 + Size * 2 - 1, Y * 2 + Size * 2 - 1);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MIP_COUNT - 1);
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    float Anisotropy = this->UseAnisotropy ? GL::GetExtensions().MaxAnisotropy : 1.f;
+    if (GL::GetExtensions().MaxAnisotropy > 1.f)
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, Anisotropy);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void shadow_moments::SetupProgram(GLuint Program, int TextureUnit) const
+{
+    glUseProgram(Program);
+    glUniform1i(glGetUniformLocation(Program, "uShadowMoments"), TextureUnit);
+}
+
+void shadow_moments::SetUniforms(GLuint Program) const
+{
+    glUniform2f(glGetUniformLocation(Program, "uShadowExponents"), this->BuiltExponents[0], this->BuiltExponents[1]);
+    glUniform1f(glGetUniformLocation(Program, "uShadowBleedReduction"), this->BleedReduction);
+}
+
+void shadow_moments::Bind(int TextureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + TextureUnit);
+    glBindTexture(GL_TEXTURE_2D, this->Texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void shadow_moments::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Shadow moments (EVSM)"))
+    {
+        ImGui::SliderFloat("Positive exponent", &this->PositiveExponent, 1.f, 5.54f);
+        ImGui::SliderFloat("Negative exponent", &this->NegativeExponent, 1.f, 5.54f);
+        ImGui::SliderInt("Blur radius (texels)", &this->BlurRadius, 0, 8);
+        ImGui::SliderFloat("Bleed reduction", &this->BleedReduction, 0.f, 0.9f);
+        if (GL::GetExtensions().MaxAnisotropy > 1.f)
+            ImGui::Checkbox("Anisotropic filtering", &this->UseAnisotropy);
+
+        ImGui::Text("Moments: %dx%d RGBA16F, %d mips", MOMENTS_SIZE, MOMENTS_SIZE, MIP_COUNT);
+        if (this->Texture)
+            ImGui::Image((void*)(intptr_t)this->Texture, ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::TreePop();
+    }
+}
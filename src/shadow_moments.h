@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+#include "opengl_headers.h"
+#include "shadow_atlas.h"
+
+// Exponential variance shadow maps (EVSM) of the shadow atlas tiles: the depths of the tiles drawn
+// this frame are warped by a positive and a negative exponential, their first two moments are stored
+// in a half resolution RGBA16F atlas (same uv layout, 2x2 depth texels averaged per texel), blurred
+// by a separable gaussian clamped inside each tile and mipmapped tile by tile. Shaders then read a single
+// trilinear/anisotropic fetch (SHADOW_FILTER_EVSM), the softness comes from the blur radius instead
+// of the number of taps.
+class shadow_moments
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int MOMENTS_SIZE = shadow_atlas::ATLAS_SIZE / 2;
+
+    // Mip levels built per tile (the sampling clamps the level and the filter footprint inside each tile)
+    static const int MIP_COUNT = 4;
+
+    // Warp exponents, 5.54 at most to fit the squared moments in 16-bit floats
+    float PositiveExponent = 5.f;
+    float NegativeExponent = 5.f;
+
+    // Gaussian radius in moments texels (0 disables the blur)
+    int BlurRadius = 2;
+
+    // Part of the Chebyshev bound cut to remove light bleeding
+    float BleedReduction = 0.2f;
+
+    bool UseAnisotropy = true;
+
+    //  Constructor(s) & Destructor(s)
+    //  ---------------------------------
+
+    shadow_moments();
+    ~shadow_moments();
+
+    shadow_moments(const shadow_moments&) = delete;
+    shadow_moments& operator=(const shadow_moments&) = delete;
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Moments of the tiles drawn in the atlas this frame (every allocated tile after a settings change or Invalidate)
+    void Update(const shadow_atlas& Atlas, const std::vector<int>& UpdatedTiles);
+
+    // The moments are not kept up to date (another filter is used), they are all rebuilt by the next Update
+    void Invalidate() { this->Valid = false; }
+
+    // Sampler unit of a program using GLINCLUDE_SHADOW_ATLAS
+    void SetupProgram(GLuint Program, int TextureUnit) const;
+
+    // Set the EVSM uniforms of a program using GLINCLUDE_SHADOW_ATLAS (in use)
+    void SetUniforms(GLuint Program) const;
+
+    void Bind(int TextureUnit) const;
+
+    // ImGui debug function (settings and moments preview)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Fuction(s)
+    //  -----------------------
+
+    // Targets are only allocated when EVSM is used
+    void CreateTargets();
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    GLuint Texture = 0;        // Blurred moments with mipmaps
+    GLuint ScratchTexture = 0; // Horizontal blur
+    GLuint FBO = 0;
+    GLuint ScratchFBO = 0;
+    GLuint MipFBO = 0;         // Attached to the level being built
+
+    GLuint ConvertProgram = 0;
+    GLuint BlurProgram = 0;
+    GLuint DownsampleProgram = 0;
+    GLuint EmptyVAO = 0;
+
+    // Settings of the moments in the texture
+    bool Valid = false;
+    float BuiltExponents[2] = {};
+    int BuiltBlurRadius = 0;
+
+    std::vector<int> Tiles;
+};
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cfloat>
+
+#include <imgui.h>
+
+#include "maths.h"
+
+#include "shadow_scheduler.h"
+
+void shadow_scheduler::BeginFrame()
+{
+    // Results of the last frames, in order
+    double Milliseconds = 0.0;
+    int Faces = 0;
+    while (this->Timer.PopResult(&Milliseconds, &Faces))
+    {
+        if (Faces > 0)
+        {
+            float FaceTime = (float)Milliseconds / (float)Faces;
+            this->MillisecondsPerFace = (this->MillisecondsPerFace == 0.f) ? FaceTime : Math::Lerp(this->MillisecondsPerFace, FaceTime, 0.1f);
+        }
+
+        this->TimeHistory[this->HistoryIndex] = (float)Milliseconds;
+        this->FaceHistory[this->HistoryIndex] = (float)Faces;
+        this->HistoryIndex = (this->HistoryIndex + 1) % HISTORY_SIZE;
+    }
+
+    this->Updates.clear();
+    this->ScheduledFaces = 0;
+    this->SubmittedFaces = 0;
+}
+
+void shadow_scheduler::AddUpdate(int FirstTile, int FaceCount, float Contribution, bool Required)
+{
+    // The longer an update waits, the more it is worth
+    float Priority = Contribution * (float)(this->Ages[FirstTile] + 1);
+    this->Updates.push_back({ FirstTile, FaceCount, Priority, Required });
+    this->SubmittedFaces += FaceCount;
+}
+
+void shadow_scheduler::Schedule()
+{
+    int Budget = this->FaceBudget;
+    if (this->UseTimeBudget && this->MillisecondsPerFace > 0.f)
+        Budget = (int)(this->TimeBudget / this->MillisecondsPerFace);
+    if (!this->Enabled)
+        Budget = this->SubmittedFaces;
+
+    std::stable_sort(this->Updates.begin(), this->Updates.end(), [](const update& A, const update& B)
+    {
+        if (A.Required != B.Required)
+            return A.Required;
+        return A.Priority > B.Priority;
+    });
+
+    bool Submitted[shadow_atlas::MAX_TILE_COUNT] = {};
+    for (int i = 0; i < shadow_atlas::MAX_TILE_COUNT; ++i)
+        this->Scheduled[i] = false;
+
+    int Remaining = Budget;
+    for (const update& Update : this->Updates)
+    {
+        Submitted[Update.FirstTile] = true;
+
+        // The first one is drawn even over budget so every update eventually happens
+        if (Update.Required || Update.FaceCount <= Remaining || this->ScheduledFaces == 0)
+        {
+            this->Scheduled[Update.FirstTile] = true;
+            this->ScheduledFaces += Update.FaceCount;
+            Remaining -= Update.FaceCount;
+        }
+    }
+
+    for (int i = 0; i < shadow_atlas::MAX_TILE_COUNT; ++i)
+        this->Ages[i] = (Submitted[i] && !this->Scheduled[i]) ? this->Ages[i] + 1 : 0;
+}
+
+void shadow_scheduler::BeginUpdates()
+{
+    this->Timer.Begin(this->ScheduledFaces);
+}
+
+void shadow_scheduler::EndUpdates()
+{
+    this->Timer.End();
+}
+
+void shadow_scheduler::DisplayDebugUI()
+{
+    if (ImGui::TreeNodeEx("Shadow scheduler"))
+    {
+        ImGui::Checkbox("Time slicing", &this->Enabled);
+        ImGui::Checkbox("Budget in milliseconds", &this->UseTimeBudget);
+        if (this->UseTimeBudget)
+            ImGui::SliderFloat("Time budget (ms)", &this->TimeBudget, 0.1f, 8.f);
+        else
+            ImGui::SliderInt("Face budget", &this->FaceBudget, 1, shadow_atlas::MAX_TILE_COUNT);
+
+        ImGui::Text("Faces: %d drawn, %d requested", this->ScheduledFaces, this->SubmittedFaces);
+        ImGui::Text("GPU time per face: %.3f ms", this->MillisecondsPerFace);
+
+        ImGui::PlotLines("Shadow GPU time (ms)", this->TimeHistory, HISTORY_SIZE, this->HistoryIndex, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+        ImGui::PlotHistogram("Faces drawn", this->FaceHistory, HISTORY_SIZE, this->HistoryIndex, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+#include "opengl_helpers_query.h"
+#include "shadow_atlas.h"
+
+// Spreads the shadow updates over several frames. Every frame, the updates a demo needs (a group of
+// atlas tiles drawn together: a spot light, the six faces of a point light, a cascade) are ranked by
+// the screen contribution of their light times the frames they have been waiting, and only as many
+// faces as the budget allows are drawn. Distant lights are refreshed less often, lights out of view
+// are not submitted at all. The budget is a face count, or milliseconds converted to faces with the
+// GPU time measured per face.
+//
+// Updates of lights not drawn since created or edited, and of tiles without content, are required:
+// always drawn, their faces still taken from the budget.
+class shadow_scheduler
+{
+public:
+
+    //  Public Variable(s)
+    //  -------------------
+
+    static const int HISTORY_SIZE = 128;
+
+    bool Enabled = true;
+
+    // Faces drawn per frame at most (at least one update is always drawn)
+    int FaceBudget = 12;
+
+    // Use TimeBudget instead of FaceBudget
+    bool UseTimeBudget = false;
+    float TimeBudget = 1.f; // Milliseconds
+
+    //  Public Fuction(s)
+    //  ------------------
+
+    // Read the GPU timings and reset the updates of the frame
+    void BeginFrame();
+
+    // Submit the update of tiles FirstTile to FirstTile + FaceCount - 1, Contribution is in ]0, 1]
+    void AddUpdate(int FirstTile, int FaceCount, float Contribution, bool Required);
+
+    // Choose the updates of this frame
+    void Schedule();
+
+    bool IsScheduled(int FirstTile) const { return this->Scheduled[FirstTile]; }
+
+    // Around the shadow draws of the frame (GPU timer)
+    void BeginUpdates();
+    void EndUpdates();
+
+    // ImGui debug function (budget settings and shadow time/face history)
+    void DisplayDebugUI();
+
+private:
+
+    //  Private Variable(s)
+    //  -----------------------
+
+    struct update
+    {
+        int FirstTile;
+        int FaceCount;
+        float Priority;
+        bool Required;
+    };
+
+    std::vector<update> Updates;
+
+    // Frames since the last update, per first tile
+    int Ages[shadow_atlas::MAX_TILE_COUNT] = {};
+    bool Scheduled[shadow_atlas::MAX_TILE_COUNT] = {};
+    int ScheduledFaces = 0;
+    int SubmittedFaces = 0;
+
+    GL::gpu_timer Timer;
+    float MillisecondsPerFace = 0.f; // Running average, 0 until measured
+
+    // Last frames, for the profile graphs
+    float TimeHistory[HISTORY_SIZE] = {};
+    float FaceHistory[HISTORY_SIZE] = {};
+    int HistoryIndex = 0;
+};
@@ -24,7 +24,9 @@ struct v3
 };
 
 
-struct v4
+// 16-byte aligned on the stack and in structs. Heap storage may only be 8-byte aligned before C++17
+// (Win32), so the SIMD backends of maths.h use unaligned loads/stores.
+struct alignas(16) v4
 {
     union
     {
@@ -46,11 +48,39 @@ struct mat3
     };
 };
 
-struct mat4
+// Column-major, same alignment as v4 (each column is a v4)
+struct alignas(16) mat4
 {
     union
     {
         float e[16];
         v4 c[4];
     };
+};
+
+// Rotation quaternion, (x, y, z) is the vector part
+struct quat
+{
+    union
+    {
+        struct { float x, y, z, w; };
+        v3 xyz;
+        float e[4];
+    };
+};
+
+// Rigid transform (rotation + translation) as a dual quaternion
+struct dualquat
+{
+    quat Real;
+    quat Dual;
+};
+
+// Translation/rotation/scale, 40 bytes instead of the 64 of a mat4.
+// Applied as Translation * Rotation * Scale, like the usual model matrices.
+struct transform
+{
+    quat Rotation;
+    v3 Translation;
+    v3 Scale;
 };
\ No newline at end of file